@@ -0,0 +1,33 @@
+import React from 'react'
+
+import { NumberInput } from '@electricui/components-desktop-blueprint'
+
+type GainInputsProps = {
+  accessor: string // dg or pg, a kp, ki, kd array on the sub
+}
+
+const TERMS = ['Kp', 'Ki', 'Kd']
+
+//Edits one PID's gains. The sub picks them up on its next control update
+export const GainInputs = (props: GainInputsProps) => {
+  return (
+    <React.Fragment>
+      {TERMS.map((term, index) => (
+        <React.Fragment key={term}>
+          <h4>{term}</h4>
+          <NumberInput
+            accessor={state => state[props.accessor][index]}
+            writer={(state, value) => {
+              state[props.accessor][index] = value
+            }}
+            intent="primary"
+            min={0}
+            stepSize={1}
+            leftIcon="settings"
+            large
+          />
+        </React.Fragment>
+      ))}
+    </React.Fragment>
+  )
+}
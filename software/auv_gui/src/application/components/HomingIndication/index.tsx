@@ -0,0 +1,36 @@
+import React from 'react'
+
+import { Callout } from '@blueprintjs/core'
+import { useHardwareState } from '@electricui/components-core'
+
+type HomingIndicatorProps = {
+  accessor: string // bsh or psh
+}
+
+//Matches Mechanics::HomingPhase on the sub
+export const HomingIndicator = (props: HomingIndicatorProps) => {
+  const phase = useHardwareState(props.accessor)
+  if (phase == 0) {
+    return <Callout title="Not homing" intent="none"></Callout>
+  } else if (phase == 1) {
+    return <Callout title="Homing" intent="primary" icon="pulse">
+        Seeking the limit switch
+    </Callout>
+  } else if (phase == 2) {
+    return <Callout title="Homing" intent="primary" icon="pulse">
+        Backing off the limit switch
+    </Callout>
+  } else if (phase == 3) {
+    return <Callout title="Homing" intent="primary" icon="pulse">
+        Slow approach
+    </Callout>
+  } else if (phase == 4) {
+    return <Callout title="Homed" intent="success" icon="tick"></Callout>
+  } else if (phase == 5) {
+    return <Callout title="Homing failed" intent="danger" icon="error">
+        Check the limit switch
+    </Callout>
+  } else {
+    return <Callout title="Unknown" intent="danger" icon="error"></Callout>
+  }
+}
@@ -5,6 +5,8 @@ import { ProgressBar, Switch } from '@electricui/components-desktop-blueprint'
 import { MessageDataSource } from '@electricui/core-timeseries'
 import { Composition } from 'atomic-layout'
 import { StateIndicator } from 'src/application/components/StateIndication'
+import { HomingIndicator } from 'src/application/components/HomingIndication'
+import { GainInputs } from 'src/application/components/GainInputs'
 import { Statistic, Statistics } from '@electricui/components-desktop-blueprint'
 import { NumberInput } from '@electricui/components-desktop-blueprint'
 import { Popover } from '@blueprintjs/core'
@@ -65,6 +67,8 @@ export const MechanicsPage = (props: RouteComponentProps) => {
                     color={Colors.ORANGE5}
                   />
                 </Statistics>
+                <br></br>
+                <HomingIndicator accessor="bsh" />
               </Card>
               <StateIndicator />
 
@@ -174,6 +178,8 @@ export const MechanicsPage = (props: RouteComponentProps) => {
                     color={Colors.ORANGE5}
                   />
                 </Statistics>
+                <br></br>
+                <HomingIndicator accessor="psh" />
               </Card>
               <Card>
                 <Popover>
@@ -266,6 +272,20 @@ export const MechanicsPage = (props: RouteComponentProps) => {
                 </Popover>
 
                 <br></br>
+                <br></br>
+
+                <Popover>
+                  <BlueprintButton large intent="primary" icon="settings">
+                    Depth Control Gains
+                  </BlueprintButton>
+
+                  <div style={{ padding: '20px' }}>
+                    <h3>Depth (ballast half steps per m)</h3>
+                    <GainInputs accessor="dg" />
+                    <h3>Pitch (carriage half steps per degree)</h3>
+                    <GainInputs accessor="pg" />
+                  </div>
+                </Popover>
               </Card>
             </Areas.PControls>
 
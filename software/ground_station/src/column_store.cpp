@@ -0,0 +1,204 @@
+/**
+ * @file column_store.cpp
+ * @author Daniel Kim
+ * @brief Append-only columnar recording of every telemetry message
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "column_store.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace GroundStation
+{
+    namespace
+    {
+        template <typename T>
+        void put(std::vector<uint8_t> &buffer, T value)
+        {
+            const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        bool writeAll(int fd, const uint8_t *data, std::size_t len)
+        {
+            while (len > 0)
+            {
+                ssize_t written = ::write(fd, data, len);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                data += written;
+                len -= static_cast<std::size_t>(written);
+            }
+            return true;
+        }
+    }
+
+    ColumnStore::~ColumnStore()
+    {
+        close();
+    }
+
+    /**
+     * @brief Opens (or continues) a recording
+     * A new file gets a header; an existing file is appended to only if its header is this version's
+     *
+     * @param path file to record to
+     * @return true file is ready
+     * @return false file could not be opened, or is not a version 2 recording
+     */
+    bool ColumnStore::open(const std::string &path)
+    {
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (m_fd < 0)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> header = {'O', 'A', 'I', 'C'};
+        put<uint16_t>(header, VERSION);
+
+        struct stat info;
+        if (fstat(m_fd, &info) != 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+
+        if (info.st_size == 0)
+        {
+            return writeAll(m_fd, header.data(), header.size());
+        }
+
+        //Blocks of another version, or appended to something that isn't a recording, couldn't be read back
+        uint8_t existing[6];
+        if (::pread(m_fd, existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) ||
+            std::memcmp(existing, header.data(), sizeof(existing)) != 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Flushes buffered rows and closes the file
+     *
+     */
+    void ColumnStore::close()
+    {
+        if (m_fd < 0)
+        {
+            return;
+        }
+
+        flush();
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    /**
+     * @brief Adds one message to its column
+     *
+     * @param vehicle_id vehicle the message came from
+     * @param host_time_ns time the message was received on the host
+     * @param message decoded message
+     */
+    void ColumnStore::append(uint16_t vehicle_id, int64_t host_time_ns, const EUI::Message &message)
+    {
+        if (m_fd < 0)
+        {
+            return;
+        }
+
+        ColumnKey key(vehicle_id, message.name());
+        Column &column = m_columns[key];
+
+        //Arrays can change length between messages. A block only ever holds one width
+        if (!column.times.empty() && (column.value_size != message.payload_len || column.type != message.type))
+        {
+            writeBlock(key, column);
+        }
+
+        column.type = message.type;
+        column.value_size = message.payload_len;
+        column.times.push_back(host_time_ns);
+        column.values.insert(column.values.end(), message.payload, message.payload + message.payload_len);
+
+        if (column.times.size() >= ROWS_PER_BLOCK)
+        {
+            writeBlock(key, column);
+        }
+    }
+
+    /**
+     * @brief Writes every partially filled column to disk
+     *
+     * @return true all blocks were written
+     * @return false a write failed
+     */
+    bool ColumnStore::flush()
+    {
+        bool ok = true;
+        for (auto &entry : m_columns)
+        {
+            if (!entry.second.times.empty())
+            {
+                ok &= writeBlock(entry.first, entry.second);
+            }
+        }
+
+        if (m_fd >= 0)
+        {
+            ::fdatasync(m_fd);
+        }
+        return ok;
+    }
+
+    bool ColumnStore::writeBlock(const ColumnKey &key, Column &column)
+    {
+        const std::string &id = key.second;
+        uint32_t rows = static_cast<uint32_t>(column.times.size());
+
+        m_block.clear();
+        m_block.insert(m_block.end(), {'B', 'L', 'K', '2'});
+        put<uint16_t>(m_block, key.first);
+        put<uint8_t>(m_block, static_cast<uint8_t>(column.type));
+        put<uint8_t>(m_block, static_cast<uint8_t>(id.size()));
+        put<uint16_t>(m_block, column.value_size);
+        put<uint32_t>(m_block, rows);
+        m_block.insert(m_block.end(), id.begin(), id.end());
+
+        const uint8_t *times = reinterpret_cast<const uint8_t *>(column.times.data());
+        m_block.insert(m_block.end(), times, times + rows * sizeof(int64_t));
+        m_block.insert(m_block.end(), column.values.begin(), column.values.end());
+
+        column.times.clear();
+        column.values.clear();
+
+        if (!writeAll(m_fd, m_block.data(), m_block.size()))
+        {
+            return false;
+        }
+
+        m_rows_written += rows;
+        return true;
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * @file column_store.h
+ * @author Daniel Kim
+ * @brief Append-only columnar recording of every telemetry message
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "eui_frame.h"
+
+namespace GroundStation
+{
+    /**
+     * File layout (all integers little endian):
+     *   file header:  "OAIC" | uint16 version
+     *   block header: "BLK2" | uint16 vehicle_id | uint8 type | uint8 id_len | uint16 value_size | uint32 rows | id bytes
+     *   block body:   int64 host_time_ns[rows] | value bytes[rows * value_size]
+     *
+     * Each (vehicle, message id) pair is buffered as its own column and written out as a block once it holds
+     * ROWS_PER_BLOCK rows or when flush() is called. Blocks are only ever appended,
+     * so a crash loses at most the rows that had not been flushed yet.
+     */
+    class ColumnStore
+    {
+    public:
+        static constexpr uint16_t VERSION = 2;
+        static constexpr uint32_t ROWS_PER_BLOCK = 1024;
+
+        ColumnStore() {}
+        ~ColumnStore();
+
+        bool open(const std::string &path);
+        void close();
+
+        void append(uint16_t vehicle_id, int64_t host_time_ns, const EUI::Message &message);
+        bool flush();
+
+        uint64_t rowsWritten() const { return m_rows_written; }
+
+    private:
+        struct Column
+        {
+            EUI::Type type;
+            uint16_t value_size = 0;
+            std::vector<int64_t> times;
+            std::vector<uint8_t> values;
+        };
+
+        using ColumnKey = std::pair<uint16_t, std::string>;
+
+        bool writeBlock(const ColumnKey &key, Column &column);
+
+        int m_fd = -1;
+        std::map<ColumnKey, Column> m_columns;
+        std::vector<uint8_t> m_block; //reused staging buffer so each block is a single write
+        uint64_t m_rows_written = 0;
+    };
+}
+
+#endif
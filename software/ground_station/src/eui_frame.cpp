@@ -0,0 +1,269 @@
+/**
+ * @file eui_frame.cpp
+ * @author Daniel Kim
+ * @brief Zero-copy ElectricUI frame parser and encoder for the ground station
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "eui_frame.h"
+
+#include <cstring>
+
+namespace GroundStation
+{
+namespace EUI
+{
+    /**
+     * @brief CRC16-CCITT (0xFFFF seed) matching electricui-embedded
+     *
+     * @param data bytes to checksum
+     * @param len number of bytes
+     * @return uint16_t checksum
+     */
+    uint16_t crc16(const uint8_t *data, std::size_t len)
+    {
+        uint16_t crc = 0xFFFF;
+        for (std::size_t i = 0; i < len; i++)
+        {
+            crc = static_cast<uint16_t>((crc >> 8) | (crc << 8));
+            crc ^= data[i];
+            crc ^= static_cast<uint8_t>(crc & 0xFF) >> 4;
+            crc ^= static_cast<uint16_t>((crc << 8) << 4);
+            crc ^= static_cast<uint16_t>(((crc & 0xFF) << 4) << 1);
+        }
+        return crc;
+    }
+
+    FrameParser::FrameParser(std::size_t capacity) : m_buffer(capacity) {}
+
+    /**
+     * @brief Space the caller may read serial bytes into
+     * Compacts the buffer when the tail is exhausted
+     *
+     * @param available set to the number of writable bytes
+     * @return uint8_t* where to write
+     */
+    uint8_t *FrameParser::writable(std::size_t &available)
+    {
+        if (m_end == m_buffer.size())
+        {
+            if (m_begin == 0)
+            {
+                //A single frame filled the whole buffer. Nothing valid can be that long
+                m_dropped++;
+                m_begin = m_end = m_scan = 0;
+            }
+            else
+            {
+                std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+                m_end -= m_begin;
+                m_scan -= m_begin;
+                m_begin = 0;
+            }
+        }
+
+        available = m_buffer.size() - m_end;
+        return m_buffer.data() + m_end;
+    }
+
+    /**
+     * @brief Consumes bytes written into writable()
+     *
+     * @param received how many bytes were written
+     * @param callback called once per valid message
+     * @return std::size_t number of messages decoded
+     */
+    std::size_t FrameParser::commit(std::size_t received, const MessageCallback &callback)
+    {
+        m_end += received;
+
+        std::size_t decoded = 0;
+        uint8_t *base = m_buffer.data();
+
+        while (m_scan < m_end)
+        {
+            void *delim = std::memchr(base + m_scan, 0x00, m_end - m_scan);
+            if (delim == nullptr)
+            {
+                m_scan = m_end;
+                break;
+            }
+
+            std::size_t position = static_cast<uint8_t *>(delim) - base;
+            std::size_t len = position - m_begin;
+
+            //Back to back delimiters frame every packet, so empty frames are expected
+            if (len > 0 && decodeFrame(base + m_begin, len, callback))
+            {
+                decoded++;
+            }
+
+            m_begin = position + 1;
+            m_scan = m_begin;
+        }
+
+        if (m_begin == m_end)
+        {
+            m_begin = m_end = m_scan = 0;
+        }
+
+        return decoded;
+    }
+
+    /**
+     * @brief COBS decodes a frame in place and validates the ElectricUI packet
+     *
+     * @param frame encoded bytes without delimiters
+     * @param len length of the frame
+     * @param callback receives the message if it is valid
+     * @return true message was valid
+     * @return false message was malformed and dropped
+     */
+    bool FrameParser::decodeFrame(uint8_t *frame, std::size_t len, const MessageCallback &callback)
+    {
+        //COBS decoding never writes ahead of where it reads, so it can run in place
+        std::size_t read = 0;
+        std::size_t write = 0;
+        while (read < len)
+        {
+            uint8_t code = frame[read++];
+            if (code == 0 || read + code - 1 > len)
+            {
+                m_dropped++;
+                return false;
+            }
+
+            for (uint8_t i = 1; i < code; i++)
+            {
+                frame[write++] = frame[read++];
+            }
+
+            if (code < 0xFF && read < len)
+            {
+                frame[write++] = 0x00;
+            }
+        }
+
+        if (write < HEADER_SIZE + CRC_SIZE)
+        {
+            m_dropped++;
+            return false;
+        }
+
+        Message message;
+        uint16_t data_len = static_cast<uint16_t>(frame[0] | ((frame[1] & 0x03) << 8));
+        message.type = static_cast<Type>((frame[1] >> 2) & 0x0F);
+        message.internal = (frame[1] >> 6) & 0x01;
+        bool has_offset = (frame[1] >> 7) & 0x01;
+        message.id_len = frame[2] & 0x0F;
+        message.response = (frame[2] >> 4) & 0x01;
+        message.acknum = (frame[2] >> 5) & 0x07;
+
+        std::size_t expected = HEADER_SIZE + message.id_len + (has_offset ? 2 : 0) + data_len + CRC_SIZE;
+        if (expected != write)
+        {
+            m_dropped++;
+            return false;
+        }
+
+        uint16_t crc = static_cast<uint16_t>(frame[write - 2] | (frame[write - 1] << 8));
+        if (crc != crc16(frame, write - CRC_SIZE))
+        {
+            m_dropped++;
+            return false;
+        }
+
+        std::size_t position = HEADER_SIZE;
+        message.id = reinterpret_cast<const char *>(frame + position);
+        position += message.id_len;
+
+        message.offset = 0;
+        if (has_offset)
+        {
+            message.offset = static_cast<uint16_t>(frame[position] | (frame[position + 1] << 8));
+            position += 2;
+        }
+
+        message.payload = frame + position;
+        message.payload_len = data_len;
+
+        m_frames++;
+        callback(message);
+        return true;
+    }
+
+    /**
+     * @brief Encodes one ElectricUI message as a delimited COBS frame
+     *
+     * @param id message identifier (max 15 characters)
+     * @param type payload type
+     * @param payload payload bytes
+     * @param payload_len size of the payload
+     * @param out frame is appended here
+     * @return std::size_t number of bytes appended, 0 if the message is too large
+     */
+    std::size_t encode(const char *id, Type type, const void *payload, uint16_t payload_len, std::vector<uint8_t> &out)
+    {
+        std::size_t id_len = std::strlen(id);
+        if (id_len == 0 || id_len > MAX_ID_LEN || payload_len > MAX_PAYLOAD_LEN)
+        {
+            return 0;
+        }
+
+        uint8_t packet[HEADER_SIZE + MAX_ID_LEN + MAX_PAYLOAD_LEN + CRC_SIZE];
+        std::size_t len = 0;
+
+        packet[len++] = payload_len & 0xFF;
+        packet[len++] = static_cast<uint8_t>((payload_len >> 8) | (static_cast<uint8_t>(type) << 2));
+        packet[len++] = static_cast<uint8_t>(id_len);
+
+        std::memcpy(packet + len, id, id_len);
+        len += id_len;
+
+        std::memcpy(packet + len, payload, payload_len);
+        len += payload_len;
+
+        uint16_t crc = crc16(packet, len);
+        packet[len++] = crc & 0xFF;
+        packet[len++] = crc >> 8;
+
+        std::size_t start = out.size();
+        out.push_back(0x00);
+
+        //COBS encode, one code byte per run of up to 254 non-zero bytes
+        std::size_t code_index = out.size();
+        out.push_back(0);
+        uint8_t code = 1;
+        for (std::size_t i = 0; i < len; i++)
+        {
+            if (packet[i] == 0x00)
+            {
+                out[code_index] = code;
+                code_index = out.size();
+                out.push_back(0);
+                code = 1;
+            }
+            else
+            {
+                out.push_back(packet[i]);
+                code++;
+                if (code == 0xFF)
+                {
+                    out[code_index] = code;
+                    code_index = out.size();
+                    out.push_back(0);
+                    code = 1;
+                }
+            }
+        }
+        out[code_index] = code;
+        out.push_back(0x00);
+
+        return out.size() - start;
+    }
+}
+}
@@ -0,0 +1,106 @@
+/**
+ * @file eui_frame.h
+ * @author Daniel Kim
+ * @brief Zero-copy ElectricUI frame parser and encoder for the ground station
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef EUI_FRAME_H
+#define EUI_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace GroundStation
+{
+namespace EUI
+{
+    /**
+     * @brief Type codes used by electricui-embedded in the packet header
+     *
+     */
+    enum class Type : uint8_t
+    {
+        CALLBACK = 0,
+        CUSTOM = 1,
+        OFFSET_METADATA = 2,
+        BYTE = 3,
+        CHAR = 4,
+        INT8 = 5,
+        UINT8 = 6,
+        INT16 = 7,
+        UINT16 = 8,
+        INT32 = 9,
+        UINT32 = 10,
+        FLOAT = 11,
+        DOUBLE = 12,
+    };
+
+    constexpr std::size_t HEADER_SIZE = 3;
+    constexpr std::size_t CRC_SIZE = 2;
+    constexpr std::size_t MAX_ID_LEN = 15;
+    constexpr std::size_t MAX_PAYLOAD_LEN = 1023; // 10 bit length field
+
+    /**
+     * @brief View of one decoded message
+     * Pointers refer to the parser's buffer and are only valid inside the callback
+     */
+    struct Message
+    {
+        const char *id;
+        uint8_t id_len;
+        Type type;
+        bool internal;
+        bool response;
+        uint8_t acknum;
+        uint16_t offset;
+        const uint8_t *payload;
+        uint16_t payload_len;
+
+        std::string name() const { return std::string(id, id_len); }
+    };
+
+    using MessageCallback = std::function<void(const Message &)>;
+
+    uint16_t crc16(const uint8_t *data, std::size_t len);
+
+    /**
+     * @brief Splits a COBS byte stream into ElectricUI messages without copying
+     * Callers read directly into writable(), then commit() the bytes they received.
+     * Frames are COBS decoded in place and handed out as views into the same buffer
+     */
+    class FrameParser
+    {
+    public:
+        explicit FrameParser(std::size_t capacity = 64 * 1024);
+
+        uint8_t *writable(std::size_t &available);
+        std::size_t commit(std::size_t received, const MessageCallback &callback);
+
+        uint64_t framesDecoded() const { return m_frames; }
+        uint64_t framesDropped() const { return m_dropped; }
+
+    private:
+        bool decodeFrame(uint8_t *frame, std::size_t len, const MessageCallback &callback);
+
+        std::vector<uint8_t> m_buffer;
+        std::size_t m_begin = 0; // first byte of the frame currently being assembled
+        std::size_t m_end = 0;   // one past the last received byte
+        std::size_t m_scan = 0;  // where the delimiter search resumes
+
+        uint64_t m_frames = 0;
+        uint64_t m_dropped = 0;
+    };
+
+    std::size_t encode(const char *id, Type type, const void *payload, uint16_t payload_len, std::vector<uint8_t> &out);
+}
+}
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file event_loop.cpp
+ * @author Daniel Kim
+ * @brief epoll event loop shared by every serial link and client socket
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "event_loop.h"
+
+#include <cerrno>
+
+#include <unistd.h>
+
+namespace GroundStation
+{
+    EventLoop::EventLoop() : m_events(64)
+    {
+        m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    }
+
+    EventLoop::~EventLoop()
+    {
+        if (m_epoll_fd >= 0)
+        {
+            ::close(m_epoll_fd);
+        }
+    }
+
+    /**
+     * @brief Starts watching a file descriptor
+     *
+     * @param fd descriptor to watch
+     * @param events epoll event mask (EPOLLIN, EPOLLOUT...)
+     * @param handler called with the ready events
+     * @return true fd registered
+     * @return false epoll_ctl failed
+     */
+    bool EventLoop::add(int fd, uint32_t events, Handler handler)
+    {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+
+        if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            return false;
+        }
+
+        m_handlers[fd] = std::make_shared<Handler>(std::move(handler));
+        return true;
+    }
+
+    bool EventLoop::modify(int fd, uint32_t events)
+    {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+
+        return ::epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0;
+    }
+
+    /**
+     * @brief Stops watching a file descriptor. Call before closing it
+     *
+     */
+    void EventLoop::remove(int fd)
+    {
+        ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        m_handlers.erase(fd);
+    }
+
+    /**
+     * @brief Waits for events and dispatches them
+     *
+     * @param timeout_ms how long to wait, -1 waits forever
+     * @return int number of events dispatched, -1 on error
+     */
+    int EventLoop::runOnce(int timeout_ms)
+    {
+        int ready = ::epoll_wait(m_epoll_fd, m_events.data(), static_cast<int>(m_events.size()), timeout_ms);
+        if (ready < 0)
+        {
+            return errno == EINTR ? 0 : -1;
+        }
+
+        for (int i = 0; i < ready; i++)
+        {
+            auto it = m_handlers.find(m_events[i].data.fd);
+            if (it == m_handlers.end())
+            {
+                continue; //removed by an earlier handler in this batch
+            }
+
+            //Hold a reference so the handler survives removing itself
+            std::shared_ptr<Handler> handler = it->second;
+            (*handler)(m_events[i].events);
+        }
+
+        return ready;
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * @file event_loop.h
+ * @author Daniel Kim
+ * @brief epoll event loop shared by every serial link and client socket
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+
+namespace GroundStation
+{
+    /**
+     * @brief Dispatches readiness events to per-fd handlers
+     * Handlers may add or remove fds (including their own) while being called
+     */
+    class EventLoop
+    {
+    public:
+        using Handler = std::function<void(uint32_t events)>;
+
+        EventLoop();
+        ~EventLoop();
+
+        bool add(int fd, uint32_t events, Handler handler);
+        bool modify(int fd, uint32_t events);
+        void remove(int fd);
+
+        int runOnce(int timeout_ms);
+
+    private:
+        int m_epoll_fd = -1;
+        std::unordered_map<int, std::shared_ptr<Handler>> m_handlers;
+        std::vector<epoll_event> m_events;
+    };
+}
+
+#endif
@@ -0,0 +1,487 @@
+/**
+ * @file file_transfer.cpp
+ * @author Daniel Kim
+ * @brief Host side of the SD card download protocol (see sub_driver/src/Data/FileTransfer.h)
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "file_transfer.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace GroundStation
+{
+namespace FileTransfer
+{
+    static constexpr std::size_t HEADER_SIZE = 5; // type + seq
+    static constexpr std::size_t CRC_SIZE = 4;
+    static constexpr int REPLY_TIMEOUT_MS = 2000;
+    static constexpr int STALL_ACK_MS = 200; // repeat the last ACK if the vehicle goes quiet, in case it was lost
+    static constexpr int DONE_ATTEMPTS = 3; // final ACKs sent while waiting for DONE before falling back to ABORT
+
+    static std::array<uint32_t, 256> makeCrcTable()
+    {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    uint32_t crc32(const uint8_t *data, std::size_t len)
+    {
+        static const std::array<uint32_t, 256> table = makeCrcTable();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (std::size_t i = 0; i < len; i++)
+        {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    static void putU32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 24));
+    }
+
+    static uint32_t getU32(const uint8_t *data)
+    {
+        return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+               (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    /**
+     * @brief COBS decodes a frame in place
+     *
+     * @return std::size_t decoded length, 0 if the frame is malformed
+     */
+    static std::size_t cobsDecode(uint8_t *frame, std::size_t len)
+    {
+        std::size_t read = 0;
+        std::size_t write = 0;
+        while (read < len)
+        {
+            uint8_t code = frame[read++];
+            if (code == 0 || read + code - 1 > len)
+            {
+                return 0;
+            }
+            for (uint8_t i = 1; i < code; i++)
+            {
+                frame[write++] = frame[read++];
+            }
+            if (code < 0xFF && read < len)
+            {
+                frame[write++] = 0x00;
+            }
+        }
+        return write;
+    }
+
+    bool Client::send(PacketType type, uint32_t seq, const std::vector<uint8_t> &payload)
+    {
+        std::vector<uint8_t> packet;
+        packet.reserve(HEADER_SIZE + payload.size() + CRC_SIZE);
+        packet.push_back(static_cast<uint8_t>(type));
+        putU32(packet, seq);
+        packet.insert(packet.end(), payload.begin(), payload.end());
+        putU32(packet, crc32(packet.data(), packet.size()));
+
+        std::vector<uint8_t> encoded;
+        encoded.reserve(packet.size() + packet.size() / 254 + 3);
+        encoded.push_back(0x00);
+        std::size_t code_index = encoded.size();
+        encoded.push_back(0);
+        uint8_t code = 1;
+        for (uint8_t byte : packet)
+        {
+            if (byte == 0x00)
+            {
+                encoded[code_index] = code;
+                code_index = encoded.size();
+                encoded.push_back(0);
+                code = 1;
+                continue;
+            }
+
+            encoded.push_back(byte);
+            if (++code == 0xFF)
+            {
+                encoded[code_index] = code;
+                code_index = encoded.size();
+                encoded.push_back(0);
+                code = 1;
+            }
+        }
+        encoded[code_index] = code;
+        encoded.push_back(0x00);
+
+        if (!m_link.write(encoded.data(), encoded.size()))
+        {
+            m_error = "link closed";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Waits for the next valid packet. Corrupt frames are dropped silently
+     *
+     * @return false on timeout, or with error() set if the link closed
+     */
+    bool Client::receive(Packet &packet, int timeout_ms)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+        while (true)
+        {
+            auto delimiter = std::find(m_rx.begin(), m_rx.end(), 0x00);
+            if (delimiter != m_rx.end())
+            {
+                m_frame.assign(m_rx.begin(), delimiter);
+                m_rx.erase(m_rx.begin(), delimiter + 1);
+
+                std::size_t len = cobsDecode(m_frame.data(), m_frame.size());
+                if (len < HEADER_SIZE + CRC_SIZE || crc32(m_frame.data(), len - CRC_SIZE) != getU32(m_frame.data() + len - CRC_SIZE))
+                {
+                    continue;
+                }
+
+                packet.type = static_cast<PacketType>(m_frame[0]);
+                packet.seq = getU32(m_frame.data() + 1);
+                packet.payload.assign(m_frame.begin() + HEADER_SIZE, m_frame.begin() + (len - CRC_SIZE));
+                return true;
+            }
+
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0 || m_cancelled)
+            {
+                return false;
+            }
+
+            pollfd pfd = {m_link.fd(), POLLIN, 0};
+            if (::poll(&pfd, 1, static_cast<int>(remaining)) <= 0)
+            {
+                continue;
+            }
+
+            uint8_t buffer[16 * 1024];
+            ssize_t received = m_link.read(buffer, sizeof(buffer));
+            if (received < 0)
+            {
+                m_error = "link closed";
+                return false;
+            }
+            m_rx.insert(m_rx.end(), buffer, buffer + received);
+        }
+    }
+
+    bool Client::list(std::vector<Entry> &entries)
+    {
+        m_error.clear();
+        if (!send(PacketType::LIST, 0, {}))
+        {
+            return false;
+        }
+
+        Packet packet;
+        while (receive(packet, REPLY_TIMEOUT_MS))
+        {
+            if (packet.type == PacketType::LIST_ENTRY && packet.payload.size() >= 4)
+            {
+                entries.push_back({std::string(packet.payload.begin() + 4, packet.payload.end()), getU32(packet.payload.data())});
+            }
+            else if (packet.type == PacketType::LIST_END)
+            {
+                return true;
+            }
+            else if (packet.type == PacketType::ERROR)
+            {
+                m_error = "vehicle error " + std::to_string(packet.payload.empty() ? 0 : packet.payload[0]);
+                return false;
+            }
+        }
+
+        if (m_error.empty())
+        {
+            m_error = "no reply to LIST";
+        }
+        return false;
+    }
+
+    bool Client::stat(const std::string &name, bool &exists, uint32_t &size)
+    {
+        m_error.clear();
+        if (!send(PacketType::STAT, 0, std::vector<uint8_t>(name.begin(), name.end())))
+        {
+            return false;
+        }
+
+        Packet packet;
+        while (receive(packet, REPLY_TIMEOUT_MS))
+        {
+            if (packet.type == PacketType::STAT_REPLY && packet.payload.size() >= 5)
+            {
+                exists = packet.payload[0] != 0;
+                size = getU32(packet.payload.data() + 1);
+                return true;
+            }
+            if (packet.type == PacketType::ERROR)
+            {
+                m_error = "vehicle error " + std::to_string(packet.payload.empty() ? 0 : packet.payload[0]);
+                return false;
+            }
+        }
+
+        if (m_error.empty())
+        {
+            m_error = "no reply to STAT";
+        }
+        return false;
+    }
+
+    /**
+     * @brief Cumulative base plus a bitmap of the 32 chunks after it
+     *
+     */
+    bool Client::sendAck(uint32_t base, const std::vector<bool> &received)
+    {
+        uint32_t bitmap = 0;
+        for (uint32_t i = 0; i < 32 && base + 1 + i < received.size(); i++)
+        {
+            if (received[base + 1 + i])
+            {
+                bitmap |= 1u << i;
+            }
+        }
+
+        std::vector<uint8_t> payload;
+        putU32(payload, base);
+        putU32(payload, bitmap);
+        return send(PacketType::ACK, 0, payload);
+    }
+
+    /**
+     * @brief Waits for DONE after the last chunk. The vehicle sends it once, and again for each ACK
+     * of the finished read, so a lost DONE or final ACK costs a retry instead of the download.
+     * If it never comes the read is aborted so the vehicle stops resending its window
+     *
+     */
+    void Client::confirmDone(uint32_t base, const std::vector<bool> &received)
+    {
+        using clock = std::chrono::steady_clock;
+
+        for (int attempt = 0; attempt < DONE_ATTEMPTS; attempt++)
+        {
+            auto deadline = clock::now() + std::chrono::milliseconds(STALL_ACK_MS);
+            Packet packet;
+            while (clock::now() < deadline)
+            {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+                if (receive(packet, static_cast<int>(std::max<int64_t>(remaining, 1))) && packet.type == PacketType::DONE)
+                {
+                    return;
+                }
+                if (!m_error.empty())
+                {
+                    m_error.clear(); //the file is complete, a closed link doesn't change that
+                    return;
+                }
+            }
+            sendAck(base, received);
+        }
+
+        send(PacketType::ABORT, 0, {});
+        m_error.clear();
+    }
+
+    /**
+     * @brief Downloads a file, resuming from the end of an existing partial copy at destination
+     *
+     */
+    bool Client::download(const std::string &name, const std::string &destination, const ProgressCallback &progress)
+    {
+        using clock = std::chrono::steady_clock;
+
+        bool exists = false;
+        uint32_t size = 0;
+        if (!stat(name, exists, size))
+        {
+            return false;
+        }
+        if (!exists)
+        {
+            m_error = name + " not found on the vehicle";
+            return false;
+        }
+
+        int fd = ::open(destination.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            m_error = "cannot open " + destination;
+            return false;
+        }
+
+        struct stat local;
+        fstat(fd, &local);
+        if (static_cast<uint64_t>(local.st_size) > size)
+        {
+            ::close(fd);
+            m_error = destination + " is larger than the file on the vehicle";
+            return false;
+        }
+
+        //Pin the length: the vehicle may still be appending to the file
+        uint32_t start = static_cast<uint32_t>(local.st_size);
+        uint32_t length = size - start;
+        uint32_t count = static_cast<uint32_t>((length + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+        if (progress)
+        {
+            progress(start, size);
+        }
+        if (count == 0)
+        {
+            ::close(fd);
+            return true;
+        }
+
+        std::vector<uint8_t> request;
+        putU32(request, start);
+        putU32(request, length);
+        request.insert(request.end(), name.begin(), name.end());
+        if (!send(PacketType::READ, 0, request))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        std::vector<bool> received(count, false);
+        uint32_t base = 0;
+        uint32_t highest = 0;
+        int since_ack = 0;
+        bool complete = false;
+        auto last_ack = clock::now();
+        auto last_data = clock::now();
+
+        while (!complete && !m_cancelled)
+        {
+            Packet packet;
+            bool got = receive(packet, ACK_INTERVAL_MS);
+            auto now = clock::now();
+
+            if (got && packet.type == PacketType::DATA && packet.payload.size() >= 4 && packet.seq < count)
+            {
+                uint32_t offset = getU32(packet.payload.data());
+                std::size_t bytes = packet.payload.size() - 4;
+
+                if (received[packet.seq] || packet.seq < highest)
+                {
+                    m_retransmits++;
+                }
+
+                if (!received[packet.seq] && offset == start + packet.seq * CHUNK_SIZE)
+                {
+                    if (pwrite(fd, packet.payload.data() + 4, bytes, offset) != static_cast<ssize_t>(bytes))
+                    {
+                        m_error = "write to " + destination + " failed";
+                        break;
+                    }
+                    received[packet.seq] = true;
+                    highest = std::max(highest, packet.seq);
+                    while (base < count && received[base])
+                    {
+                        base++;
+                    }
+                    if (progress)
+                    {
+                        progress(start + std::min<uint64_t>(static_cast<uint64_t>(base) * CHUNK_SIZE, length), size);
+                    }
+                }
+
+                last_data = now;
+                since_ack++;
+
+                //ACK right away when a gap shows up or the last chunk lands
+                if (base == count || packet.seq > base || since_ack >= ACK_EVERY_CHUNKS)
+                {
+                    sendAck(base, received);
+                    since_ack = 0;
+                    last_ack = now;
+                }
+
+                //Every byte is on disk. DONE only confirms the vehicle saw the last ACK, see confirmDone
+                complete = base == count;
+            }
+            else if (got && packet.type == PacketType::ERROR)
+            {
+                m_error = "vehicle error " + std::to_string(packet.payload.empty() ? 0 : packet.payload[0]);
+                break;
+            }
+            else if (!got && !m_error.empty())
+            {
+                break; //link closed
+            }
+
+            if ((since_ack > 0 && now - last_ack >= std::chrono::milliseconds(ACK_INTERVAL_MS)) ||
+                now - last_ack >= std::chrono::milliseconds(STALL_ACK_MS))
+            {
+                sendAck(base, received);
+                since_ack = 0;
+                last_ack = now;
+            }
+
+            if (now - last_data >= std::chrono::milliseconds(IDLE_TIMEOUT_MS))
+            {
+                m_error = "timed out waiting for data";
+                break;
+            }
+        }
+
+        if (complete)
+        {
+            confirmDone(base, received);
+        }
+        else
+        {
+            if (m_error.empty())
+            {
+                m_error = "cancelled";
+            }
+            send(PacketType::ABORT, 0, {});
+
+            //Keep only the contiguous prefix so the next download resumes from the right place
+            uint64_t contiguous = start + std::min<uint64_t>(static_cast<uint64_t>(base) * CHUNK_SIZE, length);
+            if (ftruncate(fd, static_cast<off_t>(contiguous)) != 0)
+            {
+                m_error += ", and truncating the partial file failed";
+            }
+        }
+
+        ::close(fd);
+        return complete;
+    }
+}
+}
@@ -0,0 +1,104 @@
+/**
+ * @file file_transfer.h
+ * @author Daniel Kim
+ * @brief Host side of the SD card download protocol (see sub_driver/src/Data/FileTransfer.h)
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef FILE_TRANSFER_H
+#define FILE_TRANSFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "serial_link.h"
+
+namespace GroundStation
+{
+    namespace FileTransfer
+    {
+        //Mirrors the firmware definitions
+        enum class PacketType : uint8_t
+        {
+            LIST = 0x01,
+            STAT = 0x02,
+            READ = 0x03,
+            ACK = 0x04,
+            ABORT = 0x05,
+
+            LIST_ENTRY = 0x81,
+            LIST_END = 0x82,
+            STAT_REPLY = 0x83,
+            DATA = 0x84,
+            DONE = 0x85,
+            ERROR = 0x86,
+        };
+
+        constexpr std::size_t CHUNK_SIZE = 1024;
+        constexpr int ACK_EVERY_CHUNKS = 8; // cumulative ACK cadence while data arrives in order
+        constexpr int ACK_INTERVAL_MS = 10;
+        constexpr int IDLE_TIMEOUT_MS = 5000; // give up (and keep the partial file for resuming) after this long without data
+
+        uint32_t crc32(const uint8_t *data, std::size_t len);
+
+        struct Entry
+        {
+            std::string name;
+            uint32_t size;
+        };
+
+        struct Packet
+        {
+            PacketType type;
+            uint32_t seq;
+            std::vector<uint8_t> payload;
+        };
+
+        using ProgressCallback = std::function<void(uint64_t received, uint64_t total)>;
+
+        /**
+         * @brief Talks to the vehicle's file transfer port
+         * Downloads write each chunk at its own offset, so out of order and retransmitted chunks
+         * land in place. On failure the file is truncated to the last contiguous byte so the
+         * next download resumes from there.
+         */
+        class Client
+        {
+        public:
+            explicit Client(SerialLink &link) : m_link(link) {}
+
+            bool list(std::vector<Entry> &entries);
+            bool stat(const std::string &name, bool &exists, uint32_t &size);
+            bool download(const std::string &name, const std::string &destination, const ProgressCallback &progress = nullptr);
+
+            void cancel() { m_cancelled = true; } //safe to call from a signal handler
+
+            const std::string &error() const { return m_error; }
+
+            uint64_t retransmits() const { return m_retransmits; }
+
+        private:
+            bool send(PacketType type, uint32_t seq, const std::vector<uint8_t> &payload);
+            bool receive(Packet &packet, int timeout_ms);
+            bool sendAck(uint32_t base, const std::vector<bool> &received);
+            void confirmDone(uint32_t base, const std::vector<bool> &received);
+
+            SerialLink &m_link;
+            std::vector<uint8_t> m_rx;   //raw bytes not yet split into frames
+            std::vector<uint8_t> m_frame;
+            std::string m_error;
+            uint64_t m_retransmits = 0;
+            std::atomic<bool> m_cancelled{false};
+        };
+    }
+}
+
+#endif
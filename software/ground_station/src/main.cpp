@@ -0,0 +1,242 @@
+/**
+ * @file main.cpp
+ * @author Daniel Kim
+ * @brief Ground station daemon: owns the serial port, records everything and republishes it
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "column_store.h"
+#include "event_loop.h"
+#include "serial_link.h"
+#include "stream_merger.h"
+#include "vehicle_session.h"
+
+using namespace GroundStation;
+
+static volatile std::sig_atomic_t running = 1;
+
+static void stop(int)
+{
+    running = 0;
+}
+
+static void usage(const char *name)
+{
+    std::cout << "Usage: " << name << " [options]" << std::endl;
+    std::cout << "  --vehicle <id>:<path>      add a vehicle on a serial device (repeatable)" << std::endl;
+    std::cout << "  --vehicle <id>:fake:<hz>   add a fake vehicle sending at <hz>" << std::endl;
+    std::cout << "  --port <path>              shorthand for --vehicle 0:<path> (default /dev/ttyACM0)" << std::endl;
+    std::cout << "  --fake <hz>                shorthand for --vehicle 0:fake:<hz>" << std::endl;
+    std::cout << "  --baud <rate>              baud rate (default 2000000)" << std::endl;
+    std::cout << "  --record <path>            columnar recording (default telemetry.oaic)" << std::endl;
+    std::cout << "  --socket <path>            unix socket for clients (default /tmp/oceanai.sock)" << std::endl;
+    std::cout << "                             with several vehicles, each gets <path>.<id>" << std::endl;
+}
+
+struct VehicleSpec
+{
+    uint16_t id;
+    std::string path; //empty for a fake vehicle
+    double fake_rate;
+};
+
+/**
+ * @brief Parses "<id>:<path>" or "<id>:fake:<hz>"
+ *
+ */
+static bool parseVehicle(const std::string &arg, VehicleSpec &spec)
+{
+    std::size_t colon = arg.find(':');
+    if (colon == std::string::npos || colon == 0)
+    {
+        return false;
+    }
+
+    std::string rest = arg.substr(colon + 1);
+    spec.fake_rate = 0.0;
+    spec.path.clear();
+
+    try
+    {
+        spec.id = static_cast<uint16_t>(std::stoul(arg.substr(0, colon)));
+        if (rest.compare(0, 5, "fake:") == 0)
+        {
+            spec.fake_rate = std::stod(rest.substr(5));
+            return spec.fake_rate > 0.0 && std::isfinite(spec.fake_rate); //a rate of 0 would be an infinite period
+        }
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+
+    spec.path = rest;
+    return !spec.path.empty();
+}
+
+int main(int argc, char const *argv[])
+{
+    std::vector<VehicleSpec> specs;
+    int baud = 2000000;
+    std::string record_path = "telemetry.oaic";
+    std::string socket_path = "/tmp/oceanai.sock";
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        VehicleSpec spec;
+
+        if (arg == "--vehicle" && has_value && parseVehicle(argv[i + 1], spec))
+        {
+            specs.push_back(spec);
+            i++;
+        }
+        else if (arg == "--port" && has_value)
+        {
+            specs.push_back({0, argv[++i], 0.0});
+        }
+        else if (arg == "--fake" && has_value && parseVehicle(std::string("0:fake:") + argv[i + 1], spec))
+        {
+            specs.push_back(spec);
+            i++;
+        }
+        else if (arg == "--baud" && has_value)
+        {
+            baud = std::stoi(argv[++i]);
+        }
+        else if (arg == "--record" && has_value)
+        {
+            record_path = argv[++i];
+        }
+        else if (arg == "--socket" && has_value)
+        {
+            socket_path = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (specs.empty())
+    {
+        specs.push_back({0, "/dev/ttyACM0", 0.0});
+    }
+
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
+
+    ColumnStore store;
+    if (!store.open(record_path))
+    {
+        std::cout << "Error opening " << record_path << " (existing files must be version " << ColumnStore::VERSION << " recordings)" << std::endl;
+        return 1;
+    }
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<VehicleSession>> sessions;
+
+    for (const VehicleSpec &spec : specs)
+    {
+        std::unique_ptr<SerialLink> link;
+        if (spec.path.empty())
+        {
+            auto fake = std::make_unique<FakeSerial>(spec.fake_rate);
+            if (!fake->open())
+            {
+                std::cout << "Error creating fake vehicle " << spec.id << std::endl;
+                return 1;
+            }
+            link = std::move(fake);
+        }
+        else
+        {
+            auto serial = std::make_unique<SerialPort>();
+            if (!serial->open(spec.path, baud))
+            {
+                std::cout << "Error opening " << spec.path << ": " << std::strerror(errno) << std::endl;
+                return 1;
+            }
+            link = std::move(serial);
+        }
+
+        std::string path = specs.size() == 1 ? socket_path : socket_path + "." + std::to_string(spec.id);
+
+        auto session = std::make_unique<VehicleSession>(spec.id, std::move(link));
+        if (!session->start(loop, path))
+        {
+            std::cout << "Error starting vehicle " << spec.id << " on " << path << std::endl;
+            return 1;
+        }
+
+        std::cout << "Vehicle " << spec.id << " publishing on " << path << std::endl;
+        sessions.push_back(std::move(session));
+    }
+
+    std::vector<VehicleSession *> session_ptrs;
+    for (auto &session : sessions)
+    {
+        session_ptrs.push_back(session.get());
+    }
+
+    StreamMerger merger(store, session_ptrs);
+    merger.start();
+
+    std::cout << "Recording to " << record_path << std::endl;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (running)
+    {
+        if (loop.runOnce(100) < 0)
+        {
+            break;
+        }
+
+        bool any_connected = false;
+        for (auto &session : sessions)
+        {
+            any_connected |= session->connected();
+        }
+        if (!any_connected)
+        {
+            break;
+        }
+    }
+
+    for (auto &session : sessions)
+    {
+        session->stop();
+    }
+    merger.stop();
+    store.close();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    for (auto &session : sessions)
+    {
+        std::cout << "Vehicle " << session->id() << ": frames decoded: " << session->framesDecoded()
+                  << " dropped: " << session->framesDropped()
+                  << " (" << session->framesDecoded() / elapsed << " frames/s, "
+                  << session->bytesReceived() / elapsed / 1e6 << " MB/s)" << std::endl;
+    }
+    std::cout << "Rows recorded: " << store.rowsWritten() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file publisher.cpp
+ * @author Daniel Kim
+ * @brief Fans the vehicle byte stream out to local clients over a Unix socket
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "publisher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace GroundStation
+{
+    Publisher::~Publisher()
+    {
+        for (auto &entry : m_clients)
+        {
+            m_loop.remove(entry.first);
+            ::close(entry.first);
+        }
+
+        if (m_listen_fd >= 0)
+        {
+            m_loop.remove(m_listen_fd);
+            ::close(m_listen_fd);
+            ::unlink(m_path.c_str());
+        }
+    }
+
+    /**
+     * @brief Creates the socket clients connect to
+     *
+     * @param path filesystem path of the socket. A stale socket from a previous run is replaced
+     * @return true listening
+     * @return false socket could not be created
+     */
+    bool Publisher::listen(const std::string &path)
+    {
+        sockaddr_un address = {};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+
+        m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (m_listen_fd < 0)
+        {
+            return false;
+        }
+
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+        ::unlink(path.c_str());
+        if (::bind(m_listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            return false;
+        }
+
+        if (::listen(m_listen_fd, 16) != 0)
+        {
+            return false;
+        }
+
+        m_path = path;
+        return m_loop.add(m_listen_fd, EPOLLIN, [this](uint32_t) { accept(); });
+    }
+
+    /**
+     * @brief Queues bytes from the vehicle for every client
+     *
+     * @param data bytes as received from the serial link
+     * @param len number of bytes
+     */
+    void Publisher::broadcast(const uint8_t *data, std::size_t len)
+    {
+        std::vector<int> slow;
+        for (auto &entry : m_clients)
+        {
+            Client &client = entry.second;
+            if (client.outgoing.size() + len > MAX_PENDING_BYTES)
+            {
+                slow.push_back(entry.first); //too slow to keep up
+                continue;
+            }
+
+            bool was_empty = client.outgoing.empty();
+            client.outgoing.insert(client.outgoing.end(), data, data + len);
+            if (!flushClient(entry.first, client))
+            {
+                slow.push_back(entry.first);
+            }
+            else if (was_empty && !client.outgoing.empty())
+            {
+                m_loop.modify(entry.first, EPOLLIN | EPOLLOUT);
+            }
+        }
+
+        for (int fd : slow)
+        {
+            closeClient(fd);
+        }
+    }
+
+    void Publisher::accept()
+    {
+        while (true)
+        {
+            int fd = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0)
+            {
+                return;
+            }
+
+            m_clients[fd] = Client();
+            m_loop.add(fd, EPOLLIN, [this, fd](uint32_t events) {
+                auto it = m_clients.find(fd);
+                if (it == m_clients.end())
+                {
+                    return;
+                }
+
+                bool ok = !(events & (EPOLLERR | EPOLLHUP));
+                if (ok && (events & EPOLLIN))
+                {
+                    ok = readClient(fd, it->second);
+                }
+                if (ok && (events & EPOLLOUT))
+                {
+                    ok = flushClient(fd, it->second);
+                    if (ok && it->second.outgoing.empty())
+                    {
+                        m_loop.modify(fd, EPOLLIN);
+                    }
+                }
+
+                if (!ok)
+                {
+                    closeClient(fd);
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief Sends as much queued data as the socket accepts
+     *
+     * @return true client is healthy
+     * @return false client must be closed
+     */
+    bool Publisher::flushClient(int fd, Client &client)
+    {
+        uint8_t chunk[16 * 1024];
+        while (!client.outgoing.empty())
+        {
+            std::size_t len = std::min(client.outgoing.size(), sizeof(chunk));
+            std::copy(client.outgoing.begin(), client.outgoing.begin() + len, chunk);
+
+            ssize_t sent = ::send(fd, chunk, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0)
+            {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            client.outgoing.erase(client.outgoing.begin(), client.outgoing.begin() + sent);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads client bytes and hands complete frames to the frame handler
+     *
+     * @return true client is healthy
+     * @return false client disconnected or misbehaved
+     */
+    bool Publisher::readClient(int fd, Client &client)
+    {
+        uint8_t chunk[4096];
+        while (true)
+        {
+            ssize_t received = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+            if (received == 0)
+            {
+                return false;
+            }
+            if (received < 0)
+            {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+
+            //Forward whole frames only, so two clients can't corrupt each other's commands
+            for (ssize_t i = 0; i < received; i++)
+            {
+                client.incoming.push_back(chunk[i]);
+                if (chunk[i] == 0x00)
+                {
+                    if (client.incoming.size() > 1)
+                    {
+                        m_on_client_frame(client.incoming.data(), client.incoming.size());
+                    }
+                    client.incoming.clear();
+                }
+            }
+
+            if (client.incoming.size() > MAX_PENDING_BYTES)
+            {
+                return false;
+            }
+        }
+    }
+
+    void Publisher::closeClient(int fd)
+    {
+        m_loop.remove(fd);
+        ::close(fd);
+        m_clients.erase(fd);
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * @file publisher.h
+ * @author Daniel Kim
+ * @brief Fans the vehicle byte stream out to local clients over a Unix socket
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef PUBLISHER_H
+#define PUBLISHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+
+namespace GroundStation
+{
+    /**
+     * @brief Unix domain socket server that republishes raw ElectricUI frames
+     * Every client receives the vehicle's byte stream unchanged, so anything that speaks
+     * ElectricUI (the GUI, scripts) can connect as if it were the serial port.
+     * Frames a client sends are forwarded to the vehicle whole, never interleaved with another client's.
+     * A client that stops reading is disconnected instead of stalling the others.
+     */
+    class Publisher
+    {
+    public:
+        using FrameHandler = std::function<void(const uint8_t *frame, std::size_t len)>;
+
+        static constexpr std::size_t MAX_PENDING_BYTES = 4 * 1024 * 1024;
+
+        Publisher(EventLoop &loop, FrameHandler on_client_frame) : m_loop(loop), m_on_client_frame(std::move(on_client_frame)) {}
+        ~Publisher();
+
+        Publisher(const Publisher &) = delete;
+        Publisher &operator=(const Publisher &) = delete;
+
+        bool listen(const std::string &path);
+
+        void broadcast(const uint8_t *data, std::size_t len);
+
+        std::size_t clientCount() const { return m_clients.size(); }
+
+    private:
+        struct Client
+        {
+            std::deque<uint8_t> outgoing;
+            std::vector<uint8_t> incoming;
+        };
+
+        void accept();
+        bool flushClient(int fd, Client &client);
+        bool readClient(int fd, Client &client);
+        void closeClient(int fd);
+
+        EventLoop &m_loop;
+        FrameHandler m_on_client_frame;
+
+        int m_listen_fd = -1;
+        std::string m_path;
+        std::map<int, Client> m_clients;
+    };
+}
+
+#endif
@@ -0,0 +1,268 @@
+/**
+ * @file serial_link.cpp
+ * @author Daniel Kim
+ * @brief Byte links to the vehicle: a real serial port or a fake one for tests
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "serial_link.h"
+#include "telemetry_generator.h"
+#include "eui_frame.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace GroundStation
+{
+    /**
+     * @brief Reads whatever is available without blocking
+     *
+     * @return ssize_t bytes read, 0 if nothing was available, -1 if the link closed
+     */
+    ssize_t SerialLink::read(uint8_t *buffer, std::size_t len)
+    {
+        ssize_t received = ::read(fd(), buffer, len);
+        if (received < 0)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+        }
+        if (received == 0)
+        {
+            return -1; //EOF: the device went away
+        }
+        return received;
+    }
+
+    /**
+     * @brief Writes all bytes to the vehicle, waiting for room if the driver buffer is full
+     *
+     * @return true everything was written
+     * @return false the link failed
+     */
+    bool SerialLink::write(const uint8_t *data, std::size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t written = ::write(fd(), data, len);
+            if (written < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    pollfd pfd = {fd(), POLLOUT, 0};
+                    ::poll(&pfd, 1, 100);
+                    continue;
+                }
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            len -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    SerialPort::~SerialPort()
+    {
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+    }
+
+    /**
+     * @brief Opens the port in raw, non-blocking mode
+     * The Teensy is USB CDC so the baud rate is only a formality
+     *
+     * @param path device path, e.g. /dev/ttyACM0
+     * @param baud baud rate
+     * @return true port opened
+     * @return false port could not be opened or configured
+     */
+    bool SerialPort::open(const std::string &path, int baud)
+    {
+        m_fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (m_fd < 0)
+        {
+            return false;
+        }
+
+        termios tty;
+        if (tcgetattr(m_fd, &tty) != 0)
+        {
+            return false;
+        }
+
+        cfmakeraw(&tty);
+
+        speed_t speed = B115200;
+        switch (baud)
+        {
+        case 9600:
+            speed = B9600;
+            break;
+        case 115200:
+            speed = B115200;
+            break;
+        case 921600:
+            speed = B921600;
+            break;
+        case 2000000:
+            speed = B2000000;
+            break;
+        default:
+            break;
+        }
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 0;
+
+        return tcsetattr(m_fd, TCSANOW, &tty) == 0;
+    }
+
+    FakeSerial::FakeSerial(double rate_hz) : m_rate_hz(rate_hz) {}
+
+    FakeSerial::~FakeSerial()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_wake.notify_all();
+
+        //A send blocked on a full socket returns once its end is shut down
+        if (m_fds[1] >= 0)
+        {
+            ::shutdown(m_fds[1], SHUT_RDWR);
+        }
+
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+
+        for (int &fd : m_fds)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+    /**
+     * @brief Creates the socketpair and starts generating telemetry
+     *
+     * @return true fake vehicle running
+     * @return false socketpair could not be created
+     */
+    bool FakeSerial::open()
+    {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, m_fds) != 0)
+        {
+            return false;
+        }
+
+        fcntl(m_fds[0], F_SETFL, fcntl(m_fds[0], F_GETFL) | O_NONBLOCK);
+
+        m_running = true;
+        m_thread = std::thread(&FakeSerial::generate, this);
+        return true;
+    }
+
+    /**
+     * @brief Writes synthetic telemetry at the configured rate until stopped
+     * Latency probes ("cid") are answered with a "cl" report like the firmware's, with made up
+     * vehicle-side delays of half a packet period to apply and 300 us to the first step
+     */
+    void FakeSerial::generate()
+    {
+        using clock = std::chrono::steady_clock;
+
+        std::vector<uint8_t> frames;
+        EUI::FrameParser commands(4096);
+
+        uint32_t latency_report[5] = {0}; //same layout as CommandLatency::Report
+        bool latency_pending = false;
+        clock::time_point parsed_at;
+
+        auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / m_rate_hz));
+        auto next = clock::now();
+        uint64_t tick = 0;
+
+        while (m_running)
+        {
+            //Read whatever the daemon forwarded to the "vehicle"
+            while (true)
+            {
+                std::size_t available = 0;
+                uint8_t *buffer = commands.writable(available);
+                ssize_t received = ::recv(m_fds[1], buffer, available, MSG_DONTWAIT);
+                if (received <= 0)
+                {
+                    break;
+                }
+
+                commands.commit(static_cast<std::size_t>(received), [&](const EUI::Message &message)
+                                {
+                                    if (message.name() == "cid" && message.payload_len == 8)
+                                    {
+                                        std::memcpy(latency_report, message.payload, 8);
+                                        latency_report[2] = static_cast<uint32_t>(500000.0 / m_rate_hz);
+                                        latency_report[3] = 300;
+                                        latency_pending = true;
+                                        parsed_at = clock::now();
+                                    }
+                                });
+            }
+
+            frames.clear();
+            generateTelemetry(tick, m_rate_hz, frames);
+
+            if (latency_pending)
+            {
+                latency_report[4] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - parsed_at).count());
+                EUI::encode("cl", EUI::Type::CUSTOM, latency_report, sizeof(latency_report), frames);
+                latency_pending = false;
+            }
+
+            const uint8_t *data = frames.data();
+            std::size_t len = frames.size();
+            while (len > 0 && m_running)
+            {
+                ssize_t written = ::send(m_fds[1], data, len, MSG_NOSIGNAL);
+                if (written <= 0)
+                {
+                    m_running = false;
+                    break;
+                }
+                data += written;
+                len -= static_cast<std::size_t>(written);
+            }
+            m_packets++;
+
+            tick++;
+            next += period;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_until(lock, next, [this]
+                              { return !m_running; });
+        }
+    }
+}
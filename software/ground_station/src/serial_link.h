@@ -0,0 +1,88 @@
+/**
+ * @file serial_link.h
+ * @author Daniel Kim
+ * @brief Byte links to the vehicle: a real serial port or a fake one for tests
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <sys/types.h>
+
+namespace GroundStation
+{
+    /**
+     * @brief Abstract class for anything the daemon can read telemetry from
+     * Links expose a non-blocking file descriptor so they can sit in the poll loop
+     */
+    class SerialLink
+    {
+    public:
+        virtual ~SerialLink() {}
+
+        virtual int fd() const = 0;
+        virtual ssize_t read(uint8_t *buffer, std::size_t len);
+        virtual bool write(const uint8_t *data, std::size_t len);
+    };
+
+    /**
+     * @brief USB serial connection to the Teensy
+     *
+     */
+    class SerialPort : public SerialLink
+    {
+    public:
+        SerialPort() {}
+        ~SerialPort();
+
+        bool open(const std::string &path, int baud);
+        int fd() const override { return m_fd; }
+
+    private:
+        int m_fd = -1;
+    };
+
+    /**
+     * @brief Stand-in for the vehicle when no hardware is attached
+     * A background thread writes synthetic ElectricUI telemetry into one end of a socketpair
+     * at a fixed rate; the daemon reads the other end exactly like a serial port.
+     * Commands written by the daemon are read and ignored, except latency probes which are answered.
+     */
+    class FakeSerial : public SerialLink
+    {
+    public:
+        explicit FakeSerial(double rate_hz = 100.0);
+        ~FakeSerial();
+
+        bool open();
+        int fd() const override { return m_fds[0]; }
+
+        uint64_t packetsSent() const { return m_packets; }
+
+    private:
+        void generate();
+
+        int m_fds[2] = {-1, -1};
+        double m_rate_hz;
+        std::atomic<bool> m_running{false};
+        std::atomic<uint64_t> m_packets{0};
+        std::mutex m_mutex;
+        std::condition_variable m_wake; //cuts the wait for the next packet short on shutdown
+        std::thread m_thread;
+    };
+}
+
+#endif
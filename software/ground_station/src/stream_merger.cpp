@@ -0,0 +1,121 @@
+/**
+ * @file stream_merger.cpp
+ * @author Daniel Kim
+ * @brief Merges every vehicle's records into one time-ordered recording
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "stream_merger.h"
+
+#include <chrono>
+#include <limits>
+
+namespace GroundStation
+{
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    StreamMerger::StreamMerger(ColumnStore &store, std::vector<VehicleSession *> sessions)
+        : m_store(store), m_sessions(std::move(sessions)), m_pending(m_sessions.size())
+    {
+    }
+
+    StreamMerger::~StreamMerger()
+    {
+        stop();
+    }
+
+    void StreamMerger::start()
+    {
+        m_running = true;
+        m_thread = std::thread(&StreamMerger::run, this);
+    }
+
+    /**
+     * @brief Stops the store thread and writes everything that is still pending
+     * Sessions must be stopped first so no records arrive afterwards
+     */
+    void StreamMerger::stop()
+    {
+        if (!m_running)
+        {
+            return;
+        }
+
+        m_running = false;
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+
+        drain(std::numeric_limits<int64_t>::max());
+        m_store.flush();
+    }
+
+    void StreamMerger::run()
+    {
+        auto last_flush = std::chrono::steady_clock::now();
+
+        while (m_running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+            drain(now_ns() - MERGE_WINDOW_NS);
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_flush > std::chrono::seconds(1))
+            {
+                m_store.flush();
+                last_flush = now;
+            }
+        }
+    }
+
+    /**
+     * @brief Collects new records and writes all of them older than the watermark in time order
+     *
+     * @param watermark_ns records stamped at or before this time are written
+     */
+    void StreamMerger::drain(int64_t watermark_ns)
+    {
+        std::vector<Record> incoming;
+        for (std::size_t i = 0; i < m_sessions.size(); i++)
+        {
+            incoming.clear();
+            m_sessions[i]->takeRecords(incoming);
+            for (Record &record : incoming)
+            {
+                m_pending[i].push_back(std::move(record));
+            }
+        }
+
+        //Only a handful of vehicles, so a linear scan for the oldest head beats a heap
+        while (true)
+        {
+            std::deque<Record> *oldest = nullptr;
+            for (std::deque<Record> &queue : m_pending)
+            {
+                if (!queue.empty() && (oldest == nullptr || queue.front().host_time_ns < oldest->front().host_time_ns))
+                {
+                    oldest = &queue;
+                }
+            }
+
+            if (oldest == nullptr || oldest->front().host_time_ns > watermark_ns)
+            {
+                return;
+            }
+
+            const Record &record = oldest->front();
+            m_store.append(record.vehicle_id, record.host_time_ns, record.view());
+            oldest->pop_front();
+            m_merged++;
+        }
+    }
+}
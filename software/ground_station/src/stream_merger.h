@@ -0,0 +1,59 @@
+/**
+ * @file stream_merger.h
+ * @author Daniel Kim
+ * @brief Merges every vehicle's records into one time-ordered recording
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef STREAM_MERGER_H
+#define STREAM_MERGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "column_store.h"
+#include "vehicle_session.h"
+
+namespace GroundStation
+{
+    /**
+     * @brief Store thread that k-way merges the per-vehicle record streams by host time
+     * Each vehicle's records already arrive in time order. Records are held back for
+     * MERGE_WINDOW_NS so a vehicle whose decode thread is momentarily behind still lands
+     * in order, then the oldest record across all vehicles is written first.
+     */
+    class StreamMerger
+    {
+    public:
+        static constexpr int64_t MERGE_WINDOW_NS = 100000000; // 100 ms
+
+        StreamMerger(ColumnStore &store, std::vector<VehicleSession *> sessions);
+        ~StreamMerger();
+
+        void start();
+        void stop();
+
+        uint64_t recordsMerged() const { return m_merged; }
+
+    private:
+        void run();
+        void drain(int64_t watermark_ns);
+
+        ColumnStore &m_store;
+        std::vector<VehicleSession *> m_sessions;
+        std::vector<std::deque<Record>> m_pending; //one queue per session
+
+        std::thread m_thread;
+        std::atomic<bool> m_running{false};
+        std::atomic<uint64_t> m_merged{0};
+    };
+}
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * @file telemetry_generator.cpp
+ * @author Daniel Kim
+ * @brief Synthetic vehicle telemetry for fake links and load tests
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "telemetry_generator.h"
+#include "eui_frame.h"
+
+#include <cmath>
+
+namespace GroundStation
+{
+    void generateTelemetry(uint64_t tick, double rate_hz, std::vector<uint8_t> &out)
+    {
+        double t = tick * (1.0 / rate_hz);
+
+        uint16_t loop_time = 1000;
+        float voltage = 7.4f - 0.001f * static_cast<float>(t);
+        uint8_t state = 3;
+        float orientation[3] = {
+            static_cast<float>(10.0 * std::sin(t)),
+            static_cast<float>(5.0 * std::cos(t)),
+            static_cast<float>(std::fmod(t * 10.0, 360.0)),
+        };
+        float accel[3] = {0.f, 0.f, 9.81f};
+        int16_t buoyancy_position = static_cast<int16_t>(tick % 27000);
+
+        EUI::encode("lt", EUI::Type::UINT16, &loop_time, sizeof(loop_time), out);
+        EUI::encode("v", EUI::Type::FLOAT, &voltage, sizeof(voltage), out);
+        EUI::encode("sst", EUI::Type::UINT8, &state, sizeof(state), out);
+        EUI::encode("xd", EUI::Type::FLOAT, &orientation[0], sizeof(float), out);
+        EUI::encode("yd", EUI::Type::FLOAT, &orientation[1], sizeof(float), out);
+        EUI::encode("zd", EUI::Type::FLOAT, &orientation[2], sizeof(float), out);
+        EUI::encode("ad", EUI::Type::FLOAT, accel, sizeof(accel), out);
+        EUI::encode("bsp", EUI::Type::INT16, &buoyancy_position, sizeof(buoyancy_position), out);
+    }
+}
@@ -0,0 +1,31 @@
+/**
+ * @file telemetry_generator.h
+ * @author Daniel Kim
+ * @brief Synthetic vehicle telemetry for fake links and load tests
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef TELEMETRY_GENERATOR_H
+#define TELEMETRY_GENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+namespace GroundStation
+{
+    /**
+     * @brief Encodes one packet's worth of the ids TransportManager::handleTransport sends,
+     * with slowly varying values so recordings are easy to eyeball
+     *
+     * @param tick packet number
+     * @param rate_hz packet rate used to derive the simulated time
+     * @param out encoded frames are appended here
+     */
+    void generateTelemetry(uint64_t tick, double rate_hz, std::vector<uint8_t> &out);
+}
+
+#endif
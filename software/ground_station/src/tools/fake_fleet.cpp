@@ -0,0 +1,184 @@
+/**
+ * @file fake_fleet.cpp
+ * @author Daniel Kim
+ * @brief Load test harness: several pty-backed fake vehicles streaming telemetry
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../telemetry_generator.h"
+
+using namespace GroundStation;
+
+static std::atomic<bool> running{true};
+
+static void stop(int)
+{
+    running = false;
+}
+
+struct FakeVehicle
+{
+    int master = -1;
+    int slave = -1; //kept open so writes don't fail before the daemon attaches
+    std::string path;
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+/**
+ * @brief Creates a pty pair in raw mode
+ *
+ */
+static bool openPty(FakeVehicle &vehicle)
+{
+    vehicle.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (vehicle.master < 0 || grantpt(vehicle.master) != 0 || unlockpt(vehicle.master) != 0)
+    {
+        return false;
+    }
+
+    vehicle.path = ptsname(vehicle.master);
+    vehicle.slave = open(vehicle.path.c_str(), O_RDWR | O_NOCTTY);
+    if (vehicle.slave < 0)
+    {
+        return false;
+    }
+
+    termios tty;
+    tcgetattr(vehicle.slave, &tty);
+    cfmakeraw(&tty);
+    return tcsetattr(vehicle.slave, TCSANOW, &tty) == 0;
+}
+
+/**
+ * @brief Streams telemetry into the pty master. A rate of 0 sends as fast as the reader drains it
+ *
+ */
+static void drive(FakeVehicle &vehicle, double rate_hz)
+{
+    using clock = std::chrono::steady_clock;
+
+    std::vector<uint8_t> frames;
+    double simulated_rate = rate_hz > 0.0 ? rate_hz : 1000.0;
+    auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / simulated_rate));
+    auto next = clock::now();
+    uint64_t tick = 0;
+
+    while (running)
+    {
+        frames.clear();
+        generateTelemetry(tick++, simulated_rate, frames);
+
+        const uint8_t *data = frames.data();
+        std::size_t len = frames.size();
+        while (len > 0 && running)
+        {
+            ssize_t written = write(vehicle.master, data, len);
+            if (written <= 0)
+            {
+                return;
+            }
+            data += written;
+            len -= static_cast<std::size_t>(written);
+        }
+
+        vehicle.packets++;
+        vehicle.bytes += frames.size();
+
+        if (rate_hz > 0.0)
+        {
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <vehicles> [rate_hz, 0 = full rate] [seconds, 0 = until Ctrl+C]" << std::endl;
+        return 1;
+    }
+
+    int count = std::atoi(argv[1]);
+    double rate_hz = argc > 2 ? std::atof(argv[2]) : 0.0;
+    int seconds = argc > 3 ? std::atoi(argv[3]) : 0;
+    if (count <= 0 || rate_hz < 0.0 || seconds < 0)
+    {
+        std::cout << "Vehicles must be at least 1, the rate and seconds can't be negative" << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
+
+    std::vector<FakeVehicle> vehicles(count);
+    std::string command = "./ground_station";
+    for (int i = 0; i < count; i++)
+    {
+        if (!openPty(vehicles[i]))
+        {
+            std::cout << "Error creating pty for vehicle " << i << std::endl;
+            return 1;
+        }
+        std::cout << "Vehicle " << i << ": " << vehicles[i].path << std::endl;
+        command += " --vehicle " + std::to_string(i) + ":" + vehicles[i].path;
+    }
+
+    std::cout << "Start the ground station with:" << std::endl;
+    std::cout << "  " << command << std::endl;
+
+    std::vector<std::thread> threads;
+    for (FakeVehicle &vehicle : vehicles)
+    {
+        threads.emplace_back(drive, std::ref(vehicle), rate_hz);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    while (running)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (seconds > 0 && std::chrono::steady_clock::now() - start >= std::chrono::seconds(seconds))
+        {
+            running = false;
+        }
+    }
+
+    //Closing the masters unblocks any writer stuck on a full pty
+    for (FakeVehicle &vehicle : vehicles)
+    {
+        close(vehicle.slave);
+        close(vehicle.master);
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int i = 0; i < count; i++)
+    {
+        std::cout << "Vehicle " << i << ": " << vehicles[i].packets / elapsed << " packets/s, "
+                  << vehicles[i].bytes / elapsed / 1e6 << " MB/s" << std::endl;
+    }
+
+    return 0;
+}
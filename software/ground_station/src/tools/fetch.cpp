@@ -0,0 +1,156 @@
+/**
+ * @file fetch.cpp
+ * @author Daniel Kim
+ * @brief Lists and downloads files from the vehicle's SD card over its file transfer port
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../file_transfer.h"
+#include "../serial_link.h"
+
+using namespace GroundStation;
+
+static FileTransfer::Client *active_client = nullptr;
+
+static void stop(int)
+{
+    if (active_client != nullptr)
+    {
+        active_client->cancel();
+    }
+}
+
+static void usage(const char *program)
+{
+    std::cout << "Usage: " << program << " --port <path> [--baud <baud>] <command>" << std::endl;
+    std::cout << "  list                  list files on the SD card" << std::endl;
+    std::cout << "  stat <name>           size of one file" << std::endl;
+    std::cout << "  get <name> [dest]     download (resumes if dest already holds part of the file)" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::string port;
+    int baud = 2000000;
+    std::vector<std::string> command;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+        {
+            port = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--baud") == 0 && i + 1 < argc)
+        {
+            baud = std::atoi(argv[++i]);
+        }
+        else
+        {
+            command.push_back(argv[i]);
+        }
+    }
+
+    if (port.empty() || command.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    SerialPort link;
+    if (!link.open(port, baud))
+    {
+        std::cout << "Error opening " << port << std::endl;
+        return 1;
+    }
+
+    FileTransfer::Client client(link);
+    active_client = &client;
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
+
+    if (command[0] == "list")
+    {
+        std::vector<FileTransfer::Entry> entries;
+        if (!client.list(entries))
+        {
+            std::cout << "Error: " << client.error() << std::endl;
+            return 1;
+        }
+        for (const FileTransfer::Entry &entry : entries)
+        {
+            std::cout << std::setw(12) << entry.size << "  " << entry.name << std::endl;
+        }
+        return 0;
+    }
+
+    if (command[0] == "stat" && command.size() == 2)
+    {
+        bool exists = false;
+        uint32_t size = 0;
+        if (!client.stat(command[1], exists, size))
+        {
+            std::cout << "Error: " << client.error() << std::endl;
+            return 1;
+        }
+        if (!exists)
+        {
+            std::cout << command[1] << " not found" << std::endl;
+            return 1;
+        }
+        std::cout << size << std::endl;
+        return 0;
+    }
+
+    if (command[0] == "get" && (command.size() == 2 || command.size() == 3))
+    {
+        std::string destination = command.size() == 3 ? command[2] : command[1].substr(command[1].find_last_of('/') + 1);
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t first = 0;
+        bool started = false;
+        auto last_print = start;
+
+        bool ok = client.download(command[1], destination, [&](uint64_t received, uint64_t total)
+                                  {
+                                      if (!started)
+                                      {
+                                          first = received;
+                                          started = true;
+                                      }
+                                      auto now = std::chrono::steady_clock::now();
+                                      if (now - last_print > std::chrono::milliseconds(250) || received == total)
+                                      {
+                                          std::cout << "\r" << received << " / " << total << " bytes" << std::flush;
+                                          last_print = now;
+                                      }
+                                  });
+        std::cout << std::endl;
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!ok)
+        {
+            std::cout << "Error: " << client.error() << ". Run the same command again to resume." << std::endl;
+            return 1;
+        }
+
+        std::cout << "Saved " << destination << " (" << first << " bytes already present), "
+                  << client.retransmits() << " retransmitted chunks, " << elapsed << " s" << std::endl;
+        return 0;
+    }
+
+    usage(argv[0]);
+    return 1;
+}
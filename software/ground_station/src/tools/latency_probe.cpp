@@ -0,0 +1,229 @@
+/**
+ * @file latency_probe.cpp
+ * @author Daniel Kim
+ * @brief Sends stamped commands through the ground station and histograms command to actuation latency
+ * @version 0.1
+ * @date 2023-05-08
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../eui_frame.h"
+
+using namespace GroundStation;
+
+static constexpr uint32_t NO_STEP = 0xFFFFFFFF; // mirrors CommandLatency::NO_STEP
+
+static uint32_t now_us()
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief Latency samples in microseconds, printed as a 1 ms bucket histogram
+ *
+ */
+class Histogram
+{
+public:
+    Histogram(const std::string &name, double budget_ms) : m_name(name), m_budget_ms(budget_ms) {}
+
+    void add(uint32_t us) { m_samples.push_back(us); }
+
+    uint32_t max() const { return m_samples.empty() ? 0 : *std::max_element(m_samples.begin(), m_samples.end()); }
+
+    void print() const
+    {
+        std::cout << m_name << ": ";
+        if (m_samples.empty())
+        {
+            std::cout << "no samples" << std::endl;
+            return;
+        }
+
+        std::vector<uint32_t> sorted = m_samples;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p)
+        { return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))] / 1000.0; };
+
+        std::cout << sorted.size() << " samples, p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99)
+                  << " ms, max " << sorted.back() / 1000.0 << " ms" << std::endl;
+
+        //Buckets up to twice the budget, everything slower lands in the last one
+        std::size_t bucket_count = static_cast<std::size_t>(m_budget_ms * 2) + 1;
+        std::vector<std::size_t> buckets(bucket_count, 0);
+        for (uint32_t us : sorted)
+        {
+            buckets[std::min<std::size_t>(us / 1000, bucket_count - 1)]++;
+        }
+
+        std::size_t tallest = *std::max_element(buckets.begin(), buckets.end());
+        for (std::size_t i = 0; i < bucket_count; i++)
+        {
+            if (buckets[i] == 0)
+            {
+                continue;
+            }
+            std::string label = i + 1 == bucket_count ? ">=" + std::to_string(i) : std::to_string(i) + "-" + std::to_string(i + 1);
+            std::cout << "  " << std::setw(6) << label << " ms " << std::setw(6) << buckets[i] << " "
+                      << std::string(buckets[i] * 50 / tallest, '#') << std::endl;
+        }
+    }
+
+private:
+    std::string m_name;
+    double m_budget_ms;
+    std::vector<uint32_t> m_samples;
+};
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <ground station socket> [commands=200] [rate_hz=10] [budget_ms=20] [id=psc] [values=200,400]" << std::endl;
+        return 1;
+    }
+
+    std::string socket_path = argv[1];
+    int count = argc > 2 ? std::atoi(argv[2]) : 200;
+    double rate_hz = argc > 3 ? std::atof(argv[3]) : 10.0;
+    double budget_ms = argc > 4 ? std::atof(argv[4]) : 20.0;
+    std::string command_id = argc > 5 ? argv[5] : "psc";
+    std::string values_arg = argc > 6 ? argv[6] : "200,400";
+
+    std::vector<int16_t> values;
+    for (std::size_t start = 0; start <= values_arg.size();)
+    {
+        std::size_t comma = values_arg.find(',', start);
+        values.push_back(static_cast<int16_t>(std::atoi(values_arg.substr(start, comma - start).c_str())));
+        start = comma == std::string::npos ? values_arg.size() + 1 : comma + 1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        std::cout << "Error connecting to " << socket_path << std::endl;
+        return 1;
+    }
+
+    Histogram uplink("Host to vehicle (half the corrected round trip)", budget_ms);
+    Histogram parse_to_apply("Parse to apply", budget_ms);
+    Histogram apply_to_step("Apply to first step", budget_ms);
+    Histogram total("Command to actuation", budget_ms);
+
+    std::map<uint32_t, uint32_t> outstanding; //seq -> host send time
+    std::size_t no_step = 0;
+
+    EUI::FrameParser parser;
+    auto handle = [&](const EUI::Message &message)
+    {
+        uint32_t report[5];
+        if (message.name() != "cl" || message.payload_len != sizeof(report))
+        {
+            return;
+        }
+        std::memcpy(report, message.payload, sizeof(report));
+
+        auto it = outstanding.find(report[0]);
+        if (it == outstanding.end() || it->second != report[1])
+        {
+            return; //stale report from an earlier run
+        }
+        outstanding.erase(it);
+
+        //Round trip minus the time the report waited on the vehicle, split evenly both ways
+        uint32_t round_trip = now_us() - report[1];
+        uint32_t one_way = round_trip > report[4] ? (round_trip - report[4]) / 2 : 0;
+
+        uplink.add(one_way);
+        parse_to_apply.add(report[2]);
+        if (report[3] == NO_STEP)
+        {
+            no_step++;
+            total.add(one_way + report[2]);
+        }
+        else
+        {
+            apply_to_step.add(report[3]);
+            total.add(one_way + report[2] + report[3]);
+        }
+    };
+
+    auto period = std::chrono::duration<double>(1.0 / rate_hz);
+    auto next = std::chrono::steady_clock::now();
+    auto deadline = next + period * count + std::chrono::seconds(2); //late reports still count
+    uint32_t seq = now_us(); //unlikely to collide with a previous run's last id
+    int sent = 0;
+
+    while (std::chrono::steady_clock::now() < deadline && (sent < count || !outstanding.empty()))
+    {
+        if (sent < count && std::chrono::steady_clock::now() >= next)
+        {
+            //Command first, then its id, so the vehicle stamps the moment the command is complete
+            std::vector<uint8_t> frames;
+            int16_t value = values[sent % values.size()];
+            EUI::encode(command_id.c_str(), EUI::Type::INT16, &value, sizeof(value), frames);
+
+            uint32_t stamp[2] = {++seq, now_us()};
+            EUI::encode("cid", EUI::Type::UINT32, stamp, sizeof(stamp), frames);
+            if (write(fd, frames.data(), frames.size()) != static_cast<ssize_t>(frames.size()))
+            {
+                std::cout << "Error writing to the ground station" << std::endl;
+                return 1;
+            }
+
+            outstanding[stamp[0]] = stamp[1];
+            sent++;
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+        }
+
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 1) <= 0)
+        {
+            continue;
+        }
+
+        std::size_t available = 0;
+        uint8_t *buffer = parser.writable(available);
+        ssize_t received = read(fd, buffer, available);
+        if (received <= 0)
+        {
+            std::cout << "Ground station closed the connection" << std::endl;
+            break;
+        }
+        parser.commit(static_cast<std::size_t>(received), handle);
+    }
+    close(fd);
+
+    uplink.print();
+    parse_to_apply.print();
+    apply_to_step.print();
+    total.print();
+
+    std::cout << sent << " commands sent, " << outstanding.size() << " without a report, "
+              << no_step << " applied without motion" << std::endl;
+
+    bool within_budget = total.max() <= budget_ms * 1000.0 && outstanding.empty();
+    std::cout << (within_budget ? "PASS" : "FAIL") << ": worst case " << total.max() / 1000.0
+              << " ms against a " << budget_ms << " ms budget" << std::endl;
+    return within_budget ? 0 : 2;
+}
@@ -0,0 +1,338 @@
+/**
+ * @file loopback.cpp
+ * @author Daniel Kim
+ * @brief Loopback test of the SD card download protocol: the firmware's FileTransfer on one end of a pty, fetch's client on the other
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*
+The vehicle side is sub_driver/src/Data/FileTransfer.cpp itself, built against tools/vehicle/Arduino.h
+(SerialUSB1 on a pty) and the FsFile below (files under a temporary directory standing in for the SD card).
+Its SD and configuration headers are skipped through their include guards.
+*/
+
+static std::string sd_root;
+
+/**
+ * @brief The SdFat calls FileTransfer makes, on POSIX files under sd_root
+ *
+ */
+class FsFile
+{
+public:
+    ~FsFile() { close(); }
+
+    bool open(const char *name, int)
+    {
+        close();
+        m_path = sd_root + "/" + name;
+        struct stat info;
+        if (::stat(m_path.c_str(), &info) != 0)
+        {
+            return false;
+        }
+        if (S_ISDIR(info.st_mode))
+        {
+            m_dir = opendir(m_path.c_str());
+            return m_dir != nullptr;
+        }
+        m_fd = ::open(m_path.c_str(), O_RDONLY);
+        return m_fd >= 0;
+    }
+
+    bool openNext(FsFile *dir, int)
+    {
+        close();
+        while (dirent *entry = readdir(dir->m_dir))
+        {
+            if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+            {
+                continue;
+            }
+            std::string relative = dir->m_path.substr(sd_root.size() + 1) + "/" + entry->d_name;
+            m_name = entry->d_name;
+            return open(relative.c_str(), 0);
+        }
+        return false;
+    }
+
+    void close()
+    {
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+        if (m_dir != nullptr)
+        {
+            closedir(m_dir);
+        }
+        m_fd = -1;
+        m_dir = nullptr;
+    }
+
+    bool isOpen() const { return m_fd >= 0 || m_dir != nullptr; }
+    bool isDir() const { return m_dir != nullptr; }
+
+    uint32_t fileSize() const
+    {
+        struct stat info;
+        fstat(m_fd, &info);
+        return static_cast<uint32_t>(info.st_size);
+    }
+
+    bool seekSet(uint32_t offset) { return lseek(m_fd, offset, SEEK_SET) == static_cast<off_t>(offset); }
+
+    int read(void *buffer, std::size_t len)
+    {
+        std::size_t total = 0;
+        while (total < len)
+        {
+            ssize_t got = ::read(m_fd, static_cast<uint8_t *>(buffer) + total, len - total);
+            if (got <= 0)
+            {
+                break;
+            }
+            total += static_cast<std::size_t>(got);
+        }
+        return static_cast<int>(total);
+    }
+
+    std::size_t getName(char *name, std::size_t size)
+    {
+        std::size_t length = std::min(m_name.size(), size - 1);
+        std::memcpy(name, m_name.data(), length);
+        name[length] = '\0';
+        return length;
+    }
+
+private:
+    int m_fd = -1;
+    DIR *m_dir = nullptr;
+    std::string m_path;
+    std::string m_name;
+};
+
+namespace DataFile
+{
+    inline bool initializeSD() { return true; }
+}
+
+#define CONFIGURATION_H
+#define SD_h
+#define DataFile_h
+#define FILE_TRANSFER_ON true
+#define USB_DUAL_SERIAL
+
+#include "../../../sub_driver/src/Data/FileTransfer.cpp"
+
+#include "../file_transfer.h"
+#include "../serial_link.h"
+
+using Client = GroundStation::FileTransfer::Client;
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+static std::vector<uint8_t> readFile(const std::string &path)
+{
+    std::vector<uint8_t> bytes;
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return bytes;
+    }
+    uint8_t buffer[4096];
+    std::size_t got;
+    while ((got = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + got);
+    }
+    std::fclose(file);
+    return bytes;
+}
+
+static void writeFile(const std::string &path, const std::vector<uint8_t> &bytes, std::size_t length)
+{
+    FILE *file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, length, file);
+    std::fclose(file);
+}
+
+/**
+ * @brief Packet type of a COBS frame as written by the firmware (delimiter, code, type...)
+ *
+ */
+static FileTransfer::PacketType frameType(const uint8_t *frame, std::size_t len)
+{
+    return len > 2 && frame[1] > 1 ? static_cast<FileTransfer::PacketType>(frame[2]) : FileTransfer::PacketType::ERROR;
+}
+
+int main()
+{
+    char root_template[] = "/tmp/oceanai_loopbackXXXXXX";
+    if (mkdtemp(root_template) == nullptr)
+    {
+        std::cout << "Error creating the SD directory" << std::endl;
+        return 1;
+    }
+    sd_root = root_template;
+    mkdir((sd_root + "/images").c_str(), 0755);
+
+    std::mt19937 random(12345);
+    std::vector<uint8_t> log(300 * 1024 + 123);
+    std::vector<uint8_t> image(50 * 1024);
+    for (uint8_t &byte : log)
+    {
+        byte = static_cast<uint8_t>(random());
+    }
+    for (uint8_t &byte : image)
+    {
+        byte = static_cast<uint8_t>(random());
+    }
+    writeFile(sd_root + "/data001.json", log, log.size());
+    writeFile(sd_root + "/images/img001.jpg", image, image.size());
+
+    //Vehicle on the pty master, client on the slave
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        std::cout << "Error creating pty" << std::endl;
+        return 1;
+    }
+    std::string path = ptsname(master);
+    termios tty;
+    int slave = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+    tcgetattr(slave, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(slave, TCSANOW, &tty);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    SerialUSB1.fd = master;
+    FileTransfer::init();
+
+    std::atomic<bool> running{true};
+    std::thread vehicle([&running]
+                        {
+                            while (running)
+                            {
+                                FileTransfer::update();
+                                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                            } });
+
+    GroundStation::SerialPort link;
+    if (!link.open(path, 2000000))
+    {
+        std::cout << "Error opening " << path << std::endl;
+        running = false;
+        vehicle.join();
+        return 1;
+    }
+    Client client(link);
+    const std::string destination = sd_root + "/download";
+
+    std::vector<GroundStation::FileTransfer::Entry> entries;
+    bool listed = client.list(entries);
+    bool found_log = false;
+    bool found_image = false;
+    for (const GroundStation::FileTransfer::Entry &entry : entries)
+    {
+        found_log |= entry.name == "data001.json" && entry.size == log.size();
+        found_image |= entry.name == "images/img001.jpg" && entry.size == image.size();
+    }
+    check(listed && found_log && found_image, "list has both files with their sizes");
+
+    bool exists = true;
+    uint32_t size = 0;
+    check(client.stat("data001.json", exists, size) && exists && size == log.size(), "stat of a file");
+    check(client.stat("missing.json", exists, size) && !exists, "stat of a missing file");
+
+    check(client.download("data001.json", destination) && readFile(destination) == log, "download");
+
+    //Resume: keep the first 100000 bytes, the rest comes from a READ at that offset
+    writeFile(destination, log, 100000);
+    uint64_t first = 0;
+    bool started = false;
+    bool resumed = client.download("data001.json", destination, [&](uint64_t received, uint64_t)
+                                   {
+                                       if (!started)
+                                       {
+                                           first = received;
+                                           started = true;
+                                       } });
+    check(resumed && first == 100000 && readFile(destination) == log, "resume from a partial copy");
+
+    //Lose one DATA packet in ten: the selective ACKs have to bring them back
+    std::bernoulli_distribution lose(0.1);
+    SerialUSB1.drop = [&](const uint8_t *frame, std::size_t len)
+    { return frameType(frame, len) == FileTransfer::PacketType::DATA && lose(random); };
+    std::remove(destination.c_str());
+    bool lossy = client.download("images/img001.jpg", destination);
+    check(lossy && readFile(destination) == image && client.retransmits() > 0, "download with lost chunks (" + std::to_string(client.retransmits()) + " retransmitted)");
+
+    //Lose the DONE: a fully received file still counts, well before the idle timeout
+    int dropped_done = 0;
+    SerialUSB1.drop = [&](const uint8_t *frame, std::size_t len)
+    {
+        if (frameType(frame, len) == FileTransfer::PacketType::DONE && dropped_done == 0)
+        {
+            dropped_done++;
+            return true;
+        }
+        return false;
+    };
+    std::remove(destination.c_str());
+    auto start = std::chrono::steady_clock::now();
+    bool without_done = client.download("data001.json", destination);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    check(without_done && dropped_done == 1 && readFile(destination) == log && seconds < 2.0, "download with the DONE lost (" + std::to_string(seconds) + " s)");
+
+    //Lose every DONE: the client still finishes and aborts the read
+    SerialUSB1.drop = [&](const uint8_t *frame, std::size_t len)
+    { return frameType(frame, len) == FileTransfer::PacketType::DONE; };
+    std::remove(destination.c_str());
+    bool never_done = client.download("images/img001.jpg", destination);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    check(never_done && readFile(destination) == image && !FileTransfer::transferActive(), "download with every DONE lost, read aborted");
+
+    running = false;
+    vehicle.join();
+    ::close(slave);
+
+    std::string cleanup = "rm -rf " + sd_root;
+    if (std::system(cleanup.c_str()) != 0)
+    {
+        std::cout << "Couldn't remove " << sd_root << std::endl;
+    }
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
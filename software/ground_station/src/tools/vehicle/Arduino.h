@@ -0,0 +1,114 @@
+/**
+ * @file Arduino.h
+ * @author Daniel Kim
+ * @brief The parts of the Teensy core that the firmware's file transfer uses, on a pty, for loopback
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef LOOPBACK_ARDUINO_H
+#define LOOPBACK_ARDUINO_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+
+#define DMAMEM
+
+inline uint32_t millis()
+{
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b)
+{
+    return a < b ? a : b;
+}
+
+/**
+ * @brief SerialUSB1 on the master side of a pty
+ * drop decides, per packet written, whether it's lost on the way to the host
+ */
+class LoopbackSerial
+{
+public:
+    int fd = -1;
+    std::function<bool(const uint8_t *frame, std::size_t len)> drop;
+
+    void begin(uint32_t) {}
+
+    int available()
+    {
+        if (m_length == 0)
+        {
+            ssize_t received = ::read(fd, m_buffer, sizeof(m_buffer));
+            m_length = received > 0 ? static_cast<std::size_t>(received) : 0;
+            m_position = 0;
+        }
+        return static_cast<int>(m_length - m_position);
+    }
+
+    int read()
+    {
+        if (available() == 0)
+        {
+            return -1;
+        }
+        uint8_t byte = m_buffer[m_position++];
+        if (m_position == m_length)
+        {
+            m_length = 0;
+        }
+        return byte;
+    }
+
+    int availableForWrite() { return 8192; }
+
+    std::size_t write(const uint8_t *data, std::size_t len)
+    {
+        if (drop && drop(data, len))
+        {
+            return len;
+        }
+
+        std::size_t left = len;
+        while (left > 0)
+        {
+            ssize_t written = ::write(fd, data, left);
+            if (written < 0)
+            {
+                if (errno != EAGAIN && errno != EINTR)
+                {
+                    return len - left;
+                }
+                pollfd pfd = {fd, POLLOUT, 0};
+                ::poll(&pfd, 1, 10);
+                continue;
+            }
+            data += written;
+            left -= static_cast<std::size_t>(written);
+        }
+        return len;
+    }
+
+private:
+    uint8_t m_buffer[4096];
+    std::size_t m_length = 0;
+    std::size_t m_position = 0;
+};
+
+inline LoopbackSerial SerialUSB1;
+
+#endif
@@ -0,0 +1,240 @@
+/**
+ * @file vehicle_session.cpp
+ * @author Daniel Kim
+ * @brief One vehicle's serial link, decode thread and client socket
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "vehicle_session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace GroundStation
+{
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief View of the record in the form the column store takes
+     *
+     */
+    EUI::Message Record::view() const
+    {
+        EUI::Message message = {};
+        message.id = id;
+        message.id_len = id_len;
+        message.type = type;
+        message.payload = payload.data();
+        message.payload_len = static_cast<uint16_t>(payload.size());
+        return message;
+    }
+
+    VehicleSession::VehicleSession(uint16_t id, std::unique_ptr<SerialLink> link) : m_id(id), m_link(std::move(link)) {}
+
+    VehicleSession::~VehicleSession()
+    {
+        stop();
+    }
+
+    /**
+     * @brief Registers the link with the event loop and starts decoding
+     *
+     * @param loop event loop shared by all vehicles
+     * @param socket_path where this vehicle's clients connect
+     * @return true session running
+     * @return false socket or link could not be registered
+     */
+    bool VehicleSession::start(EventLoop &loop, const std::string &socket_path)
+    {
+        m_loop = &loop;
+
+        m_publisher = std::make_unique<Publisher>(loop, [this](const uint8_t *frame, std::size_t len) {
+            const uint8_t delimiter = 0x00; //resync the vehicle's parser before every client frame
+            m_link->write(&delimiter, 1);
+            m_link->write(frame, len);
+        });
+
+        if (!m_publisher->listen(socket_path))
+        {
+            return false;
+        }
+
+        if (!loop.add(m_link->fd(), EPOLLIN, [this](uint32_t events) { onReadable(events); }))
+        {
+            return false;
+        }
+
+        m_connected = true;
+        m_running = true;
+        m_thread = std::thread(&VehicleSession::decode, this);
+        return true;
+    }
+
+    /**
+     * @brief Stops the decode thread. Queued bytes are decoded first
+     *
+     */
+    void VehicleSession::stop()
+    {
+        if (m_loop != nullptr && m_connected)
+        {
+            m_loop->remove(m_link->fd());
+            m_connected = false;
+        }
+
+        if (m_running)
+        {
+            m_running = false;
+            m_input_ready.notify_all();
+        }
+
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    /**
+     * @brief Moves every record decoded so far into out
+     *
+     */
+    void VehicleSession::takeRecords(std::vector<Record> &out)
+    {
+        std::lock_guard<std::mutex> lock(m_output_mutex);
+        if (out.empty())
+        {
+            out.swap(m_output);
+        }
+        else
+        {
+            std::move(m_output.begin(), m_output.end(), std::back_inserter(out));
+            m_output.clear();
+        }
+    }
+
+    /**
+     * @brief Event loop thread: read, republish and hand off to the decoder
+     *
+     */
+    void VehicleSession::onReadable(uint32_t events)
+    {
+        Chunk chunk;
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            if (!m_spare.empty())
+            {
+                chunk = std::move(m_spare.back());
+                m_spare.pop_back();
+            }
+        }
+
+        chunk.bytes.resize(CHUNK_SIZE);
+        ssize_t received = m_link->read(chunk.bytes.data(), chunk.bytes.size());
+
+        if (received < 0 || (received == 0 && (events & (EPOLLERR | EPOLLHUP))))
+        {
+            std::cout << "Vehicle " << m_id << " disconnected" << std::endl;
+            m_loop->remove(m_link->fd());
+            m_connected = false;
+            return;
+        }
+        if (received == 0)
+        {
+            return;
+        }
+
+        chunk.host_time_ns = now_ns();
+        chunk.bytes.resize(static_cast<std::size_t>(received));
+        m_bytes += static_cast<uint64_t>(received);
+
+        m_publisher->broadcast(chunk.bytes.data(), chunk.bytes.size());
+
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            m_input.push_back(std::move(chunk));
+        }
+        m_input_ready.notify_one();
+    }
+
+    /**
+     * @brief Decode thread: turns queued bytes into Records
+     *
+     */
+    void VehicleSession::decode()
+    {
+        EUI::FrameParser parser;
+        std::vector<Chunk> work;
+        std::vector<Record> decoded;
+
+        int64_t chunk_time = 0;
+        auto on_message = [&](const EUI::Message &message) {
+            Record record;
+            record.vehicle_id = m_id;
+            record.host_time_ns = chunk_time;
+            record.type = message.type;
+            record.id_len = message.id_len;
+            std::memcpy(record.id, message.id, message.id_len);
+            record.payload.assign(message.payload, message.payload + message.payload_len);
+            decoded.push_back(std::move(record));
+        };
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_input_mutex);
+                m_input_ready.wait(lock, [&] { return !m_input.empty() || !m_running; });
+                if (m_input.empty() && !m_running)
+                {
+                    break;
+                }
+                work.swap(m_input);
+            }
+
+            for (Chunk &chunk : work)
+            {
+                chunk_time = chunk.host_time_ns;
+
+                const uint8_t *data = chunk.bytes.data();
+                std::size_t remaining = chunk.bytes.size();
+                while (remaining > 0)
+                {
+                    std::size_t available = 0;
+                    uint8_t *buffer = parser.writable(available);
+                    std::size_t len = std::min(available, remaining);
+
+                    std::memcpy(buffer, data, len);
+                    parser.commit(len, on_message);
+
+                    data += len;
+                    remaining -= len;
+                }
+            }
+
+            m_frames = parser.framesDecoded();
+            m_dropped = parser.framesDropped();
+
+            {
+                std::lock_guard<std::mutex> lock(m_output_mutex);
+                std::move(decoded.begin(), decoded.end(), std::back_inserter(m_output));
+            }
+            decoded.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(m_input_mutex);
+                std::move(work.begin(), work.end(), std::back_inserter(m_spare));
+            }
+            work.clear();
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file vehicle_session.h
+ * @author Daniel Kim
+ * @brief One vehicle's serial link, decode thread and client socket
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef VEHICLE_SESSION_H
+#define VEHICLE_SESSION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eui_frame.h"
+#include "event_loop.h"
+#include "publisher.h"
+#include "serial_link.h"
+
+namespace GroundStation
+{
+    /**
+     * @brief Decoded message that owns its bytes so it can cross threads
+     *
+     */
+    struct Record
+    {
+        uint16_t vehicle_id;
+        int64_t host_time_ns;
+        EUI::Type type;
+        uint8_t id_len;
+        char id[EUI::MAX_ID_LEN];
+        std::vector<uint8_t> payload;
+
+        EUI::Message view() const;
+    };
+
+    /**
+     * @brief Everything that belongs to one vehicle
+     * The event loop thread reads the link, republishes the raw bytes and queues them;
+     * the session's own thread decodes them into Records for the merger.
+     * Decoding never blocks the event loop, so one busy vehicle can't delay the others.
+     */
+    class VehicleSession
+    {
+    public:
+        VehicleSession(uint16_t id, std::unique_ptr<SerialLink> link);
+        ~VehicleSession();
+
+        VehicleSession(const VehicleSession &) = delete;
+        VehicleSession &operator=(const VehicleSession &) = delete;
+
+        bool start(EventLoop &loop, const std::string &socket_path);
+        void stop();
+
+        void takeRecords(std::vector<Record> &out);
+
+        uint16_t id() const { return m_id; }
+        bool connected() const { return m_connected; }
+        uint64_t framesDecoded() const { return m_frames; }
+        uint64_t framesDropped() const { return m_dropped; }
+        uint64_t bytesReceived() const { return m_bytes; }
+
+    private:
+        struct Chunk
+        {
+            int64_t host_time_ns;
+            std::vector<uint8_t> bytes;
+        };
+
+        void onReadable(uint32_t events);
+        void decode();
+
+        uint16_t m_id;
+        std::unique_ptr<SerialLink> m_link;
+        std::unique_ptr<Publisher> m_publisher;
+        EventLoop *m_loop = nullptr;
+
+        std::mutex m_input_mutex;
+        std::condition_variable m_input_ready;
+        std::vector<Chunk> m_input;
+        std::vector<Chunk> m_spare; //recycled chunk buffers
+
+        std::mutex m_output_mutex;
+        std::vector<Record> m_output;
+
+        std::thread m_thread;
+        std::atomic<bool> m_running{false};
+        std::atomic<bool> m_connected{false};
+
+        std::atomic<uint64_t> m_frames{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<uint64_t> m_bytes{0};
+    };
+}
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file CommandLatency.cpp
+ * @author Daniel Kim
+ * @brief Measures how long a GUI command takes to reach the steppers
+ * @version 0.1
+ * @date 2023-05-08
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "CommandLatency.h"
+
+#include <Arduino.h>
+
+namespace CommandLatency
+{
+    enum class Stage : uint8_t
+    {
+        IDLE,
+        PARSED,
+        APPLIED,
+        DONE,
+    };
+
+    static Stage stage = Stage::IDLE;
+    static Report current;
+    static uint32_t parse_us = 0;
+    static uint32_t apply_us = 0;
+    static uint8_t applied_axes = 0;
+
+    /**
+     * @brief Call as soon as a new cid is decoded. A command still in flight is dropped
+     *
+     * @param seq host sequence number
+     * @param host_time host send time, echoed back
+     */
+    void received(uint32_t seq, uint32_t host_time)
+    {
+        parse_us = micros();
+        current = Report();
+        current.seq = seq;
+        current.host_time = host_time;
+        stage = Stage::PARSED;
+    }
+
+    /**
+     * @brief Call where a changed command has been passed to the steppers
+     *
+     * @param axes axisBit of every axis the command changed
+     */
+    void applied(uint8_t axes)
+    {
+        if (stage != Stage::PARSED || axes == 0)
+        {
+            return;
+        }
+
+        apply_us = micros();
+        applied_axes = axes;
+        current.parse_to_apply_us = apply_us - parse_us;
+        stage = Stage::APPLIED;
+    }
+
+    /**
+     * @brief Call whenever a stepper moved a step
+     *
+     * @param axis step engine axis that moved
+     */
+    void stepped(uint8_t axis)
+    {
+        if (stage != Stage::APPLIED || (applied_axes & axisBit(axis)) == 0)
+        {
+            return;
+        }
+
+        current.apply_to_step_us = micros() - apply_us;
+        stage = Stage::DONE;
+    }
+
+    /**
+     * @brief Hands over the finished report once
+     *
+     * @param report filled in if ready
+     * @return true a report is ready to send
+     */
+    bool reportReady(Report &report)
+    {
+        if (stage == Stage::APPLIED && micros() - apply_us > STEP_TIMEOUT_US)
+        {
+            current.apply_to_step_us = NO_STEP;
+            stage = Stage::DONE;
+        }
+
+        if (stage != Stage::DONE)
+        {
+            return false;
+        }
+
+        current.since_parse_us = micros() - parse_us;
+        report = current;
+        stage = Stage::IDLE;
+        return true;
+    }
+}
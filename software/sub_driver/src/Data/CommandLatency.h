@@ -0,0 +1,52 @@
+/**
+ * @file CommandLatency.h
+ * @author Daniel Kim
+ * @brief Measures how long a GUI command takes to reach the steppers
+ * @version 0.1
+ * @date 2023-05-08
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef COMMANDLATENCY_H
+#define COMMANDLATENCY_H
+
+#include <cstdint>
+
+/*
+The host writes a command (bsc, psc, ssc...) and then "cid" = { sequence number, host send time }.
+Every command is stamped at three points:
+    parse   the cid write was decoded by eui_parse
+    apply   a command that changed something reached setSpeeds or moveTo of the axes it changed
+    step    one of those axes issued its first step pulse after the apply
+Loops where the commands didn't change aren't stamped, and steps of axes the command didn't touch
+don't count.
+The result goes back as "cl" (Report). Since the clocks aren't synced, since_parse_us lets the host
+subtract the time the vehicle held the report from its measured round trip.
+*/
+
+namespace CommandLatency
+{
+    constexpr uint32_t NO_STEP = 0xFFFFFFFF; // the command produced no motion within STEP_TIMEOUT_US
+    constexpr uint32_t STEP_TIMEOUT_US = 1000000;
+
+    struct Report
+    {
+        uint32_t seq = 0;
+        uint32_t host_time = 0; // echoed back unchanged
+        uint32_t parse_to_apply_us = 0;
+        uint32_t apply_to_step_us = 0;
+        uint32_t since_parse_us = 0; // filled in when the report is sent
+    };
+
+    constexpr uint8_t axisBit(uint8_t axis) { return static_cast<uint8_t>(1 << axis); } // step engine axis
+
+    void received(uint32_t seq, uint32_t host_time);
+    void applied(uint8_t axes);
+    void stepped(uint8_t axis);
+
+    bool reportReady(Report &report);
+}
+
+#endif
@@ -0,0 +1,627 @@
+/**
+ * @file FileTransfer.cpp
+ * @author Daniel Kim
+ * @brief Bulk download of logs and images from the SD card over the second USB serial port
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "FileTransfer.h"
+#include "SD/SD.h"
+#include "SD/DataFile.h"
+
+#include <cstring>
+
+#if FILE_TRANSFER_ON
+
+#if !defined(USB_DUAL_SERIAL) && !defined(USB_TRIPLE_SERIAL)
+#error "File transfer needs a second USB serial port. Build with -D USB_DUAL_SERIAL"
+#endif
+
+namespace FileTransfer
+{
+    /**
+     * @brief CRC32 (IEEE 802.3, reflected) lookup table generated at compile time
+     *
+     */
+    struct Crc32Table
+    {
+        uint32_t entries[256];
+
+        constexpr Crc32Table() : entries()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+                }
+                entries[i] = crc;
+            }
+        }
+    };
+
+    static constexpr Crc32Table crc_table;
+
+    static constexpr size_t HEADER_SIZE = 5; // type + seq
+    static constexpr size_t MAX_PACKET_SIZE = HEADER_SIZE + 4 + CHUNK_SIZE + 4;
+    static constexpr size_t MAX_ENCODED_SIZE = MAX_PACKET_SIZE + MAX_PACKET_SIZE / 254 + 3;
+    static constexpr size_t MAX_REQUEST_SIZE = 128;
+    static constexpr size_t MAX_NAME_LENGTH = 64;
+
+    static uint8_t rx_frame[MAX_REQUEST_SIZE]; //COBS frame being received
+    static size_t rx_length = 0;
+    static bool rx_overflow = false;
+
+    static uint8_t packet[MAX_PACKET_SIZE];
+    static uint8_t encoded[MAX_ENCODED_SIZE];
+
+    //Read state. Chunk seq lives in slot seq % WINDOW_CHUNKS of the window buffer
+    static FsFile transfer_file;
+    static bool active = false;
+    static bool done_pending = false;
+    static bool finished = false;  //the last read was fully acknowledged, ACKs for it are answered with DONE
+    static uint32_t start_offset = 0;
+    static uint32_t total_length = 0;
+    static uint32_t chunk_count = 0;
+    static uint32_t base = 0;      //oldest unacknowledged chunk
+    static uint32_t next_read = 0; //next chunk to load from SD
+    static uint32_t last_ack_ms = 0;
+
+    DMAMEM static uint8_t window_data[WINDOW_CHUNKS * CHUNK_SIZE];
+    static bool acked[WINDOW_CHUNKS];
+    static bool pending[WINDOW_CHUNKS]; //loaded and waiting to be (re)sent
+    static uint32_t sent_ms[WINDOW_CHUNKS];
+
+    //List state
+    enum class ListStage : uint8_t
+    {
+        IDLE,
+        ROOT,
+        IMAGES,
+        END,
+    };
+    static ListStage list_stage = ListStage::IDLE;
+    static FsFile list_dir;
+    static uint8_t list_entry[4 + MAX_NAME_LENGTH]; //entry that didn't fit in the USB buffer last loop
+    static size_t list_entry_length = 0;
+
+    /**
+     * @brief CRC32 of a buffer
+     *
+     * @param data bytes to checksum
+     * @param len number of bytes
+     * @return uint32_t checksum
+     */
+    uint32_t crc32(const uint8_t *data, size_t len)
+    {
+        uint32_t crc = 0xFFFFFFFFUL;
+        for (size_t i = 0; i < len; i++)
+        {
+            crc = crc_table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFUL;
+    }
+
+    static void putU32(uint8_t *buffer, uint32_t value)
+    {
+        buffer[0] = value & 0xFF;
+        buffer[1] = (value >> 8) & 0xFF;
+        buffer[2] = (value >> 16) & 0xFF;
+        buffer[3] = (value >> 24) & 0xFF;
+    }
+
+    static uint32_t getU32(const uint8_t *buffer)
+    {
+        return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+    }
+
+    /**
+     * @brief Frames and writes one packet if the USB buffer has room for all of it
+     * Never blocks: returns false so the caller can try again next loop
+     *
+     * @param type packet type
+     * @param seq sequence number
+     * @param payload packet payload
+     * @param len payload length
+     * @return true packet was written
+     * @return false not enough room in the USB buffer
+     */
+    static bool sendPacket(PacketType type, uint32_t seq, const uint8_t *payload, size_t len)
+    {
+        size_t packet_length = 0;
+        packet[packet_length++] = static_cast<uint8_t>(type);
+        putU32(packet + packet_length, seq);
+        packet_length += 4;
+
+        memcpy(packet + packet_length, payload, len);
+        packet_length += len;
+
+        putU32(packet + packet_length, crc32(packet, packet_length));
+        packet_length += 4;
+
+        //COBS encode between two delimiters
+        size_t encoded_length = 0;
+        encoded[encoded_length++] = 0x00;
+        size_t code_index = encoded_length++;
+        uint8_t code = 1;
+        for (size_t i = 0; i < packet_length; i++)
+        {
+            if (packet[i] == 0x00)
+            {
+                encoded[code_index] = code;
+                code_index = encoded_length++;
+                code = 1;
+            }
+            else
+            {
+                encoded[encoded_length++] = packet[i];
+                if (++code == 0xFF)
+                {
+                    encoded[code_index] = code;
+                    code_index = encoded_length++;
+                    code = 1;
+                }
+            }
+        }
+        encoded[code_index] = code;
+        encoded[encoded_length++] = 0x00;
+
+        if ((size_t)SerialUSB1.availableForWrite() < encoded_length)
+        {
+            return false;
+        }
+
+        SerialUSB1.write(encoded, encoded_length);
+        return true;
+    }
+
+    static void sendError(ErrorCode code)
+    {
+        uint8_t payload = static_cast<uint8_t>(code);
+        sendPacket(PacketType::ERROR, 0, &payload, 1);
+    }
+
+    static void endTransfer()
+    {
+        if (transfer_file.isOpen())
+        {
+            transfer_file.close();
+        }
+        active = false;
+    }
+
+    /**
+     * @brief Loads free window slots from SD with as few (large, sequential) reads as possible
+     *
+     */
+    static void fillWindow()
+    {
+        while (next_read < chunk_count && next_read < base + WINDOW_CHUNKS)
+        {
+            uint32_t slot = next_read % WINDOW_CHUNKS;
+            uint32_t run = min(chunk_count, base + WINDOW_CHUNKS) - next_read;
+            run = min(run, WINDOW_CHUNKS - slot); //stop at the end of the ring, wrap on the next pass
+
+            uint32_t offset = next_read * CHUNK_SIZE;
+            uint32_t bytes = min(run * CHUNK_SIZE, total_length - offset);
+
+            if (transfer_file.read(window_data + slot * CHUNK_SIZE, bytes) != (int)bytes)
+            {
+                sendError(ErrorCode::READ_FAILED);
+                endTransfer();
+                return;
+            }
+
+            for (uint32_t i = 0; i < run; i++)
+            {
+                acked[slot + i] = false;
+                pending[slot + i] = true;
+            }
+            next_read += run;
+        }
+    }
+
+    /**
+     * @brief Sends pending chunks oldest first, within the per-loop byte budget
+     *
+     */
+    static void sendWindow()
+    {
+        uint32_t budget = BYTES_PER_UPDATE;
+        for (uint32_t seq = base; seq < next_read && budget >= CHUNK_SIZE; seq++)
+        {
+            uint32_t slot = seq % WINDOW_CHUNKS;
+            if (!pending[slot] || acked[slot])
+            {
+                continue;
+            }
+
+            uint32_t offset = seq * CHUNK_SIZE;
+            uint32_t bytes = min((uint32_t)CHUNK_SIZE, total_length - offset);
+
+            uint8_t payload[4 + CHUNK_SIZE];
+            putU32(payload, start_offset + offset);
+            memcpy(payload + 4, window_data + slot * CHUNK_SIZE, bytes);
+
+            if (!sendPacket(PacketType::DATA, seq, payload, 4 + bytes))
+            {
+                return; //USB buffer full, continue next loop
+            }
+
+            pending[slot] = false;
+            sent_ms[slot] = millis();
+            budget -= CHUNK_SIZE;
+        }
+    }
+
+    /**
+     * @brief Cumulative + selective acknowledgement from the host
+     * Chunks below the highest acknowledged one that are still missing were lost and are resent
+     *
+     * @param ack_base every chunk below this was received
+     * @param bitmap bit i set = chunk ack_base + 1 + i was received
+     */
+    static void handleAck(uint32_t ack_base, uint32_t bitmap)
+    {
+        if (!active)
+        {
+            //The host is still acknowledging a finished read, so it missed the DONE
+            if (finished && ack_base >= chunk_count)
+            {
+                done_pending = true;
+            }
+            return;
+        }
+
+        last_ack_ms = millis();
+
+        ack_base = min(ack_base, next_read);
+        while (base < ack_base)
+        {
+            acked[base % WINDOW_CHUNKS] = true;
+            base++;
+        }
+
+        uint32_t highest = base;
+        for (uint8_t i = 0; i < 32; i++)
+        {
+            uint32_t seq = ack_base + 1 + i;
+            if ((bitmap & (1UL << i)) && seq < next_read)
+            {
+                acked[seq % WINDOW_CHUNKS] = true;
+                highest = seq;
+            }
+        }
+
+        //Gaps below the highest received chunk were lost. Give in-flight resends a moment before resending again
+        for (uint32_t seq = base; seq < highest; seq++)
+        {
+            uint32_t slot = seq % WINDOW_CHUNKS;
+            if (!acked[slot] && !pending[slot] && millis() - sent_ms[slot] >= RETRANSMIT_TIMEOUT_MS / 4)
+            {
+                pending[slot] = true;
+            }
+        }
+
+        if (base >= chunk_count)
+        {
+            endTransfer();
+            done_pending = true;
+            finished = true;
+        }
+    }
+
+    static bool readName(const uint8_t *data, size_t len, char *name)
+    {
+        if (len == 0 || len >= MAX_NAME_LENGTH)
+        {
+            return false;
+        }
+        memcpy(name, data, len);
+        name[len] = '\0';
+        return true;
+    }
+
+    static void handleRead(const uint8_t *payload, size_t len)
+    {
+        char name[MAX_NAME_LENGTH];
+        if (len < 8 || !readName(payload + 8, len - 8, name))
+        {
+            sendError(ErrorCode::BAD_REQUEST);
+            return;
+        }
+
+        endTransfer(); //a new read replaces the old one
+        finished = false;
+
+        if (!DataFile::initializeSD())
+        {
+            sendError(ErrorCode::NO_SD);
+            return;
+        }
+
+        if (!transfer_file.open(name, O_RDONLY))
+        {
+            sendError(ErrorCode::NOT_FOUND);
+            return;
+        }
+
+        uint32_t size = transfer_file.fileSize();
+        uint32_t offset = getU32(payload);
+        uint32_t length = getU32(payload + 4);
+
+        if (offset > size || !transfer_file.seekSet(offset))
+        {
+            transfer_file.close();
+            sendError(ErrorCode::BAD_REQUEST);
+            return;
+        }
+
+        start_offset = offset;
+        total_length = (length == 0 || length > size - offset) ? size - offset : length;
+        chunk_count = (total_length + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        base = 0;
+        next_read = 0;
+        last_ack_ms = millis();
+        active = true;
+
+        if (chunk_count == 0)
+        {
+            endTransfer();
+            done_pending = true;
+            finished = true;
+        }
+    }
+
+    static void handleStat(const uint8_t *payload, size_t len)
+    {
+        char name[MAX_NAME_LENGTH];
+        if (!readName(payload, len, name))
+        {
+            sendError(ErrorCode::BAD_REQUEST);
+            return;
+        }
+
+        uint8_t reply[5] = {0};
+        FsFile stat_file;
+        if (DataFile::initializeSD() && stat_file.open(name, O_RDONLY))
+        {
+            reply[0] = 1;
+            putU32(reply + 1, stat_file.fileSize());
+            stat_file.close();
+        }
+
+        sendPacket(PacketType::STAT_REPLY, 0, reply, sizeof(reply));
+    }
+
+    /**
+     * @brief Sends a few directory entries per loop until the root and images/ are listed
+     *
+     */
+    static void continueList()
+    {
+        for (uint8_t sent = 0; sent < 8 && list_stage != ListStage::IDLE; sent++)
+        {
+            if (list_stage == ListStage::END)
+            {
+                if (sendPacket(PacketType::LIST_END, 0, nullptr, 0))
+                {
+                    list_stage = ListStage::IDLE;
+                }
+                return;
+            }
+
+            if (list_entry_length == 0)
+            {
+                FsFile entry;
+                if (!entry.openNext(&list_dir, O_RDONLY))
+                {
+                    list_dir.close();
+                    if (list_stage == ListStage::ROOT && list_dir.open("images", O_RDONLY))
+                    {
+                        list_stage = ListStage::IMAGES;
+                    }
+                    else
+                    {
+                        list_stage = ListStage::END;
+                    }
+                    continue;
+                }
+
+                if (entry.isDir())
+                {
+                    entry.close();
+                    continue;
+                }
+
+                putU32(list_entry, entry.fileSize());
+                size_t name_length = 0;
+                if (list_stage == ListStage::IMAGES)
+                {
+                    memcpy(list_entry + 4, "images/", 7);
+                    name_length = 7;
+                }
+                name_length += entry.getName((char *)list_entry + 4 + name_length, MAX_NAME_LENGTH - name_length);
+                entry.close();
+
+                list_entry_length = 4 + name_length;
+            }
+
+            if (!sendPacket(PacketType::LIST_ENTRY, 0, list_entry, list_entry_length))
+            {
+                return; //USB buffer full, retry the same entry next loop
+            }
+            list_entry_length = 0;
+        }
+    }
+
+    static void handleRequest(const uint8_t *frame, size_t len)
+    {
+        if (len < HEADER_SIZE + 4 || crc32(frame, len - 4) != getU32(frame + len - 4))
+        {
+            return; //corrupt request, the host will time out and ask again
+        }
+
+        PacketType type = static_cast<PacketType>(frame[0]);
+        const uint8_t *payload = frame + HEADER_SIZE;
+        size_t payload_length = len - HEADER_SIZE - 4;
+
+        switch (type)
+        {
+        case PacketType::LIST:
+            if (list_dir.isOpen())
+            {
+                list_dir.close();
+            }
+            list_entry_length = 0;
+            if (!DataFile::initializeSD() || !list_dir.open("/", O_RDONLY))
+            {
+                sendError(ErrorCode::NO_SD);
+                return;
+            }
+            list_stage = ListStage::ROOT;
+            break;
+        case PacketType::STAT:
+            handleStat(payload, payload_length);
+            break;
+        case PacketType::READ:
+            handleRead(payload, payload_length);
+            break;
+        case PacketType::ACK:
+            if (payload_length >= 8)
+            {
+                handleAck(getU32(payload), getU32(payload + 4));
+            }
+            break;
+        case PacketType::ABORT:
+            endTransfer();
+            finished = false;
+            break;
+        default:
+            sendError(ErrorCode::BAD_REQUEST);
+            break;
+        }
+    }
+
+    /**
+     * @brief Decodes COBS request frames as bytes arrive
+     *
+     */
+    static void receive()
+    {
+        int available = SerialUSB1.available();
+        while (available-- > 0)
+        {
+            uint8_t byte = SerialUSB1.read();
+            if (byte != 0x00)
+            {
+                if (rx_length < sizeof(rx_frame))
+                {
+                    rx_frame[rx_length++] = byte;
+                }
+                else
+                {
+                    rx_overflow = true;
+                }
+                continue;
+            }
+
+            if (rx_length > 0 && !rx_overflow)
+            {
+                //COBS decode in place
+                size_t read = 0;
+                size_t write = 0;
+                bool valid = true;
+                while (read < rx_length)
+                {
+                    uint8_t code = rx_frame[read++];
+                    if (code == 0 || read + code - 1 > rx_length)
+                    {
+                        valid = false;
+                        break;
+                    }
+                    for (uint8_t i = 1; i < code; i++)
+                    {
+                        rx_frame[write++] = rx_frame[read++];
+                    }
+                    if (code < 0xFF && read < rx_length)
+                    {
+                        rx_frame[write++] = 0x00;
+                    }
+                }
+
+                if (valid)
+                {
+                    handleRequest(rx_frame, write);
+                }
+            }
+
+            rx_length = 0;
+            rx_overflow = false;
+        }
+    }
+
+    void init()
+    {
+        SerialUSB1.begin(2000000);
+    }
+
+    /**
+     * @brief Services the file transfer port. Call every loop; never blocks
+     *
+     */
+    void update()
+    {
+        receive();
+
+        if (list_stage != ListStage::IDLE)
+        {
+            continueList();
+        }
+
+        if (active)
+        {
+            //Host went quiet: assume the tail of the window was lost and resend it
+            if (millis() - last_ack_ms > RETRANSMIT_TIMEOUT_MS)
+            {
+                for (uint32_t seq = base; seq < next_read; seq++)
+                {
+                    uint32_t slot = seq % WINDOW_CHUNKS;
+                    if (!acked[slot])
+                    {
+                        pending[slot] = true;
+                    }
+                }
+                last_ack_ms = millis();
+            }
+
+            fillWindow();
+            if (active)
+            {
+                sendWindow();
+            }
+        }
+
+        if (done_pending)
+        {
+            uint8_t payload[4];
+            putU32(payload, total_length);
+            if (sendPacket(PacketType::DONE, chunk_count, payload, sizeof(payload)))
+            {
+                done_pending = false;
+            }
+        }
+    }
+
+    bool transferActive()
+    {
+        return active || list_stage != ListStage::IDLE;
+    }
+}
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file FileTransfer.h
+ * @author Daniel Kim
+ * @brief Bulk download of logs and images from the SD card over the second USB serial port
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include <Arduino.h>
+#include <cstdint>
+
+#include "../core/configuration.h"
+
+/*
+File transfer runs on SerialUSB1 (build flag USB_DUAL_SERIAL) so it never shares a parser with ElectricUI.
+Every packet is COBS encoded and delimited by 0x00:
+    uint8 type | uint32 seq | payload | uint32 crc32 (over type, seq and payload)
+
+Host -> vehicle
+    LIST                                     list dataNNN.json, ASCIINNN.csv, images/imgNNN.jpg...
+    STAT   name                              size of one file
+    READ   uint32 offset | uint32 length | name    stream a byte range (length 0 = to end of file)
+    ACK    uint32 base | uint32 bitmap        all chunks < base received, bit i = chunk base + 1 + i received
+    ABORT                                    cancel the current read
+
+Vehicle -> host
+    LIST_ENTRY  uint32 size | name
+    LIST_END
+    STAT_REPLY  uint8 exists | uint32 size
+    DATA        seq = chunk index | uint32 file offset | up to CHUNK_SIZE bytes
+    DONE        uint32 bytes sent. Sent again for any ACK of a finished read, in case it was lost
+    ERROR       uint8 code
+
+Resuming is just a READ that starts where the host's partial copy ends.
+The host tool lives in software/ground_station (fetch) and mirrors these definitions. Its loopback tool runs this file on a pty.
+*/
+
+namespace FileTransfer
+{
+    enum class PacketType : uint8_t
+    {
+        LIST = 0x01,
+        STAT = 0x02,
+        READ = 0x03,
+        ACK = 0x04,
+        ABORT = 0x05,
+
+        LIST_ENTRY = 0x81,
+        LIST_END = 0x82,
+        STAT_REPLY = 0x83,
+        DATA = 0x84,
+        DONE = 0x85,
+        ERROR = 0x86,
+    };
+
+    enum class ErrorCode : uint8_t
+    {
+        BAD_REQUEST = 1,
+        NO_SD = 2,
+        NOT_FOUND = 3,
+        READ_FAILED = 4,
+    };
+
+    constexpr uint16_t CHUNK_SIZE = 1024; // bytes of file data per DATA packet
+    constexpr uint8_t WINDOW_CHUNKS = 32; // unacknowledged chunks in flight, also the SD read-ahead
+    constexpr uint32_t RETRANSMIT_TIMEOUT_MS = 200; // resend the window if the host goes quiet
+    constexpr uint32_t BYTES_PER_UPDATE = 16 * 1024; // most we send in one loop so the control loop isn't held up
+
+    uint32_t crc32(const uint8_t *data, size_t len);
+
+    void init();
+    void update();
+
+    bool transferActive();
+}
+
+#endif
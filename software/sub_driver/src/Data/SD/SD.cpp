@@ -49,14 +49,6 @@ SD_Logger::SD_Logger(const int64_t duration, int64_t log_interval_ns)
     //Calculate log file size based on interval so we can preallocate
     m_log_file_size = (1536 * (duration / 1e+9) * 1.0 / (log_interval_ns / 1e+9)) + 10000; // 1536 bytes per log, 10000 bytes extra for safety
     m_log_interval = log_interval_ns;
-
-    //Flush files every 30 seconds to ensure data saves
-    flusher.setInterval(3e+10);
-    flusher.setFunction(SD_Logger::flush);
-
-    //Calculating sd card capacity is a very expensive function so we call it every once in a while
-    capacity_updater.setInterval(360000000000);
-    capacity_updater.setFunction(SD_Logger::getCapacity);
 } 
 
 /**
@@ -169,11 +161,25 @@ bool SD_Logger::init(bool format)
     file.print(("rmx(T),rmy(T),rmz(T),"));
     file.print(("fmx(T),fmy(T),fmz(T),"));
     file.print(("raw_TDS,filt_TDS,raw_ext_pres(atm),filt_ext_pres(atm),raw_voltage,filt_voltage,clk_speed,int_temp(°C),"));
-    file.print(("dive_limit,dive_homed,dive_current_pos,dive_current_pos_mm,dive_target_pos,dive_target_pos_mm,"));
+    file.print(("dive_limit,dive_homed,dive_homing_phase,dive_current_pos,dive_current_pos_mm,dive_target_pos,dive_target_pos_mm,"));
     file.print(("dive_speed,dive_accel,dive_max_speed,"));
-    file.print(("pitch_limit,pitch_homed,pitch_current_pos,pitch_current_pos_mm,dive_target_pos,dive_target_pos_mm,"));
+    file.print(("dive_plan_vel,dive_plan_accel,dive_plan_peak_vel,dive_plan_remaining(sec),"));
+    file.print(("pitch_limit,pitch_homed,pitch_homing_phase,pitch_current_pos,pitch_current_pos_mm,dive_target_pos,dive_target_pos_mm,"));
     file.print(("pitch_speed,pitch_accel,pitch_max_speed,"));
+    file.print(("pitch_plan_vel,pitch_plan_accel,pitch_plan_peak_vel,pitch_plan_remaining(sec),"));
+    file.print(("ctl_target_depth(m),ctl_target_rate(m/s),ctl_pitch_setpoint(deg),ctl_buoyancy_cmd,ctl_pitch_cmd,"));
+    file.print(("imu_accel_samples,imu_gyro_samples,imu_accel_skipped,imu_gyro_overruns,"));
+    file.print(("baro_samples,baro_overflows,"));
+    file.print(("accel_sample_time(ns),gyro_sample_time(ns),mag_sample_time(ns),baro_sample_time(ns),"));
+    file.print(("transitions,trans_from,trans_to,trans_event,trans_latency(us),trans_ignored,"));
     file.print(("cap_time,save_time,fifo_length,"));
+    file.print(("sched_overruns,sched_max_jitter(us),"));
+    for(uint8_t i = 0; i < Profiler::STAGE_COUNT; i++)
+    {
+        const char *stage = Profiler::stageName(static_cast<Profiler::Stage>(i));
+        file.print("prof_"); file.print(stage); file.print("_max(us),");
+        file.print("prof_"); file.print(stage); file.print("_p99(us),");
+    }
     file.print(("sd_capacity\n"));
 
     if(!file.close())
@@ -314,14 +320,14 @@ bool SD_Logger::init(bool format)
  * @brief logs our data to the SD card
  * 
  * @param data strucutre with our logged data
+ * @param time this loop's timestamp
  * @return true 
  * @return false 
  */
-bool SD_Logger::logData(LoggedData &data)
+bool SD_Logger::logData(LoggedData &data, const Time::LoopTime &time)
 {
     //Logging at a certain interval set by the constructor
-    int64_t current_time = scoped_timer.elapsed();
-    if(current_time - m_previous_log_time < m_log_interval)
+    if(time.now_ns - m_previous_log_time < m_log_interval)
     {
         return true;
     }
@@ -370,7 +376,7 @@ bool SD_Logger::logData(LoggedData &data)
                 m_write_iterations++;
             }
         }
-        m_previous_log_time = scoped_timer.elapsed(); //update the last time we logged
+        m_previous_log_time = time.now_ns; //update the last time we logged
     }
 
     /*
@@ -389,7 +395,7 @@ bool SD_Logger::logData(LoggedData &data)
     }
 
     //Update our timers continuously so they can update/flush when needed
-    flusher.void_tick(this);
+    flusher.tick(this);
     
     return true;
 }
@@ -408,7 +414,7 @@ void SD_Logger::update_sd_capacity(LoggedData &data)
         data.sd_capacity = configs.sd_cap;
         m_inital_cap_updated = true;
     }
-    capacity_updater.void_tick(data.sd_capacity);
+    capacity_updater.tick(data.sd_capacity);
 }
 
 bool SD_Logger::removeAllDataFiles()
@@ -25,6 +25,7 @@
 #include "DataFile.h"
 #include "../logged_data.h"
 #include "../../core/Timer.h"
+#include "../../core/LoopTime.h"
 #include "../../core/timed_function.h"
 #include "../../Sensors/Camera/camera.h"
 
@@ -41,7 +42,7 @@ public:
 
     bool log_crash_report();
     bool init(bool format = false);
-    bool logData(LoggedData &data);
+    bool logData(LoggedData &data, const Time::LoopTime &time);
     void setLoggingInterval(int64_t interval_ns) { m_log_interval = interval_ns; }
     uint16_t getLoggingIntervalHz();
 
@@ -70,8 +71,10 @@ private:
 
     std::queue<LoggedData> write_buf;
 
-    Time::Async<void, void*> flusher;
-    Time::Async<void, uint32_t&> capacity_updater;
+    //Flush files every 30 seconds to ensure data saves
+    Time::Periodic<SEC_TO_NS(30), void(void*), &SD_Logger::flush> flusher;
+    //Calculating sd card capacity is a very expensive function so we call it every once in a while
+    Time::Periodic<SEC_TO_NS(360), void(uint32_t&), &SD_Logger::getCapacity> capacity_updater;
 
     uint64_t m_log_file_size;
     int m_log_interval;
@@ -30,6 +30,8 @@ namespace TransportManager
 
     static bool packet_one = true; //Flag to switch between packets
 
+    static uint32_t last_command_seq = 0; //Last command sequence number seen from the GUI
+
     //Pairing telemetry data with names to transport to GUI
     //Identifiers must be unique and short to optimize data transfer
     static eui_message_t tracked_variables[] =
@@ -70,11 +72,19 @@ namespace TransportManager
         EUI_INT16("bst", telemetry_data.buoyancy.target_position),
         EUI_INT16("bss", telemetry_data.buoyancy.speed),
         EUI_INT16("bsa", telemetry_data.buoyancy.acceleration),
+        EUI_UINT8("bsh", telemetry_data.buoyancy.homing),
 
         EUI_INT16("psp", telemetry_data.pitch.current_position),
         EUI_INT16("pst", telemetry_data.pitch.target_position),
         EUI_INT16("pss", telemetry_data.pitch.speed),
         EUI_INT16("psa", telemetry_data.pitch.acceleration),
+        EUI_UINT8("psh", telemetry_data.pitch.homing),
+
+        EUI_FLOAT_ARRAY_RO("ctl", telemetry_data.control),
+
+        EUI_CUSTOM_RO("cl", telemetry_data.command_latency),
+        EUI_CUSTOM_RO("prof", telemetry_data.profile_report),
+        EUI_CUSTOM_RO("tr", telemetry_data.transition_report),
 
         //Data received from the GUI
         EUI_UINT8("ssc", telemetry_data.commands.system_state),
@@ -85,26 +95,75 @@ namespace TransportManager
         EUI_UINT8("pd", telemetry_data.commands.pitch.direction),
         EUI_UINT8("pr", telemetry_data.commands.recalibrate_pitch),
         EUI_UINT8("ap", telemetry_data.commands.auto_pitch),
+        EUI_FLOAT_ARRAY("dg", telemetry_data.commands.depth_gains),
+        EUI_FLOAT_ARRAY("pg", telemetry_data.commands.pitch_gains),
 
         EUI_FLOAT("hds", telemetry_data.commands.hitl_scale),
         EUI_UINT8("sde", telemetry_data.commands.sd_log_enable),
         EUI_UINT16("sdr", telemetry_data.commands.sd_log_interval_hz),
+
+        EUI_UINT32_ARRAY("cid", telemetry_data.command_id),
     };
 
 
-    //Serial write function
-    static eui_interface_t serial_comms = EUI_INTERFACE(&serial_write);
+    static void serial_callback(uint8_t message);
+
+    //Serial write function, and a callback per complete message
+    static eui_interface_t serial_comms = EUI_INTERFACE_CB(&serial_write, &serial_callback);
 
     /**
-     * @brief Receive data from GUI
+     * @brief Called by eui_parse once a whole message has been handled
+     * Stamps the command as soon as its id lands, not at the end of the read
      * 
+     * @param message EUI_CB_* code
+     */
+    static void serial_callback(uint8_t message)
+    {
+        if(message == EUI_CB_TRACKED && telemetry_data.command_id[0] != last_command_seq)
+        {
+            last_command_seq = telemetry_data.command_id[0];
+            CommandLatency::received(telemetry_data.command_id[0], telemetry_data.command_id[1]);
+        }
+    }
+
+    /**
+     * @brief Feeds a span of received bytes to the ElectricUI parser
+     * electricui-embedded only takes a byte at a time, so the loop stays, with nothing else in it
+     * 
+     * @param data bytes from the GUI
+     * @param len number of bytes
+     */
+    static void parseSpan(const uint8_t *data, size_t len)
+    {
+        for(size_t i = 0; i < len; i++)
+        {
+            eui_parse(data[i], &serial_comms);
+        }
+    }
+
+    /**
+     * @brief Receive data from GUI
+     * Reads in chunks and stops after RX_BYTES_PER_LOOP so a flood of commands can't stall the loop
      */
     void serial_rx_handler()
     {
-        // While we have data, we will pass those bytes to the ElectricUI parser
-        while (Serial.available() > 0)
+        uint8_t rx_buffer[RX_CHUNK_SIZE];
+        int budget = RX_BYTES_PER_LOOP;
+
+        while(budget > 0)
         {
-            eui_parse(Serial.read(), &serial_comms); // Ingest a byte
+            int available = Serial.available();
+            if(available <= 0)
+            {
+                break;
+            }
+
+            //Never ask for more than is available, otherwise readBytes waits for its timeout
+            size_t len = min(min(available, RX_CHUNK_SIZE), budget);
+            len = Serial.readBytes(reinterpret_cast<char*>(rx_buffer), len);
+
+            parseSpan(rx_buffer, len);
+            budget -= len;
         }
     }
 
@@ -136,10 +195,11 @@ namespace TransportManager
      * @brief Sends and receives data to the GUI
      * 
      * @param logged_data shared packet between gui and computer
+     * @param time this loop's timestamp
      * @return true change state to idle
      * @return false keep current state
      */
-    bool handleTransport(LoggedData &logged_data)
+    bool handleTransport(LoggedData &logged_data, const Time::LoopTime &time)
     {
         serial_rx_handler();
 
@@ -147,17 +207,34 @@ namespace TransportManager
          * @brief Sends data to GUI within the interval
          * Sends data in two packets to stay within UART buffer size
          */
-        int64_t current_time = scoped_timer.elapsed();
-        if(current_time - previous_telem_send_time <= SEND_INTERVAL)
+        if(time.now_ns - previous_telem_send_time <= SEND_INTERVAL)
         {
             return false;
         }
         else
         {
-            previous_telem_send_time = current_time;
+            previous_telem_send_time = time.now_ns;
 
             telemetry_data.convert(logged_data); //Convert logged data to telemetry data
 
+            //Latency reports go out as soon as they're complete, whichever packet is due
+            if(CommandLatency::reportReady(telemetry_data.command_latency))
+            {
+                eui_send_tracked("cl");
+            }
+
+            //One stage of the last profiler window per packet until all have been sent
+            if(Profiler::nextReport(telemetry_data.profile_report))
+            {
+                eui_send_tracked("prof");
+            }
+
+            //State transitions oldest first, one per packet
+            if(transition_trace.nextReport(telemetry_data.transition_report))
+            {
+                eui_send_tracked("tr");
+            }
+
             //Send data to GUI
             if(packet_one)
             {
@@ -198,11 +275,15 @@ namespace TransportManager
                 eui_send_tracked("bst");
                 eui_send_tracked("bss");
                 eui_send_tracked("bsa");
+                eui_send_tracked("bsh");
 
                 eui_send_tracked("psp");
                 eui_send_tracked("pst");
                 eui_send_tracked("pss");
                 eui_send_tracked("psa");
+                eui_send_tracked("psh");
+
+                eui_send_tracked("ctl");
 
                 eui_send_tracked("ap");
 
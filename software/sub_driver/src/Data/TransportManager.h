@@ -15,7 +15,10 @@
 #include <electricui.h>
 
 #include "../core/configuration.h"
+#include "../core/LoopTime.h"
 #include "logged_data.h"
+#include "CommandLatency.h"
+#include "../core/StateAutomation.h"
 
 namespace TransportManager
 {
@@ -36,6 +39,10 @@ namespace TransportManager
         uint8_t recalibrate_pitch = false;
         uint8_t auto_pitch = false;
 
+        //kp, ki, kd of the depth and pitch controllers. Written by the GUI to tune while running
+        float depth_gains[3] = { Control::DEPTH_KP, Control::DEPTH_KI, Control::DEPTH_KD };
+        float pitch_gains[3] = { Control::PITCH_KP, Control::PITCH_KI, Control::PITCH_KD };
+
         float hitl_scale = 0;
 
         uint8_t sd_log_enable = 1;
@@ -48,6 +55,7 @@ namespace TransportManager
         int16_t target_position = 0;
         int16_t speed = 0;
         int16_t acceleration = 0;
+        uint8_t homing = 0; // Mechanics::HomingPhase
     };
     
     class Packet
@@ -82,8 +90,16 @@ namespace TransportManager
         StepperInfo buoyancy;
         StepperInfo pitch;
 
+        float control[5] = { 0.f }; //target depth, depth, pitch setpoint, pitch, target dive rate
+
         Commands commands = {};
 
+        uint32_t command_id[2] = { 0 }; //sequence number, host send time. Written by the GUI after each command
+        CommandLatency::Report command_latency;
+
+        Profiler::StageReport profile_report;
+        TransitionRecord transition_report;
+
         /**
          * @brief Converts the data within LoggedData to the format needed for transmission by the GUI
          * 32 bit float used instead of 64 bit double to save bandwidth
@@ -141,11 +157,19 @@ namespace TransportManager
             buoyancy.current_position = static_cast<int16_t>(data.dive_stepper.current_position);
             buoyancy.target_position = static_cast<int16_t>(data.dive_stepper.target_position);
             buoyancy.speed = static_cast<int16_t>(data.dive_stepper.speed);
+            buoyancy.homing = data.dive_stepper.homing_phase;
 
             pitch.acceleration = static_cast<int16_t>(data.pitch_stepper.acceleration);
             pitch.current_position = static_cast<int16_t>(data.pitch_stepper.current_position) * -1;
             pitch.target_position = static_cast<int16_t>(data.pitch_stepper.target_position);
             pitch.speed = static_cast<int16_t>(data.pitch_stepper.speed);
+            pitch.homing = data.pitch_stepper.homing_phase;
+
+            control[0] = static_cast<float>(data.control.target_depth);
+            control[1] = static_cast<float>(data.depth);
+            control[2] = static_cast<float>(data.control.pitch_setpoint);
+            control[3] = static_cast<float>(data.rel_ori.y);
+            control[4] = static_cast<float>(data.control.target_rate);
 
             buoyancy.acceleration = std::abs<int16_t>(buoyancy.acceleration);
             buoyancy.current_position = std::abs<int16_t>(buoyancy.current_position);
@@ -165,7 +189,7 @@ namespace TransportManager
 
     void init();
 
-    bool handleTransport(LoggedData &logged_data);
+    bool handleTransport(LoggedData &logged_data, const Time::LoopTime &time);
 
     Commands getCommands();
 
@@ -16,16 +16,19 @@
 #include <ArduinoJson.h>
 #include <electricui.h>
 
+#include "../core/Profiler.h"
+
 #define ARDUINO_JSON_USE_DOUBLE 0
 #define ARDUINO_JSON_USE_LONG_LONG 0
 
-static constexpr int STATIC_JSON_DOC_SIZE = 1536;
+static constexpr int STATIC_JSON_DOC_SIZE = 2816;
 static constexpr int TELEM_STATIC_JSON_DOC_SIZE = 512;
 
 struct StepperData
 {
     bool limit_state;
     bool homed;
+    uint8_t homing_phase; // Mechanics::HomingPhase
     double current_position;
     double current_position_mm;
 
@@ -35,6 +38,12 @@ struct StepperData
     double speed;
     double acceleration;
     double max_speed;
+
+    //S-curve plan at the last planned step
+    double planned_velocity;
+    double planned_acceleration;
+    double planned_peak_velocity;
+    double plan_remaining; // seconds
 };
 
 struct OpticalData
@@ -44,6 +53,65 @@ struct OpticalData
     uint32_t FIFO_length;
 };
 
+//Depth and pitch controller, updated at Control::PERIOD
+struct ControlData
+{
+    double target_depth; // m
+    double target_rate; // m/s, smoothed
+    double pitch_setpoint; // degrees
+    int32_t buoyancy_command; // half steps
+    int32_t pitch_command; // half steps
+};
+
+//BMI088 FIFO reads in this loop
+struct ImuFifoData
+{
+    uint16_t accel_samples;
+    uint16_t gyro_samples;
+    uint32_t accel_skipped; // frames lost to a full FIFO since startup
+    uint32_t gyro_overruns; // reads that found the FIFO overrun since startup
+};
+
+//BMP388 FIFO drains, raw_bmp holds the decimated output
+struct BaroFifoData
+{
+    uint16_t samples; // read in the last drain
+    uint32_t overflows; // drains that found the FIFO full since startup
+};
+
+//When the newest reading of each sensor was sampled, on the loop clock (ns)
+struct SampleTimes
+{
+    int64_t accel_ns; // from the FIFO sensor time
+    int64_t gyro_ns; // from the FIFO watermark interrupt
+    int64_t mag_ns; // from the data ready interrupt
+    int64_t baro_ns; // middle of the last decimated block
+};
+
+//Latest state transition, see StateAutomation.h
+struct TransitionData
+{
+    uint32_t count;
+    uint8_t from;
+    uint8_t to;
+    uint8_t event;
+    uint32_t latency_us;
+    uint32_t ignored; // events raised in a state that doesn't handle them
+};
+
+struct SchedulerData
+{
+    uint32_t overruns;
+    uint32_t max_jitter_us;
+};
+
+//Per loop stage, indexed by Profiler::Stage. Updated once a second
+struct ProfileData
+{
+    uint32_t max_us[Profiler::STAGE_COUNT];
+    uint32_t p99_us[Profiler::STAGE_COUNT];
+};
+
 template <typename T>
 struct Location
 {
@@ -121,6 +189,10 @@ struct LoggedData
     Angles_3D<double> rgyr;
     Angles_3D<double> rel_ori;
 
+    ImuFifoData imu_fifo;
+    BaroFifoData baro_fifo;
+    SampleTimes sample_time;
+
     Angles_4D relative;
 
     Angles_3D<double> rmag;
@@ -140,8 +212,16 @@ struct LoggedData
     StepperData dive_stepper;
     StepperData pitch_stepper;
 
+    ControlData control;
+
+    TransitionData transition;
+
     OpticalData optical_data;
 
+    SchedulerData scheduler;
+
+    ProfileData profile;
+
     /**
      * @brief Prints out all the data to a printing object
      *
@@ -275,6 +355,8 @@ struct LoggedData
         p.print(delim);
         p.print(data.dive_stepper.homed);
         p.print(delim);
+        p.print(data.dive_stepper.homing_phase);
+        p.print(delim);
         p.print(data.dive_stepper.current_position);
         p.print(delim);
         p.print(data.dive_stepper.current_position_mm);
@@ -289,10 +371,20 @@ struct LoggedData
         p.print(delim);
         p.print(data.dive_stepper.max_speed);
         p.print(delim);
+        p.print(data.dive_stepper.planned_velocity);
+        p.print(delim);
+        p.print(data.dive_stepper.planned_acceleration);
+        p.print(delim);
+        p.print(data.dive_stepper.planned_peak_velocity);
+        p.print(delim);
+        p.print(data.dive_stepper.plan_remaining);
+        p.print(delim);
         p.print(data.pitch_stepper.limit_state);
         p.print(delim);
         p.print(data.pitch_stepper.homed);
         p.print(delim);
+        p.print(data.pitch_stepper.homing_phase);
+        p.print(delim);
         p.print(data.pitch_stepper.current_position);
         p.print(delim);
         p.print(data.pitch_stepper.current_position_mm);
@@ -307,11 +399,72 @@ struct LoggedData
         p.print(delim);
         p.print(data.pitch_stepper.max_speed);
         p.print(delim);
+        p.print(data.pitch_stepper.planned_velocity);
+        p.print(delim);
+        p.print(data.pitch_stepper.planned_acceleration);
+        p.print(delim);
+        p.print(data.pitch_stepper.planned_peak_velocity);
+        p.print(delim);
+        p.print(data.pitch_stepper.plan_remaining);
+        p.print(delim);
+        p.print(data.control.target_depth);
+        p.print(delim);
+        p.print(data.control.target_rate);
+        p.print(delim);
+        p.print(data.control.pitch_setpoint);
+        p.print(delim);
+        p.print(data.control.buoyancy_command);
+        p.print(delim);
+        p.print(data.control.pitch_command);
+        p.print(delim);
+        p.print(data.imu_fifo.accel_samples);
+        p.print(delim);
+        p.print(data.imu_fifo.gyro_samples);
+        p.print(delim);
+        p.print(data.imu_fifo.accel_skipped);
+        p.print(delim);
+        p.print(data.imu_fifo.gyro_overruns);
+        p.print(delim);
+        p.print(data.baro_fifo.samples);
+        p.print(delim);
+        p.print(data.baro_fifo.overflows);
+        p.print(delim);
+        p.print(data.sample_time.accel_ns);
+        p.print(delim);
+        p.print(data.sample_time.gyro_ns);
+        p.print(delim);
+        p.print(data.sample_time.mag_ns);
+        p.print(delim);
+        p.print(data.sample_time.baro_ns);
+        p.print(delim);
+        p.print(data.transition.count);
+        p.print(delim);
+        p.print(data.transition.from);
+        p.print(delim);
+        p.print(data.transition.to);
+        p.print(delim);
+        p.print(data.transition.event);
+        p.print(delim);
+        p.print(data.transition.latency_us);
+        p.print(delim);
+        p.print(data.transition.ignored);
+        p.print(delim);
         p.print(data.optical_data.capture_time);
         p.print(delim);
         p.print(data.optical_data.save_time);
         p.print(delim);
         p.print(data.optical_data.FIFO_length);
+        p.print(delim);
+        p.print(data.scheduler.overruns);
+        p.print(delim);
+        p.print(data.scheduler.max_jitter_us);
+        for (uint8_t i = 0; i < Profiler::STAGE_COUNT; i++)
+        {
+            p.print(delim);
+            p.print(data.profile.max_us[i]);
+            p.print(delim);
+            p.print(data.profile.p99_us[i]);
+        }
         p.print("\n");
     }
 
@@ -401,6 +554,7 @@ struct LoggedData
         JsonArray step_data = doc.createNestedArray("step_data");
         step_data.add(data.dive_stepper.limit_state);
         step_data.add(data.dive_stepper.homed);
+        step_data.add(data.dive_stepper.homing_phase);
         step_data.add(data.dive_stepper.current_position);
         step_data.add(data.dive_stepper.current_position_mm);
         step_data.add(data.dive_stepper.target_position);
@@ -408,9 +562,14 @@ struct LoggedData
         step_data.add(data.dive_stepper.speed);
         step_data.add(data.dive_stepper.acceleration);
         step_data.add(data.dive_stepper.max_speed);
+        step_data.add(data.dive_stepper.planned_velocity);
+        step_data.add(data.dive_stepper.planned_acceleration);
+        step_data.add(data.dive_stepper.planned_peak_velocity);
+        step_data.add(data.dive_stepper.plan_remaining);
 
         step_data.add(data.pitch_stepper.limit_state);
         step_data.add(data.pitch_stepper.homed);
+        step_data.add(data.pitch_stepper.homing_phase);
         step_data.add(data.pitch_stepper.current_position);
         step_data.add(data.pitch_stepper.current_position_mm);
         step_data.add(data.pitch_stepper.target_position);
@@ -418,11 +577,58 @@ struct LoggedData
         step_data.add(data.pitch_stepper.speed);
         step_data.add(data.pitch_stepper.acceleration);
         step_data.add(data.pitch_stepper.max_speed);
+        step_data.add(data.pitch_stepper.planned_velocity);
+        step_data.add(data.pitch_stepper.planned_acceleration);
+        step_data.add(data.pitch_stepper.planned_peak_velocity);
+        step_data.add(data.pitch_stepper.plan_remaining);
+
+        JsonArray control_data = doc.createNestedArray("control");
+        control_data.add(data.control.target_depth);
+        control_data.add(data.control.target_rate);
+        control_data.add(data.control.pitch_setpoint);
+        control_data.add(data.control.buoyancy_command);
+        control_data.add(data.control.pitch_command);
+
+        JsonArray fifo_data = doc.createNestedArray("imu_fifo");
+        fifo_data.add(data.imu_fifo.accel_samples);
+        fifo_data.add(data.imu_fifo.gyro_samples);
+        fifo_data.add(data.imu_fifo.accel_skipped);
+        fifo_data.add(data.imu_fifo.gyro_overruns);
+
+        JsonArray baro_fifo_data = doc.createNestedArray("baro_fifo");
+        baro_fifo_data.add(data.baro_fifo.samples);
+        baro_fifo_data.add(data.baro_fifo.overflows);
+
+        JsonArray sample_time_data = doc.createNestedArray("sample_t");
+        sample_time_data.add(data.sample_time.accel_ns);
+        sample_time_data.add(data.sample_time.gyro_ns);
+        sample_time_data.add(data.sample_time.mag_ns);
+        sample_time_data.add(data.sample_time.baro_ns);
+
+        JsonArray transition_data = doc.createNestedArray("trans");
+        transition_data.add(data.transition.count);
+        transition_data.add(data.transition.from);
+        transition_data.add(data.transition.to);
+        transition_data.add(data.transition.event);
+        transition_data.add(data.transition.latency_us);
+        transition_data.add(data.transition.ignored);
 
         JsonArray optics_data = doc.createNestedArray("optics");
         optics_data.add(data.optical_data.capture_time);
         optics_data.add(data.optical_data.save_time);
         optics_data.add(data.optical_data.FIFO_length);
+
+        JsonArray scheduler_data = doc.createNestedArray("sched");
+        scheduler_data.add(data.scheduler.overruns);
+        scheduler_data.add(data.scheduler.max_jitter_us);
+
+        //max, p99 pairs per stage
+        JsonArray profile_data = doc.createNestedArray("profile");
+        for (uint8_t i = 0; i < Profiler::STAGE_COUNT; i++)
+        {
+            profile_data.add(data.profile.max_us[i]);
+            profile_data.add(data.profile.p99_us[i]);
+        }
     }
 };
 
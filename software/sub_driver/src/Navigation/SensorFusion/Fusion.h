@@ -2,6 +2,7 @@
 #define FUSION_H
 
 #include "../../Data/logged_data.h"
+#include "../../Sensors/Sensors.h"
 #include "SensorFusion.h"
 #include "../Orientation.h"
 
@@ -10,15 +11,64 @@ class Fusion
 public:
     Fusion() {}
     SF filter;
-    void update(LoggedData &data)
+
+    /**
+     * @brief One filter step per gyro sample in the batch, each with its own dt
+     * Uses the newest accel and mag samples at or before the gyro sample
+     */
+    void update(LoggedData &data, const Sensors::ImuBatch &batch)
     {
-        filter.MadgwickUpdate(data.rgyr.x, data.rgyr.y, data.rgyr.z, data.racc.x, data.racc.y, data.racc.z, data.rmag.x, data.rmag.y, data.rmag.z, data.delta_time);
+        if (data.sample_time.mag_ns != m_pending_mag_ns)
+        {
+            m_pending_mag = data.rmag;
+            m_pending_mag_ns = data.sample_time.mag_ns;
+            m_mag_pending = true;
+        }
+
+        uint16_t a = 0;
+        for (uint16_t g = 0; g < batch.gyro_count; g++)
+        {
+            const Bmi088Sample &gyro = batch.gyro[g];
+            while (a < batch.accel_count && batch.accel[a].time_ns <= gyro.time_ns)
+            {
+                m_accel = batch.accel[a++];
+            }
+            if (m_mag_pending && m_pending_mag_ns <= gyro.time_ns)
+            {
+                m_mag = m_pending_mag;
+                m_mag_pending = false;
+            }
+
+            double dt = (gyro.time_ns - m_previous_gyro_ns) / 1000000000.0;
+            m_previous_gyro_ns = gyro.time_ns;
+            if (dt <= 0.0 || dt > MAX_STEP)
+            {
+                continue; // first sample, or a gap we can't integrate over
+            }
+
+            filter.MadgwickUpdate(gyro.x, gyro.y, gyro.z, m_accel.x, m_accel.y, m_accel.z, m_mag.x, m_mag.y, m_mag.z, dt);
+        }
+
+        if (batch.accel_count > 0)
+        {
+            m_accel = batch.accel[batch.accel_count - 1];
+        }
 
         data.rel_ori.x = filter.getRoll();
         data.rel_ori.y = filter.getPitch();
         data.rel_ori.z = filter.getYaw();
     }
 
+private:
+    static constexpr double MAX_STEP = 0.1; // s
+
+    Bmi088Sample m_accel = {0, 0.0, 0.0, 0.0}; // no accel correction until the first accel sample
+    int64_t m_previous_gyro_ns = 0;
+
+    Angles_3D<double> m_mag = {0.0, 0.0, 0.0};
+    Angles_3D<double> m_pending_mag = {0.0, 0.0, 0.0}; // read but not yet reached by the gyro samples
+    int64_t m_pending_mag_ns = 0;
+    bool m_mag_pending = false;
 };
 
-#endif
\ No newline at end of file
+#endif
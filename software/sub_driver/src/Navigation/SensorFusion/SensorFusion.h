@@ -45,8 +45,8 @@ public:
 	//const double DEG_TO_RAD = 0.0174532925199433f; //PI/180.0f;	
 	//const double RAD_TO_DEG = 57.29577951308233f; //180.0f/PI
 	
-	double deltatUpdate (){
-		Now = scoped_timer.elapsed();
+	double deltatUpdate (int64_t now_ns){
+		Now = now_ns;
 		deltat = ((Now - lastUpdate) / 1000000000.0); // set integration time by time elapsed since last filter update
 		lastUpdate = Now;
 		return deltat;
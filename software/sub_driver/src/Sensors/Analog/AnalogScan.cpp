@@ -0,0 +1,126 @@
+/**
+ * @file AnalogScan.cpp
+ * @author Daniel Kim
+ * @brief Continuous scan of the analog inputs, oversampled down to one latest value per channel
+ * @version 0.1
+ * @date 2023-05-25
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "AnalogScan.h"
+
+namespace Analog
+{
+    void Backend::deliver(const volatile uint16_t *frames, uint16_t frame_count)
+    {
+        if (m_scan != nullptr)
+        {
+            m_scan->process(frames, frame_count);
+        }
+    }
+
+    /**
+     * @brief Adds a pin to the scan. Pins can be shared, each add gets its own channel
+     *
+     * @param pin analog pin
+     * @param oversampling frames averaged into each output
+     * @param sink optional, gets every result of the channel
+     * @return int8_t channel to read with, -1 if the scan is full or already running
+     */
+    int8_t AnalogScan::add(uint8_t pin, uint16_t oversampling, SampleSink *sink)
+    {
+        if (m_running || m_count >= MAX_CHANNELS)
+        {
+            return -1;
+        }
+
+        m_pins[m_count] = pin;
+        m_channels[m_count].oversampling = oversampling > 0 ? oversampling : 1;
+        m_channels[m_count].sink = sink;
+        return static_cast<int8_t>(m_count++);
+    }
+
+    /**
+     * @brief Starts the backend on every channel added so far
+     *
+     * @return false no channels, or the backend couldn't convert one of the pins
+     */
+    bool AnalogScan::begin()
+    {
+        if (m_running || m_count == 0)
+        {
+            return m_running;
+        }
+
+        m_running = m_backend.start(m_pins, m_count);
+        return m_running;
+    }
+
+    float AnalogScan::counts(int8_t channel) const
+    {
+        if (channel < 0 || channel >= m_count)
+        {
+            return 0.0f;
+        }
+        return m_channels[channel].latest;
+    }
+
+    uint32_t AnalogScan::updates(int8_t channel) const
+    {
+        if (channel < 0 || channel >= m_count)
+        {
+            return 0;
+        }
+        return m_channels[channel].updates;
+    }
+
+    bool AnalogScan::ready() const
+    {
+        if (!m_running)
+        {
+            return false;
+        }
+        for (uint8_t c = 0; c < m_count; c++)
+        {
+            if (m_channels[c].updates == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Averages a block of frames into the channels
+     *
+     * @param frames frame_count * size() results, channel order within each frame
+     */
+    void AnalogScan::process(const volatile uint16_t *frames, uint16_t frame_count)
+    {
+        for (uint16_t f = 0; f < frame_count; f++)
+        {
+            const volatile uint16_t *frame = frames + f * m_count;
+            for (uint8_t c = 0; c < m_count; c++)
+            {
+                Channel &channel = m_channels[c];
+                const uint16_t result = frame[c];
+                if (channel.sink != nullptr)
+                {
+                    channel.sink->push(result);
+                }
+
+                channel.sum += result;
+                if (++channel.count >= channel.oversampling)
+                {
+                    channel.latest = static_cast<float>(channel.sum) / channel.count;
+                    channel.updates = channel.updates + 1;
+                    channel.sum = 0;
+                    channel.count = 0;
+                }
+            }
+        }
+        m_frames = m_frames + frame_count;
+    }
+}
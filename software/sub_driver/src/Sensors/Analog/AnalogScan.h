@@ -0,0 +1,113 @@
+/**
+ * @file AnalogScan.h
+ * @author Daniel Kim
+ * @brief Continuous scan of the analog inputs, oversampled down to one latest value per channel
+ * @version 0.1
+ * @date 2023-05-25
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef ANALOGSCAN_H
+#define ANALOGSCAN_H
+
+#include <cstdint>
+
+/*
+Sensors register their pin once, then read the latest value whenever they like instead of waiting
+on analogRead. A backend converts every channel in turn, over and over, and hands over blocks of
+frames (one 12 bit result per channel, in the order they were added):
+    DmaAdc: ADC1 with hardware averaging, results and channel switches done by DMA on the Teensy
+    SimulatedAdc: set levels, for running the sensors on the host
+Each channel averages its own number of frames into one output, so noisy inputs like the transducer
+get more than 12 bits out of it. Reads are a single word, safe against the block interrupt.
+A channel can also have a SampleSink, which gets every frame's result as it's processed (from the
+block interrupt on the Teensy), for filtering at the full frame rate.
+No Arduino dependencies.
+*/
+
+namespace Analog
+{
+    class AnalogScan;
+
+    /**
+     * @brief Converts the channels continuously and calls AnalogScan::process with each block
+     *
+     */
+    class Backend
+    {
+    public:
+        virtual ~Backend() {}
+        virtual bool start(const uint8_t *pins, uint8_t count) = 0;
+
+        void bind(AnalogScan *scan) { m_scan = scan; }
+
+    protected:
+        void deliver(const volatile uint16_t *frames, uint16_t frame_count);
+
+    private:
+        AnalogScan *m_scan = nullptr;
+    };
+
+    /**
+     * @brief Takes a channel's results one frame at a time. Called from the block interrupt, keep it short
+     *
+     */
+    class SampleSink
+    {
+    public:
+        virtual ~SampleSink() {}
+        virtual void push(uint16_t counts) = 0;
+    };
+
+    class AnalogScan
+    {
+    public:
+        static constexpr uint8_t MAX_CHANNELS = 8;
+        static constexpr uint16_t DEFAULT_OVERSAMPLING = 64; // frames per output
+        static constexpr float FULL_SCALE = 4095.0f; // 12 bit
+
+        explicit AnalogScan(Backend &backend) : m_backend(backend) { backend.bind(this); }
+
+        //Setup, before begin
+
+        int8_t add(uint8_t pin, uint16_t oversampling = DEFAULT_OVERSAMPLING, SampleSink *sink = nullptr);
+        bool begin();
+
+        //Readers, O(1)
+
+        float counts(int8_t channel) const; // average, 0 to FULL_SCALE
+        double fraction(int8_t channel) const { return counts(channel) / FULL_SCALE; } // of the reference voltage
+        uint32_t updates(int8_t channel) const; // outputs so far, 0 until the first block is averaged
+        bool ready() const; // every channel has an output
+
+        uint8_t size() const { return m_count; }
+        bool running() const { return m_running; }
+        uint32_t frames() const { return m_frames; }
+
+        //Backend side, usually from an interrupt
+
+        void process(const volatile uint16_t *frames, uint16_t frame_count);
+
+    private:
+        struct Channel
+        {
+            uint16_t oversampling = DEFAULT_OVERSAMPLING;
+            SampleSink *sink = nullptr;
+            uint16_t count = 0; // frames in sum
+            uint32_t sum = 0;
+            volatile float latest = 0.0f;
+            volatile uint32_t updates = 0;
+        };
+
+        Backend &m_backend;
+        uint8_t m_pins[MAX_CHANNELS] = {};
+        Channel m_channels[MAX_CHANNELS];
+        uint8_t m_count = 0;
+        bool m_running = false;
+        volatile uint32_t m_frames = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * @file DmaAdc.cpp
+ * @author Daniel Kim
+ * @brief Analog scan backend on the Teensy 4.1's ADC1, run by DMA
+ * @version 0.1
+ * @date 2023-05-25
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "DmaAdc.h"
+
+#if defined(CORE_TEENSY)
+    #include <Arduino.h>
+    #include <DMAChannel.h>
+
+    extern const uint8_t pin_to_channel[]; // teensy4/analog.c, also used by analogRead
+#endif
+
+namespace Analog
+{
+#if defined(CORE_TEENSY)
+
+    static constexpr uint8_t ADC2_ONLY = 0x80; // pin_to_channel flag
+    static constexpr uint8_t NOT_ANALOG = 0xFF;
+    static constexpr uint8_t PIN_COUNT = 42;
+
+    static DmaAdc *instance = nullptr;
+    static DMAChannel result_dma(false);
+    static DMAChannel next_dma(false);
+
+    // DTCM, so the CPU and the DMA agree on the contents without cache maintenance
+    static volatile uint16_t results[2 * DmaAdc::HALF_FRAMES * AnalogScan::MAX_CHANNELS] __attribute__((aligned(32)));
+    static uint32_t next_channels[AnalogScan::MAX_CHANNELS];
+
+    static void dmaISR()
+    {
+        instance->isr();
+    }
+
+    static uint32_t averagingSelect(uint8_t averaging)
+    {
+        switch (averaging)
+        {
+        case 4:
+            return ADC_CFG_AVGS(0);
+        case 8:
+            return ADC_CFG_AVGS(1);
+        case 16:
+            return ADC_CFG_AVGS(2);
+        default:
+            return ADC_CFG_AVGS(3);
+        }
+    }
+
+    /**
+     * @brief Sets up ADC1 and the DMA channels and starts the first conversion
+     *
+     * @return false a pin isn't on ADC1, or the calibration failed
+     */
+    bool DmaAdc::start(const uint8_t *pins, uint8_t count)
+    {
+        if (count == 0 || count > AnalogScan::MAX_CHANNELS)
+        {
+            return false;
+        }
+
+        uint8_t channels[AnalogScan::MAX_CHANNELS];
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint8_t channel = pins[i] < PIN_COUNT ? pin_to_channel[pins[i]] : NOT_ANALOG;
+            if (channel == NOT_ANALOG || (channel & ADC2_ONLY))
+            {
+                return false;
+            }
+            channels[i] = channel;
+        }
+
+        instance = this;
+        m_count = count;
+
+        // 12 bit, long sample time, ADCK = IPG / 4, then calibrate with that configuration
+        ADC1_GC = 0;
+        ADC1_CFG = ADC_CFG_MODE(2) | ADC_CFG_ADSTS(3) | ADC_CFG_ADLSMP | ADC_CFG_ADIV(2) | ADC_CFG_ADICLK(0) | averagingSelect(HARDWARE_AVERAGING);
+        ADC1_GC = ADC_GC_AVGE | ADC_GC_CAL;
+        while (ADC1_GC & ADC_GC_CAL)
+        {
+        }
+        if (ADC1_GS & ADC_GS_CALF)
+        {
+            return false;
+        }
+        ADC1_GC = ADC_GC_AVGE | ADC_GC_DMAEN;
+
+        // Each result triggers the write of the one after next, so the list is rotated by one
+        for (uint8_t i = 0; i < count; i++)
+        {
+            next_channels[i] = ADC_HC_ADCH(channels[(i + 1) % count]);
+        }
+
+        result_dma.begin();
+        result_dma.source((volatile uint16_t &)ADC1_R0);
+        result_dma.destinationBuffer(results, 2 * HALF_FRAMES * count * sizeof(uint16_t));
+        result_dma.interruptAtHalf();
+        result_dma.interruptAtCompletion();
+        result_dma.attachInterrupt(dmaISR);
+        result_dma.triggerAtHardwareEvent(DMAMUX_SOURCE_ADC1);
+
+        next_dma.begin();
+        next_dma.sourceBuffer(next_channels, count * sizeof(uint32_t));
+        next_dma.destination(ADC1_HC0);
+        next_dma.triggerAtTransfersOf(result_dma);
+
+        next_dma.enable();
+        result_dma.enable();
+
+        ADC1_HC0 = ADC_HC_ADCH(channels[0]);
+        return true;
+    }
+
+    /**
+     * @brief Hands over the half of the buffer the DMA just finished
+     *
+     */
+    void DmaAdc::isr()
+    {
+        result_dma.clearInterrupt();
+
+        const uint16_t half = HALF_FRAMES * m_count;
+        const volatile uint16_t *writing = static_cast<const volatile uint16_t *>(result_dma.destinationAddress());
+        const volatile uint16_t *done = writing >= results + half ? results : results + half;
+        deliver(done, HALF_FRAMES);
+
+        asm("DSB");
+    }
+
+#else
+
+    bool DmaAdc::start(const uint8_t *, uint8_t)
+    {
+        return false;
+    }
+
+    void DmaAdc::isr()
+    {
+    }
+
+#endif
+}
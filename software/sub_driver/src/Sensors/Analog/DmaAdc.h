@@ -0,0 +1,47 @@
+/**
+ * @file DmaAdc.h
+ * @author Daniel Kim
+ * @brief Analog scan backend on the Teensy 4.1's ADC1, run by DMA
+ * @version 0.1
+ * @date 2023-05-25
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef DMAADC_H
+#define DMAADC_H
+
+#include <cstdint>
+
+#include "AnalogScan.h"
+
+/*
+ADC1 runs at 12 bits with HARDWARE_AVERAGING conversions averaged into each result. Two DMA channels
+keep it going without the CPU:
+    result: ADC1_R0 into a circular buffer on every conversion complete request
+    next: linked to each result transfer, writes the next channel into ADC1_HC0, which starts it
+The result channel interrupts at each half of the buffer, and the finished half goes to
+AnalogScan::process. Roughly 20 us per conversion, so five channels give about 9k frames/s.
+analogRead mustn't be used on ADC1 after begin. Pins only on ADC2 (A12, A13, A14, A15) aren't supported.
+On the host start() fails, use SimulatedAdc there.
+*/
+
+namespace Analog
+{
+    class DmaAdc : public Backend
+    {
+    public:
+        static constexpr uint8_t HARDWARE_AVERAGING = 32; // 4, 8, 16 or 32
+        static constexpr uint16_t HALF_FRAMES = 16; // frames per block handed over
+
+        bool start(const uint8_t *pins, uint8_t count) override;
+
+        void isr();
+
+    private:
+        uint8_t m_count = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file SimulatedAdc.cpp
+ * @author Daniel Kim
+ * @brief Analog scan backend with set input levels, for running the sensors on the host
+ * @version 0.1
+ * @date 2023-05-25
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "SimulatedAdc.h"
+
+#include <cmath>
+
+namespace Analog
+{
+    bool SimulatedAdc::start(const uint8_t *pins, uint8_t count)
+    {
+        if (count > AnalogScan::MAX_CHANNELS)
+        {
+            return false;
+        }
+
+        m_count = count;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            m_pins[i] = pins[i];
+        }
+        return true;
+    }
+
+    void SimulatedAdc::setCounts(uint8_t pin, double counts)
+    {
+        counts = counts < 0.0 ? 0.0 : (counts > AnalogScan::FULL_SCALE ? AnalogScan::FULL_SCALE : counts);
+        for (uint8_t i = 0; i < m_count; i++)
+        {
+            if (m_pins[i] == pin)
+            {
+                m_levels[i] = counts;
+            }
+        }
+    }
+
+    void SimulatedAdc::run(uint32_t frames)
+    {
+        while (frames > 0)
+        {
+            uint16_t block = frames < BLOCK_FRAMES ? static_cast<uint16_t>(frames) : BLOCK_FRAMES;
+            for (uint16_t f = 0; f < block; f++)
+            {
+                for (uint8_t c = 0; c < m_count; c++)
+                {
+                    // First order noise shaping: the codes average out to the level
+                    double code = std::floor(m_levels[c] + m_error[c] + 0.5);
+                    m_error[c] += m_levels[c] - code;
+                    m_block[f * m_count + c] = static_cast<uint16_t>(code);
+                }
+            }
+            deliver(m_block, block);
+            frames -= block;
+        }
+    }
+}
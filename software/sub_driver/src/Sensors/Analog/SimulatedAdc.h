@@ -0,0 +1,44 @@
+/**
+ * @file SimulatedAdc.h
+ * @author Daniel Kim
+ * @brief Analog scan backend with set input levels, for running the sensors on the host
+ * @version 0.1
+ * @date 2023-05-25
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef SIMULATEDADC_H
+#define SIMULATEDADC_H
+
+#include <cstdint>
+
+#include "AnalogScan.h"
+
+namespace Analog
+{
+    /**
+     * @brief Levels can be between codes: the results dither between the two codes around it, so
+     * oversampling can be checked for the resolution it adds
+     */
+    class SimulatedAdc : public Backend
+    {
+    public:
+        static constexpr uint16_t BLOCK_FRAMES = 16;
+
+        bool start(const uint8_t *pins, uint8_t count) override;
+
+        void setCounts(uint8_t pin, double counts); // every channel on the pin
+        void run(uint32_t frames); // converts that many frames, handed over in blocks
+
+    private:
+        uint8_t m_pins[AnalogScan::MAX_CHANNELS] = {};
+        double m_levels[AnalogScan::MAX_CHANNELS] = {};
+        double m_error[AnalogScan::MAX_CHANNELS] = {}; // dither state
+        uint8_t m_count = 0;
+        uint16_t m_block[BLOCK_FRAMES * AnalogScan::MAX_CHANNELS];
+    };
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file AnalogConversions.h
+ * @author Daniel Kim
+ * @brief Analog sensor transfer functions, as compile time tables and constants
+ * @version 0.1
+ * @date 2023-05-26
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef ANALOGCONVERSIONS_H
+#define ANALOGCONVERSIONS_H
+
+#include "constants.h"
+#include "LookupTable.h"
+#include "Analog/AnalogScan.h"
+
+/*
+Inputs are in ADC counts from Analog::AnalogScan (0 to FULL_SCALE, fractional when oversampled).
+The functions are written out in full, so they double as the reference the tables are checked against.
+Linear ones (transducer, voltage dividers) don't need a table, they fold into a gain and an offset.
+The largest errors against the closed forms, over every half code, are the *_MAX_ERROR constants below
+(tools/analog_conversion_check holds them to it).
+*/
+
+namespace Conversion
+{
+    constexpr double VOLTS_PER_COUNT = VREF / Analog::AnalogScan::FULL_SCALE;
+
+    /**
+     * @brief Thermistor on the low side of a divider with a resistor equal to RT0 (its resistance at T0)
+     * RT / RT0 = counts / (FULL_SCALE - counts), so RT0 itself drops out
+     */
+    struct ThermistorCelsius
+    {
+        double b;
+        double t0; // K
+
+        constexpr double operator()(double counts) const
+        {
+            //Half a code in from either end, where the resistance would be 0 or infinite
+            const double lowest = 0.5;
+            const double highest = Analog::AnalogScan::FULL_SCALE - 0.5;
+            counts = counts < lowest ? lowest : (counts > highest ? highest : counts);
+
+            double ratio = counts / (Analog::AnalogScan::FULL_SCALE - counts);
+            return 1.0 / (Conversion::log(ratio) / b + 1.0 / t0) - 273.15;
+        }
+    };
+
+    /**
+     * @brief TDS probe (ppm) from its temperature compensated voltage
+     *
+     */
+    struct TdsPpm
+    {
+        constexpr double operator()(double volts) const
+        {
+            return (133.42 * volts * volts * volts - 255.86 * volts * volts + 857.39 * volts) * 0.5;
+        }
+    };
+
+    constexpr uint16_t TABLE_SEGMENTS = 256;
+
+    constexpr Table<TABLE_SEGMENTS> THERMISTOR_CELSIUS(ThermistorCelsius{THERMISTOR_B, THERMISTOR_T0 + 273.15}, 0.0, Analog::AnalogScan::FULL_SCALE);
+    constexpr double THERMISTOR_WATER_MIN = -5.0; // C
+    constexpr double THERMISTOR_WATER_MAX = 60.0; // C
+    constexpr double THERMISTOR_MAX_ERROR = 0.002; // C, between THERMISTOR_WATER_MIN and MAX
+    constexpr double THERMISTOR_RATED_MIN = -40.0; // C, the thermistor's own range
+    constexpr double THERMISTOR_RATED_MAX = 125.0; // C
+    constexpr double THERMISTOR_MAX_ERROR_RATED = 0.1; // C, the curve turns steep towards the rails where the table is coarse
+
+    constexpr double TDS_MAX_VOLTS = 2.0 * VREF; // compensation divides by at most 2 above 0 C
+    constexpr Table<TABLE_SEGMENTS> TDS_PPM(TdsPpm{}, 0.0, TDS_MAX_VOLTS);
+    constexpr double TDS_MAX_ERROR = 0.25; // ppm, in water from 0 to 35 C
+
+    /**
+     * @brief Transducer pressure (atm) is linear in its voltage: 100/3 psi per volt, 50 psi at VREF / 2
+     *
+     */
+    constexpr double PSI_PER_ATM = 14.695948775510204081632653061224;
+    constexpr double TRANSDUCER_ATM_PER_COUNT = (100.0 / 3.0) * VOLTS_PER_COUNT / PSI_PER_ATM;
+    constexpr double TRANSDUCER_ATM_OFFSET = (50.0 - ((100.0 / 3.0) * (3.3 / 2.0))) / PSI_PER_ATM;
+    constexpr double TRANSDUCER_MAX_ERROR = 1e-12; // atm, rounding
+}
+
+#endif
@@ -589,6 +589,7 @@ static const uint8_t bmi_feature_config[] = {
  */
 Bmi088Accel::Bmi088Accel(TwoWire &bus, uint8_t address)
 {
+  _i2c = &bus;        // I2C bus
   _address = address; // I2C address
   _useSPI = false;    // set to use I2C
 }
@@ -838,7 +839,13 @@ bool Bmi088Accel::setOdr(Odr odr)
   writeRegister(ACC_ODR_ADDR, writeReg);
   delay(1);
   readRegisters(ACC_ODR_ADDR, 1, &readReg);
-  return (readReg == writeReg) ? true : false;
+  if (readReg != writeReg)
+  {
+    return false;
+  }
+  /* ODR code 0x05 is 12.5 Hz, each code up doubles it */
+  odr_period_ns = 80000000LL >> ((value & 0x0F) - 0x05);
+  return true;
 }
 
 /* sets the BMI088 range */
@@ -875,6 +882,7 @@ bool Bmi088Accel::setRange(Range range)
       break;
     }
     }
+    accel_scale = (float)(accel_range_mss / 32768.0);
     return true;
   }
   else
@@ -927,25 +935,28 @@ bool Bmi088Accel::getDrdyStatus()
   return (GET_FIELD(ACC_DRDY, readReg)) ? true : false;
 }
 
-/* reads the BMI088 accel */
+/* reads the BMI088 accel. Fast path: data and sensor time in one burst
+   The temperature is a separate read, see readTemperature() */
 void Bmi088Accel::readSensor()
 {
   /* accel data */
-  uint16_t temp_uint11;
-  int16_t accel[3], temp_int11;
+  Bmi088Fifo::RawFrame accel;
   readRegisters(ACC_ACCEL_DATA_ADDR, 9, _buffer);
-  accel[0] = (_buffer[1] << 8) | _buffer[0];
-  accel[1] = (_buffer[3] << 8) | _buffer[2];
-  accel[2] = (_buffer[5] << 8) | _buffer[4];
-  accel_mss[0] = (double)(accel[0] * tX[0] + accel[1] * tX[1] + accel[2] * tX[2]) / 32768.0 * accel_range_mss;
-  accel_mss[1] = (double)(accel[0] * tY[0] + accel[1] * tY[1] + accel[2] * tY[2]) / 32768.0 * accel_range_mss;
-  accel_mss[2] = (double)(accel[0] * tZ[0] + accel[1] * tZ[1] + accel[2] * tZ[2]) / 32768.0 * accel_range_mss;
+  accel.x = (_buffer[1] << 8) | _buffer[0];
+  accel.y = (_buffer[3] << 8) | _buffer[2];
+  accel.z = (_buffer[5] << 8) | _buffer[4];
+  Bmi088Fifo::toBody(accel, accel_scale, accel_mss);
   /* time data */
   current_time_counter = (_buffer[8] << 16) | (_buffer[7] << 8) | _buffer[6];
   time_counter = current_time_counter - prev_time_counter;
   prev_time_counter = current_time_counter;
+}
 
-  /* temperature data*/
+/* reads the BMI088 accel temperature. Slow path: the sensor only updates it every 1.28 s */
+void Bmi088Accel::readTemperature()
+{
+  uint16_t temp_uint11;
+  int16_t temp_int11;
   readRegisters(ACC_TEMP_DATA_ADDR, 2, _buffer);
   temp_uint11 = (_buffer[0] * 8) + (_buffer[1] / 32);
   if (temp_uint11 > 1023)
@@ -1011,6 +1022,124 @@ void Bmi088Accel::estimateBias(uint8_t quantity)
   z_bias = zIntegration / quantity;
 }
 
+/* streams accel frames into the FIFO, the watermark interrupt fires once watermark_frames are in it */
+bool Bmi088Accel::enableFifo(uint16_t watermark_frames)
+{
+  uint8_t readReg = 0;
+  uint16_t watermark = (watermark_frames * Bmi088Fifo::ACCEL_FRAME_BYTES) & ACC_FIFO_WTM_MASK;
+  uint8_t wtm[2] = {(uint8_t)(watermark & 0xFF), (uint8_t)(watermark >> 8)};
+  writeRegisters(ACC_FIFO_WTM_ADDR, 2, wtm);
+  writeRegister(ACC_FIFO_CONFIG_0_ADDR, ACC_FIFO_STREAM_MODE);
+  writeRegister(ACC_FIFO_CONFIG_1_ADDR, ACC_FIFO_ACC_EN);
+  delay(1);
+  readRegisters(ACC_FIFO_CONFIG_1_ADDR, 1, &readReg);
+  if (readReg != ACC_FIFO_ACC_EN)
+  {
+    return false;
+  }
+  flushFifo();
+  return true;
+}
+
+/* maps the FIFO watermark signal to the Int1 pin */
+bool Bmi088Accel::mapFifoWatermarkInt1(bool enable)
+{
+  uint8_t writeReg = 0, readReg = 0;
+  readRegisters(ACC_INT1_FWM_ADDR, 1, &readReg);
+  writeReg = SET_FIELD(readReg, ACC_INT1_FWM, enable);
+  writeRegister(ACC_INT1_FWM_ADDR, writeReg);
+  delay(1);
+  readRegisters(ACC_INT1_FWM_ADDR, 1, &readReg);
+  return (readReg == writeReg) ? true : false;
+}
+
+/* returns the bytes in the FIFO */
+uint16_t Bmi088Accel::getFifoLength()
+{
+  readRegisters(ACC_FIFO_LENGTH_ADDR, 2, _buffer);
+  return ((_buffer[1] << 8) | _buffer[0]) & ACC_FIFO_LENGTH_MASK;
+}
+
+/* empties the FIFO */
+void Bmi088Accel::flushFifo()
+{
+  writeRegister(ACC_SOFT_RESET_ADDR, ACC_FIFO_FLUSH_CMD);
+  delay(1);
+}
+
+/* reads every frame in the FIFO (up to max_samples) in bursts, oldest first. Returns the number of samples
+   The newest sample gets the time of the sensor time frame, the rest are spaced at the ODR before it */
+uint16_t Bmi088Accel::readFifo(Bmi088Sample *samples, uint16_t max_samples, int64_t now_ns)
+{
+  uint16_t count = 0;
+  bool timed = false;
+  int64_t newest_ns = now_ns;
+
+  while (count < max_samples)
+  {
+    uint16_t length = getFifoLength();
+    if (length == 0)
+    {
+      break;
+    }
+
+    uint16_t room = max_samples - count;
+    if (room > FIFO_BURST_FRAMES)
+    {
+      room = FIFO_BURST_FRAMES;
+    }
+
+    /* reading past the last frame returns the sensor time, so the last burst asks for it */
+    uint16_t request = length + Bmi088Fifo::SENSOR_TIME_BYTES;
+    bool last = request <= room * Bmi088Fifo::ACCEL_FRAME_BYTES + Bmi088Fifo::SENSOR_TIME_BYTES;
+    if (!last)
+    {
+      request = room * Bmi088Fifo::ACCEL_FRAME_BYTES;
+    }
+    readRegisters(ACC_FIFO_DATA_ADDR, request, _fifo_buffer);
+
+    Bmi088Fifo::AccelParse parsed = Bmi088Fifo::parseAccel(_fifo_buffer, request, _fifo_frames, room);
+    for (uint16_t i = 0; i < parsed.frames; i++)
+    {
+      Bmi088Sample &sample = samples[count++];
+      float body[3];
+      Bmi088Fifo::toBody(_fifo_frames[i], accel_scale, body);
+      sample.x = body[0] - x_bias;
+      sample.y = body[1] - y_bias;
+      sample.z = body[2] - z_bias;
+    }
+    _fifo_skipped += parsed.skipped;
+
+    if (parsed.has_sensor_time)
+    {
+      newest_ns = _sensor_clock.toNs(parsed.sensor_time, now_ns);
+      timed = true;
+    }
+    if (last || parsed.frames == 0)
+    {
+      break;
+    }
+  }
+
+  /* stopped with frames left in the FIFO, so ours aren't the newest */
+  if (!timed && count > 0)
+  {
+    newest_ns -= (getFifoLength() / Bmi088Fifo::ACCEL_FRAME_BYTES) * odr_period_ns;
+  }
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    samples[i].time_ns = newest_ns - (count - 1 - i) * odr_period_ns;
+  }
+  return count;
+}
+
+/* returns the number of frames lost to a full FIFO */
+uint32_t Bmi088Accel::getFifoSkipped()
+{
+  return _fifo_skipped;
+}
+
 /* sets the Int1 pin configuration */
 bool Bmi088Accel::pinModeInt1(PinIO io, PinMode mode, PinLevel level)
 {
@@ -1412,7 +1541,32 @@ bool Bmi088Gyro::setOdr(Odr odr)
   writeRegister(GYRO_ODR_ADDR, writeReg);
   delay(1);
   readRegisters(GYRO_ODR_ADDR, 1, &readReg);
-  return (readReg == writeReg) ? true : false;
+  if (readReg != writeReg)
+  {
+    return false;
+  }
+  switch (odr)
+  {
+  case ODR_2000HZ_BW_532HZ:
+  case ODR_2000HZ_BW_230HZ:
+    odr_period_ns = 500000;
+    break;
+  case ODR_1000HZ_BW_116HZ:
+    odr_period_ns = 1000000;
+    break;
+  case ODR_400HZ_BW_47HZ:
+    odr_period_ns = 2500000;
+    break;
+  case ODR_200HZ_BW_23HZ:
+  case ODR_200HZ_BW_64HZ:
+    odr_period_ns = 5000000;
+    break;
+  case ODR_100HZ_BW_12HZ:
+  case ODR_100HZ_BW_32HZ:
+    odr_period_ns = 10000000;
+    break;
+  }
+  return true;
 }
 
 /* sets the BMI088 range */
@@ -1453,6 +1607,7 @@ bool Bmi088Gyro::setRange(Range range)
       break;
     }
     }
+    gyro_scale = (float)(gyro_range_rads / 32767.0);
     return true;
   }
   else
@@ -1594,15 +1749,13 @@ bool Bmi088Gyro::getDrdyStatus()
 /* reads the BMI088 gyro */
 void Bmi088Gyro::readSensor()
 {
-  /* accel data */
-  int16_t gyro[3];
+  /* gyro data */
+  Bmi088Fifo::RawFrame gyro;
   readRegisters(GYRO_DATA_ADDR, 6, _buffer);
-  gyro[0] = (_buffer[1] << 8) | _buffer[0];
-  gyro[1] = (_buffer[3] << 8) | _buffer[2];
-  gyro[2] = (_buffer[5] << 8) | _buffer[4];
-  gyro_rads[0] = (double)(gyro[0] * tX[0] + gyro[1] * tX[1] + gyro[2] * tX[2]) / 32767.0 * gyro_range_rads;
-  gyro_rads[1] = (double)(gyro[0] * tY[0] + gyro[1] * tY[1] + gyro[2] * tY[2]) / 32767.0 * gyro_range_rads;
-  gyro_rads[2] = (double)(gyro[0] * tZ[0] + gyro[1] * tZ[1] + gyro[2] * tZ[2]) / 32767.0 * gyro_range_rads;
+  gyro.x = (_buffer[1] << 8) | _buffer[0];
+  gyro.y = (_buffer[3] << 8) | _buffer[2];
+  gyro.z = (_buffer[5] << 8) | _buffer[4];
+  Bmi088Fifo::toBody(gyro, gyro_scale, gyro_rads);
 }
 
 /* returns the x gyro, rad/s */
@@ -1623,6 +1776,111 @@ double Bmi088Gyro::getGyroZ_rads()
   return gyro_rads[2];
 }
 
+/* streams x, y, z frames into the FIFO, the FIFO interrupt fires once watermark_frames are in it
+   replaces the data ready interrupt */
+bool Bmi088Gyro::enableFifo(uint8_t watermark_frames)
+{
+  uint8_t readReg = 0;
+  writeRegister(GYRO_FIFO_CONFIG_1_ADDR, GYRO_FIFO_STREAM_MODE); // writing the mode also empties the FIFO
+  writeRegister(GYRO_FIFO_CONFIG_0_ADDR, watermark_frames & GYRO_FIFO_FRAMES_MASK);
+  _fifo_watermark = watermark_frames & GYRO_FIFO_FRAMES_MASK;
+  _fifo_left = 0;
+  writeRegister(GYRO_FIFO_WM_EN_ADDR, GYRO_FIFO_WM_ENABLE);
+  writeRegister(GYRO_INT_CNTRL_ADDR, GYRO_ENABLE_FIFO_INT);
+  delay(1);
+  readRegisters(GYRO_FIFO_CONFIG_1_ADDR, 1, &readReg);
+  return (readReg == GYRO_FIFO_STREAM_MODE) ? true : false;
+}
+
+/* maps the FIFO interrupt to the Int3 pin */
+bool Bmi088Gyro::mapFifoInt3(bool enable)
+{
+  uint8_t writeReg = 0, readReg = 0;
+  readRegisters(GYRO_INT3_FIFO_ADDR, 1, &readReg);
+  writeReg = SET_FIELD(readReg, GYRO_INT3_FIFO, enable);
+  writeRegister(GYRO_INT3_FIFO_ADDR, writeReg);
+  delay(1);
+  readRegisters(GYRO_INT3_FIFO_ADDR, 1, &readReg);
+  return (readReg == writeReg) ? true : false;
+}
+
+/* returns the frames in the FIFO, counts overruns */
+uint8_t Bmi088Gyro::getFifoFrameCount()
+{
+  uint8_t readReg = 0;
+  readRegisters(GYRO_FIFO_STATUS_ADDR, 1, &readReg);
+  if (GET_FIELD(GYRO_FIFO_OVERRUN, readReg))
+  {
+    _fifo_overruns++;
+  }
+  return GET_FIELD(GYRO_FIFO_FRAMES, readReg);
+}
+
+/* reads every frame in the FIFO (up to max_samples) in bursts, oldest first. Returns the number of samples
+   The gyro has no sensor time. If the last read emptied the FIFO, the watermark interrupt fired as frame
+   number watermark came in, so watermark_ns (when the interrupt ran, -1 if it didn't) times that frame and
+   the rest are spaced at the ODR around it. Otherwise the newest frame is taken as now */
+uint16_t Bmi088Gyro::readFifo(Bmi088Sample *samples, uint16_t max_samples, int64_t now_ns, int64_t watermark_ns)
+{
+  uint16_t count = 0;
+  uint8_t left_before = _fifo_left;
+  uint32_t overruns_before = _fifo_overruns;
+  uint8_t frames = getFifoFrameCount();
+
+  while (frames > 0 && count < max_samples)
+  {
+    uint16_t burst = frames;
+    if (burst > FIFO_BURST_FRAMES)
+    {
+      burst = FIFO_BURST_FRAMES;
+    }
+    if (burst > max_samples - count)
+    {
+      burst = max_samples - count;
+    }
+
+    readRegisters(GYRO_FIFO_DATA_ADDR, burst * Bmi088Fifo::FRAME_BYTES, _fifo_buffer);
+    uint16_t parsed = Bmi088Fifo::parseGyro(_fifo_buffer, burst * Bmi088Fifo::FRAME_BYTES, _fifo_frames, burst);
+    for (uint16_t i = 0; i < parsed; i++)
+    {
+      Bmi088Sample &sample = samples[count++];
+      float body[3];
+      Bmi088Fifo::toBody(_fifo_frames[i], gyro_scale, body);
+      sample.x = body[0];
+      sample.y = body[1];
+      sample.z = body[2];
+    }
+    frames -= burst;
+  }
+
+  _fifo_left = frames;
+
+  /* an overrun dropped the oldest frames, so the watermark frame isn't where we expect it */
+  bool anchored = watermark_ns >= 0 && left_before == 0 && _fifo_overruns == overruns_before && _fifo_watermark > 0 && count >= _fifo_watermark;
+  if (anchored)
+  {
+    for (uint16_t i = 0; i < count; i++)
+    {
+      samples[i].time_ns = watermark_ns + ((int64_t)i - (_fifo_watermark - 1)) * odr_period_ns;
+    }
+    return count;
+  }
+
+  /* frames left behind are newer than ours */
+  int64_t newest_ns = now_ns - frames * odr_period_ns;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    samples[i].time_ns = newest_ns - (count - 1 - i) * odr_period_ns;
+  }
+  return count;
+}
+
+/* returns the number of times the FIFO was found overrun */
+uint32_t Bmi088Gyro::getFifoOverruns()
+{
+  return _fifo_overruns;
+}
+
 // bool Bmi088Gyro::selfTest()
 // {
 
@@ -1954,6 +2212,11 @@ void Bmi088::readSensor()
   gyro->readSensor();
 }
 
+void Bmi088::readTemperature()
+{
+  accel->readTemperature();
+}
+
 double Bmi088::getAccelX_mss()
 {
   return accel->getAccelX_mss();
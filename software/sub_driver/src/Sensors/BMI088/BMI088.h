@@ -17,7 +17,15 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 #include <Wire.h>
 #include <SPI.h>   // SPI library
 
-#include "../../Navigation/Quaternion.h"
+#include "Bmi088Fifo.h"
+#include "../SensorClock.h"
+
+/* one FIFO sample, converted and timestamped on our clock */
+struct Bmi088Sample
+{
+  int64_t time_ns;
+  double x, y, z;
+};
 
 class Bmi088Accel 
 {
@@ -84,6 +92,13 @@ class Bmi088Accel
     double getTemperature_C();
     uint64_t getTime_ps();
     void estimateBias(uint8_t quantity);
+    void readTemperature();
+    bool enableFifo(uint16_t watermark_frames);
+    bool mapFifoWatermarkInt1(bool enable);
+    uint16_t getFifoLength();
+    void flushFifo();
+    uint16_t readFifo(Bmi088Sample *samples, uint16_t max_samples, int64_t now_ns);
+    uint32_t getFifoSkipped();
 
   private:
     // allow class Bmi088 access to private members 
@@ -166,21 +181,42 @@ class Bmi088Accel
     static const uint8_t ACC_SOFT_RESET_POS = 0;
     static const uint8_t ACC_ACCEL_DATA_ADDR = 0x12;
     static const uint8_t ACC_TEMP_DATA_ADDR = 0x22;
-    // transformation from sensor frame to right hand coordinate system
-    const int16_t tX[3] = {1, 0, 0};
-    const int16_t tY[3] = {0, -1, 0};
-    const int16_t tZ[3] = {0, 0, -1};
+    static const uint8_t ACC_FIFO_LENGTH_ADDR = 0x24;
+    static const uint16_t ACC_FIFO_LENGTH_MASK = 0x3FFF;
+    static const uint8_t ACC_FIFO_DATA_ADDR = 0x26;
+    static const uint8_t ACC_FIFO_WTM_ADDR = 0x46;
+    static const uint16_t ACC_FIFO_WTM_MASK = 0x1FFF;
+    static const uint8_t ACC_FIFO_CONFIG_0_ADDR = 0x48;
+    static const uint8_t ACC_FIFO_CONFIG_1_ADDR = 0x49;
+    static const uint8_t ACC_INT1_FWM_ADDR = 0x58;
+    static const uint8_t ACC_INT1_FWM_MASK = 0x02;
+    static const uint8_t ACC_INT1_FWM_POS = 1;
+    static const uint8_t ACC_FIFO_STREAM_MODE = 0x02;
+    static const uint8_t ACC_FIFO_ACC_EN = 0x50;
+    static const uint8_t ACC_FIFO_FLUSH_CMD = 0xB0;
+    // fifo reads per transaction, within the Teensy Wire buffer
+    static const uint8_t FIFO_BURST_BYTES = 128;
+    static const uint8_t FIFO_BURST_FRAMES = (FIFO_BURST_BYTES - Bmi088Fifo::SENSOR_TIME_BYTES) / Bmi088Fifo::ACCEL_FRAME_BYTES;
     // convert G to m/s/s
     const double G = 9.80665;
     // accel full scale range
     double accel_range_mss;
+    // m/s/s per count, see Bmi088Fifo::toBody for the axes
+    float accel_scale;
     // accel data
-    double accel_mss[3];
+    float accel_mss[3];
     // temperature data
     double temp_c;
     // sensor time
     uint32_t current_time_counter, prev_time_counter = 0;
     uint64_t time_counter;
+    // time between samples at the current ODR
+    int64_t odr_period_ns = 625000;
+    // fifo
+    uint8_t _fifo_buffer[FIFO_BURST_BYTES];
+    Bmi088Fifo::RawFrame _fifo_frames[FIFO_BURST_FRAMES];
+    Sensors::SensorClock _sensor_clock;
+    uint32_t _fifo_skipped = 0;
     // interrupt pin setup
     bool pinModeInt1(PinIO io, PinMode mode, PinLevel level);
     bool pinModeInt2(PinIO io, PinMode mode, PinLevel level);
@@ -252,6 +288,11 @@ class Bmi088Gyro
     bool mapDrdyInt4(bool enable);
     bool getDrdyStatus();
     void readSensor();
+    bool enableFifo(uint8_t watermark_frames);
+    bool mapFifoInt3(bool enable);
+    uint8_t getFifoFrameCount();
+    uint16_t readFifo(Bmi088Sample *samples, uint16_t max_samples, int64_t now_ns, int64_t watermark_ns = -1);
+    uint32_t getFifoOverruns();
     double getGyroX_rads();
     double getGyroY_rads();
     double getGyroZ_rads();
@@ -316,16 +357,39 @@ class Bmi088Gyro
     static const uint8_t GYRO_INT4_DRDY_MASK = 0x80;
     static const uint8_t GYRO_INT4_DRDY_POS = 7;
     static const uint8_t GYRO_DATA_ADDR = 0x02;
-    // transformation from sensor frame to right hand coordinate system
-    const int16_t tX[3] = {1, 0, 0};
-    const int16_t tY[3] = {0, -1, 0};
-    const int16_t tZ[3] = {0, 0, -1};
+    static const uint8_t GYRO_FIFO_STATUS_ADDR = 0x0E;
+    static const uint8_t GYRO_FIFO_FRAMES_MASK = 0x7F;
+    static const uint8_t GYRO_FIFO_FRAMES_POS = 0;
+    static const uint8_t GYRO_FIFO_OVERRUN_MASK = 0x80;
+    static const uint8_t GYRO_FIFO_OVERRUN_POS = 7;
+    static const uint8_t GYRO_INT3_FIFO_ADDR = 0x18;
+    static const uint8_t GYRO_INT3_FIFO_MASK = 0x04;
+    static const uint8_t GYRO_INT3_FIFO_POS = 2;
+    static const uint8_t GYRO_FIFO_WM_EN_ADDR = 0x1E;
+    static const uint8_t GYRO_FIFO_CONFIG_0_ADDR = 0x3D;
+    static const uint8_t GYRO_FIFO_CONFIG_1_ADDR = 0x3E;
+    static const uint8_t GYRO_FIFO_DATA_ADDR = 0x3F;
+    static const uint8_t GYRO_ENABLE_FIFO_INT = 0x40;
+    static const uint8_t GYRO_FIFO_WM_ENABLE = 0x88;
+    static const uint8_t GYRO_FIFO_STREAM_MODE = 0x80;
+    // fifo reads per transaction, within the Teensy Wire buffer
+    static const uint8_t FIFO_BURST_FRAMES = 21;
     // convert deg/s to rad/s
     const double D2R = M_PI / 180.0f;
     // gyro full scale range
     double gyro_range_rads;
+    // rad/s per count, see Bmi088Fifo::toBody for the axes
+    float gyro_scale;
     // gyro data
-    double gyro_rads[3];
+    float gyro_rads[3];
+    // time between samples at the current ODR
+    int64_t odr_period_ns = 500000;
+    // fifo
+    uint8_t _fifo_buffer[FIFO_BURST_FRAMES * Bmi088Fifo::FRAME_BYTES];
+    Bmi088Fifo::RawFrame _fifo_frames[FIFO_BURST_FRAMES];
+    uint32_t _fifo_overruns = 0;
+    uint8_t _fifo_watermark = 0;
+    uint8_t _fifo_left = 0; // frames left behind by the last read
     // self test
     bool selfTest();
     // enable data read interrupt
@@ -386,6 +450,7 @@ class Bmi088 {
     bool mapSync(SyncPin pin);    
     bool pinModeDrdy(PinMode mode, PinLevel level);
     void readSensor();
+    void readTemperature();
     double getAccelX_mss();
     double getAccelY_mss();
     double getAccelZ_mss();
@@ -0,0 +1,107 @@
+/**
+ * @file Bmi088Fifo.cpp
+ * @author Daniel Kim
+ * @brief Parsing of BMI088 FIFO reads
+ * @version 0.1
+ * @date 2023-05-20
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "Bmi088Fifo.h"
+
+namespace Bmi088Fifo
+{
+    static constexpr uint8_t HEADER_MASK = 0xFC;
+    static constexpr uint8_t HEADER_ACCEL = 0x84;
+    static constexpr uint8_t HEADER_SENSOR_TIME = 0x44;
+    static constexpr uint8_t HEADER_SKIP = 0x40;
+    static constexpr uint8_t HEADER_INPUT_CONFIG = 0x48;
+    static constexpr uint8_t HEADER_SAMPLE_DROP = 0x50;
+
+    static RawFrame toFrame(const uint8_t *data)
+    {
+        RawFrame frame;
+        frame.x = static_cast<int16_t>((data[1] << 8) | data[0]);
+        frame.y = static_cast<int16_t>((data[3] << 8) | data[2]);
+        frame.z = static_cast<int16_t>((data[5] << 8) | data[4]);
+        return frame;
+    }
+
+    /**
+     * @brief Pulls the accel frames out of one FIFO read
+     *
+     * @param buffer bytes read from FIFO_DATA
+     * @param length number of bytes read
+     * @param frames written oldest first
+     * @param max_frames room in frames. Frames past it are dropped
+     * @return AccelParse what was found
+     */
+    AccelParse parseAccel(const uint8_t *buffer, uint16_t length, RawFrame *frames, uint16_t max_frames)
+    {
+        AccelParse result;
+        uint16_t i = 0;
+        while (i < length)
+        {
+            uint8_t header = buffer[i] & HEADER_MASK;
+            uint16_t remaining = length - i - 1;
+
+            if (header == HEADER_ACCEL)
+            {
+                if (remaining < FRAME_BYTES)
+                {
+                    break;
+                }
+                if (result.frames < max_frames)
+                {
+                    frames[result.frames++] = toFrame(&buffer[i + 1]);
+                }
+                i += ACCEL_FRAME_BYTES;
+            }
+            else if (header == HEADER_SENSOR_TIME)
+            {
+                if (remaining < SENSOR_TIME_BYTES - 1)
+                {
+                    break;
+                }
+                result.sensor_time = (static_cast<uint32_t>(buffer[i + 3]) << 16) | (buffer[i + 2] << 8) | buffer[i + 1];
+                result.has_sensor_time = true;
+                i += SENSOR_TIME_BYTES;
+            }
+            else if (header == HEADER_SKIP)
+            {
+                if (remaining < 1)
+                {
+                    break;
+                }
+                result.skipped += buffer[i + 1];
+                i += 2;
+            }
+            else if (header == HEADER_INPUT_CONFIG || header == HEADER_SAMPLE_DROP)
+            {
+                i += 2;
+            }
+            else
+            {
+                break; // empty frame, or something we don't know the length of
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Pulls the gyro frames out of one FIFO read
+     *
+     * @return uint16_t frames written, oldest first
+     */
+    uint16_t parseGyro(const uint8_t *buffer, uint16_t length, RawFrame *frames, uint16_t max_frames)
+    {
+        uint16_t count = 0;
+        for (uint16_t i = 0; i + FRAME_BYTES <= length && count < max_frames; i += FRAME_BYTES)
+        {
+            frames[count++] = toFrame(&buffer[i]);
+        }
+        return count;
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * @file Bmi088Fifo.h
+ * @author Daniel Kim
+ * @brief Parsing of BMI088 FIFO reads
+ * @version 0.1
+ * @date 2023-05-20
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef BMI088FIFO_H
+#define BMI088FIFO_H
+
+#include <cstdint>
+
+/*
+Accel FIFO (datasheet 4.9): frames start with a header byte
+    0x84 accel frame, 6 data bytes (x, y, z little endian)
+    0x44 sensor time, 3 bytes. Returned once when the read goes past the last frame
+    0x40 skip frame, 1 byte: frames lost because the FIFO was full
+    0x48 input config and 0x50 sample drop, 1 byte each
+    0x80 empty, the rest of the read is padding
+The two low bits of the header tag the interrupt pins and are masked off.
+Gyro FIFO: headerless 6 byte x, y, z frames.
+
+A frame cut off by the end of a read isn't parsed, the sensor sends it again on the next read.
+No Arduino dependencies.
+*/
+
+namespace Bmi088Fifo
+{
+    constexpr uint8_t FRAME_BYTES = 6;
+    constexpr uint8_t ACCEL_FRAME_BYTES = FRAME_BYTES + 1; // with its header
+    constexpr uint8_t SENSOR_TIME_BYTES = 3 + 1;
+    constexpr uint8_t GYRO_FRAME_CAPACITY = 100; // gyro FIFO size in frames
+
+    struct RawFrame
+    {
+        int16_t x = 0;
+        int16_t y = 0;
+        int16_t z = 0;
+    };
+
+    struct AccelParse
+    {
+        uint16_t frames = 0; // accel frames written out
+        uint16_t skipped = 0; // frames the sensor dropped while the FIFO was full
+        bool has_sensor_time = false;
+        uint32_t sensor_time = 0; // of the newest frame, 24 bit
+    };
+
+    /**
+     * @brief Sensor frame to right hand coordinate system (y and z flip), scaled to units
+     * The flips are done on ints so -32768 doesn't overflow, then one float multiply per axis
+     */
+    inline void toBody(const RawFrame &frame, float scale, float body[3])
+    {
+        body[0] = static_cast<float>(static_cast<int32_t>(frame.x)) * scale;
+        body[1] = static_cast<float>(-static_cast<int32_t>(frame.y)) * scale;
+        body[2] = static_cast<float>(-static_cast<int32_t>(frame.z)) * scale;
+    }
+
+    AccelParse parseAccel(const uint8_t *buffer, uint16_t length, RawFrame *frames, uint16_t max_frames);
+    uint16_t parseGyro(const uint8_t *buffer, uint16_t length, RawFrame *frames, uint16_t max_frames);
+}
+
+#endif
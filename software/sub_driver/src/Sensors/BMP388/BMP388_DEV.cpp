@@ -409,6 +409,69 @@ void BMP388_DEV::flushFIFO()																				// Flush the FIFO
 	writeByte(BMP388_CMD, FIFO_FLUSH);
 }
 
+uint16_t BMP388_DEV::readFIFO(Bmp388Sample *samples, uint16_t maxSamples, int64_t now_ns)	// Read the FIFO in bursts of whole frames
+{
+	uint16_t count = 0;
+	int64_t newest_ns = now_ns;
+	bool timed = false;
+	int64_t period_ns = 5000000LL << (odr.bit.odr_sel + fifo_config_2.bit.fifo_subsampling);	// Time between FIFO frames
+	uint8_t timeBytes = fifo_config_1.bit.fifo_time_en ? Bmp388Fifo::SENSOR_TIME_BYTES : 0;
+
+	uint16_t length = getFIFOLength();
+	if (length + Bmp388Fifo::FRAME_BYTES > FIFO_SIZE)								// No room for another frame, older ones may have been lost
+	{
+		fifo_overflows++;
+	}
+	while (length > 0 && count < maxSamples)
+	{
+		uint16_t room = maxSamples - count;
+		if (room > FIFO_BURST_FRAMES)
+		{
+			room = FIFO_BURST_FRAMES;
+		}
+		uint16_t request = length + timeBytes;													// Reading past the last frame returns the sensor time, so the last burst asks for it
+		bool last = length <= room * Bmp388Fifo::FRAME_BYTES;
+		if (!last)
+		{
+			request = room * Bmp388Fifo::FRAME_BYTES;
+		}
+		readBytes(BMP388_FIFO_DATA, fifo_buffer, request);
+
+		Bmp388Fifo::Parse parsed = Bmp388Fifo::parse(fifo_buffer, request, fifo_frames, room);
+		for (uint16_t i = 0; i < parsed.frames; i++)
+		{
+			Bmp388Sample &sample = samples[count++];
+			sample.temperature = bmp388_compensate_temp((double)fifo_frames[i].temperature);
+			sample.pressure = bmp388_compensate_press((double)fifo_frames[i].pressure, sample.temperature) / 100.0;
+		}
+		if (parsed.has_sensor_time)
+		{
+			newest_ns = sensor_clock.toNs(parsed.sensor_time, now_ns);
+			timed = true;
+		}
+		if (last || parsed.bytes == 0)
+		{
+			break;
+		}
+		length = parsed.bytes < length ? length - parsed.bytes : 0;
+	}
+
+	if (!timed && count > 0)																					// Stopped with frames left in the FIFO, so ours aren't the newest
+	{
+		newest_ns -= (getFIFOLength() / Bmp388Fifo::FRAME_BYTES) * period_ns;
+	}
+	for (uint16_t i = 0; i < count; i++)
+	{
+		samples[i].time_ns = newest_ns - (count - 1 - i) * period_ns;
+	}
+	return count;
+}
+
+uint32_t BMP388_DEV::getFIFOOverflows()															// Get the number of reads that found the FIFO full
+{
+	return fifo_overflows;
+}
+
 uint32_t BMP388_DEV::getSensorTime()																// Get the sensor time
 {
 	uint32_t sensorTime;
@@ -34,6 +34,8 @@
 #define BMP388_DEV_h
 
 #include "Device.h"
+#include "Bmp388Fifo.h"
+#include "../SensorClock.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // BMP388_DEV Definitions
@@ -196,6 +198,12 @@ enum FIFOStatus {													// FIFO status
 	CONFIG_ERROR			 		 = 0x02
 };
 
+struct Bmp388Sample {											// One FIFO sample, timed on our clock
+	int64_t time_ns;
+	double pressure;																						// hPa
+	double temperature;																					// C
+};
+
 enum WatchdogTimout {											// I2C watchdog time-out
 	WATCHDOG_TIMEOUT_1MS	 = 0x00,
 	WATCHDOG_TIMEOUT_40MS	 = 0x01
@@ -272,6 +280,9 @@ class BMP388_DEV : public Device {															// Derive the BMP388_DEV class
 														 LatchConfig latchConfig = UNLATCHED);												
 		void disableFIFOInterrupt();																// Disable FIFO interrupt
 		void flushFIFO();																						// Flush the FIFO
+		uint16_t readFIFO(Bmp388Sample *samples, uint16_t maxSamples, 	// Read every pressure and temperature frame in the FIFO in bursts
+											int64_t now_ns);
+		uint32_t getFIFOOverflows();																// Get the number of reads that found the FIFO full
 		uint32_t getSensorTime();																		// Get the BMP388 sensor time
 		void enableI2CWatchdog();																		// Enable the I2C watchdog timer
 		void disableI2CWatchdog();																	// Disable the I2C watchdog timer
@@ -452,6 +463,12 @@ class BMP388_DEV : public Device {															// Derive the BMP388_DEV class
 		volatile bool alt_enable;																		// Altitude enable flag
 		const uint16_t FIFO_SIZE = 0x01FF;													// The BMP388 FIFO size 512 bytes
 		const uint8_t MAX_PACKET_SIZE = 7;													// The BMP388 maximum FIFO packet size in bytes
+		static const uint8_t FIFO_BURST_BYTES = 128;								// FIFO bytes per transaction, within the Teensy Wire buffer
+		static const uint8_t FIFO_BURST_FRAMES = (FIFO_BURST_BYTES - Bmp388Fifo::SENSOR_TIME_BYTES) / Bmp388Fifo::FRAME_BYTES;
+		uint8_t fifo_buffer[FIFO_BURST_BYTES];											// FIFO burst read buffer
+		Bmp388Fifo::RawFrame fifo_frames[FIFO_BURST_FRAMES];				// Frames parsed from one burst
+		Sensors::SensorClock sensor_clock;													// Maps the FIFO sensor time onto our clock
+		uint32_t fifo_overflows = 0;																// Reads that found the FIFO full
 		double sea_level_pressure = 1013.23f;												// Pressure at sea level
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+/**
+ * @file Bmp388Fifo.cpp
+ * @author Daniel Kim
+ * @brief Parsing of BMP388 FIFO reads
+ * @version 0.1
+ * @date 2023-05-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "Bmp388Fifo.h"
+
+namespace Bmp388Fifo
+{
+    static constexpr uint8_t HEADER_PRESS_TEMP = 0x94;
+    static constexpr uint8_t HEADER_TEMP = 0x90;
+    static constexpr uint8_t HEADER_PRESS = 0x84;
+    static constexpr uint8_t HEADER_SENSOR_TIME = 0xA0;
+    static constexpr uint8_t HEADER_CONFIG_ERROR = 0x44;
+    static constexpr uint8_t HEADER_CONFIG_CHANGE = 0x48;
+
+    static uint32_t toCounts(const uint8_t *data)
+    {
+        return (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[1]) << 8) | data[0];
+    }
+
+    /**
+     * @brief Pulls the pressure and temperature frames out of one FIFO read
+     * Frames with only one of the two are skipped, we always store both
+     *
+     * @param buffer bytes read from FIFO_DATA
+     * @param length number of bytes read
+     * @param frames written oldest first
+     * @param max_frames room in frames. Frames past it are dropped
+     * @return Parse what was found
+     */
+    Parse parse(const uint8_t *buffer, uint16_t length, RawFrame *frames, uint16_t max_frames)
+    {
+        Parse result;
+        uint16_t i = 0;
+        while (i < length)
+        {
+            uint8_t header = buffer[i];
+            uint16_t remaining = length - i - 1;
+
+            if (header == HEADER_PRESS_TEMP)
+            {
+                if (remaining < 2 * DATA_BYTES)
+                {
+                    break;
+                }
+                if (result.frames < max_frames)
+                {
+                    RawFrame &frame = frames[result.frames++];
+                    frame.temperature = toCounts(&buffer[i + 1]);
+                    frame.pressure = toCounts(&buffer[i + 1 + DATA_BYTES]);
+                }
+                i += FRAME_BYTES;
+            }
+            else if (header == HEADER_TEMP || header == HEADER_PRESS || header == HEADER_SENSOR_TIME)
+            {
+                if (remaining < DATA_BYTES)
+                {
+                    break;
+                }
+                if (header == HEADER_SENSOR_TIME)
+                {
+                    result.sensor_time = toCounts(&buffer[i + 1]);
+                    result.has_sensor_time = true;
+                }
+                i += DATA_BYTES + 1;
+            }
+            else if (header == HEADER_CONFIG_ERROR || header == HEADER_CONFIG_CHANGE)
+            {
+                if (remaining < 1)
+                {
+                    break;
+                }
+                i += 2;
+            }
+            else
+            {
+                break; // empty frame, or something we don't know the length of
+            }
+        }
+        result.bytes = i;
+        return result;
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * @file Bmp388Fifo.h
+ * @author Daniel Kim
+ * @brief Parsing of BMP388 FIFO reads
+ * @version 0.1
+ * @date 2023-05-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef BMP388FIFO_H
+#define BMP388FIFO_H
+
+#include <cstdint>
+
+/*
+FIFO frames (datasheet 3.6) start with a header byte
+    0x94 pressure and temperature, 6 bytes (temperature then pressure, 24 bit little endian)
+    0x90 temperature only, 0x84 pressure only, 3 bytes
+    0xA0 sensor time, 3 bytes. Returned once when the read goes past the last frame
+    0x44 config error and 0x48 config change, 1 byte each
+    0x80 empty, the rest of the read is padding
+A frame cut off by the end of a read isn't parsed.
+No Arduino dependencies.
+*/
+
+namespace Bmp388Fifo
+{
+    constexpr uint8_t DATA_BYTES = 3;
+    constexpr uint8_t FRAME_BYTES = 2 * DATA_BYTES + 1; // pressure and temperature with their header
+    constexpr uint8_t SENSOR_TIME_BYTES = DATA_BYTES + 1;
+
+    struct RawFrame
+    {
+        uint32_t pressure = 0; // adc counts
+        uint32_t temperature = 0;
+    };
+
+    struct Parse
+    {
+        uint16_t frames = 0; // pressure and temperature frames written out
+        uint16_t bytes = 0; // bytes taken up by whole frames
+        bool has_sensor_time = false;
+        uint32_t sensor_time = 0; // at the read, 24 bit
+    };
+
+    Parse parse(const uint8_t *buffer, uint16_t length, RawFrame *frames, uint16_t max_frames);
+}
+
+#endif
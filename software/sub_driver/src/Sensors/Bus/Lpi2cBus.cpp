@@ -0,0 +1,235 @@
+/**
+ * @file Lpi2cBus.cpp
+ * @author Daniel Kim
+ * @brief Interrupt driven sensor bus backend on the Teensy 4.1's LPI2C1 (the Wire pins)
+ * @version 0.1
+ * @date 2023-05-23
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "Lpi2cBus.h"
+
+#if defined(CORE_TEENSY)
+    #include <Arduino.h>
+#endif
+
+namespace Bus
+{
+    static constexpr uint16_t RECEIVE_CHUNK = 256; // most bytes one receive command asks for
+    static constexpr uint8_t FIFO_WORDS = 4;
+
+    static constexpr uint16_t COMMAND_TRANSMIT = 0 << 8;
+    static constexpr uint16_t COMMAND_RECEIVE = 1 << 8;
+    static constexpr uint16_t COMMAND_STOP = 2 << 8;
+    static constexpr uint16_t COMMAND_START = 4 << 8;
+
+    /**
+     * @brief Master command number index of the active transaction
+     * Reads: start + write address, register, start + read address, receive..., stop
+     * Writes: start + write address, register, data..., stop
+     */
+    uint16_t Lpi2cBus::command(uint16_t index) const
+    {
+        const Transaction &t = *m_active;
+        uint8_t address = static_cast<uint8_t>(t.address << 1);
+
+        if (index == 0)
+        {
+            return COMMAND_START | address;
+        }
+        if (index == 1)
+        {
+            return COMMAND_TRANSMIT | t.reg;
+        }
+        if (index == m_commands - 1)
+        {
+            return COMMAND_STOP;
+        }
+
+        if (t.write)
+        {
+            return COMMAND_TRANSMIT | t.buffer[index - 2];
+        }
+        if (index == 2)
+        {
+            return COMMAND_START | address | 1;
+        }
+
+        uint16_t chunk = index - 3;
+        uint16_t remaining = t.length - chunk * RECEIVE_CHUNK;
+        uint16_t count = remaining < RECEIVE_CHUNK ? remaining : RECEIVE_CHUNK;
+        return COMMAND_RECEIVE | static_cast<uint8_t>(count - 1);
+    }
+
+#if defined(CORE_TEENSY)
+
+    static Lpi2cBus *instance = nullptr;
+
+    static void lpi2cISR()
+    {
+        instance->isr();
+    }
+
+    static constexpr uint32_t ERROR_FLAGS = LPI2C_MSR_NDF | LPI2C_MSR_ALF | LPI2C_MSR_FEF | LPI2C_MSR_PLTF;
+    static constexpr uint32_t CLEAR_FLAGS = ERROR_FLAGS | LPI2C_MSR_EPF | LPI2C_MSR_SDF;
+
+    static uint16_t receiveCommands(uint16_t length)
+    {
+        return (length + RECEIVE_CHUNK - 1) / RECEIVE_CHUNK;
+    }
+
+    static uint8_t transmitCount() { return LPI2C1_MFSR & 0x07; }
+    static uint8_t receiveCount() { return (LPI2C1_MFSR >> 16) & 0x07; }
+
+    /**
+     * @brief Takes over the LPI2C1 interrupt. Call after Wire.begin() and the sensor setup
+     *
+     * @param priority NVIC priority, lower is more urgent
+     * @return true
+     */
+    bool Lpi2cBus::begin(uint8_t priority)
+    {
+        instance = this;
+
+        LPI2C1_MIER = 0;
+        LPI2C1_MFCR = LPI2C_MFCR_RXWATER(0) | LPI2C_MFCR_TXWATER(1); // every received byte, and refill before the FIFO runs dry
+
+        attachInterruptVector(IRQ_LPI2C1, lpi2cISR);
+        NVIC_SET_PRIORITY(IRQ_LPI2C1, priority);
+        NVIC_ENABLE_IRQ(IRQ_LPI2C1);
+        return true;
+    }
+
+    void Lpi2cBus::start(Transaction &transaction)
+    {
+        m_active = &transaction;
+        m_commands = transaction.write ? 3 + transaction.length : 4 + receiveCommands(transaction.length);
+        m_sent = 0;
+        m_received = 0;
+        m_start_us = micros();
+
+        LPI2C1_MSR = CLEAR_FLAGS;
+        // The transmit FIFO is empty, so this interrupts straight away and the ISR starts feeding it
+        LPI2C1_MIER = LPI2C_MIER_TDIE | LPI2C_MIER_RDIE | LPI2C_MIER_SDIE | LPI2C_MIER_NDIE | LPI2C_MIER_ALIE | LPI2C_MIER_FEIE | LPI2C_MIER_PLTIE;
+    }
+
+    /**
+     * @brief Gives up on a transaction that's been on the bus too long, e.g. a device holding SDA low
+     *
+     */
+    void Lpi2cBus::poll()
+    {
+        noInterrupts();
+        if (m_active && micros() - m_start_us > TIMEOUT_US)
+        {
+            m_timeouts++;
+            LPI2C1_MCR |= LPI2C_MCR_RTF | LPI2C_MCR_RRF;
+            LPI2C1_MTDR = COMMAND_STOP;
+            end(Status::ERROR);
+        }
+        interrupts();
+    }
+
+    void Lpi2cBus::fillTransmit()
+    {
+        while (m_sent < m_commands && transmitCount() < FIFO_WORDS)
+        {
+            LPI2C1_MTDR = command(m_sent++);
+        }
+        if (m_sent == m_commands)
+        {
+            LPI2C1_MIER &= ~LPI2C_MIER_TDIE; // TDF stays set with an empty FIFO
+        }
+    }
+
+    void Lpi2cBus::drainReceive()
+    {
+        Transaction &t = *m_active;
+        while (receiveCount() > 0)
+        {
+            uint8_t value = LPI2C1_MRDR & 0xFF;
+            if (!t.write && m_received < t.length)
+            {
+                t.buffer[m_received++] = value;
+            }
+        }
+    }
+
+    void Lpi2cBus::isr()
+    {
+        uint32_t status = LPI2C1_MSR;
+        if (!m_active)
+        {
+            LPI2C1_MIER = 0;
+            return;
+        }
+
+        if (status & ERROR_FLAGS)
+        {
+            LPI2C1_MCR |= LPI2C_MCR_RTF | LPI2C_MCR_RRF; // drop the rest of the commands
+            LPI2C1_MSR = CLEAR_FLAGS;
+            if (!(status & LPI2C_MSR_ALF))
+            {
+                LPI2C1_MTDR = COMMAND_STOP; // let go of the bus, unless someone else has it
+            }
+            end(status & LPI2C_MSR_NDF ? Status::NACK : Status::ERROR);
+            return;
+        }
+
+        drainReceive();
+        fillTransmit();
+
+        if ((status & LPI2C_MSR_SDF) && m_sent == m_commands)
+        {
+            LPI2C1_MSR = LPI2C_MSR_SDF;
+            drainReceive();
+            const Transaction &t = *m_active;
+            end(t.write || m_received == t.length ? Status::OK : Status::ERROR);
+        }
+    }
+
+    void Lpi2cBus::end(Status status)
+    {
+        LPI2C1_MIER = 0;
+        m_active = nullptr;
+        finish(status); // may start the next transaction
+    }
+
+#else
+
+    bool Lpi2cBus::begin(uint8_t)
+    {
+        return false;
+    }
+
+    void Lpi2cBus::start(Transaction &)
+    {
+        finish(Status::ERROR);
+    }
+
+    void Lpi2cBus::poll()
+    {
+    }
+
+    void Lpi2cBus::isr()
+    {
+    }
+
+    void Lpi2cBus::fillTransmit()
+    {
+    }
+
+    void Lpi2cBus::drainReceive()
+    {
+    }
+
+    void Lpi2cBus::end(Status status)
+    {
+        m_active = nullptr;
+        finish(status);
+    }
+
+#endif
+}
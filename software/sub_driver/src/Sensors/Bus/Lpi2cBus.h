@@ -0,0 +1,59 @@
+/**
+ * @file Lpi2cBus.h
+ * @author Daniel Kim
+ * @brief Interrupt driven sensor bus backend on the Teensy 4.1's LPI2C1 (the Wire pins)
+ * @version 0.1
+ * @date 2023-05-23
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef LPI2CBUS_H
+#define LPI2CBUS_H
+
+#include <cstdint>
+
+#include "SensorBus.h"
+
+/*
+Wire sets up the pins and the clock, and the drivers still use it for configuration at startup.
+After begin() this backend owns the LPI2C1 interrupt. Each transaction is a list of master commands
+(start + address, register, repeated start, receive, stop) that the interrupt feeds into the 4 word
+transmit FIFO, while it empties the receive FIFO into the transaction's buffer.
+Wire polls the same peripheral, so it mustn't be used while a transaction is queued (SensorBus::flush).
+On the host every transaction fails straight away, use SimulatedBus there.
+*/
+
+namespace Bus
+{
+    class Lpi2cBus : public Backend
+    {
+    public:
+        static constexpr uint32_t TIMEOUT_US = 5000; // far longer than the biggest burst at 400 kHz
+
+        bool begin(uint8_t priority = 96);
+
+        void start(Transaction &transaction) override;
+        void poll() override;
+
+        uint32_t timeouts() const { return m_timeouts; }
+
+        void isr();
+
+    private:
+        uint16_t command(uint16_t index) const;
+        void fillTransmit();
+        void drainReceive();
+        void end(Status status);
+
+        Transaction *volatile m_active = nullptr;
+        uint16_t m_commands = 0; // in the active transaction
+        uint16_t m_sent = 0; // commands written to the FIFO
+        uint16_t m_received = 0; // bytes read back
+        uint32_t m_start_us = 0;
+        uint32_t m_timeouts = 0;
+    };
+}
+
+#endif
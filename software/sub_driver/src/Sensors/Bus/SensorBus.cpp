@@ -0,0 +1,153 @@
+/**
+ * @file SensorBus.cpp
+ * @author Daniel Kim
+ * @brief Queue of non-blocking register transactions on the sensor bus
+ * @version 0.1
+ * @date 2023-05-23
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "SensorBus.h"
+
+#include <atomic>
+
+#if defined(CORE_TEENSY)
+    #include <Arduino.h>
+#endif
+
+namespace Bus
+{
+    static constexpr uint8_t INDEX_MASK = SensorBus::CAPACITY - 1;
+    static_assert((SensorBus::CAPACITY & INDEX_MASK) == 0, "queue size must be a power of two");
+
+    /**
+     * @brief Keeps the bus interrupt out while the loop checks whether the bus is busy
+     *
+     */
+    class CriticalSection
+    {
+    public:
+    #if defined(CORE_TEENSY)
+        CriticalSection() { noInterrupts(); }
+        ~CriticalSection() { interrupts(); }
+    #else
+        CriticalSection() {}
+        ~CriticalSection() {}
+    #endif
+    };
+
+    void Backend::finish(Status status)
+    {
+        if (m_bus)
+        {
+            m_bus->complete(status);
+        }
+    }
+
+    /**
+     * @brief Queues a transaction, starting it if the bus is free
+     *
+     * @param transaction stays owned by the caller, don't touch it until its callback has run
+     * @return true queued, false the queue is full or the transaction is already queued
+     */
+    bool SensorBus::submit(Transaction &transaction)
+    {
+        uint8_t head = m_head;
+        if (transaction.pending() || static_cast<uint8_t>(head - m_serviced) >= CAPACITY)
+        {
+            m_rejected++;
+            return false;
+        }
+
+        transaction.status = Status::PENDING;
+        m_queue[head & INDEX_MASK] = &transaction;
+        std::atomic_signal_fence(std::memory_order_release); // slot is written before the interrupt can see it
+
+        bool start = false;
+        {
+            CriticalSection lock;
+            m_head = head + 1;
+            if (!m_busy)
+            {
+                m_busy = true;
+                start = true;
+            }
+        }
+
+        if (start)
+        {
+            m_backend.start(*m_queue[m_current & INDEX_MASK]);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Ends the transaction on the bus and starts the next one. Called by the backend
+     *
+     * @param status how it went
+     */
+    void SensorBus::complete(Status status)
+    {
+        uint8_t current = m_current;
+        m_queue[current & INDEX_MASK]->status = status;
+        m_current = ++current;
+
+        if (current != m_head)
+        {
+            m_backend.start(*m_queue[current & INDEX_MASK]);
+        }
+        else
+        {
+            m_busy = false;
+        }
+    }
+
+    /**
+     * @brief Runs the callbacks of finished transactions, oldest first
+     *
+     * @return uint8_t callbacks run
+     */
+    uint8_t SensorBus::service()
+    {
+        uint8_t count = 0;
+        uint8_t current = m_current;
+        std::atomic_signal_fence(std::memory_order_acquire);
+
+        while (m_serviced != current)
+        {
+            Transaction &transaction = *m_queue[m_serviced & INDEX_MASK];
+            m_serviced++;
+
+            if (transaction.status == Status::OK)
+            {
+                m_completed++;
+            }
+            else
+            {
+                m_failed++;
+            }
+
+            if (transaction.done)
+            {
+                transaction.done(transaction);
+            }
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Waits for everything queued to finish and runs the callbacks
+     *
+     */
+    void SensorBus::flush()
+    {
+        while (m_busy)
+        {
+            m_backend.poll();
+        }
+        service();
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file SensorBus.h
+ * @author Daniel Kim
+ * @brief Queue of non-blocking register transactions on the sensor bus
+ * @version 0.1
+ * @date 2023-05-23
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef SENSORBUS_H
+#define SENSORBUS_H
+
+#include <cstdint>
+
+/*
+Drivers queue register bursts (write the register address, then read or write length bytes) instead
+of waiting on Wire. A backend runs them one at a time:
+    Lpi2cBus: LPI2C1 interrupt on the Teensy, the CPU only touches the bus to refill its FIFOs
+    SimulatedBus: devices modelled in memory, for running drivers on the host
+The backend finishes each transaction from its interrupt and starts the next one straight away.
+Completion callbacks run later from service() in the loop, so they can use driver state freely.
+
+Transactions and their buffers belong to the driver and must stay put until the callback has run.
+Blocking Wire calls mustn't overlap a queued transaction, call flush() before them.
+No Arduino dependencies apart from the critical section on the Teensy.
+*/
+
+namespace Bus
+{
+    enum class Status : uint8_t
+    {
+        IDLE, // never submitted
+        PENDING, // queued or on the bus
+        OK,
+        NACK, // no device answered
+        ERROR, // arbitration lost, FIFO error or timeout
+    };
+
+    struct Transaction;
+    using Completion = void (*)(Transaction &transaction);
+
+    /**
+     * @brief One register burst
+     *
+     */
+    struct Transaction
+    {
+        uint8_t address = 0; // 7 bit I2C address
+        uint8_t reg = 0; // sent first, including any auto increment bit the device wants
+        bool write = false; // false reads length bytes into buffer, true writes them from it
+        uint8_t *buffer = nullptr;
+        uint16_t length = 0;
+
+        Completion done = nullptr; // called from SensorBus::service
+        void *context = nullptr; // for the callback, usually the driver
+
+        volatile Status status = Status::IDLE;
+
+        bool pending() const { return status == Status::PENDING; }
+    };
+
+    class SensorBus;
+
+    /**
+     * @brief Runs one transaction at a time and calls SensorBus::complete when it's done
+     *
+     */
+    class Backend
+    {
+    public:
+        virtual ~Backend() {}
+        virtual void start(Transaction &transaction) = 0;
+        virtual void poll() {} // lets a backend make progress while flush() waits, e.g. to time out
+
+
+        void bind(SensorBus *bus) { m_bus = bus; }
+
+    protected:
+        void finish(Status status);
+
+    private:
+        SensorBus *m_bus = nullptr;
+    };
+
+    class SensorBus
+    {
+    public:
+        static constexpr uint8_t CAPACITY = 16; // power of two
+
+        explicit SensorBus(Backend &backend) : m_backend(backend) { backend.bind(this); }
+
+        //Main loop side
+
+        bool submit(Transaction &transaction);
+        uint8_t service();
+        void flush();
+
+        bool idle() const { return m_serviced == m_head; }
+        uint8_t queued() const { return static_cast<uint8_t>(m_head - m_serviced); }
+
+        uint32_t completed() const { return m_completed; }
+        uint32_t failed() const { return m_failed; }
+        uint32_t rejected() const { return m_rejected; }
+
+        //Backend side, usually from an interrupt
+
+        void complete(Status status);
+
+    private:
+        Backend &m_backend;
+        Transaction *m_queue[CAPACITY];
+
+        volatile uint8_t m_head = 0; // next free slot, written by submit
+        volatile uint8_t m_current = 0; // transaction on the bus, written by complete
+        uint8_t m_serviced = 0; // next callback to run
+        volatile bool m_busy = false;
+
+        uint32_t m_completed = 0;
+        uint32_t m_failed = 0;
+        uint32_t m_rejected = 0; // submits that found the queue full or the transaction still pending
+    };
+}
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file SimulatedBus.cpp
+ * @author Daniel Kim
+ * @brief Sensor bus backend with the devices modelled in memory, for running drivers on the host
+ * @version 0.1
+ * @date 2023-05-23
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "SimulatedBus.h"
+
+namespace Bus
+{
+    static constexpr int64_t BITS_PER_BYTE = 9; // 8 data bits and the ack
+    static constexpr int64_t START_STOP_BITS = 2;
+
+    bool SimulatedDevice::read(uint8_t reg, uint8_t *buffer, uint16_t length)
+    {
+        for (uint16_t i = 0; i < length; i++)
+        {
+            buffer[i] = registers[static_cast<uint8_t>(reg + i)];
+        }
+        return true;
+    }
+
+    bool SimulatedDevice::write(uint8_t reg, const uint8_t *buffer, uint16_t length)
+    {
+        for (uint16_t i = 0; i < length; i++)
+        {
+            registers[static_cast<uint8_t>(reg + i)] = buffer[i];
+        }
+        return true;
+    }
+
+    /**
+     * @brief Puts a device on the bus
+     *
+     * @return false no room, or the address is taken
+     */
+    bool SimulatedBus::attach(uint8_t address, SimulatedDevice &device)
+    {
+        if (m_device_count >= MAX_DEVICES)
+        {
+            return false;
+        }
+        for (uint8_t i = 0; i < m_device_count; i++)
+        {
+            if (m_devices[i].address == address)
+            {
+                return false;
+            }
+        }
+        m_devices[m_device_count].address = address;
+        m_devices[m_device_count].device = &device;
+        m_device_count++;
+        return true;
+    }
+
+    /**
+     * @brief Time on the wire: address and register, a repeated start and address for reads, then the data
+     *
+     */
+    int64_t SimulatedBus::transferNs(const Transaction &transaction) const
+    {
+        int64_t bytes = 2 + (transaction.write ? 0 : 1) + transaction.length;
+        int64_t bits = bytes * BITS_PER_BYTE + START_STOP_BITS * (transaction.write ? 1 : 2);
+        return bits * 1000000000LL / m_clock_hz;
+    }
+
+    void SimulatedBus::start(Transaction &transaction)
+    {
+        int64_t begin_ns = m_done_ns > m_now_ns ? m_done_ns : m_now_ns; // back to back with the last one
+        m_active = &transaction;
+        m_done_ns = begin_ns + transferNs(transaction);
+        m_busy_ns += m_done_ns - begin_ns;
+    }
+
+    void SimulatedBus::poll()
+    {
+        if (m_active)
+        {
+            m_now_ns = m_done_ns;
+            finishActive();
+        }
+    }
+
+    /**
+     * @brief Moves simulated time on, finishing every transaction that's done by then
+     *
+     * @param now_ns simulated time
+     */
+    void SimulatedBus::advance(int64_t now_ns)
+    {
+        while (m_active && m_done_ns <= now_ns)
+        {
+            m_now_ns = m_done_ns;
+            finishActive();
+        }
+        m_now_ns = now_ns;
+    }
+
+    void SimulatedBus::finishActive()
+    {
+        Transaction &transaction = *m_active;
+        m_active = nullptr;
+
+        SimulatedDevice *device = nullptr;
+        for (uint8_t i = 0; i < m_device_count; i++)
+        {
+            if (m_devices[i].address == transaction.address)
+            {
+                device = m_devices[i].device;
+            }
+        }
+
+        if (!device)
+        {
+            finish(Status::NACK);
+            return;
+        }
+
+        bool ok = transaction.write ? device->write(transaction.reg, transaction.buffer, transaction.length)
+                                    : device->read(transaction.reg, transaction.buffer, transaction.length);
+        finish(ok ? Status::OK : Status::NACK); // may start the next transaction
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file SimulatedBus.h
+ * @author Daniel Kim
+ * @brief Sensor bus backend with the devices modelled in memory, for running drivers on the host
+ * @version 0.1
+ * @date 2023-05-23
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef SIMULATEDBUS_H
+#define SIMULATEDBUS_H
+
+#include <cstdint>
+
+#include "SensorBus.h"
+
+namespace Bus
+{
+    /**
+     * @brief A device on the simulated bus. By default a 256 byte register map with auto increment
+     * Override read/write to model FIFOs, status bits and the like
+     */
+    class SimulatedDevice
+    {
+    public:
+        virtual ~SimulatedDevice() {}
+        virtual bool read(uint8_t reg, uint8_t *buffer, uint16_t length);
+        virtual bool write(uint8_t reg, const uint8_t *buffer, uint16_t length);
+
+        uint8_t registers[256] = {};
+    };
+
+    /**
+     * @brief Transactions take as long as they would on the wire, in simulated time moved on by advance()
+     *
+     */
+    class SimulatedBus : public Backend
+    {
+    public:
+        static constexpr uint8_t MAX_DEVICES = 8;
+
+        explicit SimulatedBus(uint32_t clock_hz = 400000) : m_clock_hz(clock_hz) {}
+
+        bool attach(uint8_t address, SimulatedDevice &device);
+
+        void start(Transaction &transaction) override;
+        void poll() override; // finishes the transaction on the bus now
+
+        void advance(int64_t now_ns);
+
+        int64_t busyNs() const { return m_busy_ns; } // total time transactions spent on the bus
+        int64_t transferNs(const Transaction &transaction) const;
+
+    private:
+        struct Slot
+        {
+            uint8_t address = 0;
+            SimulatedDevice *device = nullptr;
+        };
+
+        void finishActive();
+
+        uint32_t m_clock_hz;
+        Slot m_devices[MAX_DEVICES];
+        uint8_t m_device_count = 0;
+
+        Transaction *m_active = nullptr;
+        int64_t m_now_ns = 0;
+        int64_t m_done_ns = 0; // when the transaction on the bus finishes
+        int64_t m_busy_ns = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,292 @@
+/**
+ * @file Decimator.h
+ * @author Daniel Kim
+ * @brief Decimators for sensors read in batches, and for streams off the analog scan
+ * @version 0.1
+ * @date 2023-05-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+#ifndef Decimator_h
+#define Decimator_h
+
+#include <cmath>
+#include <cstdint>
+
+/*
+Decimator: boxcar average of each block, for batches read out of sensor FIFOs.
+
+For streams at kHz rates (the analog scan's frames) there's a chain instead:
+    CicDecimator: ORDER integrators at the input rate, ORDER combs at the output rate. Integer adds
+        only, wrapping in uint32 is fine as long as the output fits, which BIT_GROWTH checks
+    HalfBandDecimator: halves the rate with a windowed sinc FIR. Every other tap is zero and the
+        rest are symmetric, so an output costs (TAPS + 1) / 4 multiplies
+    DecimationChain: a CIC, then HALF_BANDS half bands. The CIC does the bulk of the rate change
+        cheaply and the half bands clean up its droop and the band it lets alias
+All of them are linear phase, so the group delay is a constant number of input samples (DELAY).
+No Arduino dependencies.
+*/
+
+namespace Filter
+{
+  /**
+   * @brief Averages each block of factor samples into one output (boxcar FIR, then downsample)
+   * Uncorrelated noise drops by sqrt(factor), and the first null of the response sits at the output
+   * rate so most of what would alias onto the output is taken out. No Arduino dependencies.
+   */
+  class Decimator
+  {
+  private:
+    uint16_t factor;
+    uint16_t count = 0;
+    double sum = 0;
+    int64_t time_sum = 0;
+
+  public:
+    explicit Decimator(uint16_t factor) : factor(factor > 0 ? factor : 1) {}
+
+    void reset()
+    {
+      count = 0;
+      sum = 0;
+      time_sum = 0;
+    }
+
+    /**
+     * @brief Adds one sample
+     *
+     * @param xn sample
+     * @param time_ns when it was taken
+     * @param yn average of the block, set when one is finished
+     * @param y_time_ns middle of the block
+     * @return true a block was finished
+     */
+    bool push(double xn, int64_t time_ns, double &yn, int64_t &y_time_ns)
+    {
+      sum += xn;
+      time_sum += time_ns / factor;
+      if (++count < factor)
+      {
+        return false;
+      }
+
+      yn = sum / factor;
+      y_time_ns = time_sum;
+      reset();
+      return true;
+    }
+
+    uint16_t getFactor() const { return factor; }
+  };
+
+  constexpr uint8_t ceilLog2(uint32_t x)
+  {
+    return x <= 1 ? 0 : 1 + ceilLog2((x + 1) / 2);
+  }
+
+  constexpr uint32_t power(uint32_t base, uint8_t exponent)
+  {
+    return exponent == 0 ? 1 : base * power(base, exponent - 1);
+  }
+
+  /**
+   * @brief Cascaded integrator comb decimator, for unsigned samples of INPUT_BITS
+   * The response is sinc^ORDER with nulls at multiples of the output rate, and a gain of GAIN
+   */
+  template <uint8_t ORDER, uint16_t RATIO, uint8_t INPUT_BITS = 12>
+  class CicDecimator
+  {
+  public:
+    static constexpr uint32_t GAIN = power(RATIO, ORDER);
+    static constexpr uint8_t BIT_GROWTH = ORDER * ceilLog2(RATIO);
+    static constexpr double DELAY = ORDER * (RATIO - 1) / 2.0; // input samples
+
+    static_assert(ORDER > 0 && RATIO > 1, "CIC needs at least one stage and a ratio of 2");
+    static_assert(INPUT_BITS + BIT_GROWTH <= 32, "CIC output doesn't fit in 32 bits");
+
+    void reset()
+    {
+      count = 0;
+      for (uint8_t k = 0; k < ORDER; k++)
+      {
+        integrator[k] = 0;
+        comb[k] = 0;
+      }
+    }
+
+    /**
+     * @brief Adds one sample
+     *
+     * @param xn sample
+     * @param yn set to the output, times GAIN, when one is finished
+     * @return true an output was finished
+     */
+    bool push(uint32_t xn, uint32_t &yn)
+    {
+      uint32_t v = xn;
+      for (uint8_t k = 0; k < ORDER; k++)
+      {
+        integrator[k] += v;
+        v = integrator[k];
+      }
+      if (++count < RATIO)
+      {
+        return false;
+      }
+      count = 0;
+
+      for (uint8_t k = 0; k < ORDER; k++)
+      {
+        uint32_t difference = v - comb[k];
+        comb[k] = v;
+        v = difference;
+      }
+      yn = v;
+      return true;
+    }
+
+  private:
+    uint32_t integrator[ORDER] = {};
+    uint32_t comb[ORDER] = {};
+    uint16_t count = 0;
+  };
+
+  /**
+   * @brief Decimates by 2 with a Blackman windowed half band FIR
+   * The history is written twice, TAPS apart, so the window is always contiguous
+   */
+  template <uint8_t TAPS, typename T = float>
+  class HalfBandDecimator
+  {
+  public:
+    static_assert(TAPS % 4 == 3, "half band filters have 4k + 3 taps");
+
+    static constexpr uint8_t CENTER = (TAPS - 1) / 2;
+    static constexpr uint8_t SIDE = (TAPS + 1) / 4; // non zero taps each side of the center
+    static constexpr double DELAY = CENTER; // input samples
+
+    HalfBandDecimator()
+    {
+      // Taps at odd distances m from the center: sinc(m / 2) / 2, windowed
+      double sum = 0.0;
+      double taps[SIDE];
+      for (uint8_t k = 0; k < SIDE; k++)
+      {
+        const double m = 2 * k + 1;
+        const double n = CENTER + m + 1; // window two longer than the filter, so its zero ends fall outside
+        const double window = 0.42 - 0.5 * std::cos(2.0 * M_PI * n / (TAPS + 1)) + 0.08 * std::cos(4.0 * M_PI * n / (TAPS + 1));
+        taps[k] = std::sin(M_PI * m / 2.0) / (M_PI * m) * window;
+        sum += 2.0 * taps[k];
+      }
+
+      // Scaled so the DC gain is 1 with the 0.5 center tap
+      for (uint8_t k = 0; k < SIDE; k++)
+      {
+        coefficient[k] = static_cast<T>(taps[k] * 0.5 / sum);
+      }
+    }
+
+    void reset()
+    {
+      head = 0;
+      odd = false;
+      for (uint8_t i = 0; i < 2 * TAPS; i++)
+      {
+        history[i] = 0;
+      }
+    }
+
+    /**
+     * @brief Adds one sample, every second one finishes an output
+     *
+     */
+    bool push(T xn, T &yn)
+    {
+      history[head] = xn;
+      history[head + TAPS] = xn;
+      head = head + 1 < TAPS ? head + 1 : 0;
+
+      odd = !odd;
+      if (odd)
+      {
+        return false;
+      }
+
+      const T *window = &history[head]; // oldest first
+      T sum = static_cast<T>(0.5) * window[CENTER];
+      for (uint8_t k = 0; k < SIDE; k++)
+      {
+        sum += coefficient[k] * (window[CENTER - 1 - 2 * k] + window[CENTER + 1 + 2 * k]);
+      }
+      yn = sum;
+      return true;
+    }
+
+    T tap(uint8_t k) const { return coefficient[k]; } // at a distance of 2k + 1 from the center
+
+  private:
+    T coefficient[SIDE];
+    T history[2 * TAPS] = {};
+    uint8_t head = 0;
+    bool odd = false;
+  };
+
+  /**
+   * @brief CIC followed by HALF_BANDS half bands, RATIO in total
+   * Outputs are in input units (the CIC gain is taken out)
+   */
+  template <uint8_t CIC_ORDER, uint16_t CIC_RATIO, uint8_t HALF_BANDS, uint8_t TAPS, uint8_t INPUT_BITS = 12>
+  class DecimationChain
+  {
+  public:
+    using Cic = CicDecimator<CIC_ORDER, CIC_RATIO, INPUT_BITS>;
+    using HalfBand = HalfBandDecimator<TAPS>;
+
+    static_assert(HALF_BANDS > 0, "use CicDecimator on its own");
+
+    static constexpr uint32_t RATIO = static_cast<uint32_t>(CIC_RATIO) << HALF_BANDS;
+    static constexpr double DELAY = Cic::DELAY + HalfBand::DELAY * CIC_RATIO * ((1 << HALF_BANDS) - 1); // input samples
+
+    void reset()
+    {
+      cic.reset();
+      for (uint8_t j = 0; j < HALF_BANDS; j++)
+      {
+        half_bands[j].reset();
+      }
+    }
+
+    /**
+     * @brief Adds one sample
+     *
+     * @param xn sample
+     * @param yn set when an output is finished
+     * @return true an output was finished, every RATIO samples
+     */
+    bool push(uint32_t xn, float &yn)
+    {
+      uint32_t sum;
+      if (!cic.push(xn, sum))
+      {
+        return false;
+      }
+
+      float v = static_cast<float>(sum) * (1.0f / Cic::GAIN);
+      for (uint8_t j = 0; j < HALF_BANDS; j++)
+      {
+        if (!half_bands[j].push(v, v))
+        {
+          return false;
+        }
+      }
+      yn = v;
+      return true;
+    }
+
+  private:
+    Cic cic;
+    HalfBand half_bands[HALF_BANDS];
+  };
+};
+#endif // Decimator_h
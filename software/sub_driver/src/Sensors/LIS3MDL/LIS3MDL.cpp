@@ -120,6 +120,27 @@ void LIS3MDL::enableDefault(void)
   }
 }
 
+/*
+Switches to one of the FAST_ODR rates, which take the performance mode with them (datasheet table 21)
+Block data update is turned on so a burst read never mixes two samples. The DRDY pin goes high
+when a sample is ready and low once it has been read.
+*/
+void LIS3MDL::setFastOdr(fastOdr odr)
+{
+  static const uint32_t periods_ns[] = {1000000, 1785714, 3333333, 6451613};
+
+  // OM = odr, FAST_ODR = 1
+  writeReg(CTRL_REG1, (uint8_t)(odr << 5) | 0x02);
+
+  // OMZ = odr
+  writeReg(CTRL_REG4, (uint8_t)(odr << 2));
+
+  // BDU = 1
+  writeReg(CTRL_REG5, 0x40);
+
+  odr_period_ns = periods_ns[odr];
+}
+
 // Writes a mag register
 void LIS3MDL::writeReg(uint8_t reg, uint8_t value)
 {
@@ -176,6 +197,48 @@ void LIS3MDL::read()
   m.z = (int16_t)(zhm << 8 | zlm);
 }
 
+// Queues the same read on the sensor bus instead of waiting for it, with the status register in the same burst
+bool LIS3MDL::requestRead(Bus::SensorBus &bus)
+{
+  read_transaction.address = address;
+  // assert MSB to enable subaddress updating
+  read_transaction.reg = STATUS_REG | 0x80;
+  read_transaction.buffer = read_buffer;
+  read_transaction.length = sizeof(read_buffer);
+  read_transaction.done = &LIS3MDL::onRead;
+  read_transaction.context = this;
+  return bus.submit(read_transaction);
+}
+
+bool LIS3MDL::takeReading()
+{
+  bool ready = reading_ready;
+  reading_ready = false;
+  return ready;
+}
+
+void LIS3MDL::onRead(Bus::Transaction &transaction)
+{
+  LIS3MDL *self = static_cast<LIS3MDL *>(transaction.context);
+  if (transaction.status != Bus::Status::OK)
+  {
+    self->did_timeout = true;
+    return;
+  }
+
+  // ZYXDA clear: nothing new since the last read
+  const uint8_t *data = transaction.buffer;
+  if (!(data[0] & 0x08))
+  {
+    return;
+  }
+
+  self->m.x = (int16_t)(data[2] << 8 | data[1]);
+  self->m.y = (int16_t)(data[4] << 8 | data[3]);
+  self->m.z = (int16_t)(data[6] << 8 | data[5]);
+  self->reading_ready = true;
+}
+
 void LIS3MDL::vector_normalize(vector<float> *a)
 {
   float mag = sqrt(vector_dot(a, a));
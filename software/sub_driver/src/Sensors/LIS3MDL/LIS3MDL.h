@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 
+#include "../Bus/SensorBus.h"
+
 class LIS3MDL
 {
   public:
@@ -13,6 +15,8 @@ class LIS3MDL
 
     enum deviceType { device_LIS3MDL, device_auto };
     enum sa1State { sa1_low, sa1_high, sa1_auto };
+    // FAST_ODR rates, each tied to a performance mode (the OM/OMZ value)
+    enum fastOdr { odr_1000hz_lp, odr_560hz_mp, odr_300hz_hp, odr_155hz_uhp };
 
     // register addresses
     enum regAddr
@@ -50,11 +54,16 @@ class LIS3MDL
     deviceType getDeviceType(void) { return _device; }
 
     void enableDefault(void);
+    void setFastOdr(fastOdr odr);
+    uint32_t getOdrPeriodNs(void) const { return odr_period_ns; }
 
     void writeReg(uint8_t reg, uint8_t value);
     uint8_t readReg(uint8_t reg);
 
     void read(void);
+    bool requestRead(Bus::SensorBus &bus); // queues a read of the status and 3 mag channels, m is updated from SensorBus::service
+    bool readPending(void) const { return read_transaction.pending(); }
+    bool takeReading(void); // true once for each queued read that came back with new data
 
     void setTimeout(uint16_t timeout);
     uint16_t getTimeout(void);
@@ -73,6 +82,12 @@ class LIS3MDL
     bool did_timeout;
 
     int16_t testReg(uint8_t address, regAddr reg);
+
+    Bus::Transaction read_transaction;
+    uint8_t read_buffer[7]; // STATUS_REG, then OUT_X_L to OUT_Z_H
+    uint32_t odr_period_ns = 100000000;
+    bool reading_ready = false;
+    static void onRead(Bus::Transaction &transaction);
 };
 
 template <typename Ta, typename Tb, typename To> void LIS3MDL::vector_cross(const vector<Ta> *a, const vector<Tb> *b, vector<To> *out)
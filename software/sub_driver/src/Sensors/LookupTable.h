@@ -0,0 +1,100 @@
+/**
+ * @file LookupTable.h
+ * @author Daniel Kim
+ * @brief Transfer functions sampled into tables at compile time, read back with linear interpolation
+ * @version 0.1
+ * @date 2023-05-26
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef LOOKUPTABLE_H
+#define LOOKUPTABLE_H
+
+#include <cstdint>
+
+/*
+A table is built from any function object with a constexpr operator()(double), evaluated at
+SEGMENTS + 1 evenly spaced points between x_min and x_max. Declared constexpr, the whole table is
+worked out by the compiler and ends up in flash; a lookup is a multiply, a truncation and one
+interpolation. Inputs outside the range get the end values.
+The std:: math functions aren't constexpr, so the ones the tables need are here.
+No Arduino dependencies.
+*/
+
+namespace Conversion
+{
+    /**
+     * @brief Natural log for building tables. x must be positive
+     * x = m * 2^k with m in [0.75, 1.5), then ln(m) = 2 atanh((m - 1) / (m + 1)), |z| < 0.2
+     */
+    constexpr double log(double x)
+    {
+        constexpr double LN2 = 0.69314718055994530942;
+
+        int k = 0;
+        while (x >= 1.5)
+        {
+            x /= 2.0;
+            k++;
+        }
+        while (x < 0.75)
+        {
+            x *= 2.0;
+            k--;
+        }
+
+        double z = (x - 1.0) / (x + 1.0);
+        double z2 = z * z;
+        double term = z;
+        double sum = 0.0;
+        for (int n = 1; n < 40; n += 2)
+        {
+            sum += term / n;
+            term *= z2;
+        }
+        return 2.0 * sum + k * LN2;
+    }
+
+    template <uint16_t SEGMENTS>
+    class Table
+    {
+    public:
+        template <typename Function>
+        constexpr Table(const Function &function, double x_min, double x_max)
+            : m_min(static_cast<float>(x_min)), m_scale(static_cast<float>(SEGMENTS / (x_max - x_min))), m_values{}
+        {
+            for (uint16_t i = 0; i <= SEGMENTS; i++)
+            {
+                m_values[i] = static_cast<float>(function(x_min + (x_max - x_min) * i / SEGMENTS));
+            }
+        }
+
+        float operator()(float x) const
+        {
+            float position = (x - m_min) * m_scale;
+            if (!(position > 0.0f)) // NaN too
+            {
+                return m_values[0];
+            }
+            if (position >= SEGMENTS)
+            {
+                return m_values[SEGMENTS];
+            }
+
+            uint16_t i = static_cast<uint16_t>(position);
+            float t = position - i;
+            return m_values[i] + (m_values[i + 1] - m_values[i]) * t;
+        }
+
+        constexpr float at(uint16_t i) const { return m_values[i]; } // the function at point i
+
+    private:
+        float m_min;
+        float m_scale; // points per unit of x
+        float m_values[SEGMENTS + 1];
+    };
+}
+
+#endif
@@ -11,21 +11,75 @@
 #ifndef LowPass_h
 #define LowPass_h
 
-#include <Arduino.h>
+#include <cmath>
+#include <cstdint>
+
+/*
+Butterworth low pass, discretized with the bilinear transform for the dt it's given.
+Working out the coefficients takes a few divisions (and a sqrt for order 2), so they're kept until
+dt drifts more than DT_TOLERANCE from the dt they were made for. Filters on a fixed rate can call
+setRate() once and filt(xn) after that.
+    LowPass<order, T>: one channel, T is double or float (coefficients are always worked out in double)
+    LowPass3<order, T>: x, y and z with the same coefficients, one pass over all three
+    LowPassFixed<order>: integer samples within int16 at a fixed rate, Q29 coefficients and Q15 output
+No Arduino dependencies.
+*/
 
 namespace Filter
 {
-  template <int order> // order is 1 or 2
+  constexpr double DT_TOLERANCE = 0.01; // relative change in dt before the coefficients are worked out again
+
+  /**
+   * @brief Coefficients of y[n] = b0 x[n] + b1 x[n-1] (+ b2 x[n-2]) + a0 y[n-1] (+ a1 y[n-2])
+   * b1 = b0 for order 1 and 2 b0 for order 2, so only b0 is kept
+   */
+  template <int order>
+  struct LowPassCoefficients
+  {
+    static_assert(order == 1 || order == 2, "order is 1 or 2");
+
+    double b0 = 0.0;
+    double a[order] = {};
+    double dt_low = 1.0; // dt within [dt_low, dt_high] keeps them, an empty range until they're made
+    double dt_high = 0.0;
+
+    void make(double omega0, double new_dt)
+    {
+      double alpha = omega0 * new_dt;
+      if (order == 1)
+      {
+        b0 = alpha / (alpha + 2.0);
+        a[0] = -(alpha - 2.0) / (alpha + 2.0);
+      }
+      else
+      {
+        double alphaSq = alpha * alpha;
+        double D = alphaSq + 2.0 * M_SQRT2 * alpha + 4.0;
+        b0 = alphaSq / D;
+        a[0] = -(2.0 * alphaSq - 8.0) / D;
+        a[order - 1] = -(alphaSq - 2.0 * M_SQRT2 * alpha + 4.0) / D;
+      }
+      dt_low = new_dt * (1.0 - DT_TOLERANCE);
+      dt_high = new_dt * (1.0 + DT_TOLERANCE);
+    }
+
+    bool stale(double new_dt) const
+    {
+      return !(new_dt >= dt_low && new_dt <= dt_high);
+    }
+  };
+
+  template <int order, typename T = double> // order is 1 or 2
   class LowPass
   {
   private:
-    double a[order];
-    double b[order + 1];
-    double omega0;
+    double omega0 = 0.0;
+    LowPassCoefficients<order> coef;
 
-    double tn1 = 0;
-    double x[order + 1]; // Raw values
-    double y[order + 1]; // Filtered values
+    T b0 = 0;
+    T a[order] = {};
+    T x[order] = {}; // previous raw values, newest first
+    T y[order] = {}; // previous filtered values, newest first
 
   public:
     LowPass(double f0)
@@ -38,61 +92,241 @@ namespace Filter
     void setCutoff(double f0)
     {
       omega0 = 6.28318530718 * f0;
-      for(int k = 0; k < order + 1; k++)
+      coef = LowPassCoefficients<order>();
+      for (int k = 0; k < order; k++)
       {
         x[k] = 0;
         y[k] = 0;
       }
     }
 
-    void setCoef(double dt)
+    /**
+     * @brief Works out the coefficients for a fixed sample period, for use with filt(xn)
+     *
+     */
+    void setRate(double dt)
     {
-
-      double alpha = omega0 * dt;
-      if (order == 1)
+      coef.make(omega0, dt);
+      b0 = static_cast<T>(coef.b0);
+      for (int k = 0; k < order; k++)
       {
-        a[0] = -(alpha - 2.0) / (alpha + 2.0);
-        b[0] = alpha / (alpha + 2.0);
-        b[1] = alpha / (alpha + 2.0);
+        a[k] = static_cast<T>(coef.a[k]);
       }
-      if (order == 2)
+    }
+
+    void setCoef(double dt)
+    {
+      if (coef.stale(dt))
       {
-        double alphaSq = alpha * alpha;
-        double beta[] = {1, sqrt(2), 1};
-        double D = alphaSq * beta[0] + 2 * alpha * beta[1] + 4 * beta[2];
-        b[0] = alphaSq / D;
-        b[1] = 2 * b[0];
-        b[2] = b[0];
-        a[0] = -(2 * alphaSq * beta[0] - 8 * beta[2]) / D;
-        a[1] = -(beta[0] * alphaSq - 2 * beta[1] * alpha + 4 * beta[2]) / D;
+        setRate(dt);
       }
     }
 
-    double filt(double xn, double dt)
+    T filt(T xn, double dt)
     {
       // Provide me with the current raw value: x
       // I will give you the current filtered value: y
 
       setCoef(dt); // Update coefficients if necessary
+      return filt(xn);
+    }
 
-      y[0] = 0;
+    T filt(T xn)
+    {
+      T yn;
+      if (order == 1)
+      {
+        yn = b0 * (xn + x[0]) + a[0] * y[0];
+      }
+      else
+      {
+        yn = b0 * (xn + 2 * x[0] + x[order - 1]) + a[0] * y[0] + a[order - 1] * y[order - 1];
+        x[order - 1] = x[0];
+        y[order - 1] = y[0];
+      }
       x[0] = xn;
-      // Compute the filtered values
+      y[0] = yn;
+
+      // Return the filtered value
+      return yn;
+    }
+  };
+
+  /**
+   * @brief Three channels through the same filter, e.g. the axes of one sensor
+   * The channels sit next to each other so the loops over them can be vectorized
+   */
+  template <int order, typename T = float>
+  class LowPass3
+  {
+  private:
+    double omega0 = 0.0;
+    LowPassCoefficients<order> coef;
+
+    T b0 = 0;
+    T a[order] = {};
+    T x[order][3] = {};
+    T y[order][3] = {};
+
+  public:
+    LowPass3(double f0)
+    {
+      setCutoff(f0);
+    }
+
+    LowPass3() {}
+
+    void setCutoff(double f0)
+    {
+      omega0 = 6.28318530718 * f0;
+      coef = LowPassCoefficients<order>();
+      for (int k = 0; k < order; k++)
+      {
+        for (int i = 0; i < 3; i++)
+        {
+          x[k][i] = 0;
+          y[k][i] = 0;
+        }
+      }
+    }
+
+    void setRate(double dt)
+    {
+      coef.make(omega0, dt);
+      b0 = static_cast<T>(coef.b0);
       for (int k = 0; k < order; k++)
       {
-        y[0] += a[k] * y[k + 1] + b[k] * x[k];
+        a[k] = static_cast<T>(coef.a[k]);
       }
-      y[0] += b[order] * x[order];
+    }
 
-      // Save the historical values
-      for (int k = order; k > 0; k--)
+    void setCoef(double dt)
+    {
+      if (coef.stale(dt))
       {
-        y[k] = y[k - 1];
-        x[k] = x[k - 1];
+        setRate(dt);
       }
+    }
 
-      // Return the filtered value
-      return y[0];
+    /**
+     * @brief Filters xyz in place
+     *
+     */
+    void filt(T xyz[3], double dt)
+    {
+      setCoef(dt);
+      filt(xyz);
+    }
+
+    void filt(T xyz[3])
+    {
+      // Read out first, xyz could alias the state as far as the compiler knows
+      const T xn0 = xyz[0];
+      const T xn1 = xyz[1];
+      const T xn2 = xyz[2];
+      xyz[0] = step(0, xn0);
+      xyz[1] = step(1, xn1);
+      xyz[2] = step(2, xn2);
+    }
+
+  private:
+    inline T step(int i, T xn)
+    {
+      T yn;
+      if (order == 1)
+      {
+        yn = b0 * (xn + x[0][i]) + a[0] * y[0][i];
+      }
+      else
+      {
+        yn = b0 * (xn + 2 * x[0][i] + x[order - 1][i]) + a[0] * y[0][i] + a[order - 1] * y[order - 1][i];
+        x[order - 1][i] = x[0][i];
+        y[order - 1][i] = y[0][i];
+      }
+      x[0][i] = xn;
+      y[0][i] = yn;
+      return yn;
+    }
+  };
+
+  /**
+   * @brief Fixed rate filter for integer samples (within int16), without floating point per sample
+   * Coefficients are Q29. The output keeps FRACTION_BITS below the input's LSB so small steps aren't lost,
+   * and is fed back as it is. Each sample sums into 64 bits and is rounded back with an arithmetic shift
+   */
+  template <int order>
+  class LowPassFixed
+  {
+  public:
+    static constexpr int COEFFICIENT_BITS = 29;
+    static constexpr int FRACTION_BITS = 15;
+
+  private:
+    double omega0 = 0.0;
+
+    int32_t b0 = 0;
+    int32_t a[order] = {};
+    int32_t x[order] = {}; // previous raw values, input units
+    int32_t y[order] = {}; // previous filtered values, Q15
+
+    static int32_t toFixed(double coefficient)
+    {
+      return static_cast<int32_t>(std::lround(coefficient * (INT64_C(1) << COEFFICIENT_BITS)));
+    }
+
+  public:
+    LowPassFixed(double f0, double dt)
+    {
+      setCutoff(f0);
+      setRate(dt);
+    }
+
+    LowPassFixed() {}
+
+    void setCutoff(double f0)
+    {
+      omega0 = 6.28318530718 * f0;
+      for (int k = 0; k < order; k++)
+      {
+        x[k] = 0;
+        y[k] = 0;
+      }
+    }
+
+    void setRate(double dt)
+    {
+      LowPassCoefficients<order> coef;
+      coef.make(omega0, dt);
+      b0 = toFixed(coef.b0);
+      for (int k = 0; k < order; k++)
+      {
+        a[k] = toFixed(coef.a[k]);
+      }
+    }
+
+    /**
+     * @brief Filters one sample
+     *
+     * @param xn raw value, within int16
+     * @return int32_t filtered value, Q15 (divide by 1 << FRACTION_BITS for input units)
+     */
+    int32_t filt(int32_t xn)
+    {
+      // Q29 coefficients times Q15 values: under 2^62 for inputs within int16, order 2 included
+      int64_t inputs = order == 1 ? static_cast<int64_t>(xn) + x[0] : static_cast<int64_t>(xn) + 2 * static_cast<int64_t>(x[0]) + x[order - 1];
+      int64_t sum = static_cast<int64_t>(b0) * (inputs * (INT64_C(1) << FRACTION_BITS)) + static_cast<int64_t>(a[0]) * y[0];
+      if (order == 2)
+      {
+        sum += static_cast<int64_t>(a[order - 1]) * y[order - 1];
+        x[order - 1] = x[0];
+        y[order - 1] = y[0];
+      }
+
+      // Round to nearest: >> of a negative int64 is an arithmetic shift on GCC and the M7
+      int32_t yn = static_cast<int32_t>((sum + (INT64_C(1) << (COEFFICIENT_BITS - 1))) >> COEFFICIENT_BITS);
+      x[0] = xn;
+      y[0] = yn;
+      return yn;
     }
   };
 };
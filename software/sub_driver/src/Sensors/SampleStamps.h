@@ -0,0 +1,116 @@
+/**
+ * @file SampleStamps.h
+ * @author Daniel Kim
+ * @brief Timestamps taken in the sensor interrupts, for timing samples that are read later
+ * @version 0.1
+ * @date 2023-05-24
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef SAMPLESTAMPS_H
+#define SAMPLESTAMPS_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "../core/LoopTime.h"
+
+/*
+A sample is read some time after the sensor took it, whenever the loop gets to it. The interrupt that
+says it's ready runs within a microsecond, so it stamps Time::rawTicks() into a ring and the loop maps
+the stamps onto its own clock when it reads the sample.
+Raw ticks wrap every few seconds, so stamps have to be used within about a second.
+*/
+
+namespace Sensors
+{
+    /**
+     * @brief Single producer (interrupt), single consumer (main loop) ring of raw tick stamps
+     *
+     * @tparam SIZE entries, power of two
+     */
+    template <uint8_t SIZE>
+    class StampRing
+    {
+        static_assert((SIZE & (SIZE - 1)) == 0, "ring size must be a power of two");
+
+    public:
+        /**
+         * @brief Interrupt side. A full ring keeps its older stamps and counts the new one as dropped
+         *
+         */
+        void push(uint32_t ticks)
+        {
+            uint8_t head = m_head;
+            if (static_cast<uint8_t>(head - m_tail) >= SIZE)
+            {
+                m_dropped++;
+                return;
+            }
+            m_buffer[head & (SIZE - 1)] = ticks;
+            std::atomic_signal_fence(std::memory_order_release);
+            m_head = head + 1;
+        }
+
+        bool pop(uint32_t &ticks)
+        {
+            uint8_t tail = m_tail;
+            if (tail == m_head)
+            {
+                return false;
+            }
+            std::atomic_signal_fence(std::memory_order_acquire);
+            ticks = m_buffer[tail & (SIZE - 1)];
+            m_tail = tail + 1;
+            return true;
+        }
+
+        /**
+         * @brief Empties the ring, keeping the newest stamp
+         *
+         * @return false there were none
+         */
+        bool latest(uint32_t &ticks)
+        {
+            bool found = false;
+            while (pop(ticks))
+            {
+                found = true;
+            }
+            return found;
+        }
+
+        uint8_t size() const { return static_cast<uint8_t>(m_head - m_tail); }
+        uint32_t dropped() const { return m_dropped; }
+
+    private:
+        uint32_t m_buffer[SIZE];
+        volatile uint8_t m_head = 0;
+        volatile uint8_t m_tail = 0;
+        volatile uint32_t m_dropped = 0;
+    };
+
+    /**
+     * @brief Pairs a raw tick count with the loop clock, read back to back
+     *
+     */
+    struct StampReference
+    {
+        uint32_t ticks = 0;
+        int64_t ns = 0;
+
+        /**
+         * @brief A stamp on the loop clock. Stamps a little after the reference come out after it too
+         *
+         */
+        int64_t toNs(uint32_t stamp) const
+        {
+            int32_t age = static_cast<int32_t>(ticks - stamp); // wraps cleanly
+            return ns - static_cast<int64_t>(age) * 1000 / Time::rawTicksPerUs();
+        }
+    };
+}
+
+#endif
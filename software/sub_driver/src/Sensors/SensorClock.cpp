@@ -0,0 +1,50 @@
+/**
+ * @file SensorClock.cpp
+ * @author Daniel Kim
+ * @brief Maps the sensor time of Bosch FIFOs onto our clock
+ * @version 0.1
+ * @date 2023-05-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "SensorClock.h"
+
+namespace Sensors
+{
+    static constexpr uint8_t OFFSET_CREEP_SHIFT = 8; // offset moves up by 1/256 of the difference per read
+
+    /**
+     * @brief Time of a sensor time on our clock
+     *
+     * @param sensor_time 24 bit counter from the FIFO
+     * @param read_ns our time when the FIFO was read
+     * @return int64_t ns
+     */
+    int64_t SensorClock::toNs(uint32_t sensor_time, int64_t read_ns)
+    {
+        sensor_time &= SENSOR_TIME_MASK;
+        if (!m_started)
+        {
+            m_previous = sensor_time;
+            m_ticks = sensor_time;
+        }
+        m_ticks += (sensor_time - m_previous) & SENSOR_TIME_MASK; // wraps every 655 s
+        m_previous = sensor_time;
+
+        int64_t sensor_ns = m_ticks * SENSOR_TIME_TICK_NS2 / 2;
+        int64_t offset = read_ns - sensor_ns;
+        if (!m_started || offset < m_offset_ns)
+        {
+            m_offset_ns = offset;
+            m_started = true;
+        }
+        else
+        {
+            m_offset_ns += (offset - m_offset_ns) >> OFFSET_CREEP_SHIFT;
+        }
+
+        return sensor_ns + m_offset_ns;
+    }
+}
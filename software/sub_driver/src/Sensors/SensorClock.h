@@ -0,0 +1,47 @@
+/**
+ * @file SensorClock.h
+ * @author Daniel Kim
+ * @brief Maps the sensor time of Bosch FIFOs onto our clock
+ * @version 0.1
+ * @date 2023-05-22
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef SENSORCLOCK_H
+#define SENSORCLOCK_H
+
+#include <cstdint>
+
+/*
+The BMI088 accel and the BMP388 both append a 24 bit sensor time to a FIFO read that goes past the
+last frame. It counts at 25.6 kHz (39.0625 us) and wraps every 655 s.
+No Arduino dependencies.
+*/
+
+namespace Sensors
+{
+    constexpr int64_t SENSOR_TIME_TICK_NS2 = 78125; // 39.0625 us in half nanoseconds
+    constexpr uint32_t SENSOR_TIME_MASK = 0xFFFFFF;
+
+    /**
+     * @brief Maps a 24 bit sensor time onto our clock
+     * The read always comes after the newest sample, so the smallest (read time - sensor time) seen is the
+     * best offset. It creeps up slowly so the drift between the two oscillators can't leave it behind.
+     */
+    class SensorClock
+    {
+    public:
+        int64_t toNs(uint32_t sensor_time, int64_t read_ns);
+        void reset() { m_started = false; }
+
+    private:
+        bool m_started = false;
+        uint32_t m_previous = 0;
+        int64_t m_ticks = 0; // unwrapped sensor time
+        int64_t m_offset_ns = 0;
+    };
+}
+
+#endif
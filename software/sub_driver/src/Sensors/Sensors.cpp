@@ -13,6 +13,9 @@
 #include "../Data/StartInfo.h"
 #include "../core/debug.h"
 #include "../core/pins.h"
+#include "../core/Timer.h"
+#include "Bus/Lpi2cBus.h"
+#include "SampleStamps.h"
 
 namespace Sensors
 {
@@ -29,15 +32,37 @@ namespace Sensors
 
     static BMP388_DEV baro;
 
+    // Reads that don't need to block go through the LPI2C interrupt, see Bus/SensorBus.h
+    static Bus::Lpi2cBus i2c_backend;
+    static Bus::SensorBus sensor_bus(i2c_backend);
+
     static int64_t previous_mag_time = 0;
 
+    static ImuBatch batch;
+    static int64_t previous_accel_read = 0;
+    static int64_t previous_gyro_read = 0;
+
+    static Bmp388Sample baro_samples[BARO_FIFO_CAPACITY];
+
+    // Raw ticks from the interrupts, see SampleStamps.h. The accel and baro FIFOs carry their own sensor time
+    static StampRing<8> gyro_stamps;
+    static StampRing<8> mag_stamps;
+    static StampReference stamp_reference; // latched at the start of logData
+    static int64_t previous_gyro_stamp = -1;
+    static int64_t latest_mag_stamp = 0;
+    static int64_t mag_sample_time = 0; // of the mag read on the bus
+
     /*
     BMI088 comes with built in low pass filter
-    LIS3MDL does not come with built in low pass filter so we use our own
+    LIS3MDL does not come with built in low pass filter so we use our own, at the mag's ODR
     */
-    Filter::LowPass<1> mag_x;
-    Filter::LowPass<1> mag_y;
-    Filter::LowPass<1> mag_z;
+    static Filter::LowPass3<1, float> mag_filter;
+
+    /*
+    BMP388 samples faster than we need, the extra samples are averaged down for resolution
+    */
+    static Filter::Decimator baro_pressure(BARO_DECIMATION);
+    static Filter::Decimator baro_temperature(BARO_DECIMATION);
 
     /**
      * @brief Initializes the accelerometer on the BMI088
@@ -49,9 +74,14 @@ namespace Sensors
     {
         int status = accel.begin();
         accel.pinModeInt1(Bmi088Accel::PUSH_PULL, Bmi088Accel::ACTIVE_HIGH);
-        accel.mapDrdyInt1(true);
+        accel.setOdr(Bmi088Accel::ODR_800HZ_BW_140HZ);
         accel.setRange(Bmi088Accel::RANGE_3G);
 
+        // Samples are batched in the FIFO, INT1 fires at the watermark instead of every sample
+        accel.mapDrdyInt1(false);
+        accel.mapFifoWatermarkInt1(true);
+        accel.enableFifo(ACCEL_FIFO_WATERMARK);
+
         // Saving the configurations to the StartInfo struct
         configs.accel_range = (char *)"Accel: 3G";
         configs.accel_ODR = (char *)"Accel ODR: 800Hz";
@@ -79,9 +109,13 @@ namespace Sensors
         int status = gyro.begin();
         gyro.setOdr(Bmi088Gyro::ODR_1000HZ_BW_116HZ);
         gyro.pinModeInt3(Bmi088Gyro::PUSH_PULL, Bmi088Gyro::ACTIVE_HIGH);
-        gyro.mapDrdyInt3(true);
         gyro.setRange(Bmi088Gyro::RANGE_250DPS);
 
+        // Samples are batched in the FIFO, INT3 fires at the watermark instead of every sample
+        gyro.mapDrdyInt3(false);
+        gyro.mapFifoInt3(true);
+        gyro.enableFifo(GYRO_FIFO_WATERMARK);
+
         // Saving the configurations to the StartInfo struct
         configs.gyro_range = (char *)"Gyro: 2000dps";
         configs.gyro_ODR = (char *)"Gyro ODR: 3200Hz";
@@ -117,16 +151,16 @@ namespace Sensors
         }
 
         mag.enableDefault();
+        mag.setFastOdr(LIS3MDL::odr_155hz_uhp);
 
         // Saving the configurations to the StartInfo struct
         configs.mag_range = (char *)"Mag: +/- 4 Gauss";
-        configs.mag_ODR = (char *)"Mag ODR: 1000Hz";
+        configs.mag_ODR = (char *)"Mag ODR: 155Hz";
         configs.mag_bias = {mag_bias.x, mag_bias.y, mag_bias.z};
 
         // Setting the cutoff frequency for the mag low pass filter
-        mag_x.setCutoff(30);
-        mag_y.setCutoff(30);
-        mag_z.setCutoff(30);
+        mag_filter.setCutoff(30);
+        mag_filter.setRate(mag.getOdrPeriodNs() / 1e9);
 
         return true;
     }
@@ -149,16 +183,20 @@ namespace Sensors
             SUCCESS_LOG("Baro: Initialized");
         }
 
-        baro.setPresOversampling(OVERSAMPLING_X4);
-        baro.setTempOversampling(OVERSAMPLING_X16);
-        baro.enableInterrupt();
-        baro.setTimeStandby(TIME_STANDBY_80MS);
+        // 19 ms per conversion at these oversampling settings, so it keeps up with the 20 ms standby
+        baro.setPresOversampling(OVERSAMPLING_X8);
+        baro.setTempOversampling(OVERSAMPLING_SKIP);
+        baro.setTimeStandby(TIME_STANDBY_20MS);
+
+        // Samples are batched in the FIFO and drained by the scheduler, so no data ready interrupt
+        baro.enableFIFO(PRESS_ENABLED, ALT_DISABLED, TIME_ENABLED, SUBSAMPLING_OFF, UNFILTERED, STOP_ON_FULL_DISABLED);
+        baro.flushFIFO();
         baro.startNormalConversion();
 
         // Saving the configurations to the StartInfo struct
-        configs.BMP_os_p = (char *)"Pressure: X4";
-        configs.BMP_os_t = (char *)"Temperature: X16";
-        configs.BMP_ODR = (char *)"Standby: 80 milliseconds";
+        configs.BMP_os_p = (char *)"Pressure: X8";
+        configs.BMP_os_t = (char *)"Temperature: X1";
+        configs.BMP_ODR = (char *)"Standby: 20 milliseconds, FIFO";
         
         return true;
     }
@@ -189,6 +227,9 @@ namespace Sensors
             return false;
         }
 
+        // Configuration above went through Wire, the bus interrupt takes over from here
+        i2c_backend.begin();
+
         return true;
     }
 
@@ -268,11 +309,13 @@ namespace Sensors
 
     void gyro_drdy()
     {
+        gyro_stamps.push(Time::rawTicks());
         gyro_flag = true;
     }
 
     void mag_drdy()
     {
+        mag_stamps.push(Time::rawTicks());
         mag_flag = true;
     }
 
@@ -364,23 +407,33 @@ namespace Sensors
     }
 
     /**
-     * @brief Reads the raw magnetometer data (uTesla)
+     * @brief Converts magnetometer counts to uTesla and takes off the bias
      *
-     * @return Angles_3D<double> object storing the x, y, and z magnetic field values
      */
-    Angles_3D<double> returnRawMag()
+    static Angles_3D<double> toMicroTesla(const LIS3MDL::vector<int16_t> &m)
     {
         Angles_3D<double> mag_data;
 
-        mag.read();
         // Convert to mTesla. Rangle is +/-4 so we divide by 6842 to get gauss, then mult. by 100 to get utesla
-        mag_data.x = mag.m.x / 68.42 - mag_bias.x;
-        mag_data.y = mag.m.y / 68.42 - mag_bias.y;
-        mag_data.z = mag.m.z / 68.42 - mag_bias.z;
+        mag_data.x = m.x / 68.42 - mag_bias.x;
+        mag_data.y = m.y / 68.42 - mag_bias.y;
+        mag_data.z = m.z / 68.42 - mag_bias.z;
 
         return mag_data;
     }
 
+    /**
+     * @brief Reads the raw magnetometer data (uTesla)
+     *
+     * @return Angles_3D<double> object storing the x, y, and z magnetic field values
+     */
+    Angles_3D<double> returnRawMag()
+    {
+        sensor_bus.flush();
+        mag.read();
+        return toMicroTesla(mag.m);
+    }
+
     /**
      * @brief Reads the raw temperature data (C)
      *
@@ -391,41 +444,171 @@ namespace Sensors
         return accel.getTemperature_C();
     }
 
-    void logData(LoggedData &data)
+    /**
+     * @brief Samples read in the last logData()
+     *
+     */
+    const ImuBatch &imuBatch()
     {
-        // Flags are triggered by the interrupt ISRs set in setInterrupts()
-        // Mag, gyro, accel, and baro all have different interrupt pins
-        if(data.time_ns - previous_mag_time > HZ_TO_NS(1000))
+        return batch;
+    }
+
+    /**
+     * @brief Reads everything in the accel FIFO
+     *
+     */
+    static void readAccelFifo(LoggedData &data)
+    {
+        batch.accel_count = accel.readFifo(batch.accel, ImuBatch::CAPACITY, scoped_timer.elapsed());
+        if (batch.accel_count == 0)
         {
-            data.rmag = returnRawMag();
+            return;
+        }
 
-            data.fmag.x = mag_x.filt(data.rmag.x, data.delta_time);
-            data.fmag.y = mag_y.filt(data.rmag.y, data.delta_time);
-            data.fmag.z = mag_z.filt(data.rmag.z, data.delta_time);
-            mag_flag = false;
+        const Bmi088Sample &newest = batch.accel[batch.accel_count - 1];
+        data.racc = {newest.x, newest.y, newest.z};
+        data.sample_time.accel_ns = newest.time_ns;
+    }
+
+    /**
+     * @brief Reads everything in the gyro FIFO and takes off the bias
+     *
+     */
+    static void readGyroFifo(LoggedData &data)
+    {
+        // Only a watermark newer than the last one can time this read's frames
+        int64_t watermark_ns = -1;
+        uint32_t stamp;
+        if (gyro_stamps.latest(stamp))
+        {
+            watermark_ns = stamp_reference.toNs(stamp);
+            if (watermark_ns <= previous_gyro_stamp)
+            {
+                watermark_ns = -1;
+            }
+            else
+            {
+                previous_gyro_stamp = watermark_ns;
+            }
         }
-        
 
-        if (accel_flag) // If the accelerometer has new data
+        batch.gyro_count = gyro.readFifo(batch.gyro, ImuBatch::CAPACITY, scoped_timer.elapsed(), watermark_ns);
+        for (uint16_t i = 0; i < batch.gyro_count; i++)
+        {
+            batch.gyro[i].x -= gyro_bias.x;
+            batch.gyro[i].y -= gyro_bias.y;
+            batch.gyro[i].z -= gyro_bias.z;
+        }
+
+        if (batch.gyro_count > 0)
+        {
+            const Bmi088Sample &newest = batch.gyro[batch.gyro_count - 1];
+            data.rgyr = {newest.x, newest.y, newest.z};
+            data.sample_time.gyro_ns = newest.time_ns;
+        }
+    }
+
+    /**
+     * @brief Reads the IMU temperature. Run from the scheduler, the sensor only updates it every 1.28 s
+     *
+     */
+    void logImuTemperature(LoggedData &data)
+    {
+        sensor_bus.flush(); // the read below uses Wire
+        accel.readTemperature();
+        data.bmi_temp = accel.getTemperature_C();
+    }
+
+    /**
+     * @brief Drains the barometer FIFO and averages the samples down. Run from the scheduler
+     *
+     * @param data raw_bmp is updated when a block of BARO_DECIMATION samples is finished
+     * @param now_ns loop timestamp
+     */
+    void logBaro(LoggedData &data, int64_t now_ns)
+    {
+        sensor_bus.flush(); // the drain below uses Wire
+        uint16_t count = baro.readFIFO(baro_samples, BARO_FIFO_CAPACITY, now_ns);
+        for (uint16_t i = 0; i < count; i++)
+        {
+            double pressure, temperature;
+            int64_t time_ns;
+            bool finished = baro_pressure.push(baro_samples[i].pressure, baro_samples[i].time_ns, pressure, time_ns);
+            baro_temperature.push(baro_samples[i].temperature, baro_samples[i].time_ns, temperature, time_ns); // same blocks as the pressure
+            if (finished)
+            {
+                data.raw_bmp.pressure = pressure * 0.0009869233; // convert to atm
+                data.raw_bmp.temperature = temperature;
+                data.sample_time.baro_ns = time_ns;
+            }
+        }
+
+        data.baro_fifo.samples = count;
+        data.baro_fifo.overflows = baro.getFIFOOverflows();
+    }
+
+    void logData(LoggedData &data)
+    {
+        stamp_reference.ticks = Time::rawTicks();
+        stamp_reference.ns = scoped_timer.elapsed();
+
+        // Drained every loop so the ring never fills up with stale edges
+        uint32_t stamp;
+        if (mag_stamps.latest(stamp))
         {
-            data.racc = returnRawAccel();
-            data.bmi_temp = returnAccelTemp();
+            latest_mag_stamp = stamp_reference.toNs(stamp);
+        }
+
+        // Reads queued at the end of the last loop are done by now, this runs their callbacks
+        // and keeps the bus clear for the blocking FIFO reads below
+        sensor_bus.flush();
 
-            accel_flag = false;
+        // Flags are triggered by the interrupt ISRs set in setInterrupts()
+        // Mag, gyro, accel, and baro all have different interrupt pins
+        if (mag.takeReading())
+        {
+            data.rmag = toMicroTesla(mag.m);
+            data.sample_time.mag_ns = mag_sample_time;
+
+            float fmag[3] = {static_cast<float>(data.rmag.x), static_cast<float>(data.rmag.y), static_cast<float>(data.rmag.z)};
+            mag_filter.filt(fmag);
+            data.fmag.x = fmag[0];
+            data.fmag.y = fmag[1];
+            data.fmag.z = fmag[2];
         }
 
-        if (gyro_flag) // If the gyroscope has new data
+
+        // Accel and gyro flags mean a FIFO reached its watermark. The timeout catches a missed edge
+        batch.accel_count = 0;
+        if (accel_flag || data.time_ns - previous_accel_read > FIFO_READ_TIMEOUT)
         {
-            data.rgyr = returnRawGyro();
+            accel_flag = false; // before the read, so a watermark during it isn't lost
+            previous_accel_read = data.time_ns;
+            readAccelFifo(data);
+        }
 
+        batch.gyro_count = 0;
+        if (gyro_flag || data.time_ns - previous_gyro_read > FIFO_READ_TIMEOUT)
+        {
             gyro_flag = false;
+            previous_gyro_read = data.time_ns;
+            readGyroFifo(data);
         }
 
-        if (bar_flag) // If the barometer has new data
+        data.imu_fifo.accel_samples = batch.accel_count;
+        data.imu_fifo.gyro_samples = batch.gyro_count;
+        data.imu_fifo.accel_skipped = accel.getFifoSkipped();
+        data.imu_fifo.gyro_overruns = gyro.getFifoOverruns();
+
+        // The mag read goes out on the bus while fusion and control run, and is picked up next loop
+        if((mag_flag || data.time_ns - previous_mag_time > MAG_READ_TIMEOUT) && !mag.readPending())
         {
-            data.raw_bmp = returnRawBaro();
+            mag_flag = false;
+            previous_mag_time = data.time_ns;
 
-            bar_flag = false;
+            // The read gets the sample from the last data ready edge
+            mag_sample_time = latest_mag_stamp;
+            mag.requestRead(sensor_bus);
         }
     }
 
@@ -18,10 +18,26 @@
 #include "LIS3MDL/LIS3MDL.h"
 #include "BMP388/BMP388_DEV.h"
 #include "LowPass.h"
+#include "Decimator.h"
 #include "../Data/logged_data.h"
 
 namespace Sensors
 {
+    /**
+     * @brief Every accel and gyro sample read from the BMI088 FIFOs in one loop, oldest first
+     * Gyro samples have the bias taken off
+     */
+    struct ImuBatch
+    {
+        static constexpr uint16_t CAPACITY = 128;
+
+        Bmi088Sample accel[CAPACITY];
+        uint16_t accel_count = 0;
+
+        Bmi088Sample gyro[CAPACITY];
+        uint16_t gyro_count = 0;
+    };
+
     bool initAccel();
     bool initGyro();
     bool initMag();
@@ -48,7 +64,11 @@ namespace Sensors
     Angles_3D<double> returnRawMag();
     double returnAccelTemp();
 
+    const ImuBatch &imuBatch();
+
     void logData(LoggedData &data);
+    void logBaro(LoggedData &data, int64_t now_ns);
+    void logImuTemperature(LoggedData &data);
 }
 
 
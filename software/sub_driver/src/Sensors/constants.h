@@ -13,8 +13,11 @@
 #define constants_h
 
 constexpr double VREF = 3.3;
-constexpr double ANALOG_TO_VOLTAGE = VREF / 1023.0;
 constexpr double STANDARD_TEMP = 25.0;
+constexpr double SURFACE_PRESSURE = 1.0; // atm
+constexpr double METERS_PER_ATM = 10.08; // seawater
+constexpr double THERMISTOR_B = 4100.0;
+constexpr double THERMISTOR_T0 = 25.0; // C, where the thermistor matches its divider resistor (10k)
 
 
 #endif
\ No newline at end of file
@@ -1,17 +1,17 @@
 #include "tds.h"
+#include "AnalogConversions.h"
 
 /**
  * @brief Construct a new Sensors:: Total Dissolved Solids:: Total Dissolved Solids object
  * 
+ * @param scan analog scan the pin is added to
  * @param pin pin the tds sensor is connected to    
  * @param cutoff cutoff frequency for the low pass filter
- * @param interval_ns time inbetween readings (nanoseconds)
  */
-Sensors::TotalDissolvedSolids::TotalDissolvedSolids(const uint8_t pin, const double cutoff, const long interval_ns)
+Sensors::TotalDissolvedSolids::TotalDissolvedSolids(Analog::AnalogScan &scan, const uint8_t pin, const double cutoff) : m_scan(scan)
 {
     pinMode(pin, INPUT);
-    m_pin = pin;
-    m_interval_ns = interval_ns;
+    m_channel = scan.add(pin);
 
     m_filter.setCutoff(cutoff);
 }
@@ -24,13 +24,12 @@ Sensors::TotalDissolvedSolids::TotalDissolvedSolids(const uint8_t pin, const dou
  */
 double Sensors::TotalDissolvedSolids::readRaw(const double temp)
 {
-    int tds = analogRead(m_pin);
-    double averageVoltage = tds * ANALOG_TO_VOLTAGE;
+    double averageVoltage = m_scan.fraction(m_channel) * VREF;
 
     double compensationCoefficient = 1.0 + 0.02 * (temp - STANDARD_TEMP);
     double compensationVoltage = averageVoltage / compensationCoefficient;
 
-    m_raw_tds_reading = (133.42 * compensationVoltage * compensationVoltage * compensationVoltage - 255.86 * compensationVoltage * compensationVoltage + 857.39 * compensationVoltage) * 0.5;
+    m_raw_tds_reading = Conversion::TDS_PPM(static_cast<float>(compensationVoltage));
     m_tds_updated = true; 
 
     return m_raw_tds_reading;
@@ -64,16 +63,13 @@ double Sensors::TotalDissolvedSolids::readFiltered(const double delta_time, cons
  * @brief logs tds value to data struct
  * 
  * @param data reference to struct where data is logged
+ * @param now_ns loop timestamp. The scheduler decides when this runs
  */
-void Sensors::TotalDissolvedSolids::logToStruct(LoggedData &data)
+void Sensors::TotalDissolvedSolids::logToStruct(LoggedData &data, const int64_t now_ns)
 {
-    int64_t current_time = scoped_timer.elapsed();
-    if(current_time >= m_prev_log_ns + m_interval_ns)
-    {
-        double delta_time = (current_time - m_prev_log_ns) / 1e9;
-        data.raw_TDS = readRaw(data.filt_ext_temp);
-        data.filt_TDS = readFiltered(delta_time, data.filt_ext_temp);
+    double delta_time = (now_ns - m_prev_log_ns) / 1e9;
+    data.raw_TDS = readRaw(data.filt_ext_temp);
+    data.filt_TDS = readFiltered(delta_time, data.filt_ext_temp);
 
-        m_prev_log_ns = current_time;
-    }
+    m_prev_log_ns = now_ns;
 }
\ No newline at end of file
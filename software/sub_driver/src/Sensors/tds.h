@@ -19,22 +19,23 @@
 #include "read_functions.h"
 #include "LowPass.h"
 #include "../core/Timer.h"
+#include "Analog/AnalogScan.h"
 
 namespace Sensors
 {
     class TotalDissolvedSolids
     {
     public:
-        TotalDissolvedSolids(const uint8_t pin, const double cutoff, const long interval_ns);
+        TotalDissolvedSolids(Analog::AnalogScan &scan, const uint8_t pin, const double cutoff);
 
         double readRaw(const double temp);
         double readFiltered(const double delta_time, const double temp);
 
-        void logToStruct(LoggedData &data);
+        void logToStruct(LoggedData &data, const int64_t now_ns);
 
     private:
-        uint8_t m_pin;
-        long m_interval_ns;
+        Analog::AnalogScan &m_scan;
+        int8_t m_channel;
 
         double m_raw_tds_reading;
         bool m_tds_updated = false;
@@ -10,26 +10,20 @@
  */
 
 #include "thermistor.h"
+#include "AnalogConversions.h"
 
 /**
  * @brief Construct a new Thermistor:: Thermistor object
  * 
- * @param pin pin the thermistor is connected to
- * @param RT0 resistance at 0 degrees C
- * @param B B constant
- * @param T0 T0 constant in in Celsius
+ * @param scan analog scan the pin is added to
+ * @param pin pin the thermistor is connected to, B and T0 are in constants.h
  * @param cutoff cutoff frequency for low pass filter
- * @param interval_ns interval in nanoseconds to read from sensor
  */
-Sensors::Thermistor::Thermistor(const uint8_t pin, const double RT0, const double B, const double T0, const double cutoff, const long interval_ns)
+Sensors::Thermistor::Thermistor(Analog::AnalogScan &scan, const uint8_t pin, const double cutoff) : m_scan(scan)
 {
-    m_pin = pin;
-    m_RT0 = RT0;
-    m_B = B;
-    m_T0 = T0 + 273.15; // convert to Kelvin
-    m_interval = interval_ns;
+    m_channel = scan.add(pin);
 
-    pinMode(m_pin, INPUT);
+    pinMode(pin, INPUT);
 
     m_filter.setCutoff(cutoff);
 }
@@ -41,18 +35,7 @@ Sensors::Thermistor::Thermistor(const uint8_t pin, const double RT0, const doubl
  */ 
 double Sensors::Thermistor::readRaw()
 {
-    constexpr double VREF = 3.3;
-    double RT = 0.0;
-    double VR = 0.0;
-    double ln = 0.0;
-    double VRT = 0.0;
-
-    VRT = analogRead(m_pin) * (VREF / 1023.0);
-    VR = VREF - VRT;
-    RT = VRT / (VR / m_RT0);
-    ln = std::log(RT / m_RT0);
-    raw_reading = 1.0 / ((ln / m_B) + (1.0 / m_T0));
-    raw_reading = raw_reading - 273.15;
+    raw_reading = Conversion::THERMISTOR_CELSIUS(m_scan.counts(m_channel)); // see AnalogConversions.h for the B equation
 
     m_temp_updated = true;
 
@@ -86,17 +69,14 @@ double Sensors::Thermistor::readFiltered(const double delta_time)
  * @brief Logs the raw and filtered temperature to the data struct
  * 
  * @param data reference to the struct to log to
+ * @param now_ns loop timestamp. The scheduler decides when this runs
  */
-void Sensors::Thermistor::logToStruct(LoggedData &data)
+void Sensors::Thermistor::logToStruct(LoggedData &data, const int64_t now_ns)
 {
-    int64_t current_time = scoped_timer.elapsed();
-    if(current_time >= m_prev_log_ns + m_interval)
-    {
-        double delta_time = (current_time - m_prev_log_ns) / 1e9;
+    double delta_time = (now_ns - m_prev_log_ns) / 1e9;
 
-        data.raw_ext_temp = readRaw();
-        data.filt_ext_temp = readFiltered(delta_time);
+    data.raw_ext_temp = readRaw();
+    data.filt_ext_temp = readFiltered(delta_time);
 
-        m_prev_log_ns = current_time;
-    }
+    m_prev_log_ns = now_ns;
 }
\ No newline at end of file
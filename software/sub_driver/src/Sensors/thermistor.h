@@ -20,6 +20,7 @@
 #include "LowPass.h"
 #include "read_functions.h"
 #include "../core/Timer.h"
+#include "Analog/AnalogScan.h"
 
 
 namespace Sensors
@@ -27,19 +28,17 @@ namespace Sensors
     class Thermistor : public ReadFunctions
     {
     public:
-        Thermistor(const uint8_t pin, const double RT0, const double B, const double T0, const double cutoff, const long interval_ns);
+        Thermistor(Analog::AnalogScan &scan, const uint8_t pin, const double cutoff);
         double readRaw();
         double readFiltered(const double delta_time);
 
-        void logToStruct(LoggedData &data);
+        void logToStruct(LoggedData &data, const int64_t now_ns);
 
     private:
-        uint8_t m_pin;
-        double m_RT0;
-        double m_B;
-        double m_T0;
-        long m_interval;
-        
+        Analog::AnalogScan &m_scan;
+        int8_t m_channel;
+
+
         bool m_temp_updated = false;
 
         int64_t m_prev_log_ns = 0;
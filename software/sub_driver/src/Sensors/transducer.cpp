@@ -1,30 +1,28 @@
 #include "transducer.h"
+#include "AnalogConversions.h"
 
 
 /**
  * @brief Construct a new Transducer:: Transducer object
  * 
+ * @param scan analog scan the pin is added to
  * @param pin pin the transducer is connected to 
- * @param cutoff cutoff frequency for low pass filter
- * @param interval_ns how long to wait between readings (nanoseconds)
  */
-Sensors::Transducer::Transducer(const uint8_t pin, const double cutoff, const long interval_ns)
+Sensors::Transducer::Transducer(Analog::AnalogScan &scan, const uint8_t pin) : m_scan(scan)
 {
-    m_pin = pin;
-    m_interval = interval_ns;
-    m_filter.setCutoff(cutoff);
+    m_channel = scan.add(pin, Analog::AnalogScan::DEFAULT_OVERSAMPLING, this);
 
-    pinMode(m_pin, INPUT);
+    pinMode(pin, INPUT);
 }
 
 /**
- * @brief Reads raw voltage from GPIO
+ * @brief Latest oversampled voltage from the analog scan
  * 
  * @return double measured voltage
  */
 inline double Sensors::Transducer::readVoltage()
 {
-    return analogRead(m_pin) * ANALOG_TO_VOLTAGE;
+    return m_scan.fraction(m_channel) * VREF;
 }
 
 /**
@@ -34,52 +32,48 @@ inline double Sensors::Transducer::readVoltage()
  */
 double Sensors::Transducer::readRaw()
 {
-    double voltage = readVoltage();
-    double psi = (100.0 / 3.0) * voltage + (50.0 - ((100.0 / 3.0) * (3.3 / 2.0))); //pressure = 25psi * voltage - 12.5psi (linear)
-    m_raw_pressure = psi / 14.695948775510204081632653061224; //convert psi to atm 
-    m_pres_updated = true;
+    m_raw_pressure = m_scan.counts(m_channel) * Conversion::TRANSDUCER_ATM_PER_COUNT + Conversion::TRANSDUCER_ATM_OFFSET;
     return m_raw_pressure;
 }
 
 /**
- * @brief Returns a filtered pressure value
+ * @brief Latest output of the decimation chain, the raw pressure until it has one
  * 
- * @param delta_time change in time (sec)
  * @return double filtered pressure in atm
  */
-double Sensors::Transducer::readFiltered(const double delta_time)
+double Sensors::Transducer::readFiltered()
 {
-    double filtered_pressure = 0.0;
-
-    //Make sure that the filtered data and raw data are updated at the same time
-    if(m_pres_updated)
+    if (m_decimated_count == 0)
     {
-        filtered_pressure = m_filter.filt(m_raw_pressure, delta_time);
-        m_pres_updated = false;
+        return readRaw();
     }
-    else
+    return m_decimated * Conversion::TRANSDUCER_ATM_PER_COUNT + Conversion::TRANSDUCER_ATM_OFFSET;
+}
+
+/**
+ * @brief Takes one scan frame's result, from the scan's block interrupt
+ * 
+ * @param counts 12 bit result
+ */
+void Sensors::Transducer::push(uint16_t counts)
+{
+    float decimated;
+    if (m_decimator.push(counts, decimated))
     {
-        filtered_pressure = m_filter.filt(readRaw(), delta_time);
-        m_pres_updated = false;
+        m_decimated = decimated;
+        m_decimated_count = m_decimated_count + 1;
     }
-
-    return filtered_pressure;
 }
 
 /**
- * @brief logs the raw and filtered pressure to the data struct
+ * @brief logs the raw and filtered pressure, and the depth from the filtered pressure, to the data struct
  * 
  * @param data reference to struct where the data is logged
+ * The decimation chain runs at the scan's rate, this just takes its latest output
  */
-void Sensors::Transducer::logToStruct(LoggedData &data)
+void Sensors::Transducer::logToStruct(LoggedData &data, const int64_t)
 {
-    int64_t current_time = scoped_timer.elapsed();
-    if(current_time >= m_prev_log_ns + m_interval)
-    {
-        double delta_time = (current_time - m_prev_log_ns) / 1e9; //convert to seconds
-        data.raw_ext_pres = readRaw();
-        data.filt_ext_pres = readFiltered(delta_time);
-
-        m_prev_log_ns = current_time;
-    }
+    data.raw_ext_pres = readRaw();
+    data.filt_ext_pres = readFiltered();
+    data.depth = (data.filt_ext_pres - SURFACE_PRESSURE) * METERS_PER_ATM;
 }
\ No newline at end of file
@@ -17,34 +17,43 @@
 #include <cmath>
 
 #include "constants.h"
-#include "LowPass.h"
+#include "Decimator.h"
 #include "read_functions.h"
 #include "../core/Timer.h"
+#include "Analog/AnalogScan.h"
 
 namespace Sensors
 {
-    class Transducer
+    /**
+     * @brief Every scan frame goes through Decimator (about 9 kHz down to 70 Hz, 128 frames per output),
+     * which is the filtered pressure and depth. Its group delay is Decimator::DELAY frames, about 60 ms
+     *
+     */
+    class Transducer : public Analog::SampleSink
     {
     public:
-        Transducer(const uint8_t pin, const double cutoff, const long interval_ns);
+        using Decimator = Filter::DecimationChain<3, 32, 2, 11>;
+
+        Transducer(Analog::AnalogScan &scan, const uint8_t pin);
         
         inline double readVoltage();
 
         double readRaw();
-        double readFiltered(const double delta_time);
+        double readFiltered();
+
+        void push(uint16_t counts) override;
 
-        void logToStruct(LoggedData &data);
+        void logToStruct(LoggedData &data, const int64_t now_ns);
 
     private:
-        uint8_t m_pin;
-        long m_interval;
+        Analog::AnalogScan &m_scan;
+        int8_t m_channel;
 
         double m_raw_pressure;
 
-        bool m_pres_updated = false;
-        int64_t m_prev_log_ns = 0;
-
-        Filter::LowPass<1> m_filter;
+        Decimator m_decimator;
+        volatile float m_decimated = 0.0f; // counts
+        volatile uint32_t m_decimated_count = 0;
     };
 }
 
@@ -1,13 +1,12 @@
 #include "voltage.h"
+#include "AnalogConversions.h"
 
-Sensors::Voltage::Voltage(const uint8_t pin, const double cutoff, const long interval_ns, double r1, double r2)
+Sensors::Voltage::Voltage(Analog::AnalogScan &scan, const uint8_t pin, const double cutoff, double r1, double r2) : m_scan(scan)
 {
     pinMode(pin, INPUT);
-    m_pin = pin;
-    m_interval = interval_ns;
+    m_channel = scan.add(pin);
 
-    m_r1 = r1;
-    m_r2 = r2;
+    m_volts_per_count = Conversion::VOLTS_PER_COUNT * (r1 + r2) / r2; // voltage divider
 
     m_filter.setCutoff(cutoff);
 }
@@ -19,11 +18,7 @@ Sensors::Voltage::Voltage(const uint8_t pin, const double cutoff, const long int
  */
 double Sensors::Voltage::readRaw()
 {
-    double voltage = analogRead(m_pin) * ANALOG_TO_VOLTAGE;
-
-    const double resistor_sum  = m_r1 + m_r2;
-
-    voltage *= resistor_sum / m_r2; // voltage divider
+    double voltage = m_scan.counts(m_channel) * m_volts_per_count;
 
     if(voltage <= 0.1)
     {
@@ -65,18 +60,15 @@ double Sensors::Voltage::readFiltered(const double delta_time)
  * @param data data struct
  * @param log_location_raw location where to log (needed because we have multiple voltmeters)
  * @param log_location_filtered location where to log (needed because we have multiple voltmeters)
+ * @param now_ns loop timestamp. The scheduler decides when this runs
  */
-void Sensors::Voltage::logData(LoggedData &data, double &log_location_raw, double &log_location_filtered)
+void Sensors::Voltage::logData(LoggedData &data, double &log_location_raw, double &log_location_filtered, const int64_t now_ns)
 {
-    int64_t current_time = scoped_timer.elapsed();
-    if(current_time - m_prev_log_ns >= m_interval)
-    {
-        double delta_time = (current_time - m_prev_log_ns) / 1e9;
-        log_location_raw = readRaw();
-        log_location_filtered = readFiltered(delta_time);
+    double delta_time = (now_ns - m_prev_log_ns) / 1e9;
+    log_location_raw = readRaw();
+    log_location_filtered = readFiltered(delta_time);
 
-        m_prev_log_ns = current_time;
-    }
+    m_prev_log_ns = now_ns;
 }
 
 
@@ -20,24 +20,24 @@
 #include "LowPass.h"
 #include "read_functions.h"
 #include "../core/Timer.h"
+#include "Analog/AnalogScan.h"
 
 namespace Sensors
 {
     class Voltage : public ReadFunctions
     {
     public:
-        Voltage(const uint8_t pin, const double cutoff, const long interval_ns, double r1, double r2);
+        Voltage(Analog::AnalogScan &scan, const uint8_t pin, const double cutoff, double r1, double r2);
 
         double readRaw();
         double readFiltered(const double delta_time);
 
-        void logData(LoggedData &data, double &log_location_raw, double &log_location_filtered); //since we have multiple voltmeters, we need to specify the location in the within the data struct
+        void logData(LoggedData &data, double &log_location_raw, double &log_location_filtered, const int64_t now_ns); //since we have multiple voltmeters, we need to specify the location in the within the data struct
 
     private:
-        uint8_t m_pin;
-        long m_interval;
-        double m_r1;
-        double m_r2;
+        Analog::AnalogScan &m_scan;
+        int8_t m_channel;
+        double m_volts_per_count; // through the divider
 
         double m_raw_voltage;
 
@@ -0,0 +1,94 @@
+/**
+ * @file LoopTime.h
+ * @author Daniel Kim
+ * @brief One timestamp per loop, shared by every subsystem, plus a raw tick counter for profiling
+ * @version 0.1
+ * @date 2023-05-13
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef LOOPTIME_H
+#define LOOPTIME_H
+
+#include <cstdint>
+
+#if defined(CORE_TEENSY)
+    #include <Arduino.h>
+#else
+    #include <chrono>
+#endif
+
+namespace Time
+{
+    /**
+     * @brief What every stage of one loop agrees "now" is
+     *
+     */
+    struct LoopTime
+    {
+        int64_t now_ns = 0; // since program start
+        int64_t dt_ns = 0;  // since the previous loop
+        double dt_s = 0.0;
+        uint32_t loop = 0;  // loop count
+    };
+
+    /**
+     * @brief Latches the loop timestamp. Subsystems get the LoopTime by reference instead of reading the clock
+     * The clock is read by the caller so this works with a virtual clock on the host
+     */
+    class LoopClock
+    {
+    public:
+        const LoopTime &latch(int64_t now_ns)
+        {
+            m_time.dt_ns = now_ns - m_time.now_ns;
+            m_time.dt_s = m_time.dt_ns / 1000000000.0;
+            m_time.now_ns = now_ns;
+            m_time.loop++;
+            return m_time;
+        }
+
+        /**
+         * @brief Starts dt over, e.g. so the first loop doesn't include initialization
+         *
+         */
+        void restart(int64_t now_ns) { m_time.now_ns = now_ns; }
+
+        const LoopTime &now() const { return m_time; }
+
+    private:
+        LoopTime m_time;
+    };
+
+    /**
+     * @brief Free running high resolution counter for profiling, not tied to the loop timestamp
+     * CPU cycles (DWT) on the Teensy, nanoseconds on the host. Wraps every few seconds, so only use differences
+     */
+    inline uint32_t rawTicks()
+    {
+    #if defined(CORE_TEENSY)
+        return ARM_DWT_CYCCNT;
+    #else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    #endif
+    }
+
+    /**
+     * @brief rawTicks per microsecond
+     *
+     */
+    inline uint32_t rawTicksPerUs()
+    {
+    #if defined(CORE_TEENSY)
+        return F_CPU_ACTUAL / 1000000; // follows the thermal throttling in cpu.cpp
+    #else
+        return 1000;
+    #endif
+    }
+}
+
+extern Time::LoopClock loop_clock;
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file Profiler.cpp
+ * @author Daniel Kim
+ * @brief Low overhead per-stage loop profiler with log2 histograms
+ * @version 0.1
+ * @date 2023-05-12
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "Profiler.h"
+
+namespace Profiler
+{
+    static Histogram window[STAGE_COUNT];    // filling up now
+    static Histogram published[STAGE_COUNT]; // last complete window, sent in telemetry
+    static uint32_t published_ticks_per_us = 1;
+    static uint8_t next_report = STAGE_COUNT; // stage to send next, STAGE_COUNT when all were sent
+
+    static const char *const stage_names[STAGE_COUNT] = {"loop", "sensors", "fusion", "nav", "leds", "steppers", "sd", "ui"};
+
+    /**
+     * @brief Makes sure the cycle counter is running (the Teensy core normally enables it at boot)
+     *
+     */
+    void init()
+    {
+    #if defined(CORE_TEENSY)
+        ARM_DEMCR |= ARM_DEMCR_TRCENA;
+        ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+    #endif
+    }
+
+    /**
+     * @brief Ticks below which the given fraction of runs fall, rounded up to a bucket edge
+     *
+     * @param fraction 0 to 1
+     * @return uint32_t ticks
+     */
+    uint32_t Histogram::percentileTicks(float fraction) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        uint32_t target = static_cast<uint32_t>(fraction * count);
+        if (target == 0)
+        {
+            target = 1;
+        }
+
+        uint32_t seen = 0;
+        for (uint8_t bucket = 0; bucket < BUCKETS; bucket++)
+        {
+            seen += buckets[bucket];
+            if (seen >= target)
+            {
+                uint32_t upper = bucket == 0 ? 0 : (1UL << (bucket - 1)) * 2 - 1;
+                return upper < max_ticks ? upper : max_ticks;
+            }
+        }
+        return max_ticks;
+    }
+
+    void record(Stage stage, uint32_t elapsed)
+    {
+        window[static_cast<uint8_t>(stage)].add(elapsed);
+    }
+
+    /**
+     * @brief Closes the current window (call at 1 Hz). The closed window is queued for telemetry
+     *
+     * @param max_us STAGE_COUNT entries, worst time per stage
+     * @param p99_us STAGE_COUNT entries, 99th percentile per stage
+     */
+    void snapshot(uint32_t *max_us, uint32_t *p99_us)
+    {
+        published_ticks_per_us = Time::rawTicksPerUs();
+
+        for (uint8_t i = 0; i < STAGE_COUNT; i++)
+        {
+            max_us[i] = window[i].max_ticks / published_ticks_per_us;
+            p99_us[i] = window[i].percentileTicks(0.99f) / published_ticks_per_us;
+
+            published[i] = window[i];
+            window[i] = Histogram();
+        }
+
+        next_report = 0;
+    }
+
+    /**
+     * @brief Hands out the closed window one stage at a time so telemetry packets stay small
+     *
+     * @param report filled in if there is a stage left to send
+     * @return true report is valid
+     */
+    bool nextReport(StageReport &report)
+    {
+        if (next_report >= STAGE_COUNT)
+        {
+            return false;
+        }
+
+        const Histogram &histogram = published[next_report];
+        report.stage = next_report;
+        report.ticks_per_us = published_ticks_per_us;
+        report.max_us = histogram.max_ticks / published_ticks_per_us;
+        report.p99_us = histogram.percentileTicks(0.99f) / published_ticks_per_us;
+        for (uint8_t i = 0; i < BUCKETS; i++)
+        {
+            report.buckets[i] = histogram.buckets[i];
+        }
+
+        next_report++;
+        return true;
+    }
+
+    const char *stageName(Stage stage)
+    {
+        uint8_t index = static_cast<uint8_t>(stage);
+        return index < STAGE_COUNT ? stage_names[index] : "unknown";
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file Profiler.h
+ * @author Daniel Kim
+ * @brief Low overhead per-stage loop profiler with log2 histograms
+ * @version 0.1
+ * @date 2023-05-12
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+
+#include "LoopTime.h"
+
+/*
+Ticks are DWT cycles on the Teensy and nanoseconds on the host (steady_clock).
+Bucket b counts stage runs that took [2^(b-1), 2^b) ticks; bucket 0 counts runs of 0 ticks.
+*/
+
+namespace Profiler
+{
+    enum class Stage : uint8_t
+    {
+        LOOP, // all of continuousFunctions
+        SENSORS,
+        FUSION,
+        NAVIGATION,
+        LEDS,
+        STEPPERS,
+        SD,
+        UI,
+        COUNT,
+    };
+
+    constexpr uint8_t STAGE_COUNT = static_cast<uint8_t>(Stage::COUNT);
+    constexpr uint8_t BUCKETS = 32;
+
+    inline uint32_t ticks() { return Time::rawTicks(); }
+
+    struct Histogram
+    {
+        uint32_t buckets[BUCKETS] = {0};
+        uint32_t count = 0;
+        uint32_t max_ticks = 0;
+
+        inline void add(uint32_t elapsed)
+        {
+            uint8_t bucket = elapsed == 0 ? 0 : 32 - __builtin_clz(elapsed);
+            buckets[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+            count++;
+            if (elapsed > max_ticks)
+            {
+                max_ticks = elapsed;
+            }
+        }
+
+        uint32_t percentileTicks(float fraction) const;
+    };
+
+    /**
+     * @brief One stage's histogram as sent in telemetry ("prof")
+     *
+     */
+    struct StageReport
+    {
+        uint8_t stage = 0;
+        uint8_t reserved[3] = {0};
+        uint32_t ticks_per_us = 0;
+        uint32_t max_us = 0;
+        uint32_t p99_us = 0; // upper edge of the bucket holding the 99th percentile
+        uint32_t buckets[BUCKETS] = {0};
+    };
+
+    void init();
+
+    void record(Stage stage, uint32_t elapsed);
+
+    void snapshot(uint32_t *max_us, uint32_t *p99_us);
+    bool nextReport(StageReport &report);
+
+    const char *stageName(Stage stage);
+
+    /**
+     * @brief Times the enclosing block
+     *
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(Stage stage) : m_stage(stage), m_start(ticks()) {}
+        ~Scope() { record(m_stage, ticks() - m_start); }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Stage m_stage;
+        uint32_t m_start;
+    };
+}
+
+#endif
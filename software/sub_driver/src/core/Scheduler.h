@@ -0,0 +1,274 @@
+/**
+ * @file Scheduler.h
+ * @author Daniel Kim
+ * @brief Rate-monotonic cooperative scheduler for the periodic work in continuousFunctions
+ * @version 0.1
+ * @date 2023-05-10
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstdint>
+
+/*
+No Arduino dependencies: time is passed into run(), so the scheduler can be driven by a virtual clock on the host.
+*/
+
+namespace Time
+{
+    using TaskFunction = void (*)(int64_t now_ns);
+
+    struct TaskStats
+    {
+        uint32_t runs = 0;
+        uint32_t overruns = 0;       // releases started after their deadline, including releases skipped entirely
+        int64_t last_jitter_ns = 0;  // how late the last run started
+        int64_t max_jitter_ns = 0;
+        int64_t total_jitter_ns = 0; // average = total / runs
+    };
+
+    struct Task
+    {
+        const char *name = nullptr;
+        TaskFunction function = nullptr;
+        int64_t period_ns = 0; // 0 runs every loop
+        int64_t deadline_ns = 0; // latest acceptable start after the release
+        uint8_t priority = 0; // lower runs first when several tasks are due in the same loop
+        int64_t next_due_ns = 0;
+        TaskStats stats;
+    };
+
+    /**
+     * @brief Static task table ordered by a next-due min-heap
+     * An idle loop costs one compare against the top of the heap. Tasks that are due together
+     * run in priority order (rate-monotonic: give shorter periods lower numbers).
+     * No dynamic allocation.
+     *
+     * @tparam CAPACITY most tasks that can be registered
+     */
+    template <uint8_t CAPACITY>
+    class Scheduler
+    {
+    public:
+        /**
+         * @brief Registers a task
+         *
+         * @param name name for reports
+         * @param function called with the loop timestamp
+         * @param period_ns how often to run
+         * @param priority lower runs first
+         * @param deadline_ns start lateness that counts as an overrun (0 = one period)
+         * @param first_due_ns when the first release is
+         * @return int8_t task id, -1 if the table is full
+         */
+        int8_t add(const char *name, TaskFunction function, int64_t period_ns, uint8_t priority, int64_t deadline_ns = 0, int64_t first_due_ns = 0)
+        {
+            if (m_count >= CAPACITY || function == nullptr || period_ns < 0)
+            {
+                return -1;
+            }
+
+            Task &task = m_tasks[m_count];
+            task.name = name;
+            task.function = function;
+            task.period_ns = period_ns;
+            task.deadline_ns = deadline_ns > 0 ? deadline_ns : period_ns;
+            task.priority = priority;
+            task.next_due_ns = first_due_ns;
+            task.stats = TaskStats();
+
+            m_heap[m_count] = m_count;
+            siftUp(m_count);
+            return static_cast<int8_t>(m_count++);
+        }
+
+        /**
+         * @brief Runs every task that is due
+         *
+         * @param now_ns the loop timestamp, handed to every task
+         */
+        void run(int64_t now_ns)
+        {
+            if (m_count == 0 || m_tasks[m_heap[0]].next_due_ns > now_ns)
+            {
+                return;
+            }
+
+            //Pull every due task off the heap, then order them by priority
+            uint8_t due[CAPACITY];
+            uint8_t due_count = 0;
+            while (m_count - due_count > 0 && m_tasks[m_heap[0]].next_due_ns <= now_ns)
+            {
+                uint8_t id = popTop(m_count - due_count);
+                uint8_t position = due_count++;
+                while (position > 0 && m_tasks[due[position - 1]].priority > m_tasks[id].priority)
+                {
+                    due[position] = due[position - 1];
+                    position--;
+                }
+                due[position] = id;
+            }
+
+            for (uint8_t i = 0; i < due_count; i++)
+            {
+                Task &task = m_tasks[due[i]];
+                release(task, now_ns);
+                task.function(now_ns);
+            }
+
+            //Put them back with their new due times
+            for (uint8_t i = 0; i < due_count; i++)
+            {
+                uint8_t position = m_count - due_count + i;
+                m_heap[position] = due[i];
+                siftUp(position);
+            }
+        }
+
+        int64_t nextDue() const { return m_count == 0 ? INT64_MAX : m_tasks[m_heap[0]].next_due_ns; }
+
+        uint8_t size() const { return m_count; }
+        const Task &task(uint8_t id) const { return m_tasks[id]; }
+
+        /**
+         * @brief Totals across all tasks, for logging
+         *
+         * @param overruns total overruns
+         * @param max_jitter_ns worst start lateness of any task
+         */
+        void summarize(uint32_t &overruns, int64_t &max_jitter_ns) const
+        {
+            overruns = 0;
+            max_jitter_ns = 0;
+            for (uint8_t i = 0; i < m_count; i++)
+            {
+                overruns += m_tasks[i].stats.overruns;
+                if (m_tasks[i].stats.max_jitter_ns > max_jitter_ns)
+                {
+                    max_jitter_ns = m_tasks[i].stats.max_jitter_ns;
+                }
+            }
+        }
+
+        void resetStats()
+        {
+            for (uint8_t i = 0; i < m_count; i++)
+            {
+                m_tasks[i].stats = TaskStats();
+            }
+        }
+
+    private:
+        /**
+         * @brief Records jitter and schedules the next release
+         * Releases that were missed entirely are skipped and counted as overruns instead of
+         * running the task several times back to back
+         */
+        void release(Task &task, int64_t now_ns)
+        {
+            int64_t jitter = now_ns - task.next_due_ns;
+
+            TaskStats &stats = task.stats;
+            stats.runs++;
+            stats.last_jitter_ns = jitter;
+            stats.total_jitter_ns += jitter;
+            if (jitter > stats.max_jitter_ns)
+            {
+                stats.max_jitter_ns = jitter;
+            }
+
+            if (task.period_ns == 0)
+            {
+                task.next_due_ns = now_ns;
+                return;
+            }
+
+            if (jitter > task.deadline_ns)
+            {
+                stats.overruns++;
+            }
+
+            task.next_due_ns += task.period_ns;
+            if (task.next_due_ns <= now_ns)
+            {
+                int64_t skipped = (now_ns - task.next_due_ns) / task.period_ns + 1;
+                stats.overruns += static_cast<uint32_t>(skipped);
+                task.next_due_ns += skipped * task.period_ns;
+            }
+        }
+
+        bool before(uint8_t a, uint8_t b) const
+        {
+            const Task &first = m_tasks[a];
+            const Task &second = m_tasks[b];
+            return first.next_due_ns < second.next_due_ns || (first.next_due_ns == second.next_due_ns && first.priority < second.priority);
+        }
+
+        void siftUp(uint8_t position)
+        {
+            while (position > 0)
+            {
+                uint8_t parent = (position - 1) / 2;
+                if (!before(m_heap[position], m_heap[parent]))
+                {
+                    return;
+                }
+                swap(position, parent);
+                position = parent;
+            }
+        }
+
+        void siftDown(uint8_t position, uint8_t count)
+        {
+            while (true)
+            {
+                uint8_t smallest = position;
+                uint8_t left = 2 * position + 1;
+                uint8_t right = left + 1;
+                if (left < count && before(m_heap[left], m_heap[smallest]))
+                {
+                    smallest = left;
+                }
+                if (right < count && before(m_heap[right], m_heap[smallest]))
+                {
+                    smallest = right;
+                }
+                if (smallest == position)
+                {
+                    return;
+                }
+                swap(position, smallest);
+                position = smallest;
+            }
+        }
+
+        /**
+         * @brief Removes the top of a heap of count entries
+         *
+         */
+        uint8_t popTop(uint8_t count)
+        {
+            uint8_t top = m_heap[0];
+            m_heap[0] = m_heap[count - 1];
+            siftDown(0, count - 1);
+            return top;
+        }
+
+        void swap(uint8_t a, uint8_t b)
+        {
+            uint8_t temp = m_heap[a];
+            m_heap[a] = m_heap[b];
+            m_heap[b] = temp;
+        }
+
+        Task m_tasks[CAPACITY];
+        uint8_t m_heap[CAPACITY]; // task ids, earliest next_due_ns on top
+        uint8_t m_count = 0;
+    };
+}
+
+#endif
@@ -10,19 +10,106 @@
  */
 
 #include "StateAutomation.h"
-#include "States.h"
+#include "LoopTime.h"
+
+TransitionTrace transition_trace;
 
 /**
- * @brief Transition to new state.
- * Runs exit of current state, then enter of new state
- * 
- * @param newState 
+ * @brief Keeps a transition, overwriting the oldest once full
+ *
+ * @param record sequence is filled in
+ * @return uint32_t sequence number of the record
+ */
+uint32_t TransitionTrace::push(const TransitionRecord &record)
+{
+    m_count++;
+    TransitionRecord &slot = m_records[(m_count - 1) % CAPACITY];
+    slot = record;
+    slot.sequence = m_count;
+    return m_count;
+}
+
+/**
+ * @brief Latency is only known once the new state has been entered
+ *
+ */
+void TransitionTrace::setLatency(uint32_t sequence, uint32_t latency_us)
+{
+    if (sequence == 0 || m_count - sequence >= CAPACITY)
+    {
+        return; // already overwritten
+    }
+    m_records[(sequence - 1) % CAPACITY].latency_us = latency_us;
+}
+
+/**
+ * @brief Hands out transitions oldest first, one per call. Skips any that were overwritten before being sent
+ *
+ * @param record filled in if there is a transition left to send
+ * @return true record is valid
+ */
+bool TransitionTrace::nextReport(TransitionRecord &record)
+{
+    if (m_reported >= m_count)
+    {
+        return false;
+    }
+
+    if (m_count - m_reported > CAPACITY)
+    {
+        m_reported = m_count - CAPACITY;
+    }
+
+    record = m_records[m_reported % CAPACITY];
+    m_reported++;
+    return true;
+}
+
+/**
+ * @brief Handles an event from the current state
+ * Looks the event up in the table, then runs exit of the current state, the transition's action and enter of the new state
+ *
+ * @param event what happened
+ * @return true the state changed
  */
-void StateAutomation::setState(State& newState)
+bool StateAutomation::dispatch(Event event)
 {
+    uint32_t start = Time::rawTicks();
+
+    const Transition &transition = m_table[static_cast<uint8_t>(m_state)][static_cast<uint8_t>(event)];
+    if (!transition.allowed || (transition.guard != nullptr && !transition.guard()))
+    {
+        transition_trace.countIgnored();
+        return false;
+    }
+
+    CurrentState from = m_state;
+    CurrentState next = transition.to_previous ? m_previous : transition.next;
+    if (next == CurrentState::IDLE_MODE)
+    {
+        m_previous = from;
+    }
+
+    TransitionRecord record;
+    record.from = static_cast<uint8_t>(from);
+    record.to = static_cast<uint8_t>(next);
+    record.event = static_cast<uint8_t>(event);
+    record.time_ms = static_cast<uint32_t>(loop_clock.now().now_ns / 1000000);
+    uint32_t sequence = transition_trace.push(record);
+
     m_currentState->exit(this);
-    m_currentState = &newState;
+    if (transition.action != nullptr)
+    {
+        transition.action();
+    }
+
+    //Set before enter so events raised in enter are looked up from the new state
+    m_state = next;
+    m_currentState = &stateInstance(next);
     m_currentState->enter(this);
+
+    transition_trace.setLatency(sequence, (Time::rawTicks() - start) / Time::rawTicksPerUs());
+    return true;
 }
 
 /**
@@ -33,13 +120,15 @@ void StateAutomation::run()
 {
     if(!m_initialized)
     {
-        m_currentState = &Initialization::getInstance();
-        m_currentState->enter(this);
         m_initialized = true;
+        m_state = CurrentState::INITIALIZATION;
+        m_currentState = &stateInstance(m_state);
+        m_currentState->enter(this);
     }
     m_currentState->run(this);
 }
 
+#if defined(CORE_TEENSY)
 /**
  * @brief Prints out the state to a printer
  * Converts the enum to a string
@@ -75,4 +164,5 @@ void StateAutomation::printState(Print &printer, CurrentState &state)
         break;
     }
     printer.print("\n");
-}
\ No newline at end of file
+}
+#endif
@@ -4,21 +4,38 @@
  * @brief finite state automation driver
  * @version 0.1
  * @date 2022-09-30
- * 
+ *
  * @copyright Copyright (c) 2022 OceanAI (https://github.com/daniel360kim/OceanAI)
- * 
+ *
  */
 
 #ifndef STATE_AUTOMATION_H
 #define STATE_AUTOMATION_H
 
-#include <Arduino.h>
+#include <cstdint>
+
+#if defined(CORE_TEENSY)
+    #include <Arduino.h>
+#endif
+
+/*
+States don't pick the next state themselves. They raise an Event and the automation looks up
+TRANSITIONS[current state][event] (see Transitions.cpp):
+    allowed: events that aren't in the table for the current state are ignored and counted
+    guard: optional, the transition only happens if it returns true
+    action: optional, runs between the old state's exit and the new state's enter
+    next: the new state, or the state before the last GUI pause for Event::GUI_RESUME
+Every transition taken is timed from dispatch to the end of enter and kept in transition_trace,
+which is logged and sent to the GUI.
+
+No Arduino dependencies apart from printState, so event sequences can be replayed on the host.
+*/
 
 class StateAutomation;
 
 /**
  * @brief Abstract class that allows for reference to generic state w/o having to specify true type of state
- * 
+ *
  */
 class State
 {
@@ -27,40 +44,133 @@ public:
     virtual void enter(StateAutomation* state) = 0;
     virtual void run(StateAutomation* state) = 0;
     virtual void exit(StateAutomation* state) = 0;
-    
+
 };
 
 /**
  * @brief All the different states
- * 
+ *
  */
-enum class CurrentState
+enum class CurrentState : uint8_t
 {
     INITIALIZATION,
     ERROR_INDICATION,
     IDLE_MODE,
     DIVING_MODE,
     RESURFACING,
+    COUNT,
+};
+
+/**
+ * @brief Causes of state changes
+ *
+ */
+enum class Event : uint8_t
+{
+    HOMED, // initialization finished and both steppers are homed
+    FAULT, // something failed that we can't dive without
+    GUI_PAUSE, // GUI asked for idle
+    GUI_RESUME, // GUI let go of idle
+    LIMIT_REACHED, // buoyancy carriage hit its limit switch while diving
+    SURFACED, // ballast emptied
+    DIVE_COMPLETE, // the dive ran past its depth or time limit
+    COUNT,
+};
+
+constexpr uint8_t STATE_COUNT = static_cast<uint8_t>(CurrentState::COUNT);
+constexpr uint8_t EVENT_COUNT = static_cast<uint8_t>(Event::COUNT);
+
+/**
+ * @brief One cell of the transition table
+ *
+ */
+struct Transition
+{
+    bool allowed;
+    CurrentState next;
+    bool to_previous; // go back to the state before the last pause instead of next
+    bool (*guard)();
+    void (*action)();
+};
+
+using TransitionTable = Transition[STATE_COUNT][EVENT_COUNT];
+
+extern const TransitionTable TRANSITIONS;
+
+/**
+ * @brief One transition as logged and sent in telemetry ("tr")
+ *
+ */
+struct TransitionRecord
+{
+    uint32_t sequence = 0; // 1 for the first transition, 0 means none yet
+    uint8_t from = 0;
+    uint8_t to = 0;
+    uint8_t event = 0;
+    uint8_t reserved = 0;
+    uint32_t latency_us = 0; // dispatch to the end of the new state's enter, including any transitions raised in it
+    uint32_t time_ms = 0; // loop timestamp when the event was raised
 };
 
+/**
+ * @brief Ring of the last transitions. The GUI drains it one record per packet
+ *
+ */
+class TransitionTrace
+{
+public:
+    static constexpr uint8_t CAPACITY = 16;
+
+    uint32_t push(const TransitionRecord &record);
+    void setLatency(uint32_t sequence, uint32_t latency_us);
+
+    bool nextReport(TransitionRecord &record);
+    const TransitionRecord &latest() const { return m_records[(m_count + CAPACITY - 1) % CAPACITY]; }
+    uint32_t count() const { return m_count; }
+
+    uint32_t ignored() const { return m_ignored; }
+    void countIgnored() { m_ignored++; }
+
+private:
+    TransitionRecord m_records[CAPACITY];
+    uint32_t m_count = 0; // transitions ever recorded
+    uint32_t m_reported = 0; // transitions handed to telemetry
+    uint32_t m_ignored = 0; // events not allowed in the state they were raised in, or rejected by a guard
+};
+
+extern TransitionTrace transition_trace;
+
+/**
+ * @brief Instance of each state, defined with the states
+ *
+ */
+State &stateInstance(CurrentState state);
+
 /**
  * @brief StateAutomation class that handles the state transitions and runs current state
- * 
+ *
  */
 class StateAutomation
 {
 public:
-    StateAutomation() {}
+    explicit StateAutomation(const TransitionTable &table = TRANSITIONS) : m_table(table) {}
 
     inline State* getCurrentState() { return m_currentState; }
+    inline CurrentState current() const { return m_state; }
     void run();
-    void setState(State& newState);
+    bool dispatch(Event event);
 
+#if defined(CORE_TEENSY)
     static void printState(Print &printer, CurrentState &state);
+#endif
 
 private:
+    const TransitionTable &m_table;
+
     bool m_initialized = false;
-    State* m_currentState;
+    State* m_currentState = nullptr;
+    CurrentState m_state = CurrentState::INITIALIZATION;
+    CurrentState m_previous = CurrentState::INITIALIZATION; // state before the last GUI pause
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -11,13 +11,19 @@
 
 #include "States.h"
 #include "Timer.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "LoopTime.h"
 #include "cpu.h"
 #include "../Data/TransportManager.h"
+#include "../Data/FileTransfer.h"
+#include "../Data/CommandLatency.h"
 #include "../Sensors/Sensors.h"
 #include "../Sensors/thermistor.h"
 #include "../Sensors/transducer.h"
 #include "../Sensors/tds.h"
 #include "../Sensors/voltage.h"
+#include "../Sensors/Analog/DmaAdc.h"
 
 #include "../Data/SD/SD.h"
 #include "../Data/hitl.h"
@@ -43,16 +49,21 @@
 #include "core/Timer.h"
 #include "module/stepper.h"
 #include "module/limit.h"
+#include "module/DepthControl.h"
 
 
 static Fusion SFori;
 
-static Sensors::Thermistor external_temp(RX_RF, 10000, 4100, 25, 30, HZ_TO_NS(5));
-static Sensors::Transducer external_pres(TX_RF, 30, HZ_TO_NS(5));
-static Sensors::TotalDissolvedSolids total_dissolved_solids(TDS, 30, HZ_TO_NS(5));
+//Analog inputs are scanned continuously in the background, the sensors read the latest values
+static Analog::DmaAdc adc_backend;
+static Analog::AnalogScan analog_scan(adc_backend);
 
-static Sensors::Voltage regulator(v_div, 30, HZ_TO_NS(1), 9.95, 1.992);
-static Sensors::Voltage battery(TX_GPS, 30, HZ_TO_NS(1), 9.62, 4.47);
+static Sensors::Thermistor external_temp(analog_scan, RX_RF, 30);
+static Sensors::Transducer external_pres(analog_scan, TX_RF);
+static Sensors::TotalDissolvedSolids total_dissolved_solids(analog_scan, TDS, 30);
+
+static Sensors::Voltage regulator(analog_scan, v_div, 30, 9.95, 1.992);
+static Sensors::Voltage battery(analog_scan, TX_GPS, 30, 9.62, 4.47);
 
 static Orientation ori;
  
@@ -100,10 +111,129 @@ static Mechanics::Pitch pitch(pins_p, Mechanics::Stepper::Resolution::HALF, pitc
 
 static CurrentState currentState;
 
+/**
+ * @brief Carriage ranges are measured from the limit switches (zero), towards negative positions
+ * 
+ */
+static Control::ControlSettings controlSettings()
+{
+    Control::ControlSettings settings;
+    settings.period = Control::PERIOD / 1e9;
+
+    settings.buoyancy_min = -buoyancy_properties.halves_length;
+    settings.buoyancy_max = -Control::SWITCH_MARGIN; //the switch end is heavy
+    settings.buoyancy_neutral = -buoyancy_properties.halves_length / 2;
+
+    settings.pitch_min = -pitch_properties.halves_length;
+    settings.pitch_max = -Control::SWITCH_MARGIN; //the switch end is nose down
+    settings.pitch_neutral = -pitch_properties.halves_length / 2;
+
+    settings.buoyancy_per_rate = Control::BUOYANCY_PER_RATE;
+    settings.pitch_per_buoyancy = Control::PITCH_PER_BUOYANCY;
+    settings.max_pitch = Control::MAX_PITCH;
+    settings.target_rate_time_constant = Control::TARGET_RATE_TIME_CONSTANT;
+    settings.deadband = Control::POSITION_DEADBAND;
+
+    return settings;
+}
+
+static Control::DepthPitchController controller(controlSettings());
+
 static StaticJsonDocument<STATIC_JSON_DOC_SIZE> data_json;
 
+static Time::Scheduler<10> scheduler; //periodic work in continuousFunctions
+
+/**
+ * @brief Scheduled tasks. Each gets the loop timestamp
+ */
+static void externalTempTask(int64_t now_ns) { external_temp.logToStruct(data, now_ns); }
+static void externalPresTask(int64_t now_ns) { external_pres.logToStruct(data, now_ns); }
+static void tdsTask(int64_t now_ns) { total_dissolved_solids.logToStruct(data, now_ns); } //temperature compensated, so runs after externalTempTask
+static void baroTask(int64_t now_ns) { Sensors::logBaro(data, now_ns); }
+static void batteryTask(int64_t now_ns) { battery.logData(data, data.raw_voltage, data.filt_voltage, now_ns); }
+static void regulatorTask(int64_t now_ns) { regulator.logData(data, data.raw_regulator, data.filt_regulator, now_ns); }
+static void imuTemperatureTask(int64_t) { Sensors::logImuTemperature(data); }
+static void cpuTask(int64_t) { CPU::log_cpu_info(data); }
+static void profilerTask(int64_t) { Profiler::snapshot(data.profile.max_us, data.profile.p99_us); }
+
+/**
+ * @brief Depth and pitch control. Only runs while diving, so it doesn't wind up while something else has the carriages
+ */
+static void controlTask(int64_t)
+{
+    if(currentState != CurrentState::DIVING_MODE)
+    {
+        return;
+    }
+
+    Control::ControlInput input;
+    input.depth = data.depth;
+    input.pitch = data.rel_ori.y;
+    #if HITL_ON
+        input.target_depth = data.HITL.depth; //follow the recorded mission's depth profile
+    #else
+        input.target_depth = Control::TARGET_DEPTH;
+    #endif
+
+    const Control::ControlOutput &output = controller.update(input);
+
+    data.control.target_depth = input.target_depth;
+    data.control.target_rate = output.target_rate;
+    data.control.pitch_setpoint = output.pitch_setpoint;
+    data.control.buoyancy_command = output.buoyancy_position;
+    data.control.pitch_command = output.pitch_position;
+}
+
+/**
+ * @brief Fills the task table once. Priorities are rate-monotonic: faster tasks go first
+ * 
+ * @param now_ns first release
+ */
+static void registerTasks(int64_t now_ns)
+{
+    if(scheduler.size() > 0)
+    {
+        return;
+    }
+
+    scheduler.add("ext_pres", &externalPresTask, Scheduling::DEPTH_PERIOD, 0, 0, now_ns);
+    scheduler.add("ext_temp", &externalTempTask, Scheduling::EXTERNAL_SENSOR_PERIOD, 1, 0, now_ns);
+    scheduler.add("tds", &tdsTask, Scheduling::EXTERNAL_SENSOR_PERIOD, 2, 0, now_ns);
+    scheduler.add("baro", &baroTask, Scheduling::BARO_PERIOD, 3, 0, now_ns);
+    scheduler.add("control", &controlTask, Control::PERIOD, 4, 0, now_ns); //after the depth reading it uses
+    scheduler.add("battery", &batteryTask, Scheduling::VOLTAGE_PERIOD, 5, 0, now_ns);
+    scheduler.add("regulator", &regulatorTask, Scheduling::VOLTAGE_PERIOD, 6, 0, now_ns);
+    scheduler.add("imu_temp", &imuTemperatureTask, Scheduling::IMU_TEMPERATURE_PERIOD, 7, 0, now_ns);
+    scheduler.add("cpu", &cpuTask, CPU_INFO_LOG_INTERVAL, 8, 0, now_ns);
+    scheduler.add("profiler", &profilerTask, Scheduling::PROFILE_PERIOD, 9, 0, now_ns);
+}
+
 #if UI_ON
-    static CurrentState callbackState; //State to go back to after going into idle
+static TransportManager::StepperCommands buoyancy_command; //speed and acceleration last given to the buoyancy stepper
+
+/**
+ * @brief Gives the GUI's buoyancy speed and acceleration to the stepper, so changes take effect mid-dive
+ * Only a changed command is stamped for the latency report
+ * 
+ * @param force set them even if they haven't changed, e.g. on entering a state
+ */
+static void applyBuoyancyCommands(bool force)
+{
+    TransportManager::StepperCommands command = TransportManager::getCommands().buoyancy;
+    bool changed = command.speed != buoyancy_command.speed || command.acceleration != buoyancy_command.acceleration;
+    if(!changed && !force)
+    {
+        return;
+    }
+
+    buoyancy.setSpeeds(command.speed, command.acceleration);
+    buoyancy_command = command;
+
+    if(changed)
+    {
+        CommandLatency::applied(CommandLatency::axisBit(Mechanics::Buoyancy::AXIS));
+    }
+}
 #endif
 
 #if HITL_ON
@@ -124,42 +254,63 @@ static StaticJsonDocument<STATIC_JSON_DOC_SIZE> data_json;
  */
 void continuousFunctions(StateAutomation *state)
 {
-    data.time_ns = scoped_timer.elapsed(); // scoped timer is a global object to measure time since program epoch
-    data.delta_time = scoped_timer.deltaTime(); // delta time is the time since the last time this function was called
+    Profiler::Scope loop_scope(Profiler::Stage::LOOP);
+
+    //The clock is read once here. Everything in this loop uses this timestamp instead of reading it again
+    const Time::LoopTime &time = loop_clock.latch(scoped_timer.elapsed());
+    data.time_ns = time.now_ns;
+    data.delta_time = time.dt_s;
 
     data.system_state = static_cast<uint8_t>(currentState); //update the current state within the logged data
 
+    const TransitionRecord &transition = transition_trace.latest();
+    data.transition.count = transition_trace.count();
+    data.transition.from = transition.from;
+    data.transition.to = transition.to;
+    data.transition.event = transition.event;
+    data.transition.latency_us = transition.latency_us;
+    data.transition.ignored = transition_trace.ignored();
+
 #if PRINT_STATE
     StateAutomation::printState(Serial, currentState);
 #endif
 
-    #if HITL_ON
-        data_provider.update(data.time_ns); //update the data provider with the current time
-        HITL::logData(data, data_provider, location, depth, pressure, salinity, temperature); //log the HITL data to the logged data struct
-        hitl_nav.logData(data); //log the HITL navigation data to the logged data struct
-    #endif
+    {
+        Profiler::Scope scope(Profiler::Stage::SENSORS);
 
-    //Logging sensor data
-    CPU::log_cpu_info(data); //add cpu info to the logged data
+        #if HITL_ON
+            data_provider.update(time.now_ns); //update the data provider with the current time
+            HITL::logData(data, data_provider, location, depth, pressure, salinity, temperature); //log the HITL data to the logged data struct
+            hitl_nav.logData(data); //log the HITL navigation data to the logged data struct
+        #endif
 
-    Sensors::logData(data); //add IMU data to the logged data
+        //Slow sensors, voltages and cpu info run from the task table
+        scheduler.run(time.now_ns);
 
-    external_temp.logToStruct(data);
-    external_pres.logToStruct(data);
-    total_dissolved_solids.logToStruct(data);
+        int64_t max_jitter_ns = 0;
+        scheduler.summarize(data.scheduler.overruns, max_jitter_ns);
+        data.scheduler.max_jitter_us = static_cast<uint32_t>(max_jitter_ns / 1000);
 
-    //log the voltage and regulator data
-    battery.logData(data, data.raw_voltage, data.filt_voltage);
-    regulator.logData(data, data.raw_regulator, data.filt_regulator);
+        Sensors::logData(data); //add IMU data to the logged data
+    }
 
-    nav_v.updateVelocity(data); //calculate velocity from IMU data
-    nav_p.updatePosition(data); //calculate position from IMU data
-    SFori.update(data); //update the orientation of the sub from IMU data
+    {
+        Profiler::Scope scope(Profiler::Stage::NAVIGATION);
 
-    Quaternion relative = Orientation::toQuaternion(data.rel_ori.x, data.rel_ori.y, data.rel_ori.z); //convert the relative orientation to a quaternion
-    data.wfacc = ori.convertAccelFrame(relative, data.racc.x, data.racc.y, data.racc.z); //convert the acceleration from the relative frame to the world frame
+        nav_v.updateVelocity(data); //calculate velocity from IMU data
+        nav_p.updatePosition(data); //calculate position from IMU data
+    }
 
-    data.relative = static_cast<Angles_4D>(relative); //add to logged data
+    {
+        Profiler::Scope scope(Profiler::Stage::FUSION);
+
+        SFori.update(data, Sensors::imuBatch()); //update the orientation of the sub from every IMU sample read this loop
+
+        Quaternion relative = Orientation::toQuaternion(data.rel_ori.x, data.rel_ori.y, data.rel_ori.z); //convert the relative orientation to a quaternion
+        data.wfacc = ori.convertAccelFrame(relative, data.racc.x, data.racc.y, data.racc.z); //convert the acceleration from the relative frame to the world frame
+
+        data.relative = static_cast<Angles_4D>(relative); //add to logged data
+    }
 
 #if OPTICS_ON == true
     camera.capture();
@@ -167,59 +318,84 @@ void continuousFunctions(StateAutomation *state)
     logger.log_image(camera);
 #endif
 
-    signal.blink(80); //blink to look cool :)
-
-    if (!warning)
     {
-        //Show the spectrum on the LEDs if there is no warning
-        LEDa.displaySpectrum();
-        LEDb.displaySpectrum();
+        Profiler::Scope scope(Profiler::Stage::LEDS);
+
+        signal.blink(80); //blink to look cool :)
+
+        if (!warning)
+        {
+            //Show the spectrum on the LEDs if there is no warning
+            LEDa.displaySpectrum();
+            LEDb.displaySpectrum();
+        }
+        else
+        {
+            LEDb.blink(255, 0, 0, data.sd_log_rate_hz); //blink red if there is a warning
+        }
+
+        strip.setColor(255, 255, 255); //turn on LED strip at the bottom of the vehicle
     }
-    else
+
     {
-        LEDb.blink(255, 0, 0, data.sd_log_rate_hz); //blink red if there is a warning
-    }
+        Profiler::Scope scope(Profiler::Stage::STEPPERS);
 
-    strip.setColor(255, 255, 255); //turn on LED strip at the bottom of the vehicle
+        //Homing runs a phase at a time, it does nothing once the stepper is homed
+        buoyancy.home(time.now_ns);
+        pitch.home(time.now_ns);
 
-    //Log and update buoyancy and pitch stepper motor data
-    buoyancy.logToStruct(data);
-    if(!buoyancy.update())
-    {
-        warning = true;
+        //Log and update buoyancy and pitch stepper motor data
+        buoyancy.logToStruct(data);
+        if(!buoyancy.update())
+        {
+            warning = true;
+        }
+
+        pitch.logToStruct(data);
+        if(!pitch.update())
+        {
+            warning = true;
+        }
     }
 
-    pitch.logToStruct(data);
-    if(!pitch.update())
     {
-        warning = true;
-    }
+        Profiler::Scope scope(Profiler::Stage::SD);
 
-    logger.update_sd_capacity(data);
-    data.sd_log_rate_hz = logger.getLoggingIntervalHz();
+        logger.update_sd_capacity(data);
+        data.sd_log_rate_hz = logger.getLoggingIntervalHz();
 
-    #if SD_ON
-    if (!logger.logData(data))
-    {
-        warning = true;
-        return;
+        #if FILE_TRANSFER_ON
+            FileTransfer::update(); //serve log downloads on the second USB port
+        #endif
+
+        #if SD_ON
+        if (!logger.logData(data, time))
+        {
+            warning = true;
+            return;
+        }
+        #endif
     }
-    #endif
+
+    Profiler::Scope ui_scope(Profiler::Stage::UI); //until the end of the loop
 
 #if UI_ON
     //Send/receive data to/from the UI
     //If GUI wants to change the state, it will be handled here
-    if(TransportManager::handleTransport(data))
+    if(TransportManager::handleTransport(data, time))
     {
-        callbackState = currentState;
-        state->setState(IdleMode::getInstance());
+        state->dispatch(Event::GUI_PAUSE);
         return;
     }
 
     //Get commands from the GUI
     TransportManager::Commands commands = TransportManager::getCommands();
 
-    pitch.runPitch(commands, currentState, buoyancy.currentPosition());
+    //Gains from the GUI take effect on the next control update
+    controller.setDepthGains(Control::PIDGains{commands.depth_gains[0], commands.depth_gains[1], commands.depth_gains[2]});
+    controller.setPitchGains(Control::PIDGains{commands.pitch_gains[0], commands.pitch_gains[1], commands.pitch_gains[2]});
+
+    pitch.runPitch(commands, currentState, controller.output().pitch_position); //stamps the latency report if the command changed
 
     #if HITL_ON
         data_provider.update_frequency_scale(commands.hitl_scale);
@@ -234,7 +410,7 @@ void continuousFunctions(StateAutomation *state)
     if(commands.sd_log_enable > 0)
     {
         logger.setLoggingInterval(std::lround((1.0 / commands.sd_log_enable) * 1000000000.0)); //hz to ns
-        if(!logger.logData(data))
+        if(!logger.logData(data, time))
         {
             warning = true;   
         }
@@ -242,7 +418,7 @@ void continuousFunctions(StateAutomation *state)
     #endif
 
 #else
-    pitch.runPitch(currentState, buoyancy.currentPosition());
+    pitch.runPitch(currentState, controller.output().pitch_position);
 #endif
 
 }
@@ -280,13 +456,30 @@ void Initialization::enter(StateAutomation *state)
         hitl_nav.setInitialCoordinate(HITL_DATA_ALPHA[0][0], HITL_DATA_ALPHA[0][1], scoped_timer.elapsed());
     #endif
 
+    if (!analog_scan.begin())
+    {
+        ERROR_LOG(Severity::ERROR, "Analog scan: Failed to start");
+        state->dispatch(Event::FAULT);
+        return;
+    }
+    for (int i = 0; i < 100 && !analog_scan.ready(); i++)
+    {
+        delay(1); // first oversampled value of every channel, a few ms
+    }
+    SUCCESS_LOG("Analog scan started");
+
     if (battery.readRaw() <= 6 && battery.readRaw() >= 5.5)
     {
         ERROR_LOG(Debug::Critical_Error, "Low battery voltage");
-        state->setState(ErrorIndication::getInstance());
+        state->dispatch(Event::FAULT);
     }
     
     CPU::init();
+    Profiler::init();
+    registerTasks(scoped_timer.elapsed());
+
+    controller.setDepthGains(Control::PIDGains{Control::DEPTH_KP, Control::DEPTH_KI, Control::DEPTH_KD});
+    controller.setPitchGains(Control::PIDGains{Control::PITCH_KP, Control::PITCH_KI, Control::PITCH_KD});
 
 #if LIVE_DEBUG == true
     while (!Serial)
@@ -298,6 +491,10 @@ void Initialization::enter(StateAutomation *state)
         TransportManager::init();
     #endif
 
+    #if FILE_TRANSFER_ON
+        FileTransfer::init();
+    #endif
+
     LEDa.setColor(255, 0, 255);
     LEDb.setColor(255, 0, 255);
 
@@ -307,7 +504,7 @@ void Initialization::enter(StateAutomation *state)
     // Initialize the navigation sensors (IMU, Barometer, Magnetometer)
     if (!Sensors::initAll())
     {
-        state->setState(ErrorIndication::getInstance());
+        state->dispatch(Event::FAULT);
         return;
     }
 
@@ -327,7 +524,7 @@ void Initialization::enter(StateAutomation *state)
     if (!camera.initialize())
     {
         //ERROR_LOG(Debug::Critical_Error, "Camera Initialization Failed");
-        state->setState(ErrorIndication::getInstance());
+        state->dispatch(Event::FAULT);
     }
     else
     {
@@ -339,18 +536,40 @@ void Initialization::enter(StateAutomation *state)
     // Initialize the SD card
     if (!logger.init())
     {
-        state->setState(ErrorIndication::getInstance());
+        state->dispatch(Event::FAULT);
         return;
     }
     #endif
     SUCCESS_LOG("SD Card Initialization Complete");
 
+    if (!Mechanics::startStepEngine(buoyancy, pitch))
+    {
+        ERROR_LOG(Severity::ERROR, "Step timer failed to start");
+        state->dispatch(Event::FAULT);
+        return;
+    }
+
     Mechanics::setDefaultSettings(buoyancy, pitch);
     Mechanics::setDefaultSpeeds(buoyancy, pitch);
 
-    while(!Mechanics::calibrateBoth(buoyancy, pitch))
+    //Both steppers home together in run(), while the rest of the loop keeps going
+    Mechanics::startHoming(buoyancy, pitch);
+}
+
+void Initialization::run(StateAutomation *state)
+{
+    continuousFunctions(state);
+
+    Mechanics::HomingPhase homing = Mechanics::homingStatus(buoyancy, pitch);
+    if(homing == Mechanics::HomingPhase::FAILED)
+    {
+        ERROR_LOG(Severity::ERROR, "Stepper homing failed");
+        state->dispatch(Event::FAULT);
+        return;
+    }
+    else if(homing != Mechanics::HomingPhase::HOMED)
     {
-        continuousFunctions(state);
+        return;
     }
 
     #if UI_ON
@@ -371,19 +590,16 @@ void Initialization::enter(StateAutomation *state)
     #else
         Mechanics::setDefaultSpeeds(buoyancy, pitch);
     #endif
-}
 
-void Initialization::run(StateAutomation *state)
-{
-    // initialization happens once and we move on...
-    state->setState(Diving::getInstance());
+    // initialization is done once both steppers are homed, and we move on...
+    state->dispatch(Event::HOMED);
 }
 
 void Initialization::exit(StateAutomation *state)
 {
     output.indicateCompleteStartup();
-    // set previous time before main loop
-    scoped_timer.setPreviousTime(scoped_timer.elapsed());
+    // start the loop clock so the first delta time doesn't include startup
+    loop_clock.restart(scoped_timer.elapsed());
 }
 
 void ErrorIndication::enter(StateAutomation *state)
@@ -408,6 +624,10 @@ void IdleMode::enter(StateAutomation *state)
     
     buoyancy.setSpeeds(0, 0);
     pitch.setSpeeds(0, 0);
+
+    #if UI_ON
+        CommandLatency::applied(CommandLatency::axisBit(Mechanics::Buoyancy::AXIS) | CommandLatency::axisBit(Mechanics::Pitch::AXIS)); //the stop command has reached the steppers
+    #endif
 }
 
 void IdleMode::run(StateAutomation *state)
@@ -420,24 +640,7 @@ void IdleMode::run(StateAutomation *state)
     #if UI_ON
     if(TransportManager::getCommands().system_state == 0)
     {
-        switch(callbackState)
-        {
-            case CurrentState::DIVING_MODE:
-                state->setState(Diving::getInstance());
-                return;
-            case CurrentState::ERROR_INDICATION:
-                state->setState(ErrorIndication::getInstance());
-                return;
-            case CurrentState::INITIALIZATION:
-                state->setState(Initialization::getInstance());
-                return;
-            case CurrentState::RESURFACING:
-                state->setState(Resurfacing::getInstance());
-                return;
-            default:
-                state->setState(Diving::getInstance());
-                return;
-        }
+        state->dispatch(Event::GUI_RESUME); //back to whatever was paused
     }
     #endif
 }
@@ -457,7 +660,7 @@ void Resurfacing::enter(StateAutomation *state)
     #if UI_ON
         TransportManager::Commands stepper_commands = TransportManager::getCommands();
 
-        buoyancy.setSpeeds(stepper_commands.buoyancy.speed, stepper_commands.buoyancy.acceleration);
+        applyBuoyancyCommands(true);
         pitch.setSpeeds(stepper_commands.pitch.speed, stepper_commands.pitch.acceleration);
     #else  
         Mechanics::setDefaultSettings(buoyancy, pitch);
@@ -471,11 +674,15 @@ void Resurfacing::run(StateAutomation *state)
     // If we emptied the ballast, we move to the surface
     if (buoyancy.currentPosition() == buoyancy.targetPosition())
     {
-        state->setState(Diving::getInstance());
+        state->dispatch(Event::SURFACED);
         return;
     }
 
     continuousFunctions(state);
+
+    #if UI_ON
+        applyBuoyancyCommands(false);
+    #endif
 }
 
 void Resurfacing::exit(StateAutomation *state)
@@ -483,32 +690,71 @@ void Resurfacing::exit(StateAutomation *state)
     
 }
 
+static int64_t dive_start_ns = 0;
+
+/**
+ * @brief The controller keeps the buoyancy carriage off its limit switch, so a dive ends on these instead
+ * 
+ * @return true too deep, or down for longer than MAX_DIVE_TIME
+ */
+static bool diveComplete()
+{
+    return data.depth > Control::MAX_DEPTH || data.time_ns - dive_start_ns > Control::MAX_DIVE_TIME;
+}
+
 void Diving::enter(StateAutomation *state)
 {
     currentState = CurrentState::DIVING_MODE;
     #if UI_ON
         TransportManager::Commands stepper_commands = TransportManager::getCommands();
 
-        buoyancy.setSpeeds(stepper_commands.buoyancy.speed, stepper_commands.buoyancy.acceleration);
+        applyBuoyancyCommands(true);
         pitch.setSpeeds(stepper_commands.pitch.speed, stepper_commands.pitch.acceleration);
     #else
         Mechanics::setDefaultSettings(buoyancy, pitch);
     #endif
 
-    buoyancy.move(500000);
+    controller.reset(); //starts from neutral ballast and a level carriage
+    dive_start_ns = data.time_ns;
 }
 
 void Diving::run(StateAutomation *state)
 {
     continuousFunctions(state);
+    if (state->current() != CurrentState::DIVING_MODE)
+    {
+        return; //paused or faulted in there: the carriage is the new state's now
+    }
+
+    #if UI_ON
+        applyBuoyancyCommands(false);
+    #endif
+
+    if (diveComplete())
+    {
+        state->dispatch(Event::DIVE_COMPLETE);
+        return;
+    }
 
+    buoyancy.moveTo(controller.output().buoyancy_position);
+
+    //Only if steps were lost, since the controller stops short of the switch
     if (buoyancy.limit.state() == true)
     {
-        state->setState(Resurfacing::getInstance());
+        state->dispatch(Event::LIMIT_REACHED);
     }
 }
 
 void Diving::exit(StateAutomation *state)
+{
+
+}
+
+/**
+ * @brief Diving -> Resurfacing. The carriage is on its limit switch, which is zero
+ * Only on this transition, pausing a dive mustn't move the zero
+ */
+void zeroBuoyancy()
 {
     buoyancy.setCurrentPosition(0);
 }
@@ -549,3 +795,19 @@ Diving &Diving::getInstance()
     return instance;
 }
 
+State &stateInstance(CurrentState state)
+{
+    switch(state)
+    {
+        case CurrentState::ERROR_INDICATION:
+            return ErrorIndication::getInstance();
+        case CurrentState::IDLE_MODE:
+            return IdleMode::getInstance();
+        case CurrentState::DIVING_MODE:
+            return Diving::getInstance();
+        case CurrentState::RESURFACING:
+            return Resurfacing::getInstance();
+        default:
+            return Initialization::getInstance();
+    }
+}
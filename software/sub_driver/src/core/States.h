@@ -129,5 +129,11 @@ private:
     static Diving instance;
 };
 
+/*
+Guards and actions of the transition table (Transitions.cpp)
+*/
+void zeroBuoyancy();
+
+
 
 #endif
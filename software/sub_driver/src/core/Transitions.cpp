@@ -0,0 +1,36 @@
+/**
+ * @file Transitions.cpp
+ * @author Daniel Kim
+ * @brief Transition table of the state automation
+ * @version 0.1
+ * @date 2023-05-19
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "StateAutomation.h"
+#include "States.h"
+
+static constexpr Transition to(CurrentState next, void (*action)() = nullptr, bool (*guard)() = nullptr)
+{
+    return Transition{true, next, false, guard, action};
+}
+
+static constexpr Transition IGNORED{false, CurrentState::INITIALIZATION, false, nullptr, nullptr};
+static constexpr Transition BACK{true, CurrentState::INITIALIZATION, true, nullptr, nullptr}; // to the state the GUI paused
+
+using S = CurrentState;
+
+/*
+Rows are states, columns are events in the order of the Event enum:
+    HOMED, FAULT, GUI_PAUSE, GUI_RESUME, LIMIT_REACHED, SURFACED, DIVE_COMPLETE
+*/
+const TransitionTable TRANSITIONS =
+{
+    /* INITIALIZATION */   {to(S::DIVING_MODE), to(S::ERROR_INDICATION), to(S::IDLE_MODE), IGNORED, IGNORED, IGNORED, IGNORED},
+    /* ERROR_INDICATION */ {IGNORED, IGNORED, to(S::IDLE_MODE), IGNORED, IGNORED, IGNORED, IGNORED},
+    /* IDLE_MODE */        {IGNORED, to(S::ERROR_INDICATION), IGNORED, BACK, IGNORED, IGNORED, IGNORED},
+    /* DIVING_MODE */      {IGNORED, to(S::ERROR_INDICATION), to(S::IDLE_MODE), IGNORED, to(S::RESURFACING, &zeroBuoyancy), IGNORED, to(S::RESURFACING)},
+    /* RESURFACING */      {IGNORED, to(S::ERROR_INDICATION), to(S::IDLE_MODE), IGNORED, IGNORED, to(S::DIVING_MODE), IGNORED},
+};
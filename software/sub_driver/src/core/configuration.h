@@ -54,6 +54,12 @@
 
 #define SD_ON false
 
+/**
+ * Bulk download of SD files over the second USB serial port (SerialUSB1)
+ * Requires the USB_DUAL_SERIAL build flag in platformio.ini
+ */
+#define FILE_TRANSFER_ON true
+
 #define OPTICS_ON false
 
 /**
@@ -97,10 +103,33 @@ namespace CPU
 namespace Sensors
 {
     constexpr Angles_3D<double> mag_bias = {0.36, 0.39, 0.49}; // in uT: set in mag calibration script
+
+    /**
+     * @brief BMI088 FIFO watermarks, about 20 ms of samples each
+     * The FIFOs are read when the watermark interrupt fires, or after FIFO_READ_TIMEOUT in case an edge was missed
+     */
+    constexpr uint16_t ACCEL_FIFO_WATERMARK = 16; // frames at 800 Hz
+    constexpr uint8_t GYRO_FIFO_WATERMARK = 20; // frames at 1000 Hz, the FIFO holds 100
+    constexpr int64_t FIFO_READ_TIMEOUT = MS_TO_NS(40);
+
+    /**
+     * @brief LIS3MDL is read on its data ready interrupt. DRDY stays high until the sample is read,
+     * so a missed edge would stop the reads. After MAG_READ_TIMEOUT it's read anyway, which restarts them
+     */
+    constexpr int64_t MAG_READ_TIMEOUT = MS_TO_NS(20); // about 3 samples at 155 Hz
+
+    /**
+     * @brief BMP388 samples at 50 Hz into its FIFO, which the scheduler drains every Scheduling::BARO_PERIOD
+     * Every BARO_DECIMATION samples are averaged into one pressure reading
+     */
+    constexpr uint16_t BARO_FIFO_CAPACITY = 73; // pressure and temperature frames, 1.4 s at 50 Hz
+    constexpr uint16_t BARO_DECIMATION = 10; // 5 Hz out
 }
 
 
     constexpr int SEND_INTERVAL = HZ_TO_NS(100); //how often data is sent to the GUI
+    constexpr int RX_CHUNK_SIZE = 256; //bytes pulled from the USB buffer per read
+    constexpr int RX_BYTES_PER_LOOP = 1024; //most GUI bytes parsed per loop, the rest wait in the USB buffer
 
 
 namespace Logging
@@ -111,6 +140,49 @@ namespace Logging
     constexpr unsigned long long CAPACITY_UPDATE_INTERVAL = SEC_TO_NS(360);// update capacity every 6 minutes
 }
 
+/**
+ * @brief Periods of the tasks run by the scheduler in continuousFunctions
+ * 
+ */
+namespace Scheduling
+{
+    constexpr int64_t EXTERNAL_SENSOR_PERIOD = SEC_TO_NS(1) / 5; // thermistor, TDS
+    constexpr int64_t DEPTH_PERIOD = HZ_TO_NS(50); // transducer, its decimated output comes at about 70 Hz
+    constexpr int64_t VOLTAGE_PERIOD = SEC_TO_NS(1); // battery and regulator
+    constexpr int64_t PROFILE_PERIOD = SEC_TO_NS(1); // loop profiler window
+    constexpr int64_t BARO_PERIOD = SEC_TO_NS(1) / 5; // BMP388 FIFO drain, about 10 samples each
+    constexpr int64_t IMU_TEMPERATURE_PERIOD = SEC_TO_NS(1); // BMI088 temperature, updated every 1.28 s by the sensor
+}
+
+/**
+ * @brief Depth and pitch controller (module/DepthControl.h), tuned against a host model of the vehicle
+ * Gains can be changed from the GUI while running, these are the startup values
+ */
+namespace Control
+{
+    constexpr int64_t PERIOD = Scheduling::EXTERNAL_SENSOR_PERIOD; // uses the latest depth, which is read at Scheduling::DEPTH_PERIOD
+
+    constexpr double DEPTH_KP = 2000; // half steps of ballast per m of depth error
+    constexpr double DEPTH_KI = 20; // per m*s
+    constexpr double DEPTH_KD = 2000; // per m/s
+    constexpr double PITCH_KP = 100; // half steps of carriage per degree of pitch error
+    constexpr double PITCH_KI = 20; // per degree*s
+    constexpr double PITCH_KD = 50; // per degree/s
+
+    constexpr double BUOYANCY_PER_RATE = 10000; // feed forward, half steps of ballast per m/s of target dive rate
+    constexpr double PITCH_PER_BUOYANCY = 0.002; // degrees of pitch setpoint per half step of ballast off neutral
+    constexpr double MAX_PITCH = 25; // degrees
+    constexpr double TARGET_RATE_TIME_CONSTANT = 5.0; // s, smoothing of the target's dive rate
+
+    constexpr long POSITION_DEADBAND = 400; // half steps, smaller changes aren't sent to the steppers
+    constexpr long SWITCH_MARGIN = 200; // half steps kept between the commands and the limit switches
+
+    constexpr double TARGET_DEPTH = 5.0; // m, held when there's no HITL profile to follow
+
+    constexpr double MAX_DEPTH = 25.0; // m, a dive ends and the vehicle resurfaces past this
+    constexpr int64_t MAX_DIVE_TIME = SEC_TO_NS(600); // a dive ends and the vehicle resurfaces after this long
+}
+
 namespace Mechanics
 {
     constexpr int BUOYANCY_DEFAULT_STEPPER_SPEED = 800; // default speed for stepper motor
@@ -120,6 +192,19 @@ namespace Mechanics
     constexpr int PITCH_DEFAULT_STEPPER_ACCELERATION = 500; // default acceleration for stepper motor
     
     constexpr int MIN_PULSE_WIDTH = 1; // minimum pulse width in microseconds for stepper motor
+
+    constexpr double STEPPER_JERK_TIME = 0.1; // seconds to ramp up to full acceleration (jerk = acceleration / this), 0 uses AccelStepper's trapezoid
+    constexpr int64_t STEP_LOOKAHEAD_NS = MS_TO_NS(50); // how far ahead of the motors the loop plans steps, must cover the slowest loop
+
+    /**
+     * @brief Homing: seek the limit switch at the default speed, back off, then approach slowly
+     * The slow press is the one that sets zero, so it's repeatable
+     */
+    constexpr long HOMING_BACKOFF_STEPS = 1000; // half steps to move off the switch
+    constexpr int HOMING_BACKOFF_SPEED = 500; // steps per second
+    constexpr int HOMING_APPROACH_SPEED = 200; // steps per second
+    constexpr int64_t HOMING_SEEK_TIMEOUT = SEC_TO_NS(120); // a full carriage at the default speeds takes about 35 s
+    constexpr int64_t HOMING_APPROACH_TIMEOUT = SEC_TO_NS(15); // for the back off and the approach each
 }
 
 #endif
\ No newline at end of file
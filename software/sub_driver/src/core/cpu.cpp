@@ -56,24 +56,17 @@ namespace CPU
         InternalTemperature.attachHighTempInterruptCelsius(OVERTEMP_THRESHOLD, &HighAlarmISR); // attach HighAlarmISR when temperature is above OVERTEMP_THRESHOLD
     }
 
-    int64_t previous_cpu_log = 0;
+    /**
+     * @brief Logs clock speed, temperature and loop rate. Scheduled every CPU_INFO_LOG_INTERVAL
+     * 
+     * @param logged_data data struct to log to
+     */
     void log_cpu_info(LoggedData &logged_data)
     {
-        // log CPU info at a set interval
-        int64_t current_time = scoped_timer.elapsed();
-        if(current_time - previous_cpu_log < CPU_INFO_LOG_INTERVAL)
-        {
-            return;
-        }
-        else
-        {
-            logged_data.clock_speed = F_CPU_ACTUAL;
-            logged_data.internal_temp = InternalTemperature.readTemperatureC();
-
-            logged_data.loop_time = 1.0 / logged_data.delta_time;
+        logged_data.clock_speed = F_CPU_ACTUAL;
+        logged_data.internal_temp = InternalTemperature.readTemperatureC();
 
-            previous_cpu_log = current_time;
-        }
+        logged_data.loop_time = 1.0 / logged_data.delta_time;
     }
 
 }
\ No newline at end of file
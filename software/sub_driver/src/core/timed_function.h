@@ -2,109 +2,155 @@
  * @file timed_function.h
  * @author Daniel Kim
  * @brief calls functions at an interval
- * @version 0.1
+ * @version 0.2
  * @date 2022-10-01
- * 
+ *
  * @copyright Copyright (c) 2022 OceanAI (https://github.com/daniel360kim/OceanAI)
- * 
+ *
  */
 
 #ifndef timed_function_h
 #define timed_function_h
 
-#include <chrono>
-#include <functional>
-#include <teensy_clock/teensy_clock.h>
 #include <cstdint>
+#include <type_traits>
 
-#include "Timer.h"
+#if defined(CORE_TEENSY)
+    #include <Arduino.h>
+#else
+    #include <chrono>
+#endif
 
+/*
+The period and the function are template parameters, so the call is direct (and inlined) and the
+period is converted to ticks at compile time. An idle tick() is one clock read, a subtraction and a compare.
+Tick counts are unsigned and compared as differences, so wraparound is harmless as long as the period is
+less than half the counter range.
+*/
 
 namespace Time
 {
     /**
-     * @brief Calls functions at certain intervals      
-     * 
-     
-     * @tparam T return type of the function to be called
-     * @tparam P variadic parameters of the function to be called
+     * @brief Millisecond ticks (millis() on the Teensy). Wraps after 49 days
+     *
      */
-    template<typename T, typename...P>
-    class Async : public Timer
+    struct MillisTicks
     {
-    public:
-        Async() : Timer()
+        using tick_t = uint32_t;
+        static constexpr int64_t NS_PER_TICK = 1000000;
+
+        static inline tick_t now()
         {
-            reset();
+        #if defined(CORE_TEENSY)
+            return millis();
+        #else
+            return static_cast<tick_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        #endif
         }
+    };
+
+    /**
+     * @brief Microsecond ticks (micros() on the Teensy). Wraps after 71 minutes
+     *
+     */
+    struct MicrosTicks
+    {
+        using tick_t = uint32_t;
+        static constexpr int64_t NS_PER_TICK = 1000;
 
-        Async(const long interval, T(*func)(P...)) : Timer()
+        static inline tick_t now()
         {
-            #if interval < 0
-                #error "interval cannot be negative"
-            #endif
-            reset();
-            
-            this->func = func;
-            this->interval = interval;
+        #if defined(CORE_TEENSY)
+            return micros();
+        #else
+            return static_cast<tick_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        #endif
         }
+    };
 
-        T tick(P...params)
+    namespace Detail
+    {
+        template <typename R>
+        struct LastValue
         {
-            if(elapsed() - previous_time >= interval && running)
-            {
-                *return_val = func(params...);
-                previous_time = elapsed();
-            }
-            return *return_val;
-        }
+            R value = R();
+        };
+
+        template <>
+        struct LastValue<void>
+        {
+        };
+    }
+
+    template <int64_t PERIOD_NS, typename Signature, Signature *FUNCTION, typename Clock = MillisTicks>
+    class Periodic;
+
+    /**
+     * @brief Calls FUNCTION at most once every PERIOD_NS
+     * The first call happens one period after construction (or reset())
+     *
+     * @tparam PERIOD_NS period in nanoseconds, rounded down to whole clock ticks
+     * @tparam R return type of the function
+     * @tparam Args parameters of the function
+     * @tparam FUNCTION function to call
+     * @tparam Clock tick source, MillisTicks or MicrosTicks (or a fake one for testing)
+     */
+    template <int64_t PERIOD_NS, typename R, typename... Args, R (*FUNCTION)(Args...), typename Clock>
+    class Periodic<PERIOD_NS, R(Args...), FUNCTION, Clock> : private Detail::LastValue<R>
+    {
+    public:
+        using tick_t = typename Clock::tick_t;
+
+        static constexpr tick_t PERIOD_TICKS = static_cast<tick_t>(PERIOD_NS / Clock::NS_PER_TICK);
+
+        static_assert(PERIOD_NS > 0, "period must be positive");
+        static_assert(PERIOD_NS / Clock::NS_PER_TICK > 0, "period is shorter than one clock tick");
+        static_assert(static_cast<uint64_t>(PERIOD_NS / Clock::NS_PER_TICK) < (static_cast<uint64_t>(static_cast<tick_t>(~tick_t(0))) >> 1), "period is too long for this clock");
+
+        Periodic() : m_previous(Clock::now()) {}
 
         /**
-         * @brief Special tick function for void functions
-         * 
+         * @brief Calls the function if a period has passed
+         *
+         * @param args forwarded to the function
+         * @return true the function was called
          */
-        void void_tick(P...params)
+        inline bool tick(Args... args)
         {
-            if(elapsed() - previous_time >= interval && running)
+            tick_t now = Clock::now();
+            if (static_cast<tick_t>(now - m_previous) < PERIOD_TICKS)
             {
-                func(params...);
-                previous_time = elapsed();
+                return false;
             }
-        }
 
-        void setInterval(uint64_t interval)
-        {
-            #if interval < 0
-                #error "Interval cannot be negative"
-            #endif
-            this->interval = interval;
+            m_previous = now;
+            call(args...);
+            return true;
         }
 
         /**
-         * @brief Set which function to call at the interval
-         * 
-         * @param func pointer to the function to be called
+         * @brief What the function returned the last time it was called (R() before the first call)
+         *
          */
-        void setFunction(T(*func)(P...))
-        {
-            this->func = func;
-        }
+        template <typename T = R>
+        const T &value() const { return Detail::LastValue<R>::value; }
+
+        /**
+         * @brief Starts the period over from now
+         *
+         */
+        void reset() { m_previous = Clock::now(); }
 
-        void stop()
-        {
-            running = false;
-        }
     private:
-        T(*func)(P...);
+        template <typename T = R>
+        inline typename std::enable_if<std::is_void<T>::value>::type call(Args... args) { FUNCTION(args...); }
 
-        int64_t previous_time;
-        int64_t interval;
-        bool running = true;
-        T* return_val = nullptr;
+        template <typename T = R>
+        inline typename std::enable_if<!std::is_void<T>::value>::type call(Args... args) { Detail::LastValue<R>::value = FUNCTION(args...); }
 
+        tick_t m_previous;
     };
-    
 };
 
 
-#endif
\ No newline at end of file
+#endif
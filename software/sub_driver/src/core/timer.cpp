@@ -1,5 +1,5 @@
 #include "timer.h"
+#include "LoopTime.h"
 
 Time::Timer scoped_timer; //timer that is used to measure the time since the start of the program
-
-Time::TimerManager Time::TimerManager::instance; //a time manager for our named timers
\ No newline at end of file
+Time::LoopClock loop_clock; //timestamp latched once at the start of every loop
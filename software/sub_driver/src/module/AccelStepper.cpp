@@ -25,6 +25,8 @@ application. Contact info@open.com.au for details.
 #include <cmath>
 #include <algorithm>
 
+constexpr uint32_t AccelStepper::MAX_STEP_INTERVAL; // std::min takes it by reference, so it needs a definition before C++17
+
 #if 0
 // Some debugging assistance
 void dump(uint8_t* p, int l)
@@ -110,22 +112,26 @@ void AccelStepper::setCurrentPosition(long position)
 {
     _targetPos = _currentPos = position;
     _n = 0;
+    _cn_rest = 0;
     _stepInterval = 0;
-    _speed = 0.0;
 }
 
+// Integer version of the ramp (AVR446 / Austin): called once per step, so no floating point or sqrt here
+// Step intervals are in ns, capped at MAX_STEP_INTERVAL so the 32 bit maths can't overflow
 void AccelStepper::computeNewSpeed()
 {
-    double distanceTo = distanceToGo(); // +ve is clockwise from curent location
+    long distanceTo = static_cast<long>(distanceToGo()); // +ve is clockwise from curent location
 
-    long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)); // Equation 16
+    // Equation 16 from the current interval. _n can't stand in for it: after a reversal or a change of
+    // acceleration it can be several times too small, and the ramp would start slowing down too late
+    long stepsToStop = this->stepsToStop();
 
     if (distanceTo == 0 && stepsToStop <= 1)
     {
         // We are at the target and its time to stop
         _stepInterval = 0;
-        _speed = 0.0;
         _n = 0;
+        _cn_rest = 0;
         return;
     }
 
@@ -169,22 +175,40 @@ void AccelStepper::computeNewSpeed()
     {
         // First step from stopped
         _cn = _c0;
+        _cn_rest = 0;
         _direction = (distanceTo > 0) ? DIRECTION_CW : DIRECTION_CCW;
     }
+    else if (_n > 0)
+    {
+        // Accelerating. Equation 13 with the division remainder carried to the next step
+        uint32_t denominator = 4 * static_cast<uint32_t>(_n) + 1;
+        uint32_t numerator = 2 * _cn + _cn_rest;
+        _cn -= numerator / denominator;
+        _cn_rest = numerator % denominator;
+
+        if (_cn <= _cmin)
+        {
+            // Cruising: hold the speed and stop counting steps so stepsToStop stays right
+            _cn = _cmin;
+            _cn_rest = 0;
+            _stepInterval = _cn;
+            return;
+        }
+    }
     else
     {
-        // Subsequent step. Works for accel (n is +_ve) and decel (n is -ve).
-        _cn = _cn - ((2.0 * _cn) / ((4.0 * _n) + 1)); // Equation 13
+        // Decelerating. Equation 13 with n negative, the interval grows
+        uint32_t denominator = 4 * static_cast<uint32_t>(-_n) - 1;
+        uint32_t numerator = 2 * _cn + _cn_rest;
+        _cn = std::min<uint32_t>(_cn + numerator / denominator, MAX_STEP_INTERVAL);
+        _cn_rest = numerator % denominator;
         _cn = std::max(_cn, _cmin);
     }
     _n++;
     _stepInterval = _cn;
-    _speed = 1000000000.0 / _cn;
-    if (_direction == DIRECTION_CCW)
-        _speed = -_speed;
 
 #if 0
-    Serial.println(_speed);
+    Serial.println(speed());
     Serial.println(_acceleration);
     Serial.println(_cn);
     Serial.println(_c0);
@@ -196,6 +220,32 @@ void AccelStepper::computeNewSpeed()
 #endif
 }
 
+// Equation 16 from the current interval: v^2 / 2a, with v = 1e9 / interval
+// The interval was truncated to whole ns, so this takes it as half a ns shorter
+// One single precision divide, which the M7's FPU does in hardware
+long AccelStepper::stepsToStop() const
+{
+    if (!_stepInterval)
+        return 0;
+    float inverse = 1.0f / (static_cast<float>(_stepInterval) - 0.5f);
+    return static_cast<long>(_stop_k * inverse * inverse);
+}
+
+// Plans the next step without waiting for it, for stepping from a timer interrupt
+// Advances the position and speed the same way run() does when a step is due
+// returns false if there is nothing to step
+bool AccelStepper::planStep(uint64_t &interval_ns, bool &direction)
+{
+    if (!_stepInterval)
+        return false;
+
+    interval_ns = _stepInterval;
+    direction = _direction == DIRECTION_CW;
+    _currentPos += direction ? 1 : -1;
+    computeNewSpeed();
+    return true;
+}
+
 // Run the motor to implement speed and acceleration in order to proceed to the target position
 // You must call this at least once per step, preferably in your main loop
 // If the motor is in the desired position, the cost is very small
@@ -204,7 +254,7 @@ bool AccelStepper::run()
 {
     if (runSpeed())
         computeNewSpeed();
-    return _speed != 0.0 || distanceToGo() != 0;
+    return _stepInterval != 0 || distanceToGo() != 0;
 }
 
 AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, bool enable)
@@ -212,10 +262,8 @@ AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_
     _interface = interface;
     _currentPos = 0;
     _targetPos = 0;
-    _speed = 0.0;
     _maxSpeed = 1.0;
     _acceleration = 0.0;
-    _sqrt_twoa = 1.0;
     _stepInterval = 0;
     _minPulseWidth = 10;
     _enablePin = 0xff;
@@ -228,9 +276,11 @@ AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_
 
     // NEW
     _n = 0;
-    _c0 = 0.0;
-    _cn = 0.0;
-    _cmin = 1.0;
+    _c0 = 0;
+    _cn = 0;
+    _cn_rest = 0;
+    _cmin = 1;
+    _stop_k = 0.0f;
     _direction = DIRECTION_CCW;
 
     int i;
@@ -247,10 +297,8 @@ AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
     _interface = 0;
     _currentPos = 0;
     _targetPos = 0;
-    _speed = 0.0;
     _maxSpeed = 1.0;
     _acceleration = 0.0;
-    _sqrt_twoa = 1.0;
     _stepInterval = 0;
     _minPulseWidth = 10;
     _enablePin = 0xff;
@@ -264,9 +312,11 @@ AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
 
     // NEW
     _n = 0;
-    _c0 = 0.0;
-    _cn = 0.0;
-    _cmin = 1.0;
+    _c0 = 0;
+    _cn = 0;
+    _cn_rest = 0;
+    _cmin = 1;
+    _stop_k = 0.0f;
     _direction = DIRECTION_CCW;
 
     int i;
@@ -282,12 +332,13 @@ void AccelStepper::setMaxSpeed(double speed)
         speed = -speed;
     if (_maxSpeed != speed)
     {
+        double current_speed = this->speed();
         _maxSpeed = speed;
-        _cmin = 1000000000.0 / speed;
+        _cmin = speed > 1000000000.0 / MAX_STEP_INTERVAL ? static_cast<uint32_t>(1000000000.0 / speed) : MAX_STEP_INTERVAL;
         // Recompute _n from current speed and adjust speed if accelerating or cruising
         if (_n > 0)
         {
-            _n = (long)((_speed * _speed) / (2.0 * _acceleration)); // Equation 16
+            _n = (long)((current_speed * current_speed) / (2.0 * _acceleration)); // Equation 16
             computeNewSpeed();
         }
     }
@@ -307,9 +358,10 @@ void AccelStepper::setAcceleration(double acceleration)
     if (_acceleration != acceleration)
     {
         // Recompute _n per Equation 17
-        _n = _n * (_acceleration / acceleration);
-        // New c0 per Equation 7, with correction per Equation 15
-        _c0 = 0.676 * std::sqrt(2.0 / acceleration) * 1000000000.0; // Equation 15
+        _n = (long)(_n * (_acceleration / acceleration));
+        // New c0 per Equation 7, with correction per Equation 15. Only when the acceleration changes, not per step
+        _c0 = (uint32_t)std::min<double>(0.676 * std::sqrt(2.0 / acceleration) * 1000000000.0, MAX_STEP_INTERVAL); // Equation 15
+        _stop_k = static_cast<float>(1e18 / (2.0 * acceleration));
         _acceleration = acceleration;
         computeNewSpeed();
     }
@@ -317,7 +369,7 @@ void AccelStepper::setAcceleration(double acceleration)
 
 void AccelStepper::setSpeed(double speed)
 {
-    if (speed == _speed)
+    if (speed == this->speed())
         return;
     speed = constrain(speed, -_maxSpeed, _maxSpeed);
     if (speed == 0.0)
@@ -327,12 +379,15 @@ void AccelStepper::setSpeed(double speed)
         _stepInterval = std::abs(1000000000.0 / speed);
         _direction = (speed > 0.0) ? DIRECTION_CW : DIRECTION_CCW;
     }
-    _speed = speed;
 }
 
-double AccelStepper::speed()
+// Derived from the step interval instead of being divided out on every step
+double AccelStepper::speed() const
 {
-    return _speed;
+    if (!_stepInterval)
+        return 0.0;
+    double speed = 1000000000.0 / _stepInterval;
+    return _direction == DIRECTION_CW ? speed : -speed;
 }
 
 void AccelStepper::invertDirection()
@@ -395,7 +450,7 @@ void AccelStepper::setOutputPins(uint8_t mask)
 void AccelStepper::step0(long step)
 {
     (void)(step); // Unused
-    if (_speed > 0)
+    if (_direction == DIRECTION_CW)
         _forward();
     else
         _backward();
@@ -663,10 +718,10 @@ void AccelStepper::runToNewPosition(long position)
 
 void AccelStepper::stop()
 {
-    if (_speed != 0.0)
+    if (_stepInterval)
     {
-        long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)) + 1; // Equation 16 (+integer rounding)
-        if (_speed > 0)
+        long stepsToStop = this->stepsToStop() + 1; // Equation 16 (+integer rounding)
+        if (_direction == DIRECTION_CW)
             move(stepsToStop);
         else
             move(-stepsToStop);
@@ -675,5 +730,5 @@ void AccelStepper::stop()
 
 bool AccelStepper::isRunning()
 {
-    return !(_speed == 0.0 && _targetPos == _currentPos);
+    return !(_stepInterval == 0 && _targetPos == _currentPos);
 }
\ No newline at end of file
@@ -64,14 +64,13 @@ public:
     double maxSpeed();
     void setAcceleration(double acceleration);
     void setSpeed(double speed);
-    double speed();
 
     double distanceToGo();
     double targetPosition();
     double currentPosition();
     double acceleration() const { return _acceleration; }
     double maxSpeed() const { return _maxSpeed; }
-    double speed() const { return _speed; }
+    double speed() const;
 
     void setCurrentPosition(long position);
     void runToPosition();
@@ -101,6 +100,10 @@ protected:
 
     void computeNewSpeed();
 
+    bool planStep(uint64_t &interval_ns, bool &direction);
+    void rewindTo(long position) { _currentPos = position; }
+    long plannedPosition() const { return static_cast<long>(_currentPos); }
+
     virtual void setOutputPins(uint8_t mask);
 
     virtual void step(long step);
@@ -123,13 +126,15 @@ private:
     uint8_t _pin[4];
     uint8_t _pinInverted[4];
 
+    static constexpr uint32_t MAX_STEP_INTERVAL = 1UL << 30; // ns, slowest step the integer ramp handles (about 1 step/s)
+
+    long stepsToStop() const;
+
     double _currentPos;
     double _targetPos;
-    double _speed;
 
 
     double _acceleration;
-    double _sqrt_twoa;
 
     uint64_t _stepInterval;
     uint64_t _lastStepTime;
@@ -142,10 +147,12 @@ private:
     void (*_forward)();
     void (*_backward)();
 
-    double _n;
-    double _c0;
-    double _cn;
-    double _cmin;
+    long _n; // step number in the ramp, negative while decelerating
+    uint32_t _c0; // first step interval from stopped, ns
+    uint32_t _cn; // current step interval, ns
+    uint32_t _cn_rest; // remainder of the last interval update, carried to the next
+    uint32_t _cmin; // interval at max speed, ns
+    float _stop_k; // 1e18 / (2 * acceleration): steps to stop from an interval in ns is this over its square
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,153 @@
+/**
+ * @file DepthControl.cpp
+ * @author Daniel Kim
+ * @brief Closed loop depth and pitch control through the buoyancy and pitch carriages
+ * @version 0.1
+ * @date 2023-05-18
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "DepthControl.h"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace Control
+{
+    static constexpr double DERIVATIVE_SMOOTHING = 0.3; // first order filter on the derivative, 1 is unfiltered
+
+    static double clamp(double value, double min, double max)
+    {
+        return value < min ? min : (value > max ? max : value);
+    }
+
+    void PID::setOutputLimits(double min, double max)
+    {
+        m_min = min;
+        m_max = max;
+        m_integral = clamp(m_integral, min, max);
+    }
+
+    void PID::reset()
+    {
+        m_integral = 0.0;
+        m_derivative = 0.0;
+        m_first = true;
+    }
+
+    /**
+     * @brief Runs one update
+     *
+     * @param setpoint where we want to be
+     * @param measurement where we are
+     * @param feed_forward added to the output before clamping
+     * @param dt seconds since the last update
+     * @return double output, within the limits
+     */
+    double PID::update(double setpoint, double measurement, double feed_forward, double dt)
+    {
+        if (m_first)
+        {
+            m_previous_measurement = measurement;
+            m_first = false;
+        }
+
+        double error = setpoint - measurement;
+
+        if (dt > 0.0)
+        {
+            double rate = (measurement - m_previous_measurement) / dt;
+            m_derivative += (rate - m_derivative) * DERIVATIVE_SMOOTHING;
+        }
+        m_previous_measurement = measurement;
+
+        double direct = feed_forward + m_gains.kp * error - m_gains.kd * m_derivative; //everything but the integral
+        double step = m_gains.ki * error * dt;
+
+        //Conditional integration: don't integrate further into a limit the output is already at
+        double unclamped = direct + m_integral + step;
+        bool saturated = (unclamped > m_max && step > 0.0) || (unclamped < m_min && step < 0.0);
+        if (!saturated)
+        {
+            m_integral = clamp(m_integral + step, m_min, m_max);
+        }
+
+        double output = clamp(direct + m_integral, m_min, m_max);
+
+        return output;
+    }
+
+    DepthPitchController::DepthPitchController(const ControlSettings &settings) : m_settings(settings)
+    {
+        m_depth.setOutputLimits(settings.buoyancy_min - settings.buoyancy_neutral, settings.buoyancy_max - settings.buoyancy_neutral);
+        m_pitch.setOutputLimits(settings.pitch_neutral - settings.pitch_max, settings.pitch_neutral - settings.pitch_min); //negated, see update()
+        reset();
+    }
+
+    /**
+     * @brief Starts over from neutral. Call when the controller takes over the carriages
+     *
+     */
+    void DepthPitchController::reset()
+    {
+        m_depth.reset();
+        m_pitch.reset();
+
+        m_output = ControlOutput();
+        m_output.buoyancy_position = m_settings.buoyancy_neutral;
+        m_output.pitch_position = m_settings.pitch_neutral;
+        m_first = true;
+    }
+
+    /**
+     * @brief Runs both loops once. Call every settings.period
+     *
+     * @param input latest depth, pitch and target depth
+     * @return const ControlOutput& carriage positions to move to
+     */
+    const ControlOutput &DepthPitchController::update(const ControlInput &input)
+    {
+        const double dt = m_settings.period;
+
+        //Dive rate of the target, smoothed since profiles tend to come in steps
+        if (m_first)
+        {
+            m_previous_target = input.target_depth;
+            m_first = false;
+        }
+        double rate = (input.target_depth - m_previous_target) / dt;
+        m_output.target_rate += (rate - m_output.target_rate) * dt / (m_settings.target_rate_time_constant + dt);
+        m_previous_target = input.target_depth;
+
+        //Depth: positive output is heavier, which makes the vehicle go deeper
+        double feed_forward = m_settings.buoyancy_per_rate * m_output.target_rate;
+        double ballast = m_depth.update(input.target_depth, input.depth, feed_forward, dt);
+
+        //Pitch follows the ballast: nose down when heavy
+        m_output.pitch_setpoint = clamp(-ballast * m_settings.pitch_per_buoyancy, -m_settings.max_pitch, m_settings.max_pitch);
+
+        //Carriage towards pitch_max is nose down, so a nose up error needs a negative move
+        double carriage = -m_pitch.update(m_output.pitch_setpoint, input.pitch, 0.0, dt);
+
+        m_output.buoyancy_position = applyDeadband(m_output.buoyancy_position, m_settings.buoyancy_neutral + ballast, m_settings.buoyancy_min, m_settings.buoyancy_max);
+        m_output.pitch_position = applyDeadband(m_output.pitch_position, m_settings.pitch_neutral + carriage, m_settings.pitch_min, m_settings.pitch_max);
+
+        return m_output;
+    }
+
+    /**
+     * @brief Keeps the current position unless the command has moved past the deadband
+     *
+     */
+    long DepthPitchController::applyDeadband(long current, double command, long min, long max) const
+    {
+        long rounded = std::lround(clamp(command, min, max));
+        if (std::abs(rounded - current) <= m_settings.deadband && rounded != min && rounded != max)
+        {
+            return current;
+        }
+        return rounded;
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * @file DepthControl.h
+ * @author Daniel Kim
+ * @brief Closed loop depth and pitch control through the buoyancy and pitch carriages
+ * @version 0.1
+ * @date 2023-05-18
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef DEPTHCONTROL_H
+#define DEPTHCONTROL_H
+
+#include <cstdint>
+
+/*
+Two PID loops in cascade, run at a fixed rate by the scheduler:
+    depth error -> buoyancy carriage position (plus a feed forward from the target's dive rate)
+    buoyancy command -> pitch setpoint, pitch error -> pitch carriage position
+so the nose goes down when the ballast is heavy and up when it's light, and the vehicle glides
+towards the target instead of just sinking or floating.
+
+The outputs are carriage positions in half steps from the limit switches. Changes smaller than
+the deadband aren't passed on, so the steppers don't chase sensor noise.
+
+Depth is in m (positive down), pitch in degrees (positive nose up), time in s.
+No Arduino dependencies, so it can be run against a host model of the vehicle for tuning.
+*/
+
+namespace Control
+{
+    struct PIDGains
+    {
+        double kp = 0.0;
+        double ki = 0.0;
+        double kd = 0.0;
+
+        bool operator==(const PIDGains &other) const { return kp == other.kp && ki == other.ki && kd == other.kd; }
+        bool operator!=(const PIDGains &other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief PID with the derivative taken on the measurement (setpoint steps don't kick the output),
+     * a clamped output, and conditional integration against windup
+     *
+     */
+    class PID
+    {
+    public:
+        void setGains(const PIDGains &gains) { m_gains = gains; }
+        const PIDGains &gains() const { return m_gains; }
+
+        void setOutputLimits(double min, double max);
+        void reset();
+
+        double update(double setpoint, double measurement, double feed_forward, double dt);
+
+        double integral() const { return m_integral; }
+
+    private:
+        PIDGains m_gains;
+        double m_min = -1.0;
+        double m_max = 1.0;
+
+        double m_integral = 0.0; // in output units, kept within the output limits
+        double m_previous_measurement = 0.0;
+        double m_derivative = 0.0; // filtered d(measurement)/dt
+        bool m_first = true;
+    };
+
+    struct ControlSettings
+    {
+        double period = 0.2; // s between updates
+
+        long buoyancy_neutral = 0; // half steps, ballast that roughly balances the vehicle
+        long buoyancy_min = 0; // lightest
+        long buoyancy_max = 0; // heaviest
+
+        long pitch_neutral = 0; // half steps, carriage position that levels the vehicle
+        long pitch_min = 0; // most nose up
+        long pitch_max = 0; // most nose down
+
+        double buoyancy_per_rate = 0.0; // feed forward, half steps heavier per m/s of target dive rate
+        double pitch_per_buoyancy = 0.0; // degrees nose down per half step of ballast above neutral
+        double max_pitch = 0.0; // degrees, limit of the pitch setpoint either way
+
+        double target_rate_time_constant = 1.0; // s, smoothing of the target's dive rate
+        long deadband = 0; // half steps
+    };
+
+    struct ControlInput
+    {
+        double depth = 0.0;
+        double pitch = 0.0;
+        double target_depth = 0.0;
+    };
+
+    struct ControlOutput
+    {
+        long buoyancy_position = 0;
+        long pitch_position = 0;
+
+        double target_rate = 0.0; // m/s, smoothed dive rate of the target
+        double pitch_setpoint = 0.0;
+    };
+
+    class DepthPitchController
+    {
+    public:
+        explicit DepthPitchController(const ControlSettings &settings);
+
+        void setDepthGains(const PIDGains &gains) { m_depth.setGains(gains); }
+        void setPitchGains(const PIDGains &gains) { m_pitch.setGains(gains); }
+        const PIDGains &depthGains() const { return m_depth.gains(); }
+        const PIDGains &pitchGains() const { return m_pitch.gains(); }
+
+        void reset();
+        const ControlOutput &update(const ControlInput &input);
+        const ControlOutput &output() const { return m_output; }
+
+    private:
+        ControlSettings m_settings;
+
+        PID m_depth;
+        PID m_pitch;
+
+        ControlOutput m_output;
+        double m_previous_target = 0.0;
+        bool m_first = true;
+
+        long applyDeadband(long current, double command, long min, long max) const;
+    };
+}
+
+#endif
@@ -0,0 +1,383 @@
+/**
+ * @file MotionPlanner.cpp
+ * @author Daniel Kim
+ * @brief Jerk-limited (S-curve) motion profiles for the buoyancy and pitch carriages
+ * @version 0.1
+ * @date 2023-05-16
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "MotionPlanner.h"
+
+#include <cmath>
+
+namespace Mechanics
+{
+    static constexpr double ACCELERATION_SHRINK = 0.99; // per iteration when the acceleration limit can't be reached
+    static constexpr int MAX_SOLVE_ITERATIONS = 500;
+    static constexpr double POSITION_TOLERANCE = 1e-6; // steps
+
+    /**
+     * @brief Shortest jerk-limited distance to stop from a speed, starting with no acceleration
+     *
+     */
+    double SCurvePlanner::stopDistance(double speed, double max_acceleration, double max_jerk)
+    {
+        speed = std::fabs(speed);
+        double decel_time;
+        if (speed * max_jerk < max_acceleration * max_acceleration)
+        {
+            decel_time = 2.0 * std::sqrt(speed / max_jerk);
+        }
+        else
+        {
+            decel_time = max_acceleration / max_jerk + speed / max_acceleration;
+        }
+        return speed * decel_time / 2.0;
+    }
+
+    /**
+     * @brief Plans a move to target, ending at rest
+     *
+     * @param start current planned position
+     * @param target where to go
+     * @param start_velocity current velocity, steps/s
+     * @param start_acceleration current acceleration, steps/s^2
+     * @param limits speed, acceleration and jerk limits
+     * @return true planned
+     */
+    bool SCurvePlanner::plan(long start, long target, double start_velocity, double start_acceleration, const MotionLimits &limits)
+    {
+        m_limits = limits;
+        m_start = start;
+        m_goal = target;
+        m_steps = 0;
+        m_steps_done = 0;
+        m_time = 0.0;
+        m_segment = 0;
+        m_duration = 0.0;
+        m_peak_velocity = 0.0;
+        for (Segment &segment : m_segments)
+        {
+            segment = Segment();
+        }
+
+        if (limits.max_speed <= 0.0 || limits.max_acceleration <= 0.0 || limits.max_jerk <= 0.0)
+        {
+            return false;
+        }
+
+        long distance = target - start;
+        if (distance == 0 && start_velocity == 0.0 && start_acceleration == 0.0)
+        {
+            return true;
+        }
+
+        //Work in the direction of travel so every profile is a forward one
+        double heading = start_velocity != 0.0 ? start_velocity : start_acceleration;
+        m_sign = distance != 0 ? (distance > 0 ? 1 : -1) : (heading > 0.0 ? 1 : -1);
+        double v0 = start_velocity * m_sign;
+        double a0 = start_acceleration * m_sign;
+        double h = static_cast<double>(distance * m_sign);
+
+        bool away = v0 < 0.0 || (v0 == 0.0 && a0 < 0.0);
+        if (away)
+        {
+            m_sign = -m_sign;
+            v0 = -v0;
+            a0 = -a0;
+        }
+
+        //Lead-in: take the acceleration to zero at full jerk so it doesn't jump
+        Segment &lead = m_segments[0];
+        lead.velocity = v0;
+        lead.acceleration = a0;
+        lead.jerk = a0 > 0.0 ? -limits.max_jerk : limits.max_jerk;
+        lead.duration = std::fabs(a0) / limits.max_jerk;
+        double v1 = v0 + a0 * lead.duration / 2.0;
+        if (v1 < 0.0)
+        {
+            //Only rounding at the very end of a stop gets here: end the lead-in at rest instead
+            lead.duration = (-a0 - std::sqrt(a0 * a0 - 2.0 * limits.max_jerk * v0)) / limits.max_jerk;
+            v1 = 0.0;
+        }
+        double t = lead.duration;
+        double lead_distance = v0 * t + a0 * t * t / 2.0 + lead.jerk * t * t * t / 6.0;
+
+        double stop_distance = lead_distance + stopDistance(v1, limits.max_acceleration, limits.max_jerk);
+        if (away || h < stop_distance)
+        {
+            //Moving away from the target, or too close to stop in time: stop first, the next plan comes back
+            h = std::ceil(stop_distance);
+        }
+
+        m_steps = static_cast<long>(h);
+        if (m_steps == 0)
+        {
+            return true;
+        }
+
+        //A lower speed limit mid-move applies from the next plan, this one keeps the current speed
+        double max_speed = limits.max_speed > v1 ? limits.max_speed : v1;
+        solve(h - lead_distance, v1, max_speed, limits.max_acceleration, limits.max_jerk);
+        return true;
+    }
+
+    /**
+     * @brief Fills in the segment table after the lead-in, for a forward move of distance steps from v0 to rest
+     *
+     */
+    void SCurvePlanner::solve(double h, double v0, double vmax, double amax, double jmax)
+    {
+        double jerk_time_accel = 0.0; // Tj1
+        double accel_time = 0.0;      // Ta
+        double cruise_time = 0.0;     // Tv
+        double jerk_time_decel = 0.0; // Tj2
+        double decel_time = 0.0;      // Td
+
+        for (int iteration = 0; iteration < MAX_SOLVE_ITERATIONS; iteration++)
+        {
+            //Case 1: max speed is reached
+            if ((vmax - v0) * jmax < amax * amax)
+            {
+                jerk_time_accel = std::sqrt((vmax - v0) / jmax);
+                accel_time = 2.0 * jerk_time_accel;
+            }
+            else
+            {
+                jerk_time_accel = amax / jmax;
+                accel_time = jerk_time_accel + (vmax - v0) / amax;
+            }
+
+            if (vmax * jmax < amax * amax)
+            {
+                jerk_time_decel = std::sqrt(vmax / jmax);
+                decel_time = 2.0 * jerk_time_decel;
+            }
+            else
+            {
+                jerk_time_decel = amax / jmax;
+                decel_time = jerk_time_decel + vmax / amax;
+            }
+
+            cruise_time = h / vmax - accel_time / 2.0 * (1.0 + v0 / vmax) - decel_time / 2.0;
+            if (cruise_time >= 0.0)
+            {
+                break;
+            }
+
+            //Case 2: no cruise
+            cruise_time = 0.0;
+            double jerk_time = amax / jmax;
+            double delta = std::pow(amax, 4) / (jmax * jmax) + 2.0 * v0 * v0 + amax * (4.0 * h - 2.0 * jerk_time * v0);
+            accel_time = (amax * jerk_time - 2.0 * v0 + std::sqrt(delta)) / (2.0 * amax);
+            decel_time = (amax * jerk_time + std::sqrt(delta)) / (2.0 * amax);
+            jerk_time_accel = jerk_time;
+            jerk_time_decel = jerk_time;
+
+            if (accel_time < 0.0)
+            {
+                //Already too fast to accelerate, decelerate the whole way
+                accel_time = 0.0;
+                jerk_time_accel = 0.0;
+                decel_time = 2.0 * h / v0;
+                double root = jmax * (jmax * h * h - v0 * v0 * v0);
+                jerk_time_decel = (jmax * h - std::sqrt(root > 0.0 ? root : 0.0)) / (jmax * v0);
+                break;
+            }
+
+            if (accel_time >= 2.0 * jerk_time && decel_time >= 2.0 * jerk_time)
+            {
+                break;
+            }
+
+            //The acceleration limit isn't reached in one of the phases, retry with a lower one
+            amax *= ACCELERATION_SHRINK;
+        }
+
+        const double durations[SEGMENTS] = {m_segments[0].duration, jerk_time_accel, accel_time - 2.0 * jerk_time_accel, jerk_time_accel, cruise_time,
+                                            jerk_time_decel, decel_time - 2.0 * jerk_time_decel, jerk_time_decel};
+        const double jerks[SEGMENTS] = {m_segments[0].jerk, jmax, 0.0, -jmax, 0.0, -jmax, 0.0, jmax};
+
+        //From the start of the lead-in, which ends at v0 with no acceleration
+        double position = 0.0;
+        double velocity = m_segments[0].velocity;
+        double acceleration = m_segments[0].acceleration;
+        m_duration = 0.0;
+        m_peak_velocity = velocity > v0 ? velocity : v0;
+        for (uint8_t i = 0; i < SEGMENTS; i++)
+        {
+            double t = durations[i] > 0.0 ? durations[i] : 0.0;
+            Segment &segment = m_segments[i];
+            segment.duration = t;
+            segment.jerk = jerks[i];
+            segment.position = position;
+            segment.velocity = velocity;
+            segment.acceleration = acceleration;
+
+            position += velocity * t + acceleration * t * t / 2.0 + jerks[i] * t * t * t / 6.0;
+            velocity += acceleration * t + jerks[i] * t * t / 2.0;
+            acceleration += jerks[i] * t;
+            m_duration += t;
+            if (i == 0)
+            {
+                //What the profile was solved from, without the lead-in's rounding
+                velocity = v0;
+                acceleration = 0.0;
+            }
+
+            if (velocity > m_peak_velocity)
+            {
+                m_peak_velocity = velocity;
+            }
+        }
+    }
+
+    /**
+     * @brief Time at which the profile reaches a position (in the plan's own frame)
+     * Positions only increase, so the search carries on from the last step's segment
+     */
+    double SCurvePlanner::timeAt(double target)
+    {
+        double segment_start = 0.0;
+        for (uint8_t i = 0; i < m_segment; i++)
+        {
+            segment_start += m_segments[i].duration;
+        }
+
+        while (m_segment < SEGMENTS)
+        {
+            const Segment &s = m_segments[m_segment];
+            double end = s.position + s.velocity * s.duration + s.acceleration * s.duration * s.duration / 2.0 + s.jerk * s.duration * s.duration * s.duration / 6.0;
+            if (target <= end + POSITION_TOLERANCE || m_segment == SEGMENTS - 1)
+            {
+                break;
+            }
+            segment_start += s.duration;
+            m_segment++;
+        }
+        if (m_segment >= SEGMENTS)
+        {
+            return m_duration;
+        }
+
+        //Safeguarded Newton on the cubic: bisect when a step would leave the bracket
+        const Segment &s = m_segments[m_segment];
+        double low = m_time > segment_start ? m_time - segment_start : 0.0;
+        double high = s.duration;
+        double t = low;
+        for (int i = 0; i < 40; i++)
+        {
+            double p = s.position + s.velocity * t + s.acceleration * t * t / 2.0 + s.jerk * t * t * t / 6.0;
+            double error = p - target;
+            if (std::fabs(error) < POSITION_TOLERANCE)
+            {
+                break;
+            }
+            if (error > 0.0)
+            {
+                high = t;
+            }
+            else
+            {
+                low = t;
+            }
+
+            double v = s.velocity + s.acceleration * t + s.jerk * t * t / 2.0;
+            double next = v > 0.0 ? t - error / v : low - 1.0;
+            t = next > low && next < high ? next : (low + high) / 2.0;
+        }
+        return segment_start + t;
+    }
+
+    void SCurvePlanner::stateAt(double time, double &velocity, double &acceleration) const
+    {
+        double segment_start = 0.0;
+        for (uint8_t i = 0; i < SEGMENTS; i++)
+        {
+            const Segment &s = m_segments[i];
+            if (time <= segment_start + s.duration || i == SEGMENTS - 1)
+            {
+                double t = time - segment_start;
+                velocity = s.velocity + s.acceleration * t + s.jerk * t * t / 2.0;
+                acceleration = s.acceleration + s.jerk * t;
+                return;
+            }
+            segment_start += s.duration;
+        }
+        velocity = 0.0;
+        acceleration = 0.0;
+    }
+
+    /**
+     * @brief Plans the next step
+     *
+     * @param interval_ns time since the previous step
+     * @param direction true moves the position up
+     * @return false the plan is finished
+     */
+    bool SCurvePlanner::nextStep(uint64_t &interval_ns, bool &direction)
+    {
+        if (done())
+        {
+            return false;
+        }
+
+        double time = m_steps_done + 1 == m_steps ? m_duration : timeAt(static_cast<double>(m_steps_done + 1));
+        if (time < m_time)
+        {
+            time = m_time;
+        }
+
+        interval_ns = static_cast<uint64_t>((time - m_time) * 1e9);
+        direction = m_sign > 0;
+        m_time = time;
+        m_steps_done++;
+        return true;
+    }
+
+    /**
+     * @brief Abandons the plan, the motor has been stopped
+     *
+     * @param position where the motor stopped
+     */
+    void SCurvePlanner::stop(long position)
+    {
+        m_start = position;
+        m_goal = position;
+        m_steps = 0;
+        m_steps_done = 0;
+        m_time = 0.0;
+        m_segment = 0;
+        m_duration = 0.0;
+        m_peak_velocity = 0.0;
+        for (Segment &segment : m_segments)
+        {
+            segment = Segment();
+        }
+    }
+
+    double SCurvePlanner::velocity() const
+    {
+        if (done())
+        {
+            return 0.0;
+        }
+        double velocity, acceleration;
+        stateAt(m_time, velocity, acceleration);
+        return m_sign * velocity;
+    }
+
+    double SCurvePlanner::acceleration() const
+    {
+        if (done())
+        {
+            return 0.0;
+        }
+        double velocity, acceleration;
+        stateAt(m_time, velocity, acceleration);
+        return m_sign * acceleration;
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * @file MotionPlanner.h
+ * @author Daniel Kim
+ * @brief Jerk-limited (S-curve) motion profiles for the buoyancy and pitch carriages
+ * @version 0.1
+ * @date 2023-05-16
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef MOTIONPLANNER_H
+#define MOTIONPLANNER_H
+
+#include <cstdint>
+
+/*
+Each move is planned once into at most seven constant-jerk segments (double S profile,
+Biagiotti & Melchiorri ch. 3.4), ending at rest on the target. nextStep() then walks the profile
+and returns the time between steps for the step engine.
+
+Moves can be replanned at any step. The new plan starts at the current planned velocity and
+acceleration: a lead-in segment at full jerk brings the acceleration to zero, and the double S
+profile is planned from the end of it. If the target is behind us, or too close to stop for, the
+planner first plans a jerk-limited stop and the next plan heads back.
+
+Positions are in steps, times in seconds. No Arduino dependencies.
+*/
+
+namespace Mechanics
+{
+    struct MotionLimits
+    {
+        double max_speed = 0.0; // steps/s
+        double max_acceleration = 0.0; // steps/s^2
+        double max_jerk = 0.0; // steps/s^3
+
+        bool operator==(const MotionLimits &other) const
+        {
+            return max_speed == other.max_speed && max_acceleration == other.max_acceleration && max_jerk == other.max_jerk;
+        }
+        bool operator!=(const MotionLimits &other) const { return !(*this == other); }
+    };
+
+    class SCurvePlanner
+    {
+    public:
+        static constexpr uint8_t SEGMENTS = 8; // the lead-in, then the double S profile
+
+        /**
+         * @brief One constant-jerk piece of the profile. State is at the start, relative to the plan start
+         *
+         */
+        struct Segment
+        {
+            double duration = 0.0;
+            double jerk = 0.0;
+            double position = 0.0;
+            double velocity = 0.0;
+            double acceleration = 0.0;
+        };
+
+        bool plan(long start, long target, double start_velocity, double start_acceleration, const MotionLimits &limits);
+        bool nextStep(uint64_t &interval_ns, bool &direction);
+        void stop(long position);
+
+        bool done() const { return m_steps_done >= m_steps; }
+
+        long target() const { return m_goal; }
+        long position() const { return m_start + m_sign * m_steps_done; }
+        const MotionLimits &limits() const { return m_limits; }
+
+        double velocity() const; // at the last planned step, steps/s
+        double acceleration() const;
+        double peakVelocity() const { return m_sign * m_peak_velocity; }
+        double duration() const { return m_duration; }
+        double remaining() const { return m_duration - m_time; } // s of the plan after the last planned step
+
+        static double stopDistance(double speed, double max_acceleration, double max_jerk);
+
+    private:
+        void solve(double distance, double start_velocity, double max_speed, double max_acceleration, double max_jerk);
+        double timeAt(double position);
+        void stateAt(double time, double &velocity, double &acceleration) const;
+
+        Segment m_segments[SEGMENTS];
+        MotionLimits m_limits;
+
+        long m_start = 0;
+        long m_goal = 0; // where we were asked to go
+        int m_sign = 1; // direction of this plan
+        long m_steps = 0; // steps in this plan
+        long m_steps_done = 0;
+
+        double m_duration = 0.0;
+        double m_peak_velocity = 0.0;
+        double m_time = 0.0; // time of the last planned step
+        uint8_t m_segment = 0; // segment holding m_time
+    };
+}
+
+#endif
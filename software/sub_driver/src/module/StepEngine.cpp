@@ -0,0 +1,197 @@
+/**
+ * @file StepEngine.cpp
+ * @author Daniel Kim
+ * @brief Timer interrupt step generation for the buoyancy and pitch steppers
+ * @version 0.1
+ * @date 2023-05-14
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "StepEngine.h"
+
+#if defined(CORE_TEENSY)
+    #include <Arduino.h>
+    #include <IntervalTimer.h>
+#endif
+
+Mechanics::StepEngine step_engine; //shared by the buoyancy and pitch steppers
+
+namespace Mechanics
+{
+    static constexpr uint32_t DIRECTION_BIT = 0x80000000UL;
+    static constexpr uint32_t TICKS_MASK = 0x7FFFFFFFUL;
+
+#if defined(CORE_TEENSY)
+    static IntervalTimer step_timer;
+
+    static void stepISR()
+    {
+        step_engine.tick();
+    }
+#endif
+
+    /**
+     * @brief Keeps the interrupt out while the main loop changes its state
+     *
+     */
+    class CriticalSection
+    {
+    public:
+    #if defined(CORE_TEENSY)
+        CriticalSection() { noInterrupts(); }
+        ~CriticalSection() { interrupts(); }
+    #else
+        CriticalSection() {}
+        ~CriticalSection() {}
+    #endif
+    };
+
+    void StepEngine::attach(uint8_t axis, uint8_t step_pin, uint8_t dir_pin)
+    {
+        m_axes[axis].step_pin = step_pin;
+        m_axes[axis].dir_pin = dir_pin;
+    }
+
+    /**
+     * @brief Starts the step interrupt
+     *
+     * @param write how to drive a pin
+     * @return true timer started
+     */
+    bool StepEngine::begin(PinWrite write)
+    {
+        m_write = write;
+
+    #if defined(CORE_TEENSY)
+        step_timer.priority(64); //above USB and the serial ports so steps don't jitter
+        return step_timer.begin(stepISR, TICK_NS / 1000.0f);
+    #else
+        return true;
+    #endif
+    }
+
+    void StepEngine::end()
+    {
+    #if defined(CORE_TEENSY)
+        step_timer.end();
+    #endif
+    }
+
+    /**
+     * @brief Queues one step
+     *
+     * @param axis which stepper
+     * @param interval_ns time from the previous step to this one
+     * @param direction true moves the position up
+     * @return true queued, false the queue is full
+     */
+    bool StepEngine::push(uint8_t axis, uint64_t interval_ns, bool direction)
+    {
+        Axis &a = m_axes[axis];
+
+        uint64_t total_ns = interval_ns + a.carry_ns;
+        uint64_t ticks = total_ns / TICK_NS;
+        uint32_t carry = static_cast<uint32_t>(total_ns % TICK_NS);
+        if (ticks < MIN_INTERVAL_TICKS)
+        {
+            ticks = MIN_INTERVAL_TICKS;
+            carry = 0;
+        }
+        else if (ticks > TICKS_MASK)
+        {
+            ticks = TICKS_MASK;
+            carry = 0;
+        }
+
+        if (!a.queue.push(static_cast<uint32_t>(ticks) | (direction ? DIRECTION_BIT : 0)))
+        {
+            return false;
+        }
+
+        a.carry_ns = carry;
+        a.produced_ticks += static_cast<uint32_t>(ticks);
+        return true;
+    }
+
+    /**
+     * @brief How much planned motion hasn't started yet
+     *
+     */
+    int64_t StepEngine::queuedNs(uint8_t axis) const
+    {
+        const Axis &a = m_axes[axis];
+        return static_cast<int64_t>(a.produced_ticks - a.consumed_ticks) * TICK_NS;
+    }
+
+    /**
+     * @brief Drops steps that are planned but haven't happened yet. Pulses already started still finish
+     *
+     */
+    void StepEngine::flush(uint8_t axis)
+    {
+        CriticalSection critical;
+
+        Axis &a = m_axes[axis];
+        a.queue.clear();
+        a.remaining = 0;
+        a.carry_ns = 0;
+        a.produced_ticks = a.consumed_ticks;
+        a.starved = false;
+    }
+
+    void StepEngine::setPosition(uint8_t axis, int32_t position)
+    {
+        flush(axis);
+
+        CriticalSection critical;
+        m_axes[axis].position = position;
+    }
+
+    /**
+     * @brief Interrupt body, runs every TICK_NS
+     * Finishes pulses in progress, then counts down to each axis' next step
+     */
+    void StepEngine::tick()
+    {
+        for (uint8_t i = 0; i < AXES; i++)
+        {
+            Axis &a = m_axes[i];
+
+            if (a.edges > 0)
+            {
+                a.edges--;
+                m_write(a.step_pin, a.edges & 1); //odd counts are high, ends low
+            }
+
+            if (a.remaining == 0)
+            {
+                uint32_t entry;
+                if (!a.queue.pop(entry))
+                {
+                    //The loop fell behind the motor
+                    if (a.active && !a.starved)
+                    {
+                        m_underruns = m_underruns + 1;
+                        a.starved = true;
+                    }
+                    continue;
+                }
+
+                a.starved = false;
+                a.remaining = entry & TICKS_MASK;
+                a.direction = (entry & DIRECTION_BIT) != 0;
+                a.consumed_ticks = a.consumed_ticks + a.remaining;
+            }
+
+            if (--a.remaining == 0)
+            {
+                //Direction first, pulses start on the next tick
+                m_write(a.dir_pin, a.direction);
+                a.position = a.position + (a.direction ? 1 : -1);
+                a.edges = 2 * PULSES_PER_STEP;
+            }
+        }
+    }
+}
@@ -0,0 +1,160 @@
+/**
+ * @file StepEngine.h
+ * @author Daniel Kim
+ * @brief Timer interrupt step generation for the buoyancy and pitch steppers
+ * @version 0.1
+ * @date 2023-05-14
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef STEPENGINE_H
+#define STEPENGINE_H
+
+#include <atomic>
+#include <cstdint>
+
+/*
+The main loop plans steps ahead of time (Stepper::update) and queues the interval before each one.
+A single timer interrupt shared by both axes counts the intervals down and pulses the drivers, so
+step timing doesn't depend on how long the rest of the loop takes.
+
+No Arduino dependencies here: on the Teensy begin() starts an IntervalTimer, on the host tick() or
+simulate() is called directly and the pin writes go wherever the PinWrite function sends them.
+*/
+
+namespace Mechanics
+{
+    using PinWrite = void (*)(uint8_t pin, bool level);
+
+    /**
+     * @brief Single producer (main loop), single consumer (timer ISR) ring buffer
+     *
+     * @tparam SIZE entries, power of two
+     */
+    template <uint16_t SIZE>
+    class StepQueue
+    {
+        static_assert((SIZE & (SIZE - 1)) == 0, "queue size must be a power of two");
+
+    public:
+        bool push(uint32_t entry)
+        {
+            uint16_t head = m_head;
+            if (static_cast<uint16_t>(head - m_tail) >= SIZE)
+            {
+                return false;
+            }
+            m_buffer[head & (SIZE - 1)] = entry;
+            std::atomic_signal_fence(std::memory_order_release); // entry is written before the ISR can see it
+            m_head = head + 1;
+            return true;
+        }
+
+        bool pop(uint32_t &entry)
+        {
+            uint16_t tail = m_tail;
+            if (tail == m_head)
+            {
+                return false;
+            }
+            std::atomic_signal_fence(std::memory_order_acquire);
+            entry = m_buffer[tail & (SIZE - 1)];
+            m_tail = tail + 1;
+            return true;
+        }
+
+        uint16_t size() const { return static_cast<uint16_t>(m_head - m_tail); }
+
+        /**
+         * @brief Drops everything. Only call while the consumer can't run
+         *
+         */
+        void clear() { m_tail = m_head; }
+
+    private:
+        uint32_t m_buffer[SIZE];
+        volatile uint16_t m_head = 0;
+        volatile uint16_t m_tail = 0;
+    };
+
+    class StepEngine
+    {
+    public:
+        static constexpr uint8_t AXES = 2;
+        static constexpr uint16_t QUEUE_SIZE = 128;
+        static constexpr uint32_t TICK_NS = 10000; // interrupt period, also the width of each step pulse
+        static constexpr uint8_t PULSES_PER_STEP = 3; // matches AccelStepper::step1, so positions mean the same thing
+        static constexpr uint32_t MIN_INTERVAL_TICKS = 2 * PULSES_PER_STEP; // a step's pulses finish before the next step
+
+        /**
+         * @brief Sets the pins of an axis. Call before begin()
+         *
+         */
+        void attach(uint8_t axis, uint8_t step_pin, uint8_t dir_pin);
+
+        bool begin(PinWrite write);
+        void end();
+
+        //Main loop side
+
+        bool push(uint8_t axis, uint64_t interval_ns, bool direction);
+        uint16_t space(uint8_t axis) const { return QUEUE_SIZE - m_axes[axis].queue.size(); }
+        int64_t queuedNs(uint8_t axis) const;
+
+        int32_t position(uint8_t axis) const { return m_axes[axis].position; }
+        void setPosition(uint8_t axis, int32_t position);
+        void flush(uint8_t axis);
+
+        void setActive(uint8_t axis, bool active) { m_axes[axis].active = active; }
+        uint32_t underruns() const { return m_underruns; }
+
+        //Interrupt side
+
+        void tick();
+
+    #if !defined(CORE_TEENSY)
+        /**
+         * @brief Host backend: runs the interrupt for the given amount of simulated time
+         *
+         */
+        void simulate(int64_t duration_ns)
+        {
+            for (int64_t elapsed = 0; elapsed < duration_ns; elapsed += TICK_NS)
+            {
+                tick();
+            }
+        }
+    #endif
+
+    private:
+        struct Axis
+        {
+            StepQueue<QUEUE_SIZE> queue;
+            uint8_t step_pin = 0;
+            uint8_t dir_pin = 0;
+
+            //Written by the main loop
+            uint32_t produced_ticks = 0;
+            uint32_t carry_ns = 0; // rounding left over from the last interval, so the average rate is exact
+            volatile bool active = false;
+
+            //Written by the interrupt
+            volatile uint32_t consumed_ticks = 0;
+            volatile int32_t position = 0;
+            uint32_t remaining = 0; // ticks until the current step
+            uint8_t edges = 0; // step pin edges left in the current step
+            bool direction = false;
+            bool starved = false;
+        };
+
+        Axis m_axes[AXES];
+        PinWrite m_write = nullptr;
+        volatile uint32_t m_underruns = 0;
+    };
+}
+
+extern Mechanics::StepEngine step_engine;
+
+#endif
@@ -11,11 +11,13 @@ namespace Mechanics
      * @param pins pins of the stepper driver
      * @param resolution initial resolution
      * @param properties properties of the stepper structure
+     * @param axis which step engine axis drives this stepper
      */
-    Stepper::Stepper(StepperPins pins, Resolution resolution, StepperProperties properties) : AccelStepper(1, pins.STP, pins.DIR)
+    Stepper::Stepper(StepperPins pins, Resolution resolution, StepperProperties properties, uint8_t axis) : AccelStepper(1, pins.STP, pins.DIR)
     {
         this->pins = pins;
         this->properties = properties;
+        this->axis = axis;
 
         pinMode(pins.MS1, OUTPUT);
         pinMode(pins.MS2, OUTPUT);
@@ -29,6 +31,15 @@ namespace Mechanics
     }
 
 
+    /**
+     * @brief Hands the step and direction pins to the step engine
+     * 
+     */
+    void Stepper::attach()
+    {
+        step_engine.attach(axis, pins.STP, pins.DIR);
+    }
+
     /**
      * @brief Configures GPIO to control resolution of TMC2208 stepper driver
      * 
@@ -76,26 +87,132 @@ namespace Mechanics
     }
 
     /**
-     * @brief Calibrates the stepper motor
-     * Must set stepper speeds and accelerations before calling this
+     * @brief Starts homing. home() does the work, a phase at a time
      * 
+     * @param settings speeds, back off distance and timeouts
      */
-    bool Stepper::calibrate()
+    void Stepper::startHoming(const HomingSettings &settings)
     {
-        moveTo(100000000); //move to end of rail
+        homing_settings = settings;
+        calibrated = false;
 
-        if(limit.state() == true)
+        setSpeeds(settings.seek_speed, settings.acceleration);
+        move(2 * properties.halves_length); //towards the switch, if it's further than this it's broken
+        setHomingPhase(HomingPhase::SEEK);
+    }
+
+    /**
+     * @brief Runs homing. Call every loop, it never waits for the motor
+     * Switch presses are seen a loop late at most, the steps queued past them are dropped
+     * 
+     * @param now_ns loop timestamp
+     * @return HomingPhase where homing is now
+     */
+    HomingPhase Stepper::home(int64_t now_ns)
+    {
+        if(!isHoming())
         {
-            moveTo(0);
-            setCurrentPosition(0);
-            update();
-            calibrated = true;
-            return true;
+            return homing_phase;
         }
-        else
+
+        if(phase_start_ns < 0)
+        {
+            phase_start_ns = now_ns;
+        }
+        int64_t elapsed = now_ns - phase_start_ns;
+
+        switch(homing_phase)
+        {
+        case HomingPhase::SEEK:
+            if(limit.state())
+            {
+                setCurrentPosition(0);
+                setSpeeds(homing_settings.backoff_speed, homing_settings.acceleration);
+                move(-homing_settings.backoff_steps);
+                setHomingPhase(HomingPhase::BACK_OFF);
+            }
+            else if(elapsed > homing_settings.seek_timeout || settled())
+            {
+                setHomingPhase(HomingPhase::FAILED);
+            }
+            break;
+
+        case HomingPhase::BACK_OFF:
+            if(settled())
+            {
+                if(limit.state())
+                {
+                    setHomingPhase(HomingPhase::FAILED); //switch is stuck
+                    break;
+                }
+                setSpeeds(homing_settings.approach_speed, homing_settings.acceleration);
+                move(2 * homing_settings.backoff_steps);
+                setHomingPhase(HomingPhase::APPROACH);
+            }
+            else if(elapsed > homing_settings.approach_timeout)
+            {
+                setHomingPhase(HomingPhase::FAILED);
+            }
+            break;
+
+        case HomingPhase::APPROACH:
+            if(limit.state())
+            {
+                setCurrentPosition(0);
+                calibrated = true;
+                setHomingPhase(HomingPhase::HOMED);
+            }
+            else if(elapsed > homing_settings.approach_timeout || settled())
+            {
+                setHomingPhase(HomingPhase::FAILED);
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if(homing_phase == HomingPhase::FAILED)
+        {
+            setSpeed(0);
+        }
+
+        return homing_phase;
+    }
+
+    void Stepper::setHomingPhase(HomingPhase phase)
+    {
+        homing_phase = phase;
+        phase_start_ns = -1;
+    }
+
+    /**
+     * @brief The last planned step has been taken
+     * 
+     */
+    bool Stepper::settled()
+    {
+        return distanceToGo() == 0 && step_engine.position(axis) == targetPosition();
+    }
+
+    /**
+     * @brief Setting the speed to zero stops right away, like it did when stepping from the loop
+     * Steps already planned are dropped
+     * 
+     * @param speed steps per second
+     */
+    void Stepper::setSpeed(double speed)
+    {
+        if(speed == 0.0 && (step_engine.queuedNs(axis) > 0 || !planner.done()))
         {
-            return false;
+            step_engine.flush(axis);
+            rewindTo(step_engine.position(axis));
+            planner.stop(step_engine.position(axis));
         }
+
+        stopped = speed == 0.0;
+        stopped_target = static_cast<long>(targetPosition());
+        AccelStepper::setSpeed(speed);
     }
 
     void Stepper::setSpeeds(double speed, double acceleration)
@@ -107,33 +224,26 @@ namespace Mechanics
 
 
     /**
-     * @brief After limit switch is pressed once, it goes back and slowly eases back in
-     * For further precision
+     * @brief Where the motor actually is. AccelStepper's position runs ahead by the planned steps
      * 
+     * @return double 
      */
-    void Stepper::recheckLimit()
+    double Stepper::currentPosition()
     {
-        setCurrentPosition(0);
-        move(-1000);
-        while(currentPosition() != 1000)
-        {
-            run();
-        }
-        
-        setResolution(Resolution::EIGHTH);
-
-        move(100000000);
-        uint64_t start = millis();
-        while(limit.state() == false)
-        {
-            if(millis() - start > 10000)
-            {
-                return;
-            }
-            run();
-        }
+        return step_engine.position(axis) * pos_multiplier;
+    }
 
-        setCurrentPosition(0);
+    /**
+     * @brief Stops and redefines where the motor is
+     * 
+     * @param position new position in steps
+     */
+    void Stepper::setCurrentPosition(long position)
+    {
+        step_engine.setPosition(axis, position);
+        last_position = position;
+        planner.stop(position);
+        AccelStepper::setCurrentPosition(position);
     }
 
     /**
@@ -202,6 +312,67 @@ namespace Mechanics
         goTo(mm * steps_per_mm);
     }
 
+    /**
+     * @brief Plans steps until the step engine has STEP_LOOKAHEAD_NS of motion queued
+     * 
+     */
+    void Stepper::refill()
+    {
+        uint64_t interval_ns;
+        bool direction;
+
+        if(STEPPER_JERK_TIME <= 0.0)
+        {
+            while(step_engine.space(axis) > 0 && step_engine.queuedNs(axis) < STEP_LOOKAHEAD_NS && planStep(interval_ns, direction))
+            {
+                step_engine.push(axis, interval_ns, direction);
+            }
+            step_engine.setActive(axis, distanceToGo() != 0);
+            return;
+        }
+
+        //S-curve: setSpeed(0) still means stopped, like it does for AccelStepper, until there is a new target
+        //AccelStepper's own speed can't say so: nothing steps it in this mode, and it reads zero after setCurrentPosition
+        long target = static_cast<long>(targetPosition());
+        if(stopped && target == stopped_target)
+        {
+            step_engine.setActive(axis, false);
+            return;
+        }
+        stopped = false;
+
+        //Replan when the target or the limits change, or to come back after stopping past the target
+        MotionLimits limits;
+        limits.max_speed = maxSpeed();
+        limits.max_acceleration = acceleration();
+        limits.max_jerk = acceleration() / STEPPER_JERK_TIME;
+
+        if(target != planner.target() || limits != planner.limits() || (planner.done() && plannedPosition() != target))
+        {
+            planner.plan(plannedPosition(), target, planner.velocity(), planner.acceleration(), limits);
+        }
+
+        while(step_engine.space(axis) > 0 && step_engine.queuedNs(axis) < STEP_LOOKAHEAD_NS && planner.nextStep(interval_ns, direction))
+        {
+            step_engine.push(axis, interval_ns, direction);
+        }
+        rewindTo(planner.position()); //keep AccelStepper's planned position with the planner's
+        step_engine.setActive(axis, !planner.done());
+    }
+
+    /**
+     * @brief Logs where the planned trajectory is heading
+     * 
+     * @param data this stepper's logged data
+     */
+    void Stepper::logPlan(StepperData &data)
+    {
+        data.planned_velocity = planner.velocity();
+        data.planned_acceleration = planner.acceleration();
+        data.planned_peak_velocity = planner.peakVelocity();
+        data.plan_remaining = planner.remaining();
+    }
+
     /**
      * @brief Must call in loop to update
      * 
@@ -216,7 +387,14 @@ namespace Mechanics
         }
         else
         {
-            run();
+            refill();
+
+            int32_t position = step_engine.position(axis);
+            if(position != last_position)
+            {
+                last_position = position;
+                CommandLatency::stepped(axis);
+            }
             return true;
         }
     }
@@ -267,38 +445,63 @@ namespace Mechanics
         data.dive_stepper.target_position_mm = targetPosition_mm();
 
         data.dive_stepper.limit_state = limit.state();
+        data.dive_stepper.homed = isCalibrated();
+        data.dive_stepper.homing_phase = static_cast<uint8_t>(homing_phase);
 
         data.dive_stepper.speed = speed();
         data.dive_stepper.max_speed = maxSpeed();
         data.dive_stepper.acceleration = acceleration();
+
+        logPlan(data.dive_stepper);
     }
 
-    void Pitch::runPitch(TransportManager::Commands &commands, CurrentState state, double buoyancy_position)
+    /**
+     * @brief Moves the pitch carriage: from the GUI's commands, or where the depth controller wants it
+     * 
+     * @param commands GUI commands, manual mode unless auto_pitch is 0
+     * @param state current state
+     * @param controlled_position depth controller's carriage position, half steps
+     */
+    void Pitch::runPitch(TransportManager::Commands &commands, CurrentState state, long controlled_position)
     {
+        if(isHoming())
+        {
+            return;
+        }
+
         if(commands.auto_pitch != 0)
         {
             manualMode(commands);
         }
         else
         {
-            autoMode(state, buoyancy_position);
+            autoMode(state, controlled_position);
         }
     }
 
-    void Pitch::runPitch(CurrentState state, double buoyancy_position)
+    void Pitch::runPitch(CurrentState state, long controlled_position)
     {
-        autoMode(state, buoyancy_position);
+        if(isHoming())
+        {
+            return;
+        }
+
+        autoMode(state, controlled_position);
     }
 
     void Pitch::manualMode(TransportManager::Commands &commands)
     {
         if(!isCalibrated())
         {
-            setSpeeds(1000, 500);
-            calibrate();
+            startHoming(HomingSettings(PITCH_DEFAULT_STEPPER_SPEED, PITCH_DEFAULT_STEPPER_ACCELERATION));
         }
         else
         {
+            //Only a change from the GUI counts as a command for the latency report
+            bool changed = !manual || commands.pitch.speed != manual_command.speed || commands.pitch.acceleration != manual_command.acceleration || commands.pitch.direction != manual_command.direction;
+            manual_command = commands.pitch;
+            manual = true;
+
             if(commands.pitch.direction == 0)
             {
                 commands.pitch.speed *= -1;
@@ -315,6 +518,10 @@ namespace Mechanics
             }
 
             setSpeeds(commands.pitch.speed, commands.pitch.acceleration);
+            if(changed)
+            {
+                CommandLatency::applied(CommandLatency::axisBit(AXIS));
+            }
         }
 
         if(commands.recalibrate_pitch != 0)
@@ -323,54 +530,33 @@ namespace Mechanics
         }
     }
 
-    void Pitch::autoMode(CurrentState state, double buoyancy_position)
+    /**
+     * @brief Diving follows the depth controller, resurfacing goes fully nose up
+     * 
+     */
+    void Pitch::autoMode(CurrentState state, long controlled_position)
     {
+        bool changed = manual; //the GUI just handed pitch back to the controller
+        manual = false;
         setSpeeds(PITCH_DEFAULT_STEPPER_SPEED, PITCH_DEFAULT_STEPPER_ACCELERATION);
 
-        //convert to long for comparisons
-        //GUI position readings are absolute, so we need to convert to absolute values
-        long new_buoyancy_position = static_cast<long>(buoyancy_position);
-        new_buoyancy_position = std::abs<long>(new_buoyancy_position);
-
-        long new_pitch_position = static_cast<long>(currentPosition());
-        new_pitch_position = std::abs<long>(new_pitch_position);
-
-        if(state == CurrentState::RESURFACING)
+        if(state == CurrentState::DIVING_MODE)
         {
-            if(new_buoyancy_position < 11000)
-            {
-                setSpeed(0);
-            }
-            else if(new_pitch_position == properties.halves_length)
-            {
-                setSpeed(0);
-            }
-            else
-            {
-                moveTo(-1 * properties.halves_length);
-                setSpeed(-1 * PITCH_DEFAULT_STEPPER_SPEED);
-            }
+            moveTo(controlled_position);
         }
-        else if(state == CurrentState::DIVING_MODE)
+        else if(state == CurrentState::RESURFACING)
         {
-            if(new_pitch_position == 0)
-            {
-                setSpeed(0);
-            }
-            else if(new_buoyancy_position < 9000)
-            {
-                moveTo(properties.halves_length);
-                setSpeed(PITCH_DEFAULT_STEPPER_SPEED);
-            }
-            else
-            {
-                setSpeed(0);
-            }
+            moveTo(-1 * properties.halves_length);
         }
         else
         {
             setSpeed(0);
         }
+
+        if(changed)
+        {
+            CommandLatency::applied(CommandLatency::axisBit(AXIS));
+        }
     }
 
 
@@ -383,10 +569,33 @@ namespace Mechanics
         data.pitch_stepper.target_position_mm = targetPosition_mm();
 
         data.pitch_stepper.limit_state = limit.state();
+        data.pitch_stepper.homed = isCalibrated();
+        data.pitch_stepper.homing_phase = static_cast<uint8_t>(homing_phase);
 
         data.pitch_stepper.speed = speed();
         data.pitch_stepper.max_speed = maxSpeed();
         data.pitch_stepper.acceleration = acceleration();
+
+        logPlan(data.pitch_stepper);
+    }
+
+    static void writePin(uint8_t pin, bool level)
+    {
+        digitalWriteFast(pin, level);
+    }
+
+    /**
+     * @brief Starts stepping both steppers from the step engine's timer interrupt
+     * 
+     * @param buoyancy buoyancy object
+     * @param pitch pitch object
+     * @return true timer started
+     */
+    bool startStepEngine(Buoyancy &buoyancy, Pitch &pitch)
+    {
+        buoyancy.attach();
+        pitch.attach();
+        return step_engine.begin(writePin);
     }
 
     /**
@@ -418,12 +627,33 @@ namespace Mechanics
         pitch.setSpeeds(PITCH_DEFAULT_STEPPER_SPEED, PITCH_DEFAULT_STEPPER_ACCELERATION);
     }
 
-    bool calibrateBoth(Buoyancy &buoyancy, Pitch &pitch)
+    /**
+     * @brief Starts homing both steppers. They home at the same time
+     * 
+     * @param buoyancy buoyancy object
+     * @param pitch pitch object
+     */
+    void startHoming(Buoyancy &buoyancy, Pitch &pitch)
+    {
+        buoyancy.startHoming(HomingSettings(BUOYANCY_DEFAULT_STEPPER_SPEED, BUOYANCY_DEFAULT_STEPPER_ACCELERATION));
+        pitch.startHoming(HomingSettings(PITCH_DEFAULT_STEPPER_SPEED, PITCH_DEFAULT_STEPPER_ACCELERATION));
+    }
+
+    /**
+     * @brief Combined homing state of both steppers
+     * 
+     * @return HomingPhase FAILED if either failed, HOMED once both are, otherwise the slower one's phase
+     */
+    HomingPhase homingStatus(const Buoyancy &buoyancy, const Pitch &pitch)
     {
-        bool buoyancy_calibrated = buoyancy.calibrate();
-        bool pitch_calibrated = pitch.calibrate();
+        HomingPhase b = buoyancy.homingPhase();
+        HomingPhase p = pitch.homingPhase();
 
-        return buoyancy_calibrated && pitch_calibrated;
+        if(b == HomingPhase::FAILED || p == HomingPhase::FAILED)
+        {
+            return HomingPhase::FAILED;
+        }
+        return b < p ? b : p;
     }
 
 }
@@ -6,11 +6,15 @@
 #include <cstdint>
 
 #include "AccelStepper.h"
+#include "StepEngine.h"
+#include "MotionPlanner.h"
 #include "limit.h"
 #include "data/logged_data.h"
 #include "../core/pins.h"
 #include "../Data/TransportManager.h"
+#include "../Data/CommandLatency.h"
 #include "../core/StateAutomation.h"
+#include "../core/configuration.h"
 
 
 namespace Mechanics
@@ -30,10 +34,41 @@ namespace Mechanics
         long halves_length; //how many half steps are in the carriage
     };
 
+    /**
+     * @brief Where an axis is in homing. Sent to the GUI, so the values are fixed
+     * 
+     */
+    enum class HomingPhase : uint8_t
+    {
+        IDLE,
+        SEEK, //towards the limit switch at the axis' speed
+        BACK_OFF, //off the switch
+        APPROACH, //slowly back onto the switch, this press sets zero
+        HOMED,
+        FAILED
+    };
+
+    /**
+     * @brief Speeds and limits for homing, defaults are in configuration.h
+     * 
+     */
+    struct HomingSettings
+    {
+        HomingSettings(double seek_speed, double acceleration) : seek_speed(seek_speed), acceleration(acceleration) {}
+        double seek_speed; //steps per second
+        double acceleration;
+        double backoff_speed = HOMING_BACKOFF_SPEED;
+        double approach_speed = HOMING_APPROACH_SPEED;
+        long backoff_steps = HOMING_BACKOFF_STEPS;
+        int64_t seek_timeout = HOMING_SEEK_TIMEOUT;
+        int64_t approach_timeout = HOMING_APPROACH_TIMEOUT; //back off and approach each
+    };
+
     /**
      * @brief Child class of AccelStepper
      * Includes code to change the resolution of the stepper 
      * and to calibrate the motor w/ limit switches
+     * Steps are planned by AccelStepper and output from the step engine's timer interrupt
      */
     class Stepper : public AccelStepper
     {
@@ -46,13 +81,23 @@ namespace Mechanics
             SIXTEENTH
         };
 
-        Stepper(StepperPins pins, Resolution resolution, StepperProperties properties);
+        Stepper(StepperPins pins, Resolution resolution, StepperProperties properties, uint8_t axis);
+
+        void attach();
 
         void setResolution(Resolution resolution);
-        bool calibrate();
 
+        void startHoming(const HomingSettings &settings);
+        HomingPhase home(int64_t now_ns);
+        HomingPhase homingPhase() const { return homing_phase; }
+        bool isHoming() const { return homing_phase != HomingPhase::IDLE && homing_phase != HomingPhase::HOMED && homing_phase != HomingPhase::FAILED; }
+
+        void setSpeed(double speed);
         void setSpeeds(double speed, double acceleration);
 
+        double currentPosition();
+        void setCurrentPosition(long position);
+
         double currentPosition_mm();
         double targetPosition_mm();
 
@@ -74,7 +119,21 @@ namespace Mechanics
         double steps_per_mm;
         bool calibrated = false;
 
-        void recheckLimit();
+        uint8_t axis; //step engine axis
+        int32_t last_position = 0; //stepped position at the last update
+
+        SCurvePlanner planner;
+        bool stopped = false; //by setSpeed(0), until a new target or speed
+        long stopped_target = 0;
+
+        HomingSettings homing_settings{0, 0};
+        HomingPhase homing_phase = HomingPhase::IDLE;
+        int64_t phase_start_ns = -1; //set by the first home() call of a phase
+
+        void setHomingPhase(HomingPhase phase);
+        bool settled();
+        void refill();
+        void logPlan(StepperData &data);
     };
 
     //Singleton class for buoyancy driver
@@ -82,7 +141,9 @@ namespace Mechanics
     class Buoyancy : public Stepper
     {
     public:
-        explicit Buoyancy(StepperPins pins, Resolution resolution, StepperProperties properties) : Stepper(pins, resolution, properties) {}
+        static constexpr uint8_t AXIS = 0;
+
+        explicit Buoyancy(StepperPins pins, Resolution resolution, StepperProperties properties) : Stepper(pins, resolution, properties, AXIS) {}
         
         void sink();
         void rise();
@@ -97,23 +158,31 @@ namespace Mechanics
     class Pitch : public Stepper
     {
     public:
-        explicit Pitch(StepperPins pins, Resolution resolution, StepperProperties properties) : Stepper(pins, resolution, properties) {}
+        static constexpr uint8_t AXIS = 1;
+
+        explicit Pitch(StepperPins pins, Resolution resolution, StepperProperties properties) : Stepper(pins, resolution, properties, AXIS) {}
 
-        void runPitch(TransportManager::Commands &commands, CurrentState state, double buoyancy_position);
-        void runPitch(CurrentState state, double buoyancy_position);
+        void runPitch(TransportManager::Commands &commands, CurrentState state, long controlled_position);
+        void runPitch(CurrentState state, long controlled_position);
         
         void logToStruct(LoggedData &data);
     
     private:
+        bool manual = false; //manual_command was applied by the last runPitch
+        TransportManager::StepperCommands manual_command;
+
         void manualMode(TransportManager::Commands &commands);
-        void autoMode(CurrentState state, double buoyancy_position);
+        void autoMode(CurrentState state, long controlled_position);
     };
 
 
+    bool startStepEngine(Buoyancy &buoyancy, Pitch &pitch);
+
     void setDefaultSettings(Buoyancy &buoyancy, Pitch &pitch);
     void setDefaultSpeeds(Buoyancy &buoyancy, Pitch &pitch);
 
-    bool calibrateBoth(Buoyancy &buoyancy, Pitch &pitch);
+    void startHoming(Buoyancy &buoyancy, Pitch &pitch);
+    HomingPhase homingStatus(const Buoyancy &buoyancy, const Pitch &pitch);
 
 }
 
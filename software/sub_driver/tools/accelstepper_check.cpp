@@ -0,0 +1,441 @@
+/**
+ * @file accelstepper_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of AccelStepper's integer ramp against the floating point one it replaced
+ * @version 0.1
+ * @date 2023-05-27
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/module/AccelStepper.h"
+#include "../src/core/Timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+Each move is planned step by step through planStep, the way Stepper::refill does for the step engine,
+and through ReferenceRamp, which is AccelStepper's ramp as it was: Equation 13 in doubles, the speed
+divided out and squared on every step. Events (a new target, max speed or acceleration, stop() and
+rewindTo) happen at the same step in both.
+For the named moves, step counts and end positions have to be identical. The integer ramp truncates each
+interval to whole ns and carries the remainder, so intervals differ a little: the bounds below are what
+that costs. The random moves are only held to where they end and when, see sweep().
+Built with tools/host for Arduino.h and teensy_clock.
+*/
+
+Time::Timer scoped_timer;
+
+static constexpr double MAX_INTERVAL_ERROR = 0.005; // of the reference's interval, any one step
+static constexpr double MAX_TOTAL_ERROR = 0.001; // of the reference's move time
+static constexpr long MAX_EXTRA_STEPS = 4; // random retargeting: a reversal a step sooner or later, both ways
+static constexpr double MAX_DRIFT = 0.005; // random retargeting: any step's time against the reference's, of the move time
+static constexpr double MAX_SWEEP_TOTAL_ERROR = 0.005; // random retargeting: of the reference's move time
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+/**
+ * @brief AccelStepper's ramp before the integer rewrite
+ */
+class ReferenceRamp
+{
+public:
+    ReferenceRamp() { setAcceleration(1); }
+
+    void moveTo(long absolute)
+    {
+        if (_targetPos != absolute)
+        {
+            _targetPos = absolute;
+            computeNewSpeed();
+        }
+    }
+
+    void setMaxSpeed(double speed)
+    {
+        if (speed < 0.0)
+            speed = -speed;
+        if (_maxSpeed != speed)
+        {
+            _maxSpeed = speed;
+            _cmin = 1000000000.0 / speed;
+            if (_n > 0)
+            {
+                _n = (long)((_speed * _speed) / (2.0 * _acceleration)); // Equation 16
+                computeNewSpeed();
+            }
+        }
+    }
+
+    void setAcceleration(double acceleration)
+    {
+        if (acceleration == 0.0)
+            return;
+        if (acceleration < 0.0)
+            acceleration = -acceleration;
+        if (_acceleration != acceleration)
+        {
+            _n = _n * (_acceleration / acceleration); // Equation 17
+            _c0 = 0.676 * std::sqrt(2.0 / acceleration) * 1000000000.0; // Equation 15
+            _acceleration = acceleration;
+            computeNewSpeed();
+        }
+    }
+
+    void stop()
+    {
+        if (_speed != 0.0)
+        {
+            long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)) + 1; // Equation 16 (+integer rounding)
+            moveTo(static_cast<long>(_currentPos) + (_speed > 0 ? stepsToStop : -stepsToStop));
+        }
+    }
+
+    bool planStep(uint64_t &interval_ns, bool &direction)
+    {
+        if (!_stepInterval)
+            return false;
+
+        interval_ns = _stepInterval;
+        direction = _direction;
+        _currentPos += direction ? 1 : -1;
+        computeNewSpeed();
+        return true;
+    }
+
+    void rewindTo(long position) { _currentPos = position; }
+    long plannedPosition() const { return static_cast<long>(_currentPos); }
+
+private:
+    void computeNewSpeed()
+    {
+        double distanceTo = _targetPos - _currentPos;
+        long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)); // Equation 16
+
+        if (distanceTo == 0 && stepsToStop <= 1)
+        {
+            _stepInterval = 0;
+            _speed = 0.0;
+            _n = 0;
+            return;
+        }
+
+        if (distanceTo > 0)
+        {
+            if (_n > 0)
+            {
+                if ((stepsToStop >= distanceTo) || !_direction)
+                    _n = -stepsToStop;
+            }
+            else if (_n < 0)
+            {
+                if ((stepsToStop < distanceTo) && _direction)
+                    _n = -_n;
+            }
+        }
+        else if (distanceTo < 0)
+        {
+            if (_n > 0)
+            {
+                if ((stepsToStop >= -distanceTo) || _direction)
+                    _n = -stepsToStop;
+            }
+            else if (_n < 0)
+            {
+                if ((stepsToStop < -distanceTo) && !_direction)
+                    _n = -_n;
+            }
+        }
+
+        if (_n == 0)
+        {
+            _cn = _c0;
+            _direction = distanceTo > 0;
+        }
+        else
+        {
+            _cn = _cn - ((2.0 * _cn) / ((4.0 * _n) + 1)); // Equation 13
+            _cn = std::max(_cn, _cmin);
+        }
+        _n++;
+        _stepInterval = _cn;
+        _speed = 1000000000.0 / _cn;
+        if (!_direction)
+            _speed = -_speed;
+    }
+
+    double _currentPos = 0;
+    double _targetPos = 0;
+    double _speed = 0.0;
+    double _maxSpeed = 1.0;
+    double _acceleration = 0.0;
+    uint64_t _stepInterval = 0;
+    bool _direction = false; // true is clockwise
+    double _n = 0;
+    double _c0 = 0.0;
+    double _cn = 0.0;
+    double _cmin = 1.0;
+};
+
+/**
+ * @brief AccelStepper with the step engine's side of it opened up, like Stepper
+ */
+class PlannedStepper : public AccelStepper
+{
+public:
+    PlannedStepper() : AccelStepper(AccelStepper::DRIVER, 0, 0, 0, 0, false) {}
+
+    using AccelStepper::planStep;
+    using AccelStepper::plannedPosition;
+    using AccelStepper::rewindTo;
+};
+
+struct Event
+{
+    enum Kind
+    {
+        TARGET,
+        MAX_SPEED,
+        ACCELERATION,
+        STOP,
+        REWIND // back by value steps, as if the step engine dropped that many queued steps
+    };
+
+    long at_step;
+    Kind kind;
+    double value;
+};
+
+struct Move
+{
+    const char *name;
+    double max_speed; // steps/s
+    double acceleration; // steps/s/s
+    long target;
+    std::vector<Event> events;
+};
+
+struct Trace
+{
+    std::vector<uint64_t> intervals;
+    std::vector<bool> directions;
+    long end = 0;
+};
+
+template <typename Ramp>
+static Trace plan(Ramp &ramp, const Move &move)
+{
+    ramp.setMaxSpeed(move.max_speed);
+    ramp.setAcceleration(move.acceleration);
+    ramp.moveTo(move.target);
+
+    Trace trace;
+    uint64_t interval_ns;
+    bool direction;
+    for (long step = 0; step < 1000000; step++)
+    {
+        for (const Event &event : move.events)
+        {
+            if (event.at_step != step)
+            {
+                continue;
+            }
+            switch (event.kind)
+            {
+            case Event::TARGET:
+                ramp.moveTo(static_cast<long>(event.value));
+                break;
+            case Event::MAX_SPEED:
+                ramp.setMaxSpeed(event.value);
+                break;
+            case Event::ACCELERATION:
+                ramp.setAcceleration(event.value);
+                break;
+            case Event::STOP:
+                ramp.stop();
+                break;
+            case Event::REWIND:
+                ramp.rewindTo(ramp.plannedPosition() - static_cast<long>(event.value));
+                break;
+            }
+        }
+
+        if (!ramp.planStep(interval_ns, direction))
+        {
+            break;
+        }
+        trace.intervals.push_back(interval_ns);
+        trace.directions.push_back(direction);
+    }
+    trace.end = ramp.plannedPosition();
+    return trace;
+}
+
+/**
+ * @brief Plans a move both ways and compares them step by step
+ */
+static void compare(const Move &move, double &worst_interval, double &worst_total)
+{
+    ReferenceRamp reference;
+    Trace expected = plan(reference, move);
+    PlannedStepper stepper;
+    Trace actual = plan(stepper, move);
+
+    double interval_error = 0.0;
+    double reference_time = 0.0;
+    double time = 0.0;
+    bool same_directions = expected.directions == actual.directions;
+    for (std::size_t i = 0; i < std::min(expected.intervals.size(), actual.intervals.size()); i++)
+    {
+        const double want = static_cast<double>(expected.intervals[i]);
+        interval_error = std::fmax(interval_error, std::fabs(actual.intervals[i] - want) / want);
+        reference_time += want;
+        time += actual.intervals[i];
+    }
+    const double total_error = std::fabs(time - reference_time) / reference_time;
+
+    char what[200];
+    std::snprintf(what, sizeof(what), "%-40s %6zu steps, end %6ld, worst step %.3f%%, total %.3f%%",
+                  move.name, actual.intervals.size(), actual.end, 100.0 * interval_error, 100.0 * total_error);
+    check(actual.intervals.size() == expected.intervals.size() && actual.end == expected.end && same_directions &&
+              interval_error < MAX_INTERVAL_ERROR && total_error < MAX_TOTAL_ERROR,
+          what);
+    if (actual.intervals.size() != expected.intervals.size() || actual.end != expected.end)
+    {
+        std::printf("      reference: %zu steps, end %ld\n", expected.intervals.size(), expected.end);
+    }
+
+    worst_interval = std::fmax(worst_interval, interval_error);
+    worst_total = std::fmax(worst_total, total_error);
+}
+
+/**
+ * @brief New targets at random points of random moves, like the depth controller's setpoints
+ * Where Equation 16 lands within a fraction of a step of a whole number, the ns the integer intervals
+ * differ by can start the slow down one step earlier or later, and the ramp ends a step or two apart.
+ * So here the end positions have to match, and the step times have to stay close, not step for step
+ */
+static void sweep()
+{
+    uint32_t seed = 1;
+    auto next = [&seed](uint32_t range)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % range;
+    };
+
+    const int MOVES = 300;
+    int same_end = 0;
+    int same_steps = 0;
+    long worst_steps = 0;
+    double worst_drift = 0.0; // step time against the reference's, over the move's time
+    double worst_total = 0.0;
+    for (int i = 0; i < MOVES; i++)
+    {
+        Move move{"", 500.0 + next(15500), 100.0 + next(7900), static_cast<long>(next(54000)) - 27000, {}};
+        for (int change = 0; change < 3; change++)
+        {
+            move.events.push_back({static_cast<long>(next(20000)), Event::TARGET, static_cast<double>(next(54000)) - 27000.0});
+        }
+
+        ReferenceRamp reference;
+        Trace expected = plan(reference, move);
+        PlannedStepper stepper;
+        Trace actual = plan(stepper, move);
+
+        double reference_time = 0.0;
+        double time = 0.0;
+        double drift = 0.0;
+        for (std::size_t k = 0; k < std::min(expected.intervals.size(), actual.intervals.size()); k++)
+        {
+            reference_time += expected.intervals[k];
+            time += actual.intervals[k];
+            drift = std::fmax(drift, std::fabs(time - reference_time));
+        }
+        double reference_total = 0.0;
+        double total = 0.0;
+        for (uint64_t interval : expected.intervals)
+        {
+            reference_total += interval;
+        }
+        for (uint64_t interval : actual.intervals)
+        {
+            total += interval;
+        }
+
+        same_end += actual.end == expected.end ? 1 : 0;
+        same_steps += actual.intervals.size() == expected.intervals.size() ? 1 : 0;
+        worst_steps = std::max(worst_steps, std::labs(static_cast<long>(actual.intervals.size()) - static_cast<long>(expected.intervals.size())));
+        worst_drift = std::fmax(worst_drift, drift / reference_total);
+        worst_total = std::fmax(worst_total, std::fabs(total - reference_total) / reference_total);
+    }
+
+    std::printf("random moves: %d of %d step for step, at worst %ld steps apart\n", same_steps, MOVES, worst_steps);
+    check(same_end == MOVES, std::to_string(same_end) + " of " + std::to_string(MOVES) + " random moves with three new targets each end in the same place");
+    check(worst_steps <= MAX_EXTRA_STEPS, "at most " + std::to_string(MAX_EXTRA_STEPS) + " steps more or fewer than the reference (" + std::to_string(worst_steps) + ")");
+    char what[160];
+    std::snprintf(what, sizeof(what), "every step within %.2f%% of the move time of the reference's, moves within %.2f%% (%.3f%%, %.3f%%)",
+                  100.0 * MAX_DRIFT, 100.0 * MAX_SWEEP_TOTAL_ERROR, 100.0 * worst_drift, 100.0 * worst_total);
+    check(worst_drift < MAX_DRIFT && worst_total < MAX_SWEEP_TOTAL_ERROR, what);
+}
+
+int main()
+{
+    double worst_interval = 0.0;
+    double worst_total = 0.0;
+
+    //Short and long moves over the carriages' range, in both directions
+    for (double max_speed : {800.0, 4000.0, 16000.0})
+    {
+        for (double acceleration : {100.0, 1000.0, 8000.0})
+        {
+            for (long target : {10L, 200L, -3000L, 27000L})
+            {
+                char name[64];
+                std::snprintf(name, sizeof(name), "%g/s, %g/s/s, to %ld", max_speed, acceleration, target);
+                compare({name, max_speed, acceleration, target, {}}, worst_interval, worst_total);
+            }
+        }
+    }
+
+    const std::vector<Move> changes = {
+        {"max speed up while cruising", 1000.0, 2000.0, 20000, {{3000, Event::MAX_SPEED, 3000.0}}},
+        {"max speed down while cruising", 3000.0, 2000.0, 20000, {{6000, Event::MAX_SPEED, 1000.0}}},
+        {"max speed up while accelerating", 4000.0, 500.0, 20000, {{200, Event::MAX_SPEED, 8000.0}}},
+        {"acceleration up while accelerating", 4000.0, 500.0, 20000, {{300, Event::ACCELERATION, 2000.0}}},
+        {"acceleration down while decelerating", 2000.0, 2000.0, 5000, {{4500, Event::ACCELERATION, 500.0}}},
+        {"target further while decelerating", 2000.0, 1000.0, 5000, {{4200, Event::TARGET, 9000.0}}},
+        {"target behind at speed", 2000.0, 1000.0, 10000, {{4000, Event::TARGET, 1000.0}}},
+        {"target nearer than the stop distance", 4000.0, 1000.0, 20000, {{5000, Event::TARGET, 5100.0}}},
+        {"stop() while accelerating", 4000.0, 1000.0, 20000, {{1000, Event::STOP, 0.0}}},
+        {"stop(), rewind, then a new target", 2000.0, 1000.0, 20000,
+         {{3000, Event::STOP, 0.0}, {5000, Event::REWIND, 120.0}, {5000, Event::TARGET, 0.0}}},
+        {"rewind while stopped, same target", 2000.0, 1000.0, 3000, {{4000, Event::REWIND, 500.0}, {4000, Event::TARGET, 2900.0}}},
+    };
+    for (const Move &move : changes)
+    {
+        compare(move, worst_interval, worst_total);
+    }
+    std::printf("worst step interval %.3f%% (limit %.1f%%), worst move time %.3f%% (limit %.1f%%)\n",
+                100.0 * worst_interval, 100.0 * MAX_INTERVAL_ERROR, 100.0 * worst_total, 100.0 * MAX_TOTAL_ERROR);
+    sweep();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file analog_conversion_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of the compile time conversion tables against the closed form conversions they replaced
+ * @version 0.1
+ * @date 2023-05-28
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/Sensors/AnalogConversions.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+/*
+Every ADC code, and every half code between them since oversampled channels read fractions, goes
+through each table and through the closed form the sensor classes used before the tables, with std::log
+and doubles. The worst errors have to be within the ones stated in AnalogConversions.h.
+The TDS table is read at what the compensation makes of each code, for water at 0, 25 and 35 C.
+*/
+
+using namespace Conversion;
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+static constexpr double FULL_SCALE = Analog::AnalogScan::FULL_SCALE;
+static constexpr double HALF_CODES = 2.0 * FULL_SCALE; // steps of the sweep
+
+/**
+ * @brief Thermistor::readRaw before the table: the divider solved for RT, then the B equation
+ */
+static double closedThermistor(double counts)
+{
+    const double RT0 = 10000.0;
+    double VRT = counts / FULL_SCALE * VREF;
+    double VR = VREF - VRT;
+    double RT = VRT / (VR / RT0);
+    return 1.0 / (std::log(RT / RT0) / THERMISTOR_B + 1.0 / (THERMISTOR_T0 + 273.15)) - 273.15;
+}
+
+/**
+ * @brief TotalDissolvedSolids::readRaw before the table
+ */
+static double closedTds(double volts)
+{
+    return (133.42 * volts * volts * volts - 255.86 * volts * volts + 857.39 * volts) * 0.5;
+}
+
+/**
+ * @brief Transducer::readRaw before the gain and offset
+ */
+static double closedTransducer(double counts)
+{
+    double voltage = counts / FULL_SCALE * VREF;
+    double psi = (100.0 / 3.0) * voltage + (50.0 - ((100.0 / 3.0) * (3.3 / 2.0)));
+    return psi / 14.695948775510204081632653061224;
+}
+
+/**
+ * @brief In water, and over what the thermistor is rated for
+ */
+static void checkThermistor()
+{
+    double worst_in_water = 0.0;
+    double worst = 0.0;
+    double worst_at = 0.0;
+    for (int step = 1; step < HALF_CODES; step++) // not the rails, where RT is 0 or infinite
+    {
+        double counts = step / 2.0;
+        double expected = closedThermistor(counts);
+        double error = std::fabs(THERMISTOR_CELSIUS(static_cast<float>(counts)) - expected);
+        if (expected >= THERMISTOR_WATER_MIN && expected <= THERMISTOR_WATER_MAX)
+        {
+            worst_in_water = std::fmax(worst_in_water, error);
+        }
+        if (expected >= THERMISTOR_RATED_MIN && expected <= THERMISTOR_RATED_MAX && error > worst)
+        {
+            worst = error;
+            worst_at = expected;
+        }
+    }
+
+    char what[160];
+    std::snprintf(what, sizeof(what), "thermistor within %.4f C from %.0f to %.0f C (%.5f C)",
+                  THERMISTOR_MAX_ERROR, THERMISTOR_WATER_MIN, THERMISTOR_WATER_MAX, worst_in_water);
+    check(worst_in_water <= THERMISTOR_MAX_ERROR, what);
+    std::snprintf(what, sizeof(what), "thermistor within %.2f C from %.0f to %.0f C (%.3f C at %.1f C)",
+                  THERMISTOR_MAX_ERROR_RATED, THERMISTOR_RATED_MIN, THERMISTOR_RATED_MAX, worst, worst_at);
+    check(worst <= THERMISTOR_MAX_ERROR_RATED, what);
+}
+
+/**
+ * @brief TDS_PPM against the cubic
+ */
+static void checkTds()
+{
+    const double water[] = {0.0, 25.0, 35.0};
+    double worst = 0.0;
+    for (double temperature : water)
+    {
+        double coefficient = 1.0 + 0.02 * (temperature - STANDARD_TEMP);
+        for (int step = 0; step <= HALF_CODES; step++)
+        {
+            double volts = step / 2.0 * VOLTS_PER_COUNT / coefficient;
+            worst = std::fmax(worst, std::fabs(TDS_PPM(static_cast<float>(volts)) - closedTds(volts)));
+        }
+    }
+
+    char what[160];
+    std::snprintf(what, sizeof(what), "TDS within %.2f ppm in water from 0 to 35 C (%.4f ppm)", TDS_MAX_ERROR, worst);
+    check(worst <= TDS_MAX_ERROR, what);
+}
+
+/**
+ * @brief The transducer's folded gain and offset against the formula it came from
+ */
+static void checkLinear()
+{
+    double worst = 0.0;
+    for (int step = 0; step <= HALF_CODES; step++)
+    {
+        double counts = step / 2.0;
+        worst = std::fmax(worst, std::fabs(counts * TRANSDUCER_ATM_PER_COUNT + TRANSDUCER_ATM_OFFSET - closedTransducer(counts)));
+    }
+
+    char what[160];
+    std::snprintf(what, sizeof(what), "transducer gain and offset within %.0e atm (%.1e atm)", TRANSDUCER_MAX_ERROR, worst);
+    check(worst <= TRANSDUCER_MAX_ERROR, what);
+}
+
+/**
+ * @brief The constexpr log the tables are built with, from the smallest divider ratio to the largest
+ */
+static void checkLog()
+{
+    double worst = 0.0;
+    for (double x = 1e-4; x < 1e4; x *= 1.001)
+    {
+        worst = std::fmax(worst, std::fabs(Conversion::log(x) - std::log(x)));
+    }
+
+    char what[160];
+    std::snprintf(what, sizeof(what), "Conversion::log within 1e-12 of std::log (%.1e)", worst);
+    check(worst <= 1e-12, what);
+}
+
+int main()
+{
+    checkThermistor();
+    checkTds();
+    checkLinear();
+    checkLog();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
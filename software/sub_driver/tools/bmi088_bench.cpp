@@ -0,0 +1,182 @@
+/**
+ * @file bmi088_bench.cpp
+ * @author Daniel Kim
+ * @brief Host benchmark of the BMI088 accel's fast and slow reads against a mocked bus
+ * @version 0.1
+ * @date 2023-05-24
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <Wire.h>
+
+#include "../src/Sensors/BMI088/BMI088.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+/*
+The driver runs against tools/host's Wire, a register map that counts register accesses and bytes.
+Bus traffic: a sample used to be the data burst plus a temperature read, now it's the data and sensor
+time burst alone, with the temperature read from the scheduler at 1 Hz.
+Conversion: the tX/tY/tZ matrices with double math that readSensor used to do, against
+Bmi088Fifo::toBody. The results have to match over the whole int16 range.
+Times are from this computer. The M7's single precision FPU makes the float path count for more there.
+*/
+
+TwoWire Wire;
+
+static constexpr uint8_t ACCEL_ADDRESS = 0x18;
+static constexpr uint8_t ACC_ACCEL_DATA_ADDR = 0x12;
+static constexpr double G = 9.80665;
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+//What readSensor did before the split
+static const int16_t tX[3] = {1, 0, 0};
+static const int16_t tY[3] = {0, -1, 0};
+static const int16_t tZ[3] = {0, 0, -1};
+
+static void matrixToBody(const int16_t accel[3], double range, double body[3])
+{
+    body[0] = (double)(accel[0] * tX[0] + accel[1] * tX[1] + accel[2] * tX[2]) / 32768.0 * range;
+    body[1] = (double)(accel[0] * tY[0] + accel[1] * tY[1] + accel[2] * tY[2]) / 32768.0 * range;
+    body[2] = (double)(accel[0] * tZ[0] + accel[1] * tZ[1] + accel[2] * tZ[2]) / 32768.0 * range;
+}
+
+static void setSample(int16_t x, int16_t y, int16_t z)
+{
+    const int16_t values[3] = {x, y, z};
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        Wire.registers[ACC_ACCEL_DATA_ADDR + 2 * i] = static_cast<uint8_t>(values[i] & 0xFF);
+        Wire.registers[ACC_ACCEL_DATA_ADDR + 2 * i + 1] = static_cast<uint8_t>((values[i] >> 8) & 0xFF);
+    }
+}
+
+/**
+ * @brief Register accesses and bytes per sample, before and after
+ */
+static void checkTraffic(Bmi088Accel &accel)
+{
+    Wire.transactions = 0;
+    Wire.bytes = 0;
+    accel.readSensor();
+    accel.readTemperature();
+    const long before_transactions = Wire.transactions;
+    const long before_bytes = Wire.bytes;
+
+    Wire.transactions = 0;
+    Wire.bytes = 0;
+    accel.readSensor();
+    const long transactions = Wire.transactions;
+    const long bytes = Wire.bytes;
+
+    std::printf("per sample: before %ld transactions %ld bytes, fast path %ld transactions %ld bytes\n",
+                before_transactions, before_bytes, transactions, bytes);
+    check(transactions == 1 && bytes == 10, "fast path is one burst: register address, data and sensor time");
+    check(transactions * 2 == before_transactions, "half the transactions per sample");
+}
+
+/**
+ * @brief toBody and the driver give what the matrices gave, within float precision
+ */
+static void checkRemap(Bmi088Accel &accel)
+{
+    const double range = 3.0 * G;
+    const float scale = static_cast<float>(range / 32768.0);
+
+    double worst = 0.0;
+    for (int32_t value = -32768; value <= 32767; value++)
+    {
+        const int16_t raw[3] = {static_cast<int16_t>(value), static_cast<int16_t>(-1 - value), static_cast<int16_t>(value / 3)};
+        double expected[3];
+        matrixToBody(raw, range, expected);
+
+        Bmi088Fifo::RawFrame frame;
+        frame.x = raw[0];
+        frame.y = raw[1];
+        frame.z = raw[2];
+        float body[3];
+        Bmi088Fifo::toBody(frame, scale, body);
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            worst = std::fmax(worst, std::fabs(body[i] - expected[i]));
+        }
+    }
+    check(worst < 1e-5 * range, "toBody matches the matrices over the int16 range (" + std::to_string(worst) + " m/s/s worst)");
+
+    setSample(1234, -32768, 500);
+    accel.readSensor();
+    const int16_t raw[3] = {1234, -32768, 500};
+    double expected[3];
+    matrixToBody(raw, range, expected);
+    check(std::fabs(accel.getAccelX_mss() - expected[0]) < 1e-5 && std::fabs(accel.getAccelY_mss() - expected[1]) < 1e-5 &&
+              std::fabs(accel.getAccelZ_mss() - expected[2]) < 1e-5,
+          "driver reads and remaps a sample through the bus, -32768 included");
+}
+
+/**
+ * @brief Conversion cost per sample
+ */
+static void timeConversion()
+{
+    const int N = 10000000;
+    const double range = 3.0 * G;
+    const float scale = static_cast<float>(range / 32768.0);
+
+    volatile double double_sink = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < N; n++)
+    {
+        const int16_t raw[3] = {static_cast<int16_t>(n), static_cast<int16_t>(n >> 3), static_cast<int16_t>(-n)};
+        double body[3];
+        matrixToBody(raw, range, body);
+        double_sink = double_sink + body[0] + body[1] + body[2];
+    }
+    auto middle = std::chrono::steady_clock::now();
+
+    volatile float float_sink = 0.0f;
+    for (int n = 0; n < N; n++)
+    {
+        Bmi088Fifo::RawFrame frame;
+        frame.x = static_cast<int16_t>(n);
+        frame.y = static_cast<int16_t>(n >> 3);
+        frame.z = static_cast<int16_t>(-n);
+        float body[3];
+        Bmi088Fifo::toBody(frame, scale, body);
+        float_sink = float_sink + body[0] + body[1] + body[2];
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    std::printf("conversion: matrices/double %.2f ns, toBody/float %.2f ns per sample\n",
+                std::chrono::duration<double, std::nano>(middle - start).count() / N,
+                std::chrono::duration<double, std::nano>(end - middle).count() / N);
+}
+
+int main()
+{
+    Bmi088Accel accel(Wire, ACCEL_ADDRESS);
+    accel.setRange(Bmi088Accel::RANGE_3G);
+
+    checkTraffic(accel);
+    checkRemap(accel);
+    timeConversion();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
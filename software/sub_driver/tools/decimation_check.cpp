@@ -0,0 +1,261 @@
+/**
+ * @file decimation_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of the transducer's decimation chain: DC gain, passband, stopband and DELAY
+ * @version 0.1
+ * @date 2023-05-26
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/Sensors/Decimator.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+Transducer::Decimator is DecimationChain<3, 32, 2, 11>: about 9 kHz of scan frames down to 70 Hz.
+Sines of 1000 counts around mid scale go through it. In the passband a sine at the input frequency is fitted
+to the output, with output times moved back by DELAY, which gives the gain and what phase is left after
+the delay. Above the output's Nyquist a tone aliases, so there the gain is the output's rms at any frequency.
+Limits are what the depth loop needs: flat to 10 Hz, and whatever would alias onto that band well down.
+*/
+
+using Chain = Filter::DecimationChain<3, 32, 2, 11>; // Transducer::Decimator
+
+static constexpr double FS = 9000.0; // scan frames per second
+static constexpr double FO = FS / Chain::RATIO;
+static constexpr double AMPLITUDE = 1000.0; // counts
+static constexpr double MID_SCALE = 2048.0;
+static constexpr double PASSBAND = 10.0; // Hz
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+struct Response
+{
+    double gain_db; // fitted at the input frequency
+    double any_db; // output rms at any frequency, against the input's
+    double phase_deg; // left after taking DELAY out
+};
+
+static Response measure(double f)
+{
+    Chain chain;
+    std::vector<float> out;
+    std::vector<double> times;
+    const int N = Chain::RATIO * 600;
+    for (int i = 0; i < N; i++)
+    {
+        uint32_t x = static_cast<uint32_t>(std::lround(MID_SCALE + AMPLITUDE * std::sin(2.0 * M_PI * f * i / FS)));
+        float y;
+        if (chain.push(x, y))
+        {
+            out.push_back(y);
+            times.push_back((i - Chain::DELAY) / FS);
+        }
+    }
+
+    //Least squares fit of a sine, a cosine and an offset over the second half, the filters have settled by then
+    double m[3][4] = {};
+    double power = 0.0;
+    double mean = 0.0;
+    int n = 0;
+    for (std::size_t k = out.size() / 2; k < out.size(); k++)
+    {
+        const double basis[3] = {std::sin(2.0 * M_PI * f * times[k]), std::cos(2.0 * M_PI * f * times[k]), 1.0};
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                m[r][c] += basis[r] * basis[c];
+            }
+            m[r][3] += basis[r] * out[k];
+        }
+        mean += out[k];
+        power += static_cast<double>(out[k]) * out[k];
+        n++;
+    }
+    mean /= n;
+    power = power / n - mean * mean;
+
+    for (int pivot = 0; pivot < 3; pivot++) //Gauss-Jordan, the normal equations are well conditioned
+    {
+        for (int r = 0; r < 3; r++)
+        {
+            if (r != pivot)
+            {
+                double factor = m[r][pivot] / m[pivot][pivot];
+                for (int c = pivot; c < 4; c++)
+                {
+                    m[r][c] -= factor * m[pivot][c];
+                }
+            }
+        }
+    }
+    const double in_phase = m[0][3] / m[0][0];
+    const double quadrature = m[1][3] / m[1][1];
+
+    Response response;
+    response.gain_db = 20.0 * std::log10(std::hypot(in_phase, quadrature) / AMPLITUDE + 1e-12);
+    response.any_db = 20.0 * std::log10(std::sqrt(2.0 * power) / AMPLITUDE + 1e-12);
+    response.phase_deg = std::atan2(quadrature, in_phase) * 180.0 / M_PI;
+    return response;
+}
+
+/**
+ * @brief Constant inputs come out unchanged, across the whole 12 bit range
+ */
+static void checkDcGain()
+{
+    double worst = 0.0;
+    for (uint32_t level : {0u, 1u, 2048u, 4095u})
+    {
+        Chain chain;
+        float y = 0.0f;
+        for (uint32_t i = 0; i < Chain::RATIO * 20; i++)
+        {
+            chain.push(level, y);
+        }
+        worst = std::fmax(worst, std::fabs(y - static_cast<double>(level)));
+    }
+    check(worst < 1e-3, "DC gain 1 from 0 to 4095 counts (" + std::to_string(worst) + " counts off)");
+}
+
+static void checkPassband()
+{
+    double flattest = 0.0;
+    double worst_phase = 0.0;
+    for (double f : {0.5, 1.0, 2.0, 5.0, PASSBAND})
+    {
+        Response response = measure(f);
+        flattest = std::fmax(flattest, std::fabs(response.gain_db));
+        worst_phase = std::fmax(worst_phase, std::fabs(response.phase_deg));
+    }
+    check(flattest < 0.2, "within 0.2 dB to 10 Hz (" + std::to_string(flattest) + " dB)");
+    check(worst_phase < 0.1, "DELAY accounts for the phase to 10 Hz (" + std::to_string(worst_phase) + " degrees left)");
+
+    //The -3 dB point, by bisection
+    double low = PASSBAND;
+    double high = FO / 2.0;
+    for (int i = 0; i < 20; i++)
+    {
+        double mid = 0.5 * (low + high);
+        (measure(mid).gain_db > -3.0103 ? low : high) = mid;
+    }
+    check(low > 25.0 && low < FO / 2.0, "-3 dB at " + std::to_string(low) + " Hz, below the output's Nyquist");
+}
+
+/**
+ * @brief What aliases onto the passband: within PASSBAND of a multiple of the output rate
+ * Tones that alias into the transition band (e.g. 100 Hz onto 29.7 Hz) are only printed
+ */
+static void checkStopband()
+{
+    double first = -1e9; // around the output rate
+    double rest = -1e9;
+    for (int k = 1; k <= 63; k++)
+    {
+        for (double offset = -PASSBAND; offset <= PASSBAND; offset += 2.5)
+        {
+            double db = measure(k * FO + offset).any_db;
+            (k == 1 ? first : rest) = std::fmax(k == 1 ? first : rest, db);
+        }
+    }
+    check(first < -45.0, "at least 45 dB down within 10 Hz of 70.3 Hz (" + std::to_string(first) + " dB worst)");
+    check(rest < -70.0, "at least 70 dB down within 10 Hz of its multiples (" + std::to_string(rest) + " dB worst)");
+
+    for (double f : {100.0, 200.0, 1000.0})
+    {
+        std::printf("      %.0f Hz comes out %.1f dB down\n", f, -measure(f).any_db);
+    }
+}
+
+/**
+ * @brief A step crosses half way DELAY samples after it went in, since the chain is linear phase
+ */
+static void checkDelay()
+{
+    check(Chain::DELAY == 526.5, "DELAY is " + std::to_string(Chain::DELAY) + " frames, " + std::to_string(Chain::DELAY / FS * 1e3) + " ms");
+
+    //Step at several offsets against the output grid: interpolate the half way crossing between outputs
+    double worst = 0.0;
+    for (uint32_t offset = 0; offset < Chain::RATIO; offset += 16)
+    {
+        Chain chain;
+        const uint32_t step_at = Chain::RATIO * 20 + offset;
+        double previous_y = 0.0;
+        double previous_i = 0.0;
+        double crossing = -1.0;
+        for (uint32_t i = 0; i < step_at + 4 * Chain::DELAY && crossing < 0.0; i++)
+        {
+            float y;
+            if (chain.push(i < step_at ? 1000u : 3000u, y))
+            {
+                if (previous_y < 2000.0 && y >= 2000.0)
+                {
+                    crossing = previous_i + (2000.0 - previous_y) / (y - previous_y) * (i - previous_i);
+                }
+                previous_y = y;
+                previous_i = i;
+            }
+        }
+        worst = std::fmax(worst, std::fabs(crossing - step_at - Chain::DELAY + 0.5)); //the step lands between step_at - 1 and step_at
+    }
+    check(worst < Chain::RATIO / 8.0, "step response crosses half way DELAY after the step (" + std::to_string(worst) + " frames off at worst)");
+}
+
+/**
+ * @brief Uncorrelated noise drops by more than the square root of the ratio
+ */
+static void checkNoise()
+{
+    Chain chain;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    int n = 0;
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < Chain::RATIO * 2000; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        double v = 2000.3 + ((seed >> 8) / 16777216.0 - 0.5) * 8.0; // uniform over 8 counts
+        float y;
+        if (chain.push(static_cast<uint32_t>(std::lround(v)), y) && i > Chain::RATIO * 20)
+        {
+            sum += y;
+            sum_sq += y * y;
+            n++;
+        }
+    }
+    double mean = sum / n;
+    double rms = std::sqrt(sum_sq / n - mean * mean);
+    double in_rms = 8.0 / std::sqrt(12.0);
+    check(rms < in_rms / std::sqrt(static_cast<double>(Chain::RATIO)), "noise " + std::to_string(in_rms) + " counts rms in, " + std::to_string(rms) + " out");
+}
+
+int main()
+{
+    std::printf("ratio %u, %.1f Hz out of %.0f Hz\n", Chain::RATIO, FO, FS);
+
+    checkDcGain();
+    checkPassband();
+    checkStopband();
+    checkDelay();
+    checkNoise();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file dive_model.cpp
+ * @author Daniel Kim
+ * @brief Host model of the vehicle for tuning and checking the depth and pitch controller
+ * @version 0.1
+ * @date 2023-05-18
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/module/DepthControl.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+/*
+Vertical: ballast force from the buoyancy carriage's offset from the true neutral (which is 1500 half
+steps away from the controller's idea of it), quadratic drag that grows with pitch, 20 kg.
+Pitch: a damped pendulum towards the angle the pitch carriage sets.
+Carriages move at the default stepper speeds. Depth and pitch readings get gaussian noise.
+The target is a 2-22 m yo-yo sampled once a second, like the HITL provider's.
+
+    dive_model                  runs the committed gains, prints a summary, exits non-zero past the limits below
+    dive_model trace            the same, printing the state every 10 s
+    dive_model sweep            grid search over the depth gains, feed forward and deadband
+    dive_model kp ki kd ff pkp pki pkd deadband
+*/
+
+using namespace Control;
+
+//configuration.h
+static const PIDGains DEPTH_GAINS{2000, 20, 2000};
+static const PIDGains PITCH_GAINS{100, 20, 50};
+static constexpr double FEED_FORWARD = 10000;
+static constexpr double PITCH_PER_BUOYANCY = 0.002;
+static constexpr long DEADBAND = 400;
+
+//Carriages as controlSettings() lays them out: half steps from the switches, switch end heavy and nose down
+static constexpr long BUOYANCY_LENGTH = 27000;
+static constexpr long PITCH_LENGTH = 10850;
+static constexpr long SWITCH_MARGIN = 200;
+static constexpr double BUOYANCY_SPEED = 800; // half steps/s
+static constexpr double PITCH_SPEED = 1000;
+
+//Limits for the committed gains
+static constexpr double MAX_RMS_ERROR = 1.0; // m
+static constexpr double MAX_STEP_OVERSHOOT = 2.0; // m, 0.8 of it is there with no integral at all
+
+struct Result
+{
+    double rms = 0.0; // depth error after the first 100 s, m
+    double max_error = 0.0;
+    double max_depth = 0.0;
+    double pitch_rms = 0.0; // against the controller's setpoint, degrees
+    double buoyancy_travel = 0.0; // half steps
+    double pitch_travel = 0.0;
+    int buoyancy_moves = 0; // commands that got past the deadband
+};
+
+static double yoyo(double t)
+{
+    t = std::floor(t);
+    double u = std::fmod(t, 400.0);
+    if (u < 100)
+    {
+        return 2.0 + 0.2 * u;
+    }
+    if (u < 200)
+    {
+        return 22.0;
+    }
+    if (u < 300)
+    {
+        return 22.0 - 0.2 * (u - 200);
+    }
+    return 2.0;
+}
+
+static ControlSettings settings(double feed_forward, long deadband)
+{
+    ControlSettings s;
+    s.period = 0.2;
+    s.buoyancy_min = -BUOYANCY_LENGTH;
+    s.buoyancy_max = -SWITCH_MARGIN;
+    s.buoyancy_neutral = -BUOYANCY_LENGTH / 2;
+    s.pitch_min = -PITCH_LENGTH;
+    s.pitch_max = -SWITCH_MARGIN;
+    s.pitch_neutral = -PITCH_LENGTH / 2;
+    s.buoyancy_per_rate = feed_forward;
+    s.pitch_per_buoyancy = PITCH_PER_BUOYANCY;
+    s.max_pitch = 25;
+    s.target_rate_time_constant = 5.0;
+    s.deadband = deadband;
+    return s;
+}
+
+static double stepTowards(double position, double target, double max_step, double &travel)
+{
+    double step = target - position;
+    step = step > max_step ? max_step : (step < -max_step ? -max_step : step);
+    travel += std::fabs(step);
+    return position + step;
+}
+
+/**
+ * @brief Runs the model
+ *
+ * @param target target depth over time
+ * @param true_neutral where the buoyancy carriage actually balances the vehicle
+ */
+static Result run(double (*target)(double), double duration, const PIDGains &depth_gains, const PIDGains &pitch_gains,
+                  double feed_forward, long deadband, long true_neutral, bool trace)
+{
+    const ControlSettings s = settings(feed_forward, deadband);
+    DepthPitchController controller(s);
+    controller.setDepthGains(depth_gains);
+    controller.setPitchGains(pitch_gains);
+
+    std::mt19937 random(1);
+    std::normal_distribution<double> depth_noise(0.0, 0.02);
+    std::normal_distribution<double> pitch_noise(0.0, 0.5);
+
+    const double dt = 0.01;
+    const double ballast_per_step = 2.45 / BUOYANCY_LENGTH; // N
+    const double mass = 20.0;
+    const double drag = 0.5 * 1025.0 * 0.01; // rho * Cd * A / 2
+    const double degrees_per_step = 30.0 / (PITCH_LENGTH / 2);
+    const long true_pitch_neutral = -PITCH_LENGTH / 2 + 425;
+    const double pitch_wn = 1.0;
+    const double pitch_zeta = 0.3;
+
+    double depth = target(0.0);
+    double velocity = 0.0;
+    double pitch = 0.0;
+    double pitch_rate = 0.0;
+    double buoyancy_position = s.buoyancy_neutral;
+    double pitch_position = s.pitch_neutral;
+
+    Result result;
+    double error_sum = 0.0;
+    double pitch_error_sum = 0.0;
+    long samples = 0;
+    long last_command = s.buoyancy_neutral;
+    double next_update = 0.0;
+
+    for (double t = 0.0; t < duration; t += dt)
+    {
+        if (t >= next_update)
+        {
+            next_update += s.period;
+
+            ControlInput input;
+            input.depth = depth + depth_noise(random);
+            input.pitch = pitch + pitch_noise(random);
+            input.target_depth = target(t);
+            const ControlOutput &output = controller.update(input);
+
+            if (output.buoyancy_position != last_command)
+            {
+                result.buoyancy_moves++;
+                last_command = output.buoyancy_position;
+            }
+
+            if (t > 100.0)
+            {
+                double error = depth - target(t);
+                error_sum += error * error;
+                pitch_error_sum += (pitch - output.pitch_setpoint) * (pitch - output.pitch_setpoint);
+                samples++;
+                result.max_error = std::fmax(result.max_error, std::fabs(error));
+            }
+
+            if (trace && std::fmod(t, 10.0) < s.period)
+            {
+                std::printf("%7.1f s  target %6.2f  depth %6.2f  rate %5.2f  ballast %7.0f  pitch %5.1f (%5.1f)  carriage %6.0f\n",
+                            t, target(t), depth, velocity, buoyancy_position, pitch, output.pitch_setpoint, pitch_position);
+            }
+        }
+
+        const ControlOutput &output = controller.output();
+        buoyancy_position = stepTowards(buoyancy_position, output.buoyancy_position, BUOYANCY_SPEED * dt, result.buoyancy_travel);
+        pitch_position = stepTowards(pitch_position, output.pitch_position, PITCH_SPEED * dt, result.pitch_travel);
+
+        //Heavier towards the switch end, drag grows as the hull tilts
+        double force = ballast_per_step * (buoyancy_position - true_neutral) - drag * velocity * std::fabs(velocity) * (1.0 + std::fabs(std::sin(pitch * M_PI / 180.0)));
+        velocity += force / mass * dt;
+        depth += velocity * dt;
+        if (depth < 0.0)
+        {
+            depth = 0.0;
+            velocity = 0.0;
+        }
+        result.max_depth = std::fmax(result.max_depth, depth);
+
+        double pitch_equilibrium = -degrees_per_step * (pitch_position - true_pitch_neutral);
+        double pitch_acceleration = -pitch_wn * pitch_wn * (pitch - pitch_equilibrium) - 2.0 * pitch_zeta * pitch_wn * pitch_rate;
+        pitch_rate += pitch_acceleration * dt;
+        pitch += pitch_rate * dt;
+    }
+
+    result.rms = std::sqrt(error_sum / samples);
+    result.pitch_rms = std::sqrt(pitch_error_sum / samples);
+    return result;
+}
+
+static void print(const char *name, const Result &result)
+{
+    std::printf("%-8s depth rms %.3f m, max %.2f m, pitch rms %.2f deg, ballast travel %.0f in %d moves, pitch travel %.0f\n",
+                name, result.rms, result.max_error, result.pitch_rms, result.buoyancy_travel, result.buoyancy_moves, result.pitch_travel);
+}
+
+/**
+ * @brief An 18 m step: the ballast sits at its limit for most of the descent
+ * An integral that kept growing through that would carry the vehicle well past the new target
+ */
+static double deepStep(double t)
+{
+    return t < 100.0 ? 2.0 : 20.0;
+}
+
+int main(int argc, char *argv[])
+{
+    const long true_neutral = -BUOYANCY_LENGTH / 2 + 1500;
+
+    if (argc > 1 && std::strcmp(argv[1], "sweep") == 0)
+    {
+        double best = 1e9;
+        for (double kp : {1000.0, 2000.0, 3000.0, 5000.0})
+            for (double ki : {0.0, 20.0, 50.0, 100.0})
+                for (double kd : {2000.0, 5000.0, 10000.0})
+                    for (double ff : {0.0, 5000.0, 10000.0})
+                        for (long deadband : {150L, 300L, 400L, 500L})
+                        {
+                            Result result = run(yoyo, 1600.0, {kp, ki, kd}, PITCH_GAINS, ff, deadband, true_neutral, false);
+                            double score = result.rms + result.buoyancy_travel / 2e6;
+                            if (score < best)
+                            {
+                                best = score;
+                                std::printf("kp %g ki %g kd %g ff %g deadband %ld: ", kp, ki, kd, ff, deadband);
+                                print("", result);
+                            }
+                        }
+        return 0;
+    }
+
+    if (argc > 8)
+    {
+        PIDGains depth_gains{std::atof(argv[1]), std::atof(argv[2]), std::atof(argv[3])};
+        PIDGains pitch_gains{std::atof(argv[5]), std::atof(argv[6]), std::atof(argv[7])};
+        print("yoyo", run(yoyo, 1600.0, depth_gains, pitch_gains, std::atof(argv[4]), std::atol(argv[8]), true_neutral, false));
+        return 0;
+    }
+
+    bool trace = argc > 1 && std::strcmp(argv[1], "trace") == 0;
+    Result yoyo_result = run(yoyo, 1600.0, DEPTH_GAINS, PITCH_GAINS, FEED_FORWARD, DEADBAND, true_neutral, trace);
+    print("yoyo", yoyo_result);
+
+    Result step = run(deepStep, 600.0, DEPTH_GAINS, PITCH_GAINS, FEED_FORWARD, DEADBAND, true_neutral, false);
+    print("step", step);
+    std::printf("         deepest %.2f m for a 20 m target\n", step.max_depth);
+
+    bool passed = yoyo_result.rms < MAX_RMS_ERROR && step.max_depth < 20.0 + MAX_STEP_OVERSHOOT;
+    std::printf("%s\n", passed ? "All passed" : "Failed");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file Arduino.h
+ * @author Daniel Kim
+ * @brief Just enough of the Arduino core to build drivers on the host
+ * @version 0.1
+ * @date 2023-05-24
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#define F(x) x
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+inline unsigned long millis() { return 0; }
+inline unsigned long micros() { return 0; }
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) { return value < low ? low : (value > high ? high : value); }
+
+struct HostSerial
+{
+    template <typename T> void print(T) {}
+    template <typename T> void println(T) {}
+    void println() {}
+};
+static HostSerial Serial __attribute__((unused));
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file SPI.h
+ * @author Daniel Kim
+ * @brief SPI stand-in for building sensor drivers on the host. Transfers read back zero
+ * @version 0.1
+ * @date 2023-05-24
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include "Arduino.h"
+
+struct SPISettings
+{
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+struct SPIClass
+{
+    void begin() {}
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t) { return 0; }
+};
+
+#endif
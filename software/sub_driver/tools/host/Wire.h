@@ -0,0 +1,79 @@
+/**
+ * @file Wire.h
+ * @author Daniel Kim
+ * @brief Wire stand-in for building sensor drivers on the host: one device's register map, with auto increment
+ * Counts transactions and bytes so tools can measure a driver's bus traffic
+ * @version 0.1
+ * @date 2023-05-24
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+struct TwoWire
+{
+    uint8_t registers[256] = {};
+    uint8_t auto_increment_bit = 0; // register address bits the device ignores, e.g. 0x80 on the LIS3MDL
+
+    long transactions = 0; // endTransmission calls, one per register access
+    long bytes = 0; // register addresses, data written and data read
+
+    void begin() {}
+    void setClock(uint32_t) {}
+
+    void beginTransmission(uint8_t) { m_address_phase = true; }
+
+    size_t write(uint8_t value)
+    {
+        bytes++;
+        if (m_address_phase)
+        {
+            m_pointer = value & ~auto_increment_bit;
+            m_address_phase = false;
+        }
+        else
+        {
+            registers[m_pointer++] = value;
+        }
+        return 1;
+    }
+
+    uint8_t endTransmission(bool = true)
+    {
+        transactions++;
+        return 0;
+    }
+
+    uint8_t requestFrom(uint8_t, uint8_t length, bool = true)
+    {
+        bytes += length;
+        m_available = length;
+        return length;
+    }
+
+    int available() { return m_available; }
+
+    int read()
+    {
+        if (m_available == 0)
+        {
+            return -1;
+        }
+        m_available--;
+        return registers[m_pointer++];
+    }
+
+private:
+    bool m_address_phase = true;
+    uint8_t m_pointer = 0;
+    int m_available = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
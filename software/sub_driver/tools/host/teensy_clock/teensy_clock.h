@@ -0,0 +1,32 @@
+/**
+ * @file teensy_clock.h
+ * @author Daniel Kim
+ * @brief teensy_clock on the host: steady_clock in nanoseconds
+ * @version 0.1
+ * @date 2023-05-27
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#ifndef HOST_TEENSY_CLOCK_H
+#define HOST_TEENSY_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+struct teensy_clock
+{
+    using rep = int64_t;
+    using period = std::nano;
+    using duration = std::chrono::duration<rep, period>;
+    using time_point = std::chrono::time_point<teensy_clock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now()
+    {
+        return time_point(std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()));
+    }
+};
+
+#endif
@@ -0,0 +1,312 @@
+/**
+ * @file lowpass_bench.cpp
+ * @author Daniel Kim
+ * @brief Host benchmark of the low pass filters against the per sample coefficient version they replaced
+ * @version 0.1
+ * @date 2023-05-26
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/Sensors/LowPass.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+Three channels of mag-like counts (a sine plus a sawtooth, 155 Hz, 30 Hz cutoff) through each filter,
+best of three runs. Every filter's output is compared with ReferenceLowPass, which is LowPass as it was:
+the bilinear transform worked out again on every sample.
+The dt each sample is filtered with jitters by 0.2%, like the loop's, so the reference can't work its
+coefficients out once and keep them. The cached ones are made for the first dt, which is DT.
+LowPassFixed takes the counts as integers and is compared after scaling its Q15 output back.
+Times are from this computer. The M7 doesn't pipeline divides, so dropping them saves more there. Here
+float is no faster than double (both are SSE). On the M7, double multiplies and divides take longer than float ones.
+*/
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+/**
+ * @brief LowPass before the coefficients were cached
+ */
+template <int order>
+class ReferenceLowPass
+{
+public:
+    explicit ReferenceLowPass(double f0) : omega0(6.28318530718 * f0) {}
+
+    double filt(double xn, double dt)
+    {
+        double alpha = omega0 * dt;
+        if (order == 1)
+        {
+            a[0] = -(alpha - 2.0) / (alpha + 2.0);
+            b[0] = alpha / (alpha + 2.0);
+            b[1] = alpha / (alpha + 2.0);
+        }
+        else
+        {
+            double alphaSq = alpha * alpha;
+            double beta[] = {1, std::sqrt(2), 1};
+            double D = alphaSq * beta[0] + 2 * alpha * beta[1] + 4 * beta[2];
+            b[0] = alphaSq / D;
+            b[1] = 2 * b[0];
+            b[order] = b[0];
+            a[0] = -(2 * alphaSq * beta[0] - 8 * beta[2]) / D;
+            a[order - 1] = -(beta[0] * alphaSq - 2 * beta[1] * alpha + 4 * beta[2]) / D;
+        }
+
+        y[0] = 0;
+        x[0] = xn;
+        for (int k = 0; k < order; k++)
+        {
+            y[0] += a[k] * y[k + 1] + b[k] * x[k];
+        }
+        y[0] += b[order] * x[order];
+
+        for (int k = order; k > 0; k--)
+        {
+            y[k] = y[k - 1];
+            x[k] = x[k - 1];
+        }
+        return y[0];
+    }
+
+private:
+    double omega0;
+    double a[order] = {};
+    double b[order + 1] = {};
+    double x[order + 1] = {};
+    double y[order + 1] = {};
+};
+
+static constexpr int N = 5000000;
+static constexpr double DT = 1.0 / 155.0; // LIS3MDL at odr_155hz_uhp
+static constexpr double CUTOFF = 30.0;
+
+static std::vector<double> input(N * 3);
+static std::vector<double> dts(N); // loop dt, jittering within DT_TOLERANCE
+static std::vector<double> reference(N * 3);
+static std::vector<double> output(N * 3);
+static double reference_time = 0.0;
+
+/**
+ * @brief Times a filter over the input and checks its output against the reference
+ *
+ * @param tolerance largest difference from the reference, in counts
+ * @return double best time, ns per xyz
+ */
+template <typename Run>
+static double measure(const char *name, Run run, double tolerance)
+{
+    double best = 1e9;
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N);
+    }
+
+    double worst = 0.0;
+    for (int i = 0; i < N * 3; i++)
+    {
+        worst = std::max(worst, std::fabs(output[i] - reference[i]));
+    }
+
+    char what[128];
+    std::snprintf(what, sizeof(what), "%-28s %6.2f ns/xyz   %.2g off the reference", name, best, worst);
+    check(worst <= tolerance, what);
+    return best;
+}
+
+template <int order>
+static void benchmark()
+{
+    std::cout << "order " << order << std::endl;
+
+    double best = 1e9;
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        ReferenceLowPass<order> x(CUTOFF), y(CUTOFF), z(CUTOFF);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; i++)
+        {
+            output[3 * i] = x.filt(input[3 * i], dts[i]);
+            output[3 * i + 1] = y.filt(input[3 * i + 1], dts[i]);
+            output[3 * i + 2] = z.filt(input[3 * i + 2], dts[i]);
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N);
+    }
+    std::printf("      %-28s %6.2f ns/xyz\n", "reference, dt per sample", best);
+    reference_time = best;
+
+    //What the cached coefficients (made for the first dt, which is DT) are compared with
+    ReferenceLowPass<order> x(CUTOFF), y(CUTOFF), z(CUTOFF);
+    for (int i = 0; i < N; i++)
+    {
+        reference[3 * i] = x.filt(input[3 * i], DT);
+        reference[3 * i + 1] = y.filt(input[3 * i + 1], DT);
+        reference[3 * i + 2] = z.filt(input[3 * i + 2], DT);
+    }
+
+    double dt_time = measure("LowPass<double>, dt", []
+            {
+                Filter::LowPass<order> x(CUTOFF), y(CUTOFF), z(CUTOFF);
+                for (int i = 0; i < N; i++)
+                {
+                    output[3 * i] = x.filt(input[3 * i], dts[i]);
+                    output[3 * i + 1] = y.filt(input[3 * i + 1], dts[i]);
+                    output[3 * i + 2] = z.filt(input[3 * i + 2], dts[i]);
+                }
+            },
+            1e-9);
+
+    check(dt_time < reference_time, "a dt per sample is faster with the cached coefficients");
+
+    measure("LowPass<double>, setRate", []
+            {
+                Filter::LowPass<order> x(CUTOFF), y(CUTOFF), z(CUTOFF);
+                x.setRate(DT);
+                y.setRate(DT);
+                z.setRate(DT);
+                for (int i = 0; i < N; i++)
+                {
+                    output[3 * i] = x.filt(input[3 * i]);
+                    output[3 * i + 1] = y.filt(input[3 * i + 1]);
+                    output[3 * i + 2] = z.filt(input[3 * i + 2]);
+                }
+            },
+            1e-9);
+
+    measure("LowPass<float>, setRate", []
+            {
+                Filter::LowPass<order, float> x(CUTOFF), y(CUTOFF), z(CUTOFF);
+                x.setRate(DT);
+                y.setRate(DT);
+                z.setRate(DT);
+                for (int i = 0; i < N; i++)
+                {
+                    output[3 * i] = x.filt(static_cast<float>(input[3 * i]));
+                    output[3 * i + 1] = y.filt(static_cast<float>(input[3 * i + 1]));
+                    output[3 * i + 2] = z.filt(static_cast<float>(input[3 * i + 2]));
+                }
+            },
+            1e-3);
+
+    measure("LowPassFixed, Q15 out", []
+            {
+                Filter::LowPassFixed<order> x(CUTOFF, DT), y(CUTOFF, DT), z(CUTOFF, DT);
+                const double scale = 1.0 / (1 << Filter::LowPassFixed<order>::FRACTION_BITS);
+                for (int i = 0; i < N; i++)
+                {
+                    output[3 * i] = x.filt(static_cast<int32_t>(input[3 * i])) * scale;
+                    output[3 * i + 1] = y.filt(static_cast<int32_t>(input[3 * i + 1])) * scale;
+                    output[3 * i + 2] = z.filt(static_cast<int32_t>(input[3 * i + 2])) * scale;
+                }
+            },
+            1e-3);
+
+    measure("LowPass3<float>, setRate", []
+            {
+                Filter::LowPass3<order, float> filter(CUTOFF);
+                filter.setRate(DT);
+                for (int i = 0; i < N; i++)
+                {
+                    float xyz[3] = {static_cast<float>(input[3 * i]), static_cast<float>(input[3 * i + 1]), static_cast<float>(input[3 * i + 2])};
+                    filter.filt(xyz);
+                    output[3 * i] = xyz[0];
+                    output[3 * i + 1] = xyz[1];
+                    output[3 * i + 2] = xyz[2];
+                }
+            },
+            1e-3);
+}
+
+/**
+ * @brief dt jittering within DT_TOLERANCE keeps the cached coefficients, and the filter still settles
+ * A bigger change in dt, or a new cutoff, makes them again
+ */
+static void checkJitter()
+{
+    Filter::LowPass<1> filter(1.0);
+    double y = 0.0;
+    for (int i = 0; i < 1000; i++)
+    {
+        y = filter.filt(1.0, 0.2 * (1.0 + 0.001 * (i % 3)));
+    }
+    check(std::fabs(y - 1.0) < 1e-9, "step response settles with dt jittering by 0.2% (" + std::to_string(y) + " after 200 s)");
+
+    Filter::LowPass<2> cached(2.0);
+    ReferenceLowPass<2> reference_filter(2.0);
+    double worst = 0.0;
+    for (int i = 0; i < 300; i++)
+    {
+        double dt = i < 100 ? 0.2 : (i < 200 ? 0.1 : 0.05);
+        double xn = std::sin(i * 0.3);
+        worst = std::max(worst, std::fabs(cached.filt(xn, dt) - reference_filter.filt(xn, dt)));
+    }
+    check(worst < 1e-12, "coefficients are made again when dt changes past DT_TOLERANCE");
+
+    Filter::LowPass<1> recut(1.0);
+    recut.filt(1.0, 0.01);
+    recut.setCutoff(10.0);
+    ReferenceLowPass<1> fresh(10.0);
+    check(std::fabs(recut.filt(1.0, 0.01) - fresh.filt(1.0, 0.01)) < 1e-12, "setCutoff drops the old coefficients and state");
+}
+
+/**
+ * @brief Full scale int16 steps through the fixed point filter: no overflow, and the double filter's response
+ */
+template <int order>
+static void checkFixedRange()
+{
+    Filter::LowPassFixed<order> fixed(CUTOFF, DT);
+    Filter::LowPass<order> exact(CUTOFF);
+    exact.setRate(DT);
+
+    double worst = 0.0;
+    for (int i = 0; i < 2000; i++)
+    {
+        int32_t xn = (i / 50) % 2 == 0 ? 32767 : -32768;
+        double yn = fixed.filt(xn) / static_cast<double>(1 << Filter::LowPassFixed<order>::FRACTION_BITS);
+        worst = std::max(worst, std::fabs(yn - exact.filt(xn)));
+    }
+    check(worst < 1e-3, "LowPassFixed<" + std::to_string(order) + "> follows full scale steps within 1e-3 counts (" + std::to_string(worst) + ")");
+}
+
+int main()
+{
+    for (int i = 0; i < N * 3; i++)
+    {
+        input[i] = std::round(std::sin(i * 0.01) * 3000 + (i % 7) * 40);
+    }
+    for (int i = 0; i < N; i++)
+    {
+        dts[i] = DT * (1.0 + 0.002 * std::sin(i * 0.37));
+    }
+
+    benchmark<1>();
+    benchmark<2>();
+    checkJitter();
+    checkFixedRange<1>();
+    checkFixedRange<2>();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+/**
+ * @file periodic_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of Time::Periodic on a fake clock: first call, wraparound and value(), and a benchmark against Time::Async
+ * @version 0.1
+ * @date 2023-05-10
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/core/timed_function.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+/*
+Behaviour runs on FakeTicks, which only move when told to. The benchmark times idle tick() calls, the
+common case in the loop, against ReferenceAsync: Time::Async as it was. Best of three runs.
+Times are from this computer, where the two are within noise of each other once the clock is left out.
+On the Teensy, Async converts 600 MHz cycles to ns in 64 bit arithmetic, which the M7 does in software,
+where Periodic reads millis().
+*/
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+/**
+ * @brief Millisecond ticks that only move when told to
+ *
+ * @tparam T counter width, uint16_t wraps every 65536 ticks
+ */
+template <typename T>
+struct FakeTicks
+{
+    using tick_t = T;
+    static constexpr int64_t NS_PER_TICK = 1000000;
+
+    static T ticks;
+    static T now() { return ticks; }
+};
+
+template <typename T>
+T FakeTicks<T>::ticks = 0;
+
+using Fake32 = FakeTicks<uint32_t>;
+using Fake16 = FakeTicks<uint16_t>;
+
+static int calls = 0;
+static int last_argument = 0;
+
+static void count() { calls++; }
+static void record(int argument) { calls++; last_argument = argument; }
+static int next() { return ++calls * 10; }
+
+/**
+ * @brief Nothing until a whole period has passed, then once per period
+ */
+static void checkFirstCall()
+{
+    Fake32::ticks = 1000;
+    calls = 0;
+    Time::Periodic<10000000, void(), &count, Fake32> periodic; //10 ms
+
+    bool early = false;
+    for (Fake32::ticks = 1000; Fake32::ticks < 1010; Fake32::ticks++)
+    {
+        early |= periodic.tick();
+    }
+    check(!early && calls == 0, "no call before one period");
+
+    check(periodic.tick() && calls == 1, "first call one period after construction");
+    check(!periodic.tick() && calls == 1, "one call per period");
+
+    for (int i = 0; i < 1000; i++)
+    {
+        Fake32::ticks++;
+        periodic.tick();
+    }
+    check(calls == 101, "one call every 10 ticks over 1000 ticks (" + std::to_string(calls) + ")");
+
+    Fake32::ticks += 5;
+    periodic.reset();
+    Fake32::ticks += 9;
+    bool after_reset = periodic.tick();
+    Fake32::ticks += 1;
+    check(!after_reset && periodic.tick(), "reset starts the period over");
+}
+
+/**
+ * @brief The counter wrapping through zero doesn't delay or repeat a call
+ */
+static void checkWraparound()
+{
+    Fake32::ticks = UINT32_MAX - 4;
+    calls = 0;
+    Time::Periodic<10000000, void(int), &record, Fake32> periodic;
+
+    Fake32::ticks += 9; //wrapped to 4, one tick short
+    bool early = periodic.tick(1);
+    Fake32::ticks += 1;
+    check(!early && periodic.tick(2) && calls == 1 && last_argument == 2, "32 bit counter wrapping within a period");
+
+    //A 16 bit counter wraps every 65.5 s: run it through several wraps
+    Fake16::ticks = 65000;
+    calls = 0;
+    Time::Periodic<7000000, void(), &count, Fake16> fast; //7 ms
+    for (uint32_t i = 0; i < 300000; i++)
+    {
+        Fake16::ticks++;
+        fast.tick();
+    }
+    check(calls == 300000 / 7, "16 bit counter through five wraps (" + std::to_string(calls) + " of " + std::to_string(300000 / 7) + ")");
+}
+
+/**
+ * @brief value() holds what the last call returned
+ */
+static void checkValue()
+{
+    Fake32::ticks = 0;
+    calls = 0;
+    Time::Periodic<1000000, int(), &next, Fake32> periodic; //1 ms
+    check(periodic.value() == 0, "value() is R() before the first call");
+
+    Fake32::ticks = 1;
+    periodic.tick();
+    check(periodic.value() == 10, "value() after the first call");
+
+    periodic.tick();
+    check(periodic.value() == 10, "value() holds between calls");
+
+    Fake32::ticks = 2;
+    periodic.tick();
+    check(periodic.value() == 20, "value() after the next call");
+
+    Time::Periodic<1000000, int(), &next, Time::MillisTicks> real;
+    check(sizeof(real) == sizeof(Time::MillisTicks::tick_t) + sizeof(int), "only the tick count and the value are stored");
+    check(sizeof(Time::Periodic<1000000, void(), &count, Time::MillisTicks>) == sizeof(Time::MillisTicks::tick_t), "void functions store no value");
+}
+
+/**
+ * @brief teensy_clock without the hardware: 600 MHz cycles as 64 bit chrono ticks
+ */
+struct FakeTeensyClock
+{
+    using rep = uint64_t;
+    using period = std::ratio<1, 600000000>;
+    using duration = std::chrono::duration<rep, period>;
+    using time_point = std::chrono::time_point<FakeTeensyClock>;
+    static constexpr bool is_steady = true;
+
+    static uint64_t cycles;
+    static time_point now() { return time_point(duration(cycles)); }
+};
+
+uint64_t FakeTeensyClock::cycles = 0;
+
+/**
+ * @brief Time::Async before Periodic replaced it: a function pointer and a chrono conversion per tick
+ * Only void_tick() is timed, tick() dereferenced a return pointer that was never allocated
+ *
+ * @tparam Clock teensy_clock on the vehicle
+ */
+template <typename Clock, typename T, typename... P>
+class ReferenceAsync
+{
+public:
+    ReferenceAsync(const long interval, T (*func)(P...)) : func(func), interval(interval) { start_time = Clock::now(); }
+
+    inline int64_t elapsed()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time).count();
+    }
+
+    void void_tick(P... params)
+    {
+        if (elapsed() - previous_time >= interval && running)
+        {
+            func(params...);
+            previous_time = elapsed();
+        }
+    }
+
+private:
+    T (*func)(P...);
+
+    typename Clock::time_point start_time;
+    int64_t previous_time = 0;
+    int64_t interval;
+    bool running = true;
+};
+
+/**
+ * @brief steady_clock as Periodic ticks, so both can be timed on the same real clock
+ */
+struct SteadyTicks
+{
+    using tick_t = uint64_t;
+    static constexpr int64_t NS_PER_TICK = 1;
+
+    static inline tick_t now() { return static_cast<tick_t>(std::chrono::steady_clock::now().time_since_epoch().count()); }
+};
+
+static constexpr int N = 10000000;
+
+/**
+ * @brief Best of three, in ns per call
+ */
+template <typename Run>
+static double timeIt(Run run)
+{
+    double best = 1e9;
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N);
+    }
+    return best;
+}
+
+/**
+ * @brief Idle tick() cost for SD's 30 s flusher, which almost never fires
+ * On fake clocks that advance slowly, like millis() and the cycle counter do between loop passes, the
+ * times are what each does with the clock. On steady_clock the clock read is most of it
+ */
+static void benchmark()
+{
+    calls = 0;
+
+    FakeTeensyClock::cycles = 0;
+    ReferenceAsync<FakeTeensyClock, void> fake_async(30000000000L, &count);
+    double fake_async_ns = timeIt([&]
+                                  {
+                                      for (int i = 0; i < N; i++)
+                                      {
+                                          fake_async.void_tick();
+                                          FakeTeensyClock::cycles += 600 * ((i & 0xFFFF) == 0);
+                                      }
+                                  });
+
+    Fake32::ticks = 0;
+    Time::Periodic<30000000000LL, void(), &count, Fake32> fake_periodic;
+    double fake_periodic_ns = timeIt([&]
+                                     {
+                                         for (int i = 0; i < N; i++)
+                                         {
+                                             fake_periodic.tick();
+                                             Fake32::ticks += (i & 0xFFFF) == 0;
+                                         }
+                                     });
+
+    ReferenceAsync<std::chrono::steady_clock, void> steady_async(30000000000L, &count);
+    double steady_async_ns = timeIt([&]
+                                    {
+                                        for (int i = 0; i < N; i++)
+                                        {
+                                            steady_async.void_tick();
+                                        }
+                                    });
+
+    Time::Periodic<30000000000LL, void(), &count, SteadyTicks> steady_periodic;
+    double steady_periodic_ns = timeIt([&]
+                                       {
+                                           for (int i = 0; i < N; i++)
+                                           {
+                                               steady_periodic.tick();
+                                           }
+                                       });
+
+    std::printf("idle tick, fake clocks:  Async on 600 MHz cycles %.2f ns, Periodic on ms ticks %.2f ns\n", fake_async_ns, fake_periodic_ns);
+    std::printf("idle tick, steady_clock: Async %.2f ns, Periodic %.2f ns\n", steady_async_ns, steady_periodic_ns);
+    check(calls == 0, "nothing fires within the 30 s period");
+    check(fake_periodic_ns < 1.1 * fake_async_ns, "an idle Periodic tick is no slower than an idle Async tick, leaving out the clock read (10% for timing noise)");
+}
+
+int main()
+{
+    checkFirstCall();
+    checkWraparound();
+    checkValue();
+    benchmark();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+/**
+ * @file rx_bench.cpp
+ * @author Daniel Kim
+ * @brief Host benchmark of how GUI commands are fed to the ElectricUI parser
+ * @version 0.1
+ * @date 2023-05-10
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <electricui.h>
+
+#include "../../ground_station/src/eui_frame.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/*
+Replays command streams through eui_parse the way TransportManager's parseSpan used to (the command id
+compared after every byte) and the way it does now (compared once per message, from the interface callback).
+Streams are raw bytes as the GUI writes them to the vehicle's port, e.g. captured with
+    socat -r uplink.bin PTY,link=/tmp/vehicle /dev/ttyACM0
+Without files, two are made with the ground station's encoder: latency_probe's (psc then cid) and a GUI
+tuning session (gains, stepper speeds, then cid).
+Both loops must stamp every cid. Exits non-zero if they don't.
+*/
+
+namespace
+{
+    //Same writable variables as TransportManager's tracked_variables
+    struct Commands
+    {
+        uint8_t system_state = 0;
+        int16_t buoyancy_speed = 0;
+        int16_t buoyancy_acceleration = 0;
+        int16_t pitch_speed = 0;
+        int16_t pitch_acceleration = 0;
+        uint8_t pitch_direction = 0;
+        uint8_t recalibrate_pitch = 0;
+        uint8_t auto_pitch = 0;
+        float depth_gains[3] = {0.f};
+        float pitch_gains[3] = {0.f};
+        float hitl_scale = 0.f;
+        uint8_t sd_log_enable = 0;
+        uint16_t sd_log_interval_hz = 0;
+        uint32_t command_id[2] = {0};
+    };
+
+    Commands commands;
+
+    eui_message_t tracked_variables[] =
+    {
+        EUI_UINT8("ssc", commands.system_state),
+        EUI_INT16("bsc", commands.buoyancy_speed),
+        EUI_INT16("bac", commands.buoyancy_acceleration),
+        EUI_INT16("psc", commands.pitch_speed),
+        EUI_INT16("pac", commands.pitch_acceleration),
+        EUI_UINT8("pd", commands.pitch_direction),
+        EUI_UINT8("pr", commands.recalibrate_pitch),
+        EUI_UINT8("ap", commands.auto_pitch),
+        EUI_FLOAT_ARRAY("dg", commands.depth_gains),
+        EUI_FLOAT_ARRAY("pg", commands.pitch_gains),
+        EUI_FLOAT("hds", commands.hitl_scale),
+        EUI_UINT8("sde", commands.sd_log_enable),
+        EUI_UINT16("sdr", commands.sd_log_interval_hz),
+        EUI_UINT32_ARRAY("cid", commands.command_id),
+    };
+
+    uint32_t last_command_seq = 0;
+    uint64_t stamps = 0; //what CommandLatency::received would have been called
+
+    void stamp()
+    {
+        if (commands.command_id[0] != last_command_seq)
+        {
+            last_command_seq = commands.command_id[0];
+            stamps++;
+        }
+    }
+
+    void serial_write(uint8_t *, uint16_t) {}
+
+    void serial_callback(uint8_t message)
+    {
+        if (message == EUI_CB_TRACKED)
+        {
+            stamp();
+        }
+    }
+
+    eui_interface_t per_byte_comms = EUI_INTERFACE(&serial_write);
+    eui_interface_t callback_comms = EUI_INTERFACE_CB(&serial_write, &serial_callback);
+
+    void parsePerByte(const uint8_t *data, std::size_t len)
+    {
+        for (std::size_t i = 0; i < len; i++)
+        {
+            eui_parse(data[i], &per_byte_comms);
+            stamp();
+        }
+    }
+
+    void parseWithCallback(const uint8_t *data, std::size_t len)
+    {
+        for (std::size_t i = 0; i < len; i++)
+        {
+            eui_parse(data[i], &callback_comms);
+        }
+    }
+
+    using GroundStation::EUI::Type;
+
+    void appendCommandId(uint32_t seq, std::vector<uint8_t> &stream)
+    {
+        uint32_t id[2] = {seq, seq * 1000};
+        GroundStation::EUI::encode("cid", Type::UINT32, id, sizeof(id), stream);
+    }
+
+    std::vector<uint8_t> probeStream(uint32_t count)
+    {
+        std::vector<uint8_t> stream;
+        for (uint32_t seq = 1; seq <= count; seq++)
+        {
+            int16_t speed = seq % 2 == 0 ? 400 : 200;
+            GroundStation::EUI::encode("psc", Type::INT16, &speed, sizeof(speed), stream);
+            appendCommandId(seq, stream);
+        }
+        return stream;
+    }
+
+    std::vector<uint8_t> tuningStream(uint32_t count)
+    {
+        std::vector<uint8_t> stream;
+        for (uint32_t seq = 1; seq <= count; seq++)
+        {
+            float depth_gains[3] = {0.8f + seq * 0.001f, 0.05f, 0.3f};
+            float pitch_gains[3] = {1.2f, 0.02f + seq * 0.0001f, 0.1f};
+            int16_t speed = static_cast<int16_t>(200 + seq % 100);
+            int16_t acceleration = 500;
+            uint8_t direction = seq % 2;
+            GroundStation::EUI::encode("dg", Type::FLOAT, depth_gains, sizeof(depth_gains), stream);
+            GroundStation::EUI::encode("pg", Type::FLOAT, pitch_gains, sizeof(pitch_gains), stream);
+            GroundStation::EUI::encode("bsc", Type::INT16, &speed, sizeof(speed), stream);
+            GroundStation::EUI::encode("bac", Type::INT16, &acceleration, sizeof(acceleration), stream);
+            GroundStation::EUI::encode("psc", Type::INT16, &speed, sizeof(speed), stream);
+            GroundStation::EUI::encode("pd", Type::UINT8, &direction, sizeof(direction), stream);
+            appendCommandId(seq, stream);
+        }
+        return stream;
+    }
+
+    /**
+     * @brief Counts the cid messages in a stream, which is how many stamps each loop must make
+     * A recorded stream could repeat an id, which isn't a new command
+     */
+    uint64_t expectedStamps(const std::vector<uint8_t> &stream)
+    {
+        GroundStation::EUI::FrameParser parser(stream.size() + 1);
+        std::size_t available = 0;
+        uint8_t *buffer = parser.writable(available);
+        std::copy(stream.begin(), stream.end(), buffer);
+
+        uint64_t count = 0;
+        uint32_t last = 0;
+        parser.commit(stream.size(), [&](const GroundStation::EUI::Message &message)
+                      {
+                          uint32_t seq = 0;
+                          if (message.name() == "cid" && message.payload_len == 8)
+                          {
+                              std::copy(message.payload, message.payload + 4, reinterpret_cast<uint8_t *>(&seq));
+                              count += seq != last;
+                              last = seq;
+                          } });
+        return count;
+    }
+
+    template <typename Parse>
+    double nsPerByte(Parse parse, const std::vector<uint8_t> &stream, int repeats, uint64_t &stamped)
+    {
+        constexpr std::size_t CHUNK = 64; //RX_CHUNK_SIZE
+
+        stamps = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r++)
+        {
+            //Each pass repeats the same ids
+            commands.command_id[0] = 0;
+            last_command_seq = 0;
+            for (std::size_t i = 0; i < stream.size(); i += CHUNK)
+            {
+                parse(stream.data() + i, std::min(CHUNK, stream.size() - i));
+            }
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        stamped = stamps / repeats;
+        return elapsed / (static_cast<double>(stream.size()) * repeats);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> streams;
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file)
+        {
+            std::cout << "Error opening " << argv[i] << std::endl;
+            return 1;
+        }
+        streams.emplace_back(argv[i], std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {}));
+    }
+    if (streams.empty())
+    {
+        streams.emplace_back("probe", probeStream(5000));
+        streams.emplace_back("tuning", tuningStream(2000));
+    }
+
+    eui_setup_interface(&per_byte_comms);
+    eui_setup_interface(&callback_comms);
+    EUI_TRACK(tracked_variables);
+
+    int failures = 0;
+    for (const auto &stream : streams)
+    {
+        const int repeats = static_cast<int>(std::max<std::size_t>(1, 20000000 / (stream.second.size() + 1)));
+        uint64_t expected = expectedStamps(stream.second);
+        uint64_t per_byte_stamps = 0;
+        uint64_t callback_stamps = 0;
+
+        double per_byte = nsPerByte(parsePerByte, stream.second, repeats, per_byte_stamps);
+        double callback = nsPerByte(parseWithCallback, stream.second, repeats, callback_stamps);
+
+        bool passed = per_byte_stamps == expected && callback_stamps == expected;
+        failures += passed ? 0 : 1;
+
+        std::printf("%-10s %8zu bytes %6llu cids   per byte %6.2f ns/B   callback %6.2f ns/B   %s\n",
+                    stream.first.c_str(), stream.second.size(), static_cast<unsigned long long>(expected),
+                    per_byte, callback, passed ? "PASS" : "FAIL (missed stamps)");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file scheduler_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of Time::Scheduler on a virtual clock: ordering, overruns and jitter
+ * @version 0.1
+ * @date 2023-05-10
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/core/Scheduler.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static constexpr int64_t MS = 1000000;
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+static std::vector<char> order; //which tasks ran, in order
+static std::vector<int64_t> stamps; //the now_ns each run was handed
+
+static void taskA(int64_t now_ns) { order.push_back('a'); stamps.push_back(now_ns); }
+static void taskB(int64_t now_ns) { order.push_back('b'); stamps.push_back(now_ns); }
+static void taskC(int64_t now_ns) { order.push_back('c'); stamps.push_back(now_ns); }
+static void taskD(int64_t now_ns) { order.push_back('d'); stamps.push_back(now_ns); }
+
+static void clear()
+{
+    order.clear();
+    stamps.clear();
+}
+
+/**
+ * @brief Tasks due together run by priority, whatever order they were added in
+ */
+static void checkOrdering()
+{
+    Time::Scheduler<4> scheduler;
+    scheduler.add("c", &taskC, 20 * MS, 2);
+    scheduler.add("a", &taskA, 5 * MS, 0);
+    scheduler.add("d", &taskD, 40 * MS, 3);
+    scheduler.add("b", &taskB, 10 * MS, 1);
+
+    clear();
+    scheduler.run(0);
+    check(std::string(order.begin(), order.end()) == "abcd", "all due at once run in priority order");
+
+    clear();
+    for (int64_t now = 1 * MS; now <= 40 * MS; now += 1 * MS)
+    {
+        scheduler.run(now);
+    }
+    check(std::string(order.begin(), order.end()) == "aabaabcaabaabcd", "releases over 40 ms run in time, then priority, order (" + std::string(order.begin(), order.end()) + ")");
+
+    bool stamped = true;
+    for (int64_t stamp : stamps)
+    {
+        stamped &= stamp % (5 * MS) == 0;
+    }
+    check(stamped, "every task gets the loop timestamp");
+
+    clear();
+    scheduler.run(40 * MS);
+    check(order.empty(), "nothing runs twice for the same release");
+    check(scheduler.nextDue() == 45 * MS, "next due is the earliest release");
+}
+
+/**
+ * @brief Loops that don't land on the releases: each run is late by how far the release is from the next loop
+ */
+static void checkJitter()
+{
+    const int64_t period = 10 * MS;
+    const int64_t step = 3 * MS;
+    const int64_t end = 1000 * MS;
+
+    Time::Scheduler<1> scheduler;
+    scheduler.add("a", &taskA, period, 0);
+
+    clear();
+    for (int64_t now = 0; now <= end; now += step)
+    {
+        scheduler.run(now);
+    }
+
+    //The first loop at or after every release
+    uint32_t runs = 0;
+    int64_t total = 0;
+    int64_t worst = 0;
+    for (int64_t release = 0; release <= end; release += period)
+    {
+        int64_t start = (release + step - 1) / step * step;
+        if (start > end)
+        {
+            break;
+        }
+        runs++;
+        total += start - release;
+        worst = start - release > worst ? start - release : worst;
+    }
+
+    const Time::TaskStats &stats = scheduler.task(0).stats;
+    check(stats.runs == runs, "one run per release (" + std::to_string(stats.runs) + " of " + std::to_string(runs) + ")");
+    check(stats.overruns == 0, "late by less than a period is not an overrun");
+    check(stats.max_jitter_ns == worst && stats.total_jitter_ns == total, "max and total jitter (" + std::to_string(stats.max_jitter_ns) + " ns max)");
+    check(stats.last_jitter_ns == stamps.back() - (runs - 1) * period, "last jitter");
+}
+
+/**
+ * @brief A stalled loop counts the late start and every release it skipped, and the task runs once
+ */
+static void checkOverruns()
+{
+    Time::Scheduler<2> scheduler;
+    scheduler.add("a", &taskA, 10 * MS, 0);
+    scheduler.add("b", &taskB, 10 * MS, 1, 5 * MS); //tighter deadline than its period
+
+    clear();
+    scheduler.run(0);
+    scheduler.run(17 * MS); //a and b are 7 ms late: b's deadline is missed, a's isn't
+    check(scheduler.task(0).stats.overruns == 0 && scheduler.task(1).stats.overruns == 1, "late past the deadline is an overrun");
+
+    clear();
+    scheduler.run(65 * MS); //releases at 20 ms, 30, 40, 50 and 60 come due in one loop
+    check(order.size() == 2, "a stall runs each task once, not once per missed release");
+    check(scheduler.task(0).stats.overruns == 5, "the late start and the four skipped releases are overruns (" + std::to_string(scheduler.task(0).stats.overruns) + ")");
+    check(scheduler.task(0).stats.last_jitter_ns == 45 * MS, "jitter of the stalled run");
+    check(scheduler.nextDue() == 70 * MS, "releases stay on the period grid after a stall");
+
+    uint32_t overruns = 0;
+    int64_t max_jitter = 0;
+    scheduler.summarize(overruns, max_jitter);
+    check(overruns == 5 + 6 && max_jitter == 45 * MS, "summary totals every task");
+
+    scheduler.resetStats();
+    scheduler.summarize(overruns, max_jitter);
+    check(overruns == 0 && max_jitter == 0 && scheduler.task(0).stats.runs == 0, "stats reset");
+}
+
+/**
+ * @brief Period 0 runs every loop, and the table refuses more than its capacity
+ */
+static void checkEdges()
+{
+    Time::Scheduler<2> scheduler;
+    check(scheduler.nextDue() == INT64_MAX, "empty scheduler is never due");
+    scheduler.run(0);
+
+    scheduler.add("a", &taskA, 0, 0);
+    scheduler.add("b", &taskB, 10 * MS, 1, 0, 5 * MS);
+    check(scheduler.add("c", &taskC, 10 * MS, 2) == -1, "a full table refuses a task");
+    check(scheduler.add("d", nullptr, 10 * MS, 2) == -1, "a null function is refused");
+
+    clear();
+    for (int64_t now = 0; now < 10 * MS; now += 1 * MS)
+    {
+        scheduler.run(now);
+    }
+    check(scheduler.task(0).stats.runs == 10 && scheduler.task(0).stats.overruns == 0, "period 0 runs every loop");
+    check(scheduler.task(1).stats.runs == 1 && stamps[6] == 5 * MS && order[6] == 'b', "the first release is when it was asked for");
+}
+
+int main()
+{
+    checkOrdering();
+    checkJitter();
+    checkOverruns();
+    checkEdges();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
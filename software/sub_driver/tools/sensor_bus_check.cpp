@@ -0,0 +1,248 @@
+/**
+ * @file sensor_bus_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of the sensor bus queue and the LIS3MDL driver on SimulatedBus
+ * @version 0.1
+ * @date 2023-05-24
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include <Wire.h>
+
+#include "../src/Sensors/Bus/SensorBus.h"
+#include "../src/Sensors/Bus/SimulatedBus.h"
+#include "../src/Sensors/Bus/Lpi2cBus.h"
+#include "../src/Sensors/LIS3MDL/LIS3MDL.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/*
+SensorBus runs on SimulatedBus with a LIS3MDL modelled as a register map, so transactions take their
+wire time at 400 kHz in simulated time. The driver is the real one: LIS3MDL::requestRead queues the
+status and data burst, onRead runs from service() and takeReading() hands the sample to the loop.
+Built with tools/host for Arduino.h and Wire.h. The driver's blocking Wire calls aren't used here.
+*/
+
+TwoWire Wire;
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+static constexpr uint8_t MAG_ADDRESS = 0x1E; // SA1 high
+static constexpr uint8_t STATUS_REG = 0x27;
+static constexpr uint8_t OUT_X_L = 0x28;
+
+/**
+ * @brief LIS3MDL register map: the top bit of the register address turns on auto increment
+ */
+class SimulatedMag : public Bus::SimulatedDevice
+{
+public:
+    bool read(uint8_t reg, uint8_t *buffer, uint16_t length) override
+    {
+        bursts_without_increment += length > 1 && !(reg & 0x80);
+        return SimulatedDevice::read(reg & 0x7F, buffer, length);
+    }
+
+    bool write(uint8_t reg, const uint8_t *buffer, uint16_t length) override
+    {
+        return SimulatedDevice::write(reg & 0x7F, buffer, length);
+    }
+
+    void sample(int16_t x, int16_t y, int16_t z)
+    {
+        const int16_t values[3] = {x, y, z};
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            registers[OUT_X_L + 2 * i] = static_cast<uint8_t>(values[i] & 0xFF);
+            registers[OUT_X_L + 2 * i + 1] = static_cast<uint8_t>((values[i] >> 8) & 0xFF);
+        }
+        registers[STATUS_REG] = 0x0F; //ZYXDA and each axis
+    }
+
+    int bursts_without_increment = 0; // the real device would repeat one register
+};
+
+static int callbacks = 0;
+static void countCallback(Bus::Transaction &) { callbacks++; }
+
+static Bus::Transaction readTransaction(uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t length)
+{
+    Bus::Transaction transaction;
+    transaction.address = address;
+    transaction.reg = reg;
+    transaction.buffer = buffer;
+    transaction.length = length;
+    transaction.done = &countCallback;
+    return transaction;
+}
+
+/**
+ * @brief A read takes its wire time, and its callback waits for service()
+ */
+static void checkTiming()
+{
+    Bus::SimulatedBus simulated;
+    Bus::SensorBus bus(simulated);
+    SimulatedMag mag;
+    mag.sample(0x0201, 0x0403, 0x0605);
+    check(simulated.attach(MAG_ADDRESS, mag) && !simulated.attach(MAG_ADDRESS, mag), "one device per address");
+
+    callbacks = 0;
+    uint8_t buffer[6] = {};
+    Bus::Transaction transaction = readTransaction(MAG_ADDRESS, OUT_X_L | 0x80, buffer, sizeof(buffer));
+    check(bus.submit(transaction) && transaction.pending(), "submit queues and starts a read");
+    check(!bus.submit(transaction) && bus.rejected() == 1, "a pending transaction can't be queued again");
+
+    const int64_t duration = simulated.transferNs(transaction);
+    check(duration == 212500, "6 byte read is 85 bit times at 400 kHz (" + std::to_string(duration) + " ns)");
+
+    simulated.advance(duration - 1);
+    check(transaction.pending() && bus.service() == 0, "still on the bus a nanosecond early");
+
+    simulated.advance(duration);
+    check(transaction.status == Bus::Status::OK && callbacks == 0, "done on time, callback not run yet");
+    check(bus.service() == 1 && callbacks == 1 && buffer[0] == 0x01 && buffer[5] == 0x06, "service runs the callback with the data in place");
+}
+
+/**
+ * @brief Queued transactions run back to back in order: a write, a read with no device, a read
+ */
+static void checkChaining()
+{
+    Bus::SimulatedBus simulated;
+    Bus::SensorBus bus(simulated);
+    SimulatedMag mag;
+    simulated.attach(MAG_ADDRESS, mag);
+    mag.sample(1, 2, 3);
+
+    callbacks = 0;
+    uint8_t settings[2] = {0x62, 0x00};
+    Bus::Transaction write = readTransaction(MAG_ADDRESS, 0x20 | 0x80, settings, sizeof(settings));
+    write.write = true;
+    uint8_t nothing = 0;
+    Bus::Transaction absent = readTransaction(0x50, 0x00, &nothing, 1);
+    uint8_t buffer[6] = {};
+    Bus::Transaction read = readTransaction(MAG_ADDRESS, OUT_X_L | 0x80, buffer, sizeof(buffer));
+
+    bus.submit(write);
+    bus.submit(absent);
+    bus.submit(read);
+    check(bus.queued() == 3 && read.pending(), "three queued");
+
+    int64_t write_done = simulated.transferNs(write);
+    int64_t all_done = write_done + simulated.transferNs(absent) + simulated.transferNs(read);
+    simulated.advance(write_done);
+    check(write.status == Bus::Status::OK && absent.pending() && read.pending(), "the next starts as soon as the last one finishes");
+
+    simulated.advance(all_done);
+    check(read.status == Bus::Status::OK && simulated.busyNs() == all_done, "back to back, no gaps");
+    check(bus.service() == 3 && callbacks == 3 && bus.idle(), "every callback runs, in one service()");
+    check(mag.registers[0x20] == 0x62 && mag.registers[0x21] == 0x00, "write lands in the device's registers");
+    check(absent.status == Bus::Status::NACK && bus.failed() == 1 && bus.completed() == 2, "no device is a NACK");
+}
+
+/**
+ * @brief The queue holds CAPACITY transactions, and flush() waits for all of them
+ */
+static void checkCapacity()
+{
+    Bus::SimulatedBus simulated;
+    Bus::SensorBus bus(simulated);
+    SimulatedMag mag;
+    simulated.attach(MAG_ADDRESS, mag);
+
+    callbacks = 0;
+    uint8_t buffer[Bus::SensorBus::CAPACITY + 1] = {};
+    Bus::Transaction transactions[Bus::SensorBus::CAPACITY + 1];
+    int queued = 0;
+    for (uint8_t i = 0; i < Bus::SensorBus::CAPACITY + 1; i++)
+    {
+        transactions[i] = readTransaction(MAG_ADDRESS, STATUS_REG, &buffer[i], 1);
+        queued += bus.submit(transactions[i]) ? 1 : 0;
+    }
+    check(queued == Bus::SensorBus::CAPACITY && bus.rejected() == 1, "a full queue refuses the next transaction");
+
+    bus.flush();
+    check(bus.idle() && callbacks == Bus::SensorBus::CAPACITY, "flush finishes the queue and runs the callbacks");
+
+    Bus::Lpi2cBus lpi2c;
+    Bus::SensorBus host_bus(lpi2c);
+    Bus::Transaction failing = readTransaction(MAG_ADDRESS, STATUS_REG, buffer, 1);
+    host_bus.submit(failing);
+    host_bus.flush();
+    check(failing.status == Bus::Status::ERROR, "Lpi2cBus fails straight away off the Teensy");
+}
+
+/**
+ * @brief The driver's queued read: new data once per sample, nothing when ZYXDA is clear
+ */
+static void checkDriver()
+{
+    Bus::SimulatedBus simulated;
+    Bus::SensorBus bus(simulated);
+    SimulatedMag device;
+    simulated.attach(MAG_ADDRESS, device);
+
+    LIS3MDL mag;
+    mag.init(LIS3MDL::device_LIS3MDL, LIS3MDL::sa1_high);
+
+    device.registers[STATUS_REG] = 0x00;
+    check(mag.requestRead(bus), "requestRead queues the read");
+    bus.flush();
+    check(!mag.takeReading(), "no reading while ZYXDA is clear");
+
+    device.sample(1234, -32768, 32767);
+    mag.requestRead(bus);
+    check(mag.readPending() && !mag.requestRead(bus), "one read in flight at a time");
+    bus.flush();
+    check(mag.takeReading() && !mag.takeReading(), "one reading per completed read");
+    check(mag.m.x == 1234 && mag.m.y == -32768 && mag.m.z == 32767, "channels decoded from the burst");
+    check(device.bursts_without_increment == 0, "bursts ask for auto increment");
+
+    //The loop queues the read and carries on: the CPU only sees the callback
+    int64_t now = 1000000000;
+    simulated.advance(now);
+    device.sample(-1, 2, -3);
+    mag.requestRead(bus);
+    uint8_t burst[7];
+    int64_t wire = simulated.transferNs(readTransaction(MAG_ADDRESS, STATUS_REG | 0x80, burst, sizeof(burst)));
+    bus.service();
+    check(!mag.takeReading(), "nothing until the read is off the bus");
+    simulated.advance(now + wire - 1);
+    bus.service();
+    check(!mag.takeReading() && mag.readPending(), "a status and data burst is on the wire for its whole transfer");
+    simulated.advance(now + wire);
+    bus.service();
+    check(mag.takeReading() && mag.m.x == -1 && mag.m.z == -3, "next loop picks up the reading (" + std::to_string(wire / 1000) + " us on the wire)");
+
+    Bus::SimulatedBus empty;
+    Bus::SensorBus empty_bus(empty);
+    mag.timeoutOccurred();
+    mag.requestRead(empty_bus);
+    empty_bus.flush();
+    check(!mag.takeReading() && mag.timeoutOccurred() && mag.m.x == -1, "a failed read flags a timeout and keeps the last reading");
+}
+
+int main()
+{
+    checkTiming();
+    checkChaining();
+    checkCapacity();
+    checkDriver();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
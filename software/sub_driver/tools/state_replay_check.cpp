@@ -0,0 +1,342 @@
+/**
+ * @file state_replay_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of the state automation: event sequences replayed through StateAutomation::dispatch and TRANSITIONS
+ * @version 0.1
+ * @date 2023-05-28
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/core/StateAutomation.h"
+#include "../src/core/LoopTime.h"
+#include "../src/core/States.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+The real table (Transitions.cpp) and automation (StateAutomation.cpp) with stand-in states: each one
+logs its enter and exit, and zeroBuoyancy logs that it ran, so the order of exit, action and enter is seen.
+EXPECTED below is the state diagram written out again by hand. Every event is dispatched in every
+state and the result compared with it, then a few sequences check GUI pause and resume and the trace.
+*/
+
+using S = CurrentState;
+using E = Event;
+
+Time::LoopClock loop_clock;
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+static const char *const STATE_NAMES[STATE_COUNT] = {"INITIALIZATION", "ERROR_INDICATION", "IDLE_MODE", "DIVING_MODE", "RESURFACING"};
+static const char *const EVENT_NAMES[EVENT_COUNT] = {"HOMED", "FAULT", "GUI_PAUSE", "GUI_RESUME", "LIMIT_REACHED", "SURFACED", "DIVE_COMPLETE"};
+
+static constexpr S NONE = S::COUNT; // the event is ignored
+static constexpr S BACK = S::COUNT; // GUI_RESUME goes to the paused state, see checkPauseResume
+
+/*
+Rows are states, columns are events in the order of the Event enum:
+    HOMED, FAULT, GUI_PAUSE, GUI_RESUME, LIMIT_REACHED, SURFACED, DIVE_COMPLETE
+*/
+static const S EXPECTED[STATE_COUNT][EVENT_COUNT] = {
+    /* INITIALIZATION */ {S::DIVING_MODE, S::ERROR_INDICATION, S::IDLE_MODE, NONE, NONE, NONE, NONE},
+    /* ERROR_INDICATION */ {NONE, NONE, S::IDLE_MODE, NONE, NONE, NONE, NONE},
+    /* IDLE_MODE */ {NONE, S::ERROR_INDICATION, NONE, BACK, NONE, NONE, NONE},
+    /* DIVING_MODE */ {NONE, S::ERROR_INDICATION, S::IDLE_MODE, NONE, S::RESURFACING, NONE, S::RESURFACING},
+    /* RESURFACING */ {NONE, S::ERROR_INDICATION, S::IDLE_MODE, NONE, NONE, S::DIVING_MODE, NONE},
+};
+
+static std::vector<std::string> calls; // "enter X", "exit X", "zeroBuoyancy", in order
+
+/**
+ * @brief Logs its calls, and can raise an event from enter() like Initialization does on a failed begin
+ */
+class ReplayState : public State
+{
+public:
+    explicit ReplayState(S id) : m_id(id) {}
+
+    void enter(StateAutomation *state) override
+    {
+        calls.push_back(std::string("enter ") + STATE_NAMES[static_cast<uint8_t>(m_id)]);
+        if (raise_on_enter != E::COUNT)
+        {
+            E event = raise_on_enter;
+            raise_on_enter = E::COUNT;
+            state->dispatch(event);
+        }
+    }
+    void run(StateAutomation *) override {}
+    void exit(StateAutomation *) override { calls.push_back(std::string("exit ") + STATE_NAMES[static_cast<uint8_t>(m_id)]); }
+
+    E raise_on_enter = E::COUNT;
+
+private:
+    S m_id;
+};
+
+static ReplayState states[STATE_COUNT] = {ReplayState(S::INITIALIZATION), ReplayState(S::ERROR_INDICATION), ReplayState(S::IDLE_MODE),
+                                          ReplayState(S::DIVING_MODE), ReplayState(S::RESURFACING)};
+
+State &stateInstance(CurrentState state)
+{
+    return states[static_cast<uint8_t>(state)];
+}
+
+void zeroBuoyancy()
+{
+    calls.push_back("zeroBuoyancy");
+}
+
+static std::string name(S state)
+{
+    return static_cast<uint8_t>(state) < STATE_COUNT ? STATE_NAMES[static_cast<uint8_t>(state)] : "none";
+}
+
+/**
+ * @brief Starts a new automation and drives it into a state. Clears the call log
+ *
+ */
+static void reach(StateAutomation &automation, S state)
+{
+    automation.run(); // enters INITIALIZATION
+    switch (state)
+    {
+    case S::ERROR_INDICATION:
+        automation.dispatch(E::FAULT);
+        break;
+    case S::IDLE_MODE:
+        automation.dispatch(E::GUI_PAUSE);
+        break;
+    case S::DIVING_MODE:
+        automation.dispatch(E::HOMED);
+        break;
+    case S::RESURFACING:
+        automation.dispatch(E::HOMED);
+        automation.dispatch(E::DIVE_COMPLETE);
+        break;
+    default:
+        break;
+    }
+    calls.clear();
+}
+
+/**
+ * @brief Replays events, checking the state after each and the trace records they leave
+ *
+ * @param start state to dispatch the first event in
+ * @param events what happens, in order
+ * @param expected the state after each event
+ */
+static void replay(const std::string &what, S start, const std::vector<E> &events, const std::vector<S> &expected)
+{
+    StateAutomation automation;
+    reach(automation, start);
+
+    bool passed = automation.current() == start;
+    std::string path = name(start);
+    for (std::size_t i = 0; i < events.size(); i++)
+    {
+        S from = automation.current();
+        uint32_t count = transition_trace.count();
+        bool changed = automation.dispatch(events[i]);
+        path += std::string(" -") + EVENT_NAMES[static_cast<uint8_t>(events[i])] + "-> " + name(automation.current());
+
+        passed &= automation.current() == expected[i] && changed;
+        const TransitionRecord &record = transition_trace.latest();
+        passed &= transition_trace.count() == count + 1 && record.sequence == count + 1;
+        passed &= record.from == static_cast<uint8_t>(from) && record.to == static_cast<uint8_t>(expected[i]) &&
+                  record.event == static_cast<uint8_t>(events[i]);
+    }
+    check(passed, what + ": " + path);
+}
+
+/**
+ * @brief Every event in every state against EXPECTED: the right next state, or nothing at all and one more ignored
+ */
+static void checkTable()
+{
+    int taken = 0;
+    int ignored = 0;
+    bool passed = true;
+    for (uint8_t s = 0; s < STATE_COUNT; s++)
+    {
+        for (uint8_t e = 0; e < EVENT_COUNT; e++)
+        {
+            const S state = static_cast<S>(s);
+            const E event = static_cast<E>(e);
+            if (event == E::GUI_RESUME && state == S::IDLE_MODE)
+            {
+                continue; // BACK, see checkPauseResume
+            }
+
+            StateAutomation automation;
+            reach(automation, state);
+            uint32_t count = transition_trace.count();
+            uint32_t ignored_before = transition_trace.ignored();
+            bool changed = automation.dispatch(event);
+
+            const S expected = EXPECTED[s][e];
+            bool right;
+            if (expected == NONE)
+            {
+                right = !changed && automation.current() == state && calls.empty() &&
+                        transition_trace.count() == count && transition_trace.ignored() == ignored_before + 1;
+                ignored++;
+            }
+            else
+            {
+                right = changed && automation.current() == expected && transition_trace.count() == count + 1 &&
+                        transition_trace.ignored() == ignored_before && !calls.empty() &&
+                        calls.front() == "exit " + name(state) && calls.back() == "enter " + name(expected);
+                taken++;
+            }
+            if (!right)
+            {
+                std::cout << "      " << EVENT_NAMES[e] << " in " << STATE_NAMES[s] << " went to " << name(automation.current()) << std::endl;
+            }
+            passed &= right;
+        }
+    }
+    check(passed, std::to_string(taken) + " allowed events go where the diagram says, " + std::to_string(ignored) +
+                      " invalid ones change nothing and are counted as ignored");
+}
+
+/**
+ * @brief GUI_RESUME goes back to whatever GUI_PAUSE left, from every state that can be paused
+ */
+static void checkPauseResume()
+{
+    replay("pause and resume a dive", S::DIVING_MODE, {E::GUI_PAUSE, E::GUI_RESUME, E::DIVE_COMPLETE},
+           {S::IDLE_MODE, S::DIVING_MODE, S::RESURFACING});
+    replay("pause and resume resurfacing", S::RESURFACING, {E::GUI_PAUSE, E::GUI_RESUME, E::SURFACED},
+           {S::IDLE_MODE, S::RESURFACING, S::DIVING_MODE});
+    replay("pause and resume initialization", S::INITIALIZATION, {E::GUI_PAUSE, E::GUI_RESUME, E::HOMED},
+           {S::IDLE_MODE, S::INITIALIZATION, S::DIVING_MODE});
+    replay("pause an error, resume it", S::ERROR_INDICATION, {E::GUI_PAUSE, E::GUI_RESUME},
+           {S::IDLE_MODE, S::ERROR_INDICATION});
+    replay("a fault while paused, then pause and resume", S::DIVING_MODE, {E::GUI_PAUSE, E::FAULT, E::GUI_PAUSE, E::GUI_RESUME},
+           {S::IDLE_MODE, S::ERROR_INDICATION, S::IDLE_MODE, S::ERROR_INDICATION});
+    replay("a second dive paused and resumed", S::DIVING_MODE,
+           {E::LIMIT_REACHED, E::GUI_PAUSE, E::GUI_RESUME, E::SURFACED, E::GUI_PAUSE, E::GUI_RESUME},
+           {S::RESURFACING, S::IDLE_MODE, S::RESURFACING, S::DIVING_MODE, S::IDLE_MODE, S::DIVING_MODE});
+
+    //Ignored events while paused don't change where resume goes
+    StateAutomation automation;
+    reach(automation, S::RESURFACING);
+    automation.dispatch(E::GUI_PAUSE);
+    automation.dispatch(E::HOMED);
+    automation.dispatch(E::DIVE_COMPLETE);
+    automation.dispatch(E::GUI_PAUSE);
+    automation.dispatch(E::GUI_RESUME);
+    check(automation.current() == S::RESURFACING, "events ignored while paused don't change where GUI_RESUME goes");
+}
+
+/**
+ * @brief Only LIMIT_REACHED moves the zero, between leaving the dive and starting to resurface
+ */
+static void checkActions()
+{
+    StateAutomation automation;
+    reach(automation, S::DIVING_MODE);
+    automation.dispatch(E::LIMIT_REACHED);
+    check(calls == std::vector<std::string>{"exit DIVING_MODE", "zeroBuoyancy", "enter RESURFACING"},
+          "LIMIT_REACHED: exit, zeroBuoyancy, then enter");
+
+    StateAutomation completed;
+    reach(completed, S::DIVING_MODE);
+    completed.dispatch(E::DIVE_COMPLETE);
+    check(calls == std::vector<std::string>{"exit DIVING_MODE", "enter RESURFACING"}, "DIVE_COMPLETE resurfaces without moving the zero");
+
+    StateAutomation paused;
+    reach(paused, S::DIVING_MODE);
+    paused.dispatch(E::GUI_PAUSE);
+    paused.dispatch(E::GUI_RESUME);
+    check(calls == std::vector<std::string>{"exit DIVING_MODE", "enter IDLE_MODE", "exit IDLE_MODE", "enter DIVING_MODE"},
+          "pausing and resuming a dive doesn't move the zero");
+}
+
+/**
+ * @brief An event raised in enter() is looked up from the new state, and both transitions are traced in order
+ */
+static void checkRaisedInEnter()
+{
+    StateAutomation automation;
+    reach(automation, S::INITIALIZATION);
+    uint32_t count = transition_trace.count();
+    states[static_cast<uint8_t>(S::DIVING_MODE)].raise_on_enter = E::DIVE_COMPLETE; // ignored in INITIALIZATION
+    automation.dispatch(E::HOMED);
+
+    TransitionRecord first;
+    TransitionRecord second;
+    while (transition_trace.nextReport(first) && first.sequence != count + 1)
+    {
+    }
+    bool reported = transition_trace.nextReport(second);
+    check(automation.current() == S::RESURFACING && transition_trace.count() == count + 2 && reported &&
+              first.from == static_cast<uint8_t>(S::INITIALIZATION) && first.to == static_cast<uint8_t>(S::DIVING_MODE) &&
+              second.from == static_cast<uint8_t>(S::DIVING_MODE) && second.to == static_cast<uint8_t>(S::RESURFACING) &&
+              second.event == static_cast<uint8_t>(E::DIVE_COMPLETE),
+          "an event raised in enter() is taken from the new state, and traced after the one that entered it");
+}
+
+/**
+ * @brief The trace keeps the last CAPACITY transitions and reports them oldest first
+ */
+static void checkTrace()
+{
+    TransitionRecord record;
+    while (transition_trace.nextReport(record))
+    {
+    }
+
+    StateAutomation automation;
+    reach(automation, S::DIVING_MODE);
+    uint32_t first = transition_trace.count() + 1;
+    for (int i = 0; i < TransitionTrace::CAPACITY; i++) // two transitions each
+    {
+        automation.dispatch(E::GUI_PAUSE);
+        automation.dispatch(E::GUI_RESUME);
+    }
+    uint32_t last = transition_trace.count();
+
+    //The first half was overwritten before it could be sent (the reach() above left two unsent as well)
+    std::vector<TransitionRecord> reports;
+    while (transition_trace.nextReport(record))
+    {
+        reports.push_back(record);
+    }
+    bool in_order = reports.size() == TransitionTrace::CAPACITY && reports.front().sequence == last - TransitionTrace::CAPACITY + 1;
+    for (std::size_t i = 1; i < reports.size(); i++)
+    {
+        in_order &= reports[i].sequence == reports[i - 1].sequence + 1;
+        in_order &= reports[i].to == (reports[i].event == static_cast<uint8_t>(E::GUI_PAUSE) ? static_cast<uint8_t>(S::IDLE_MODE) : static_cast<uint8_t>(S::DIVING_MODE));
+    }
+    check(last - first + 1 == 2u * TransitionTrace::CAPACITY && in_order,
+          "after " + std::to_string(last - first + 1) + " transitions the trace reports the last " + std::to_string(TransitionTrace::CAPACITY) + " in order");
+}
+
+int main()
+{
+    checkTable();
+    checkPauseResume();
+    checkActions();
+    checkRaisedInEnter();
+    checkTrace();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
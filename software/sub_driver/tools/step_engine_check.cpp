@@ -0,0 +1,508 @@
+/**
+ * @file step_engine_check.cpp
+ * @author Daniel Kim
+ * @brief Host check of StepEngine through its simulation backend: queue refill and step timing
+ * @version 0.1
+ * @date 2023-05-16
+ *
+ * @copyright Copyright (c) 2023 OceanAI (https://github.com/daniel360kim/OceanAI)
+ *
+ */
+
+#include "../src/module/StepEngine.h"
+#include "../src/module/MotionPlanner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+The loop side is Stepper::refill's S-curve path: top each axis' queue up to LOOKAHEAD_NS from its planner.
+The interrupt side is step_engine.simulate(), called a tick at a time (advance()) so pin writes can be timed.
+Step times are compared with the planner's own intervals, added up.
+*/
+
+using Mechanics::StepEngine;
+using Mechanics::SCurvePlanner;
+
+static constexpr int64_t LOOKAHEAD_NS = 50000000; // STEP_LOOKAHEAD_NS in configuration.h
+static constexpr int64_t LOOP_NS = 1000000; // main loop period
+static constexpr double MAX_SLOWER_THAN_TRAPEZOID = 0.20; // settle time, over AccelStepper's for the same limits
+
+static int failures = 0;
+
+static void check(bool passed, const std::string &what)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << what << std::endl;
+    if (!passed)
+    {
+        failures++;
+    }
+}
+
+static const uint8_t STEP_PINS[StepEngine::AXES] = {2, 4};
+static const uint8_t DIR_PINS[StepEngine::AXES] = {3, 5};
+
+static int64_t now_ns = 0;
+
+struct PinLog
+{
+    std::vector<int64_t> steps; // time of each DIR write, which is when the position moves
+    std::vector<bool> directions;
+    std::vector<int64_t> rising;
+    std::vector<int64_t> falling;
+};
+
+static PinLog logs[StepEngine::AXES];
+
+static void writePin(uint8_t pin, bool level)
+{
+    for (uint8_t axis = 0; axis < StepEngine::AXES; axis++)
+    {
+        PinLog &log = logs[axis];
+        if (pin == DIR_PINS[axis])
+        {
+            log.steps.push_back(now_ns);
+            log.directions.push_back(level);
+        }
+        else if (pin == STEP_PINS[axis])
+        {
+            (level ? log.rising : log.falling).push_back(now_ns);
+        }
+    }
+}
+
+/**
+ * @brief Runs the interrupt for duration_ns, a tick at a time so pin writes get their time
+ *
+ */
+static void advance(int64_t duration_ns)
+{
+    for (int64_t elapsed = 0; elapsed < duration_ns; elapsed += StepEngine::TICK_NS)
+    {
+        step_engine.simulate(StepEngine::TICK_NS);
+        now_ns += StepEngine::TICK_NS;
+    }
+}
+
+static void reset()
+{
+    now_ns = 0;
+    for (uint8_t axis = 0; axis < StepEngine::AXES; axis++)
+    {
+        step_engine.setPosition(axis, 0);
+        step_engine.setActive(axis, false);
+        logs[axis] = PinLog();
+    }
+}
+
+static Mechanics::MotionLimits limits(double speed, double acceleration)
+{
+    Mechanics::MotionLimits result;
+    result.max_speed = speed;
+    result.max_acceleration = acceleration;
+    result.max_jerk = acceleration / 0.1;
+    return result;
+}
+
+/**
+ * @brief Stepper::refill for one axis
+ *
+ */
+static void refill(uint8_t axis, SCurvePlanner &planner)
+{
+    uint64_t interval_ns;
+    bool direction;
+    while (step_engine.space(axis) > 0 && step_engine.queuedNs(axis) < LOOKAHEAD_NS && planner.nextStep(interval_ns, direction))
+    {
+        step_engine.push(axis, interval_ns, direction);
+    }
+    step_engine.setActive(axis, !planner.done());
+}
+
+/**
+ * @brief Runs the loop every LOOP_NS (or after a stall) until every planned step has been taken
+ *
+ * @param stall_at when the loop stalls once, -1 for never
+ * @param stall_ns how long it stalls
+ * @param min_queued least motion queued right after a refill, while the plan had more than that left
+ */
+static void run(SCurvePlanner planners[], int64_t stall_at, int64_t stall_ns, int64_t &min_queued)
+{
+    min_queued = INT64_MAX;
+    int64_t next_loop = 0;
+    bool stalled = false;
+    while (true)
+    {
+        if (now_ns >= next_loop)
+        {
+            bool idle = true;
+            for (uint8_t axis = 0; axis < StepEngine::AXES; axis++)
+            {
+                refill(axis, planners[axis]);
+                if (!planners[axis].done() && step_engine.space(axis) > 0)
+                {
+                    min_queued = std::min(min_queued, step_engine.queuedNs(axis));
+                }
+                idle &= planners[axis].done() && step_engine.position(axis) == planners[axis].position();
+            }
+            if (idle)
+            {
+                advance(StepEngine::MIN_INTERVAL_TICKS * StepEngine::TICK_NS); //the last step's pulses
+                return;
+            }
+
+            next_loop += LOOP_NS;
+            if (!stalled && stall_at >= 0 && now_ns >= stall_at)
+            {
+                next_loop += stall_ns;
+                stalled = true;
+            }
+        }
+
+        advance(StepEngine::TICK_NS);
+    }
+}
+
+/**
+ * @brief Worst difference between when each step happened and when the planner put it
+ *
+ */
+static int64_t worstTimingError(const PinLog &log, long start, long target, const Mechanics::MotionLimits &motion)
+{
+    SCurvePlanner reference;
+    reference.plan(start, target, 0.0, 0.0, motion);
+
+    //Relative to the first step, whose absolute time depends on when the loop first ran
+    uint64_t interval_ns;
+    bool direction;
+    int64_t planned = 0;
+    int64_t first = -1;
+    int64_t worst = 0;
+    std::size_t step = 0;
+    while (reference.nextStep(interval_ns, direction))
+    {
+        planned += static_cast<int64_t>(interval_ns);
+        if (step >= log.steps.size())
+        {
+            return INT64_MAX;
+        }
+        if (first < 0)
+        {
+            first = planned;
+        }
+        worst = std::max<int64_t>(worst, std::llabs((log.steps[step] - log.steps[0]) - (planned - first)));
+        step++;
+    }
+    return step == log.steps.size() ? worst : INT64_MAX;
+}
+
+/**
+ * @brief One pulse train per step: PULSES_PER_STEP high pulses one tick wide, starting the tick after DIR
+ *
+ */
+static bool pulsesValid(const PinLog &log)
+{
+    if (log.rising.size() != log.steps.size() * StepEngine::PULSES_PER_STEP || log.falling.size() != log.rising.size())
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < log.rising.size(); i++)
+    {
+        if (log.falling[i] - log.rising[i] != StepEngine::TICK_NS)
+        {
+            return false;
+        }
+        if (i % StepEngine::PULSES_PER_STEP == 0 && log.rising[i] - log.steps[i / StepEngine::PULSES_PER_STEP] != StepEngine::TICK_NS)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Walk
+{
+    long steps = 0;
+    long end = 0;
+    double time = 0.0; // s
+    double peak_velocity = 0.0; // steps/s, either way
+    double peak_acceleration = 0.0; // steps/s^2, either way
+    double worst_jerk = 0.0; // change in acceleration over a step, against what the jerk limit allows in it
+};
+
+/**
+ * @brief Plans a move step by step the way Stepper::refill does: replanning from the planner's velocity
+ * and acceleration when the target changes, and again after a stop past the target
+ *
+ * @param retargets (step, new target) pairs, in step order
+ */
+static Walk walk(long target, const Mechanics::MotionLimits &motion, const std::vector<std::pair<long, long>> &retargets)
+{
+    SCurvePlanner planner;
+    planner.plan(0, target, 0.0, 0.0, motion);
+
+    Walk result;
+    std::size_t next = 0;
+    double acceleration = 0.0;
+    uint64_t interval_ns;
+    bool direction;
+    while (result.steps < 1000000)
+    {
+        if (next < retargets.size() && result.steps == retargets[next].first)
+        {
+            target = retargets[next++].second;
+            planner.plan(planner.position(), target, planner.velocity(), planner.acceleration(), motion);
+        }
+        else if (planner.done() && planner.position() != target)
+        {
+            planner.plan(planner.position(), target, planner.velocity(), planner.acceleration(), motion);
+        }
+
+        if (!planner.nextStep(interval_ns, direction))
+        {
+            break;
+        }
+        result.steps++;
+        result.time += interval_ns * 1e-9;
+
+        double previous = acceleration;
+        acceleration = planner.acceleration();
+        result.peak_velocity = std::max(result.peak_velocity, std::fabs(planner.velocity()));
+        result.peak_acceleration = std::max(result.peak_acceleration, std::fabs(acceleration));
+        result.worst_jerk = std::max(result.worst_jerk, std::fabs(acceleration - previous) / (motion.max_jerk * (interval_ns + 1) * 1e-9));
+    }
+    result.end = planner.position();
+    return result;
+}
+
+/**
+ * @brief Time AccelStepper's trapezoid takes for a move with the same speed and acceleration limits
+ *
+ */
+static double trapezoidTime(long distance, const Mechanics::MotionLimits &motion)
+{
+    double d = std::fabs(static_cast<double>(distance));
+    double v = motion.max_speed;
+    double a = motion.max_acceleration;
+    return d >= v * v / a ? d / v + v / a : 2.0 * std::sqrt(d / a);
+}
+
+/**
+ * @brief Every move keeps to its limits, takes one step per step of distance and settles close to the trapezoid
+ * The jerk limit costs about a jerk time (0.1 s here) per move. On a move of a few hundred steps that's more than
+ * MAX_SLOWER_THAN_TRAPEZOID (200 steps at 2000/s, 4000/s/s settle 25% later), so these are the carriages' longer moves
+ */
+static void checkLimits()
+{
+    struct Case
+    {
+        long distance;
+        double speed;
+        double acceleration;
+    };
+    const Case cases[] = {
+        {3000, 2000.0, 4000.0}, // buoyancy in checkMove
+        {-700, 800.0, 1500.0}, // pitch in checkMove
+        {20000, 2000.0, 4000.0},
+        {-12000, 1200.0, 800.0},
+        {500, 2000.0, 4000.0}, // no cruise
+    };
+
+    for (const Case &c : cases)
+    {
+        const Mechanics::MotionLimits motion = limits(c.speed, c.acceleration);
+        SCurvePlanner planner;
+        planner.plan(0, c.distance, 0.0, 0.0, motion);
+        Walk result = walk(c.distance, motion, {});
+        double trapezoid = trapezoidTime(c.distance, motion);
+        double slower = result.time / trapezoid - 1.0;
+
+        char what[200];
+        std::snprintf(what, sizeof(what), "%6ld steps at %.0f/s, %.0f/s/s: peak %.0f/s, %.0f/s/s, settles %.3f s, %.1f%% after the trapezoid",
+                      c.distance, c.speed, c.acceleration, result.peak_velocity, result.peak_acceleration, result.time, 100.0 * slower);
+        check(std::fabs(planner.peakVelocity()) <= motion.max_speed && result.peak_velocity <= motion.max_speed &&
+                  result.peak_acceleration <= motion.max_acceleration * (1.0 + 1e-9) &&
+                  result.steps == std::labs(c.distance) && result.end == c.distance &&
+                  slower >= 0.0 && slower < MAX_SLOWER_THAN_TRAPEZOID,
+              what);
+    }
+}
+
+/**
+ * @brief Replanning mid-move keeps the acceleration continuous: it never changes faster than the jerk limit
+ */
+static void checkReplan()
+{
+    const Mechanics::MotionLimits motion = limits(2000.0, 4000.0);
+    struct Case
+    {
+        const char *name;
+        long step;
+        long target;
+    };
+    const Case cases[] = {
+        {"while the acceleration ramps up", 4, 3000},
+        {"at full acceleration, further", 100, 8000},
+        {"at full acceleration, behind", 100, -1000},
+        {"as the acceleration ramps down", 550, 1000},
+        {"at cruise, nearer than the stop distance", 3000, 3200},
+        {"while slowing down, further", 4700, 6000},
+    };
+
+    for (const Case &c : cases)
+    {
+        Walk result = walk(5000, motion, {{c.step, c.target}});
+        char what[160];
+        std::snprintf(what, sizeof(what), "replan %s: ends on %ld, acceleration changes at most %.3f of the jerk limit",
+                      c.name, c.target, result.worst_jerk);
+        check(result.end == c.target && result.peak_acceleration <= motion.max_acceleration * (1.0 + 1e-9) && result.worst_jerk <= 1.001, what);
+    }
+}
+
+/**
+ * @brief Both axes through a full move at a steady loop: positions, pulses and timing
+ */
+static void checkMove()
+{
+    reset();
+    const Mechanics::MotionLimits buoyancy = limits(2000.0, 4000.0);
+    const Mechanics::MotionLimits pitch = limits(800.0, 1500.0);
+
+    SCurvePlanner planners[StepEngine::AXES];
+    planners[0].plan(0, 3000, 0.0, 0.0, buoyancy);
+    planners[1].plan(0, -700, 0.0, 0.0, pitch);
+
+    uint32_t underruns = step_engine.underruns();
+    int64_t min_queued;
+    run(planners, -1, 0, min_queued);
+
+    check(step_engine.position(0) == 3000 && step_engine.position(1) == -700, "both axes end on their targets");
+    check(logs[0].steps.size() == 3000 && logs[1].steps.size() == 700, "one DIR write per step");
+
+    bool directions = true;
+    for (bool level : logs[0].directions)
+    {
+        directions &= level;
+    }
+    for (bool level : logs[1].directions)
+    {
+        directions &= !level;
+    }
+    check(directions, "DIR matches the direction of every step");
+    check(pulsesValid(logs[0]) && pulsesValid(logs[1]), "three one-tick pulses per step, the tick after DIR");
+
+    int64_t buoyancy_error = worstTimingError(logs[0], 0, 3000, buoyancy);
+    int64_t pitch_error = worstTimingError(logs[1], 0, -700, pitch);
+    check(buoyancy_error < StepEngine::TICK_NS && pitch_error < StepEngine::TICK_NS, "step times within a tick of the plan (" + std::to_string(std::max(buoyancy_error, pitch_error)) + " ns worst)");
+
+    check(min_queued >= LOOKAHEAD_NS - LOOP_NS, "each refill tops the queue up to the lookahead (" + std::to_string(min_queued / 1000) + " us least)");
+    check(step_engine.underruns() == underruns, "no underruns at a steady loop");
+}
+
+/**
+ * @brief A stall shorter than the lookahead is covered by the queue, a longer one is an underrun
+ */
+static void checkStalls()
+{
+    const Mechanics::MotionLimits motion = limits(1000.0, 2000.0);
+    SCurvePlanner planners[StepEngine::AXES];
+    int64_t min_queued;
+
+    reset();
+    planners[0].plan(0, 2000, 0.0, 0.0, motion);
+    planners[1].plan(0, 0, 0.0, 0.0, motion);
+    uint32_t underruns = step_engine.underruns();
+    run(planners, 500000000, 40000000, min_queued);
+    int64_t error = worstTimingError(logs[0], 0, 2000, motion);
+    check(step_engine.underruns() == underruns && error < StepEngine::TICK_NS, "a 40 ms stall at cruise doesn't disturb the steps");
+
+    reset();
+    planners[0].plan(0, 2000, 0.0, 0.0, motion);
+    planners[1].plan(0, 0, 0.0, 0.0, motion);
+    underruns = step_engine.underruns();
+    run(planners, 500000000, 80000000, min_queued);
+    check(step_engine.underruns() == underruns + 1 && step_engine.position(0) == 2000, "an 80 ms stall is one underrun, and the move still finishes");
+}
+
+/**
+ * @brief Flushing drops the queue: no steps after it, and the accounting starts over
+ */
+static void checkFlush()
+{
+    reset();
+    SCurvePlanner planner;
+    planner.plan(0, 5000, 0.0, 0.0, limits(2000.0, 4000.0));
+    refill(0, planner);
+    for (int i = 0; i < 20000; i++) //200 ms
+    {
+        advance(StepEngine::TICK_NS);
+        if (i % 100 == 0)
+        {
+            refill(0, planner);
+        }
+    }
+
+    step_engine.flush(0);
+    step_engine.setActive(0, false);
+    int32_t position = step_engine.position(0);
+    check(step_engine.queuedNs(0) == 0 && step_engine.space(0) == StepEngine::QUEUE_SIZE, "flush empties the queue");
+
+    advance(10000000);
+    check(step_engine.position(0) == position && position > 0, "no steps after a flush");
+
+    bool pushed = true;
+    for (uint16_t i = 0; i < StepEngine::QUEUE_SIZE; i++)
+    {
+        pushed &= step_engine.push(0, 1000000, true);
+    }
+    check(pushed && !step_engine.push(0, 1000000, true), "the queue takes QUEUE_SIZE steps and refuses the next");
+    step_engine.flush(0);
+}
+
+/**
+ * @brief Intervals that aren't whole ticks average out, and short ones are stretched to fit the pulses
+ */
+static void checkRounding()
+{
+    reset();
+    for (int i = 0; i < 100; i++)
+    {
+        step_engine.push(0, 123456, true); //12.3456 ticks
+    }
+    step_engine.setActive(0, true);
+    advance(100 * 123456 + StepEngine::TICK_NS);
+    int64_t span = logs[0].steps.back() - logs[0].steps.front();
+    check(logs[0].steps.size() == 100 && std::llabs(span - 99LL * 123456) < StepEngine::TICK_NS, "fractional intervals keep their average rate (" + std::to_string(span - 99LL * 123456) + " ns off)");
+
+    reset();
+    step_engine.push(0, 1000, true);
+    step_engine.push(0, 1000, true);
+    advance(StepEngine::MIN_INTERVAL_TICKS * StepEngine::TICK_NS * 3);
+    check(logs[0].steps.size() == 2 && logs[0].steps[1] - logs[0].steps[0] == StepEngine::MIN_INTERVAL_TICKS * StepEngine::TICK_NS, "intervals shorter than the pulses are stretched");
+    step_engine.setActive(0, false);
+}
+
+int main()
+{
+    for (uint8_t axis = 0; axis < StepEngine::AXES; axis++)
+    {
+        step_engine.attach(axis, STEP_PINS[axis], DIR_PINS[axis]);
+    }
+    step_engine.begin(&writePin);
+
+    checkMove();
+    checkLimits();
+    checkReplan();
+    checkStalls();
+    checkFlush();
+    checkRounding();
+
+    std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}